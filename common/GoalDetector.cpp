@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include <iomanip>
 #include <opencv2/highgui/highgui.hpp>
 #include "GoalDetector.hpp"
@@ -17,7 +20,9 @@ GoalDetector::GoalDetector(const cv::Point2f &fov_size, const cv::Size &frame_si
 	_otsu_threshold(5),
 	_blue_scale(90),
 	_red_scale(80),
-	_camera_angle(390) // in tenths of a degree
+	_camera_angle(390), // in tenths of a degree
+	_exhaustive_pair_search(false),
+	_full_frame_threshold(-1)
 {
 	if (gui)
 	{
@@ -35,7 +40,7 @@ GoalDetector::GoalDetector(const cv::Point2f &fov_size, const cv::Size &frame_si
 // Values around 0.5 are good. Values away from that are progressively
 // worse.  Wrap stuff above 0.5 around 0.5 so the range
 // of values go from 0 (bad) to 0.5 (good).
-float GoalDetector::createConfidence(float expectedVal, float expectedStddev, float actualVal)
+float GoalDetector::createConfidence(float expectedVal, float expectedStddev, float actualVal) const
 {
 	pair<float,float> expectedNormal(expectedVal, expectedStddev);
 	float confidence = zv_utils::normalCFD(expectedNormal, actualVal);
@@ -47,222 +52,378 @@ float GoalDetector::createConfidence(float expectedVal, float expectedStddev, fl
 // boiler vision target.  If found, save the 
 // location of it
 void GoalDetector::findBoilers(const cv::Mat& image, const cv::Mat& depth) {
-	//ObjectType(6) == piece of tape
 	clear();
-	const vector<vector<Point>> goal_contours = getContours(image);
-	if (goal_contours.size() == 0)
-		return;
-	const vector<DepthInfo> goal_depths = getDepths(depth,goal_contours, TOP_TAPE_2017, ObjectType(TOP_TAPE_2017).real_height());
+	_frame.image = image;
+	_frame.depth = depth;
+	if (thresholdStage(_frame) && measureStage(_frame))
+		pairStage(_frame);
 
+	_isValid         = _frame.valid;
+	if (_isValid)
+	{
+		_goal_pos        = _frame.goal_pos;
+		_dist_to_goal    = _frame.dist_to_goal;
+		_angle_to_goal   = _frame.angle_to_goal;
+		_goal_left_rect  = _frame.goal_left_rect;
+		_goal_right_rect = _frame.goal_right_rect;
+	}
+}
 
-	//compute confidences for both the left piece of 
-	//tape and the right piece of tape
-	const vector<GoalInfo> left_info = getInfo(goal_contours,goal_depths,TOP_TAPE_2017);
-	if(left_info.size() == 0)
-		return;
-	const vector<GoalInfo> right_info = getInfo(goal_contours,goal_depths,TOP_TAPE_2017);
-	if(right_info.size() == 0)
-		return;
+// Threshold the frame and find contours in it, or just the
+// parts of it in frame.search_windows if there are any.
+// Returns false if there's nothing to look at
+bool GoalDetector::thresholdStage(GoalFrame &frame) const
+{
+	frame.clearResults();
+	const Rect full(Point(0, 0), frame.image.size());
+	const vector<Rect> full_frame(1, full);
+	const bool windowed = !frame.search_windows.empty();
+
+	// Outside of the search windows the threshold image is left blank
+	frame.threshold_image.create(frame.image.size(), CV_8UC1);
+	if (windowed)
+		frame.threshold_image.setTo(Scalar(0));
+
+	// Look for parts the the image which are within the
+	// expected bright green color range
+	vector<Rect> windows;
+	const vector<Rect> &search = windowed ? frame.search_windows : full_frame;
+	for (size_t i = 0; i < search.size(); i++)
+	{
+		const Rect window(search[i] & full);
+		if (window.area() <= 0)
+			continue;
+		generateAddSubtract(frame, window);
+		windows.push_back(window);
+	}
+	if (windows.empty())
+		return false;
+
+	// Binarize with the same threshold everywhere, see otsuThreshold
+	const double threshold_value = otsuThreshold(frame, windows, windowed);
 #ifdef VERBOSE
-	cout << left_info.size() << " left goals found and " << right_info.size() << " right" << endl;	
+	cout << "OTSU THRESHOLD " << threshold_value << endl;
 #endif
+	// If the threshold is too low, it means the image is really dark
+	// and the threshold image will be mostly noise. In that case,
+	// skip processing it entirely
+	if (threshold_value < _otsu_threshold)
+		return false;
 
-	int best_result_index_left = 0;
-	int best_result_index_right = 0;
-	bool found_goal = false;
-	//loop through every combination of left and right goal and check for the following conditions:
-	//left is actually to the left of right
-	//confidences are higher than any previous one
-	for(size_t i = 0; i < left_info.size(); i++) {
-		for(size_t j = 0; j < right_info.size(); j++) {
-#ifdef VERBOSE_BOILER
-			cout << i << " " << j << " ij" << endl;
+	vector< vector< Point > > window_contours;
+	vector< Vec4i > window_hierarchy;
+	for (size_t i = 0; i < windows.size(); i++)
+	{
+		const Rect &window = windows[i];
+		Mat image_out(frame.threshold_image(window));
+		if (windowed)
+			threshold(image_out, image_out, threshold_value, 255., CV_THRESH_BINARY);
+		if (countNonZero(image_out) == 0)
+			continue;
+
+		// find contours in the thresholded image - these will be blobs
+		// of green to check later on to see how well they match the
+		// expected shape of the goal
+		// Note : findContours modifies the input mat, so work on
+		// a copy to keep threshold_image around for debugging
+		image_out.copyTo(frame.contour_scratch);
+		if (!windowed)
+		{
+			findContours(frame.contour_scratch, frame.contours, frame.hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));
+			break;
+		}
+		findContours(frame.contour_scratch, window_contours, window_hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, window.tl());
+
+		// Hierarchy entries index into this window's contours, shift
+		// them to where those contours end up in frame.contours
+		const int offset = frame.contours.size();
+		for (size_t j = 0; j < window_hierarchy.size(); j++)
+			for (int k = 0; k < 4; k++)
+				if (window_hierarchy[j][k] >= 0)
+					window_hierarchy[j][k] += offset;
+		frame.contours.insert(frame.contours.end(), window_contours.begin(), window_contours.end());
+		frame.hierarchy.insert(frame.hierarchy.end(), window_hierarchy.begin(), window_hierarchy.end());
+	}
+	return !frame.contours.empty();
+}
+
+// Otsu's method picks the value splitting the grayscale image into
+// black and white which best separates the two. Search windows are
+// mostly target, so running it on each window on its own gives a
+// different split than the full frame would, and one which changes as
+// the window moves. Instead each full frame's value is kept and used
+// for the windowed frames after it. Before the first full frame, Otsu
+// is run once over all of the windows together
+double GoalDetector::otsuThreshold(GoalFrame &frame, const vector<Rect> &windows, bool windowed) const
+{
+	if (!windowed)
+	{
+		// Binarizes the full frame as well
+		_full_frame_threshold = threshold(frame.threshold_image, frame.threshold_image, 0., 255., CV_THRESH_BINARY | CV_THRESH_OTSU);
+		return _full_frame_threshold;
+	}
+	if (_full_frame_threshold >= 0)
+		return _full_frame_threshold;
+
+	int total = 0;
+	for (size_t i = 0; i < windows.size(); i++)
+		total += windows[i].area();
+	Mat gathered(1, total, CV_8UC1);
+	uchar *out = gathered.ptr<uchar>(0);
+	for (size_t i = 0; i < windows.size(); i++)
+	{
+		const Mat window(frame.threshold_image(windows[i]));
+		for (int y = 0; y < window.rows; y++)
+		{
+			memcpy(out, window.ptr<uchar>(y), window.cols);
+			out += window.cols;
+		}
+	}
+	return threshold(gathered, gathered, 0., 255., CV_THRESH_BINARY | CV_THRESH_OTSU);
+}
+
+// Depth and confidence for each contour. Returns false
+// if there aren't enough candidates to make a goal
+bool GoalDetector::measureStage(GoalFrame &frame) const
+{
+	//ObjectType(6) == piece of tape
+	frame.depths = getDepths(frame, TOP_TAPE_2017, ObjectType(TOP_TAPE_2017).real_height());
+
+	//compute confidences for each candidate piece of tape.
+	//Any of them could be either the left or right piece
+	frame.goal_info = getInfo(frame.contours, frame.depths, TOP_TAPE_2017);
+#ifdef VERBOSE
+	cout << frame.goal_info.size() << " candidate goals found" << endl;
 #endif
-			// Index of the contour corrsponding to
-			// left and right goal. Since we filter out
-			// some contours prior to testing goal data
-			// these can be different than i&j
-			int left_vindex = left_info[i].vec_index;
-			int right_vindex = right_info[j].vec_index;
-			if (left_vindex == right_vindex)
+	return frame.goal_info.size() >= 2;
+}
+
+// Pick the best pair of candidates as the goal
+void GoalDetector::pairStage(GoalFrame &frame) const
+{
+	frame.valid = false;
+	const vector<GoalInfo> &goal_info = frame.goal_info;
+	if(goal_info.size() < 2)
+		return;
+
+	//sort candidates left to right on the screen so
+	//only ones close enough horizontally get paired up
+	vector<size_t> order(goal_info.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	sort(order.begin(), order.end(), [&goal_info](size_t a, size_t b) {
+		if (goal_info[a].com.x != goal_info[b].com.x)
+			return goal_info[a].com.x < goal_info[b].com.x;
+		return goal_info[a].vec_index < goal_info[b].vec_index;
+	});
+
+	int max_width = 0;
+	float max_confidence = 0;
+	for (const auto &gi : goal_info)
+	{
+		max_width = max(max_width, gi.br.width);
+		max_confidence = max(max_confidence, gi.confidence);
+	}
+
+	//a pair at or below _min_valid_confidence is never used, so
+	//start with that as the combined confidence to beat
+	size_t best_result_index_left = 0;
+	size_t best_result_index_right = 0;
+	float best_confidence = _min_valid_confidence;
+	bool found_goal = false;
+	for(size_t i = 0; i < order.size(); i++) {
+		const GoalInfo &left = goal_info[order[i]];
+		//nothing paired with this one can beat the best so far
+		if (!_exhaustive_pair_search && (left.confidence + max_confidence < best_confidence))
+			continue;
+
+		//isBoilerPair's screen distance check limits how far
+		//apart in x the centers can be
+		const int max_dx = 2 * (left.br.width + max_width);
+		for(size_t j = i + 1; j < order.size(); j++) {
+			const GoalInfo &right = goal_info[order[j]];
+			if (!_exhaustive_pair_search)
 			{
+				if ((right.com.x - left.com.x) > max_dx)
+					break;
+				if ((left.confidence + right.confidence) < best_confidence)
+					continue;
+			}
+			if (!isBoilerPair(left, right))
+				continue;
+
+			// If this is the first valid pair
+			// or if this pair has a higher combined
+			// confidence than the previously saved
+			// pair, keep it as the best result
+			const float confidence = left.confidence + right.confidence;
+			if(found_goal ? (confidence >= best_confidence) : (confidence > best_confidence)) {
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << left_vindex << " " << right_vindex << " same contour" << endl;
+				cout << left.vec_index << " " << right.vec_index << " found a better goal!" << endl;
 #endif
-				continue;
+				found_goal = true;
+				best_confidence = confidence;
+				best_result_index_left = order[i];
+				best_result_index_right = order[j];
 			}
-#ifdef VERBOSE_BOILER
-			cout << left_info[i].vec_index << " " << right_info[j].vec_index << " cidx" << endl;
+		}
+	}
+
+	//say a goal is found if the sum of the confidences is higher than _min_valid_confidence
+	if(found_goal) {
+		const GoalInfo &left = goal_info[best_result_index_left];
+		const GoalInfo &right = goal_info[best_result_index_right];
+#ifdef VERBOSE
+		cout << "Top distance: " << left.distance << " Bottom distance: " << right.distance << endl;
+		cout << "Top position: " << left.pos << " Bottom position: " << right.pos << endl;
+		cout << "Top confidence: " << left.confidence << " Bottom confidence: " << right.confidence << endl;
+		cout << "Found Goal: " << found_goal << " " << left.distance << " " << left.angle << endl;
+		cout << "Found goal with confidence: " << left.confidence + right.confidence << endl;
 #endif
-			
+		//_pastRects.push_back(SmartRect(left.rect));
+		
+		// Use data from the contour which has
+		// good depth data
+		// If neither do, do the best we can
+		const GoalInfo *gi;
+		if (right.depth_error)
+			gi = &left;
+		else
+			gi = &right;
+
+		frame.goal_pos        = gi->pos;
+		frame.dist_to_goal    = gi->distance; 
+		frame.angle_to_goal   = gi->angle;
+		frame.goal_left_rect  = left.rect;
+		frame.goal_right_rect = right.rect;
+		frame.valid           = true;
+	}
+}
 
-			// Make sure the goal parts are reasonably close 
-			// together on the screen and proportionally accurate to the tapes.
-			const float screendx = left_info[i].com.x - right_info[j].com.x;
-			const float screendy = left_info[i].com.y - right_info[j].com.y;
-			const float screenDist = sqrtf(screendx * screendx + screendy * screendy);
 
-			if (screenDist > (2 * (left_info[i].br.width + right_info[i].br.width)))
-			{
+// Geometry checks for two candidates being the two pieces of
+// tape on the boiler. None of the checks depend on which of the
+// two is passed as left or right
+bool GoalDetector::isBoilerPair(const GoalInfo &left, const GoalInfo &right) const
+{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << screenDist << " screen dist check failed" << endl;
+	const size_t i = left.vec_index;
+	const size_t j = right.vec_index;
+	cout << i << " " << j << " ij" << endl;
 #endif
-				continue;
-			}
 
-			Rect leftBr = left_info[i].br;
-			Rect rightBr = right_info[j].br;
+	// Make sure the goal parts are reasonably close 
+	// together on the screen and proportionally accurate to the tapes.
+	const float screendx = left.com.x - right.com.x;
+	const float screendy = left.com.y - right.com.y;
+	const float screenDist = sqrtf(screendx * screendx + screendy * screendy);
 
+	if (screenDist > (2 * (left.br.width + right.br.width)))
+	{
 #ifdef VERBOSE_BOILER
-			cout << leftBr << " " << rightBr << endl;
+		cout << i << " " << j << " " << screenDist << " screen dist check failed" << endl;
 #endif
+		return false;
+	}
 
-			// Make sure the two contours are
-			// similar in size
-			const float area_ratio = (float)leftBr.area() / rightBr.area();
-			const float max_area_ratio = 2.5;
-			if ((area_ratio > max_area_ratio) || (area_ratio < (1 / max_area_ratio)))
-			{
-#ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << area_ratio << " screen area ratio failed" << endl;
-#endif
-				continue;
-			}
+	const Rect &leftBr = left.br;
+	const Rect &rightBr = right.br;
 
-			// Make sure the right contour overlaps at least
-			// part of the left contour
-			if ((leftBr.br().y - (leftBr.width/2)) < rightBr.y)
-			{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 1 failed" << endl;
+	cout << leftBr << " " << rightBr << endl;
 #endif
-				continue;
-			}
 
-			if ((leftBr.y + (leftBr.width/2)) > rightBr.br().y)
-			{
+	// Make sure the two contours are
+	// similar in size
+	const float area_ratio = (float)leftBr.area() / rightBr.area();
+	const float max_area_ratio = 2.5;
+	if ((area_ratio > max_area_ratio) || (area_ratio < (1 / max_area_ratio)))
+	{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 2 failed" << endl;
+		cout << i << " " << j << " " << area_ratio << " screen area ratio failed" << endl;
 #endif
-				continue;
-			}
+		return false;
+	}
 
-			// Make sure the left contour overlaps at least
-			// part of the right contour
-			if ((rightBr.br().y - (rightBr.width/2)) < leftBr.y)
-			{
+	// Make sure the right contour overlaps at least
+	// part of the left contour
+	if ((leftBr.br().y - (leftBr.width/2)) < rightBr.y)
+	{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 3 failed" << endl;
+		cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 1 failed" << endl;
 #endif
-				continue;
-			}
+		return false;
+	}
 
-			if ((rightBr.y + (rightBr.width/2)) > leftBr.br().y)
-			{
+	if ((leftBr.y + (leftBr.width/2)) > rightBr.br().y)
+	{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 4 failed" << endl;
+		cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 2 failed" << endl;
 #endif
-				continue;
-			}
+		return false;
+	}
 
-			// Only do distance checks if we believe the
-			// depth info is correct
-			if (!left_info[i].depth_error && !right_info[j].depth_error)
-			{
-				if (fabsf(left_info[i].angle - right_info[j].angle) > 10.0)
-				{
+	// Make sure the left contour overlaps at least
+	// part of the right contour
+	if ((rightBr.br().y - (rightBr.width/2)) < leftBr.y)
+	{
 #ifdef VERBOSE_BOILER
-					cout << i << " " << j << " angle compare failed" << endl;
+		cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 3 failed" << endl;
 #endif
-					continue;
-				}
+		return false;
+	}
 
-				// Make sure there isn't too much
-				// distance left to right between the goals
-				const float dx = left_info[i].pos.x - right_info[j].pos.x;
-				if (fabsf(dx) > .3)
-				{
-#ifdef VERBOSE_BOILER
-					cout << i << " " << j << " " << dx << " dx check failed" << endl;
-#endif
-					continue;
-				}
-				const float dy = left_info[i].pos.y - right_info[j].pos.y;
-				const float dz = left_info[i].pos.z - right_info[j].pos.z;
-				const float dist = sqrt(dx * dx + dy * dy + dz * dz);
-				if (dist > 1.25)
-				{
+	if ((rightBr.y + (rightBr.width/2)) > leftBr.br().y)
+	{
 #ifdef VERBOSE_BOILER
-					cout << i << " " << j << " " << dist << " distance check failed" << endl;
+		cout << i << " " << j << " " << leftBr.br().y << " " << rightBr.y << " stacked check 4 failed" << endl;
 #endif
-					continue;
-				}
-			}
-				/*
-				// Keep detecting the goal, even if something gets in the way to 					// obstruct the goal.
-				
-				if (!found_goal || left_info[i].confidence[i] )
-				{
-#ifdef VERBOSE_BOILER
-					cout << i << " " << j << " " <<  << " obstruction detected, detecting previous goal" << endl;
+		return false;
+	}
 
-				
+	// Only do distance checks if we believe the
+	// depth info is correct
+	if (!left.depth_error && !right.depth_error)
+	{
+		if (fabsf(left.angle - right.angle) > 10.0)
+		{
+#ifdef VERBOSE_BOILER
+			cout << i << " " << j << " angle compare failed" << endl;
 #endif
-					continue;
-				} */
-
+			return false;
+		}
 
-			// This doesn't work near the edges of the frame?
-			if ((left_info[i].rect & right_info[j].rect).area() > (.5 * min(left_info[i].rect.area(), right_info[j].rect.area())))
-			{
+		// Make sure there isn't too much
+		// distance left to right between the goals
+		const float dx = left.pos.x - right.pos.x;
+		if (fabsf(dx) > .3)
+		{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " overlap check failed" << endl;
+			cout << i << " " << j << " " << dx << " dx check failed" << endl;
 #endif
-				continue;
-			}
-
-			// If this is the first valid pair
-			// or if this pair has a higher combined
-			// confidence than the previously saved
-			// pair, keep it as the best result
-			if(!found_goal || (left_info[best_result_index_left].confidence + right_info[best_result_index_right].confidence <= left_info[i].confidence + right_info[j].confidence)) {
+			return false;
+		}
+		const float dy = left.pos.y - right.pos.y;
+		const float dz = left.pos.z - right.pos.z;
+		const float dist = sqrt(dx * dx + dy * dy + dz * dz);
+		if (dist > 1.25)
+		{
 #ifdef VERBOSE_BOILER
-				cout << i << " " << j << " found a better goal!" << endl;
+			cout << i << " " << j << " " << dist << " distance check failed" << endl;
 #endif
-				found_goal = true;
-				best_result_index_left = i;
-				best_result_index_right = j;
-			}
+			return false;
 		}
 	}
-	
-	//say a goal is found if the sum of the confidences is higher than 0.5
-	if(found_goal && left_info[best_result_index_left].confidence + right_info[best_result_index_right].confidence > _min_valid_confidence) {
-#ifdef VERBOSE
-		cout << "Top distance: " << left_info[best_result_index_left].distance << " Bottom distance: " << right_info[best_result_index_right].distance << endl;
-		cout << "Top position: " << left_info[best_result_index_left].pos << " Bottom position: " << right_info[best_result_index_right].pos << endl;
-		cout << "Top confidence: " << left_info[best_result_index_left].confidence << " Bottom confidence: " << right_info[best_result_index_right].confidence << endl;
-		cout << "Found Goal: " << found_goal << " " << left_info[best_result_index_left].distance << " " << left_info[best_result_index_left].angle << endl;
-		cout << "Found goal with confidence: " << left_info[best_result_index_left].confidence + right_info[best_result_index_right].confidence << endl;
+
+	// This doesn't work near the edges of the frame?
+	if ((left.rect & right.rect).area() > (.5 * min(left.rect.area(), right.rect.area())))
+	{
+#ifdef VERBOSE_BOILER
+		cout << i << " " << j << " overlap check failed" << endl;
 #endif
-		//_pastRects.push_back(SmartRect(left_info[best_result_index_left].rect));
-		
-		// Use data from the contour which has
-		// good depth data
-		// If neither do, do the best we can
-		const GoalInfo *gi;
-		if (right_info[best_result_index_right].depth_error)
-			gi = &left_info[best_result_index_left];
-		else
-			gi = &right_info[best_result_index_right];
-
-		_goal_pos      = gi->pos;
-		_dist_to_goal  = gi->distance; 
-		_angle_to_goal = gi->angle;
-		_goal_left_rect = left_info[best_result_index_left].rect;
-		_goal_right_rect = right_info[best_result_index_right].rect;
-		_isValid = true;
+		return false;
 	}
+	return true;
 }
 
 
@@ -275,51 +436,119 @@ void GoalDetector::clear()
 	_goal_left_rect = Rect();
 	_goal_right_rect = Rect();
 	_goal_pos = Point3f();
+	_frame.clearResults();
 }
 
-const vector< vector < Point > > GoalDetector::getContours(const Mat& image) {
-	// Look for parts the the image which are within the
-	// expected bright green color range
-	Mat threshold_image;
-	vector < vector < Point > > return_contours;
-	if (!generateThresholdAddSubtract(image, threshold_image))
-	{
-		_isValid = false;
-		//_pastRects.push_back(SmartRect(Rect()));
-		return return_contours;
-	}
+void GoalFrame::clearResults(void)
+{
+	contours.clear();
+	hierarchy.clear();
+	depths.clear();
+	goal_info.clear();
+	valid = false;
+	dist_to_goal = -1.0;
+	angle_to_goal = -1.0;
+	goal_left_rect = Rect();
+	goal_right_rect = Rect();
+	goal_pos = Point3f();
+}
+
+const vector< vector < Point > > &GoalDetector::getContours(const Mat& image) {
+	_frame.image = image;
+	thresholdStage(_frame);
+	return _frame.contours;
+}
+
+const Mat &GoalDetector::thresholdImage(void) const
+{
+	return _frame.threshold_image;
+}
+
+const vector< vector < Point > > &GoalDetector::contours(void) const
+{
+	return _frame.contours;
+}
 
-	// find contours in the thresholded image - these will be blobs
-	// of green to check later on to see how well they match the
-	// expected shape of the goal
-	// Note : findContours modifies the input mat
-	vector<Vec4i> hierarchy;
-	findContours(threshold_image.clone(), return_contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));
+const vector<GoalInfo> &GoalDetector::goalInfo(void) const
+{
+	return _frame.goal_info;
+}
 
-	return return_contours;
+const DepthStats &GoalDetector::depthStats(void) const
+{
+	return _frame.depth_stats;
 }
 
-const vector<DepthInfo> GoalDetector::getDepths(const Mat &depth, const vector< vector< Point > > &contours, ObjectNum objtype, float expected_height) {
-	// Use to mask the contour off from the rest of the
-	// image - used when grabbing depth data for the contour
-	Mat contour_mask(_frame_size, CV_8UC1, Scalar(0));
+namespace
+{
+// Average depth inside each contour. The mask for a contour only covers its
+// bounding rect, so a frame full of small blobs doesn't clear and redraw a
+// full frame mask per blob. Contours don't depend on each other so they're
+// split across threads, each thread reusing one mask for its contours.
+// Contours whose bounding rect has no valid depth at all are skipped
+// without drawing a mask, using the frame's depth integral images
+class ContourDepthBody : public ParallelLoopBody
+{
+	public:
+		ContourDepthBody(const Mat &depth, const DepthStats &depth_stats, const vector< vector< Point > > &contours, const vector<Rect> &bounding_rects, vector<float> &average_depths) :
+			_depth(depth),
+			_depth_stats(depth_stats),
+			_contours(contours),
+			_bounding_rects(bounding_rects),
+			_average_depths(average_depths)
+		{
+		}
+
+		void operator()(const Range &range) const
+		{
+			Mat contour_mask;
+			for (int i = range.start; i < range.end; i++) {
+				const Rect &br(_bounding_rects[i]);
+				if (_depth_stats.count(br) == 0) {
+					_average_depths[i] = -1;
+					continue;
+				}
+				//create a mask which is the same shape as the contour, in
+				//the coordinates of its bounding rect
+				contour_mask.create(br.size(), CV_8UC1);
+				contour_mask.setTo(Scalar(0));
+				drawContours(contour_mask, _contours, i, Scalar(255), CV_FILLED, 8, noArray(), INT_MAX, -br.tl());
+				const Rect roi(br & Rect(Point(0, 0), _depth.size()));
+				_average_depths[i] = zv_utils::avgOfDepthMat(_depth(roi), contour_mask(roi - br.tl()));
+			}
+		}
+
+	private:
+		const Mat                     &_depth;
+		const DepthStats              &_depth_stats;
+		const vector< vector< Point > > &_contours;
+		const vector<Rect>            &_bounding_rects;
+		vector<float>                 &_average_depths;
+};
+}
+
+vector<DepthInfo> GoalDetector::getDepths(GoalFrame &frame, ObjectNum /*objtype*/, float expected_height) const {
+	const vector< vector< Point > > &contours = frame.contours;
+	vector<float> average_depths(contours.size());
+	if (!contours.empty()) {
+		// Depth stats are only looked up inside contour bounding
+		// rects, so only build them over the area those cover
+		vector<Rect> bounding_rects(contours.size());
+		for (size_t i = 0; i < contours.size(); i++)
+			bounding_rects[i] = boundingRect(contours[i]);
+		Rect covered(bounding_rects[0]);
+		for (size_t i = 1; i < bounding_rects.size(); i++)
+			covered |= bounding_rects[i];
+		frame.depth_stats.compute(frame.depth, covered);
+		parallel_for_(Range(0, contours.size()), ContourDepthBody(frame.depth, frame.depth_stats, contours, bounding_rects, average_depths));
+	}
+
 	vector<DepthInfo> return_vec;
 	DepthInfo depthInfo;
 	for(size_t i = 0; i < contours.size(); i++) {
-		// get the minimum and maximum depth values in the contour,
-		const Rect br(boundingRect(contours[i]));
-		const Moments mu = moments(contours[i], false);
-		const Point com = Point(mu.m10 / mu.m00, mu.m01 / mu.m00);
-		//Point center(rect.tl().x+rect.size().width/2, rect.tl().y+rect.size().height/2);
-		
-		//create a mask which is the same shape as the contour
-		contour_mask.setTo(Scalar(0));
-		drawContours(contour_mask, contours, i, Scalar(255), CV_FILLED);
 		// copy them into individual floats
-		//pair<float, float> minMax = zv_utils::minOfDepthMat(depth, contour_mask, br, 10);
-		const float average_depth = zv_utils::avgOfDepthMat(depth, contour_mask, br);
-		float depth_z_min = average_depth;
-		float depth_z_max = average_depth;
+		float depth_z_min = average_depths[i];
+		float depth_z_max = average_depths[i];
 
 #ifdef VERBOSE
 		cout << "Depth " << i << ": " << depth_z_min << " " << depth_z_max << endl;
@@ -329,7 +558,9 @@ const vector<DepthInfo> GoalDetector::getDepths(const Mat &depth, const vector<
 		// the target. This isn't perfect but better than nothing
 		if ((depth_z_min <= 0.) || (depth_z_max <= 0.)) {
 			depthInfo.error = true;
-			ObjectType ot(objtype);
+			const Rect br(boundingRect(contours[i]));
+			const Moments mu = moments(contours[i], false);
+			const Point com = Point(mu.m10 / mu.m00, mu.m01 / mu.m00);
 			depth_z_min = depth_z_max = distanceUsingFixedHeight(br,com,expected_height);
 		}
 		else
@@ -341,7 +572,7 @@ const vector<DepthInfo> GoalDetector::getDepths(const Mat &depth, const vector<
 	return return_vec;
 }
 
-const vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contours, const vector<DepthInfo> &depth_maxs, ObjectNum objtype) {
+vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contours, const vector<DepthInfo> &depth_maxs, ObjectNum objtype) const {
 	ObjectType _goal_shape(objtype);
 	vector<GoalInfo> return_info;
 	// Create some target stats based on our idealized goal model
@@ -404,16 +635,17 @@ const vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contou
 		}
 #endif
 
-		//create a trackedobject to get various statistics
-		//including area and x,y,z position of the goal
+		//get various statistics including area and
+		//x,y,z position of the goal
 		ObjectType goal_actual(contours[i], "Actual Goal", 0);
-		TrackedObject goal_tracked_obj(0, _goal_shape, br, depth_maxs[i].depth, _fov_size, _frame_size,-((float)_camera_angle/10.) * M_PI / 180.0);
+		const float camera_elevation = -((float)_camera_angle/10.) * M_PI / 180.0;
+		const Point3f goal_position(_goal_shape.screenToWorldCoords(br, depth_maxs[i].depth, _fov_size, _frame_size, camera_elevation));
 
 		// Gets the bounding box area observed divided by the
 		// bounding box area calculated given goal size and distance
 		// For an object the size of a goal we'd expect this to be
 		// close to 1.0 with some variance due to perspective
-		const float exp_area = goal_tracked_obj.getScreenPosition(_fov_size, _frame_size).area();
+		const float exp_area = _goal_shape.worldToScreenCoords(goal_position, _fov_size, _frame_size, camera_elevation).area();
 		const float actualScreenArea = (float)br.area() / exp_area;
 /*
 		if (((exp_area / br.area()) < 0.20) || ((exp_area / br.area()) > 5.00))
@@ -451,7 +683,7 @@ const vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contou
 		//taking the standard deviation of a bunch of values from the goal
 		//confidence is near 0.5 when value is near the mean
 		//confidence is small or large when value is not near mean
-		float confidence_height      = createConfidence(_goal_shape.real_height(), 0.4, goal_tracked_obj.getPosition().z - _goal_shape.height() / 2.0);
+		float confidence_height      = createConfidence(_goal_shape.real_height(), 0.4, goal_position.z - _goal_shape.height() / 2.0);
 		float confidence_com_x       = createConfidence(com_percent_expected.x, 0.125,  com_percent_actual.x);
 		float confidence_filled_area = createConfidence(filledPercentageExpected, 0.33,   filledPercentageActual);
 		float confidence_ratio       = createConfidence(expectedRatio, 2,  actualRatio);
@@ -469,13 +701,13 @@ const vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contou
 		cout << "confidence_ratio: " << confidence_ratio << endl;
 		cout << "confidence_screen_area: " << confidence_screen_area << endl;
 		cout << "confidence: " << confidence << endl;
-		cout << "Height exp/act: " << _goal_shape.real_height() << "/" <<  goal_tracked_obj.getPosition().z - _goal_shape.height() / 2.0 << endl;
+		cout << "Height exp/act: " << _goal_shape.real_height() << "/" <<  goal_position.z - _goal_shape.height() / 2.0 << endl;
 		cout << "Depth max: " << depth_maxs[i].depth << " " << depth_maxs[i].error << endl;
 		//cout << "Area exp/act: " << (int)exp_area << "/" << br.area() << endl;
 		cout << "Aspect ratio exp/act : " << expectedRatio << "/" << actualRatio << endl;
 		cout << "br: " << br << endl;
 		cout << "com: " << goal_actual.com() << endl;
-		cout << "position: " << goal_tracked_obj.getPosition() << endl;
+		cout << "position: " << goal_position << endl;
 		cout << "-------------------------------------------" << endl;
 #endif
 
@@ -483,7 +715,7 @@ const vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contou
 
 		// This goal passes the threshold required for us to consider it a goal
 		// Add it to the list of best goals
-		goal_info.pos        = goal_tracked_obj.getPosition();
+		goal_info.pos        = goal_position;
 		goal_info.confidence = confidence;
 		goal_info.distance   = depth_maxs[i].depth * cosf((_camera_angle/10.0) * (M_PI/180.0));
 		goal_info.angle 	 = atan2f(goal_info.pos.x, goal_info.pos.y) * 180. / M_PI;
@@ -510,36 +742,23 @@ const vector<GoalInfo> GoalDetector::getInfo(const vector<vector<Point>> &contou
 // blue, except multiply the pixel values by a weight
 // < 1. Using this weight will let blue-green pixels
 // show up in the output grayscale
-bool GoalDetector::generateThresholdAddSubtract(const Mat& imageIn, Mat& imageOut)
+// Green minus scaled blue and red, written straight into the roi of
+// threshold_image. BORDER_ISOLATED keeps erode and dilate from reading
+// pixels outside of roi, so a window gives the same result whatever is
+// next to it
+void GoalDetector::generateAddSubtract(GoalFrame &frame, const Rect &roi) const
 {
-    vector<Mat> splitImage;
-    Mat         bluePlusRed;
-
-    split(imageIn, splitImage);
-	addWeighted(splitImage[0], _blue_scale / 100.0,
-			    splitImage[2], _red_scale / 100.0, 0.0,
-				bluePlusRed);
-	subtract(splitImage[1], bluePlusRed, imageOut);
+	Mat imageOut(frame.threshold_image(roi));
+    split(frame.image(roi), frame.split_image);
+	addWeighted(frame.split_image[0], _blue_scale / 100.0,
+			    frame.split_image[2], _red_scale / 100.0, 0.0,
+				frame.blue_plus_red);
+	subtract(frame.split_image[1], frame.blue_plus_red, imageOut);
 
     static const Mat erodeElement(getStructuringElement(MORPH_RECT, Size(3, 3)));
     static const Mat dilateElement(getStructuringElement(MORPH_RECT, Size(3, 3)));
-	erode(imageOut, imageOut, erodeElement, Point(-1, -1), 1);
-	dilate(imageOut, imageOut, dilateElement, Point(-1, -1), 1);
-
-	// Use Ostu adaptive thresholding.  This will turn
-	// the gray scale image into a binary black and white one, with pixels
-	// above some value being forced white and those below forced to black
-	// The value to used as the split between black and white is returned
-	// from the function.  If this value is too low, it means the image is
-	// really dark and the returned threshold image will be mostly noise.
-	// In that case, skip processing it entirely.
-	const double otsuThreshold = threshold(imageOut, imageOut, 0., 255., CV_THRESH_BINARY | CV_THRESH_OTSU);
-#ifdef VERBOSE
-	cout << "OTSU THRESHOLD " << otsuThreshold << endl;
-#endif
-	if (otsuThreshold < _otsu_threshold)
-		return false;
-    return countNonZero(imageOut) != 0;
+	erode(imageOut, imageOut, erodeElement, Point(-1, -1), 1, BORDER_CONSTANT | BORDER_ISOLATED);
+	dilate(imageOut, imageOut, dilateElement, Point(-1, -1), 1, BORDER_CONSTANT | BORDER_ISOLATED);
 }
 
 // Use the camera FOV, a known target size and the apparent size to
@@ -582,6 +801,11 @@ bool GoalDetector::Valid(void) const
 	return _isValid;
 }
 
+void GoalDetector::setExhaustivePairSearch(bool exhaustive)
+{
+	_exhaustive_pair_search = exhaustive;
+}
+
 float GoalDetector::dist_to_goal(void) const
 {
  	//floor distance to goal in m
@@ -640,6 +864,26 @@ Point3f GoalDetector::goal_pos(void) const
 // Draw debugging info on frame - all non-filtered contours
 // plus their confidence. Highlight the best bounding rect in
 // a different color
+void GoalDetector::drawOnFrame(Mat &image) const
+{
+	drawOnFrame(image, _frame.contours);
+}
+
+void GoalDetector::drawOnFrame(Mat &image, const GoalFrame &frame) const
+{
+	for (size_t i = 0; i < frame.contours.size(); i++)
+	{
+		drawContours(image, frame.contours, i, Scalar(0,0,255), 3);
+		Rect br(boundingRect(frame.contours[i]));
+		rectangle(image, br, Scalar(255,0,0), 2);
+		putText(image, to_string(i), br.br(), FONT_HERSHEY_PLAIN, 1, Scalar(0,255,0));
+	}
+	if (frame.valid) {
+		rectangle(image, frame.goal_left_rect, Scalar(0,255,0), 2);	
+		rectangle(image, frame.goal_right_rect, Scalar(0,140,255), 2);	
+	}
+}
+
 void GoalDetector::drawOnFrame(Mat &image, const vector<vector<Point>> &contours) const
 {
 	for (size_t i = 0; i < contours.size(); i++)
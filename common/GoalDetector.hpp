@@ -9,6 +9,7 @@
 #include <boost/circular_buffer.hpp>
 
 #include "track3d.hpp"
+#include "depthstats.hpp"
 
 struct DepthInfo
 {
@@ -30,6 +31,40 @@ struct GoalInfo
 	cv::Rect br;
 };
 
+//Everything worked out for one frame. findBoilers keeps one of these
+//internally. Running the stages on separate GoalFrames lets different
+//frames be in different stages at the same time, see pipeline.hpp
+struct GoalFrame
+{
+	GoalFrame(void) { clearResults(); }
+	void clearResults(void);
+
+	cv::Mat image;
+	cv::Mat depth;
+	// Parts of the image to look at, e.g. from a SearchWindowTracker.
+	// Empty means the whole image
+	std::vector< cv::Rect > search_windows;
+
+	cv::Mat                                 threshold_image;
+	std::vector< std::vector< cv::Point > > contours;
+	DepthStats                              depth_stats;
+	std::vector< DepthInfo >                depths;
+	std::vector< GoalInfo >                 goal_info;
+
+	bool        valid;
+	float       dist_to_goal;
+	float       angle_to_goal;
+	cv::Rect    goal_left_rect;
+	cv::Rect    goal_right_rect;
+	cv::Point3f goal_pos;
+
+	// Scratch space, reused each time the frame is
+	std::vector< cv::Mat >   split_image;
+	cv::Mat                  blue_plus_red;
+	cv::Mat                  contour_scratch;
+	std::vector< cv::Vec4i > hierarchy;
+};
+
 class GoalDetector
 {
 	public:
@@ -40,17 +75,40 @@ class GoalDetector
 		cv::Rect goal_rect(void) const;
 		cv::Point3f goal_pos(void) const;
 		void drawOnFrame(cv::Mat &image,const std::vector< std::vector< cv::Point>> &contours) const;
+		//Draws the contours found by the last findBoilers / getContours call
+		void drawOnFrame(cv::Mat &image) const;
+		void drawOnFrame(cv::Mat &image, const GoalFrame &frame) const;
 
 		//These are the three functions to call to run GoalDetector
-		//they fill in _contours, _infos, _depth_mins, etc
+		//they fill in _contours, _goal_info, _depths, etc
 		void clear(void);
 
 		//If your objectypes have the same width it's safe to run
 		//getContours and computeConfidences with different types
 		void findBoilers(const cv::Mat& image, const cv::Mat& depth);
-		const std::vector< std::vector< cv::Point > > getContours(const cv::Mat& image);
+
+		//The stages of findBoilers, run in order on a frame with image
+		//and depth filled in. Each only touches the frame passed in, so
+		//they can run on different frames in different threads. The
+		//first two return false if there's nothing left to do
+		bool thresholdStage(GoalFrame &frame) const;
+		bool measureStage(GoalFrame &frame) const;
+		void pairStage(GoalFrame &frame) const;
+		const std::vector< std::vector< cv::Point > > &getContours(const cv::Mat& image);
+
+		//Results of each stage of the last findBoilers call, kept so
+		//drawing / debug code doesn't have to redo them
+		const cv::Mat &thresholdImage(void) const;
+		const std::vector< std::vector< cv::Point > > &contours(void) const;
+		const std::vector< GoalInfo > &goalInfo(void) const;
+		const DepthStats &depthStats(void) const;
 
 		bool Valid(void) const;
+
+		//Test every pair of candidates in findBoilers instead of only
+		//the ones close enough together on screen, skipping the
+		//confidence pruning. Slow - for checking results against
+		void setExhaustivePairSearch(bool exhaustive);
 	private:
 	
 		cv::Point2f _fov_size;
@@ -72,11 +130,23 @@ class GoalDetector
 
 		int         _camera_angle;
 
-		float createConfidence(float expectedVal, float expectedStddev, float actualVal);
+		bool        _exhaustive_pair_search;
+
+		// Otsu threshold of the last full frame, -1 before there is one.
+		// Only thresholdStage uses it, which runs on frames in order
+		mutable double _full_frame_threshold;
+
+		// Stages of the last findBoilers call, reused from
+		// frame to frame to avoid reallocating them
+		GoalFrame   _frame;
+
+		float createConfidence(float expectedVal, float expectedStddev, float actualVal) const;
 		float distanceUsingFOV(ObjectType _goal_shape, const cv::Rect &rect) const;
 		float distanceUsingFixedHeight(const cv::Rect &rect,const cv::Point &center, float expected_delta_height) const;
-		bool generateThresholdAddSubtract(const cv::Mat& imageIn, cv::Mat& imageOut);
+		bool isBoilerPair(const GoalInfo &left, const GoalInfo &right) const;
+		void generateAddSubtract(GoalFrame &frame, const cv::Rect &roi) const;
+		double otsuThreshold(GoalFrame &frame, const std::vector<cv::Rect> &windows, bool windowed) const;
 		void isValid();
-		const std::vector<DepthInfo> getDepths(const cv::Mat &depth, const std::vector< std::vector< cv::Point > > &contours, ObjectNum objtype, float expected_height);
-		const std::vector< GoalInfo > getInfo(const std::vector< std::vector< cv::Point > > &contours, const std::vector<DepthInfo> &depth_maxs, ObjectNum objtype);
+		std::vector<DepthInfo> getDepths(GoalFrame &frame, ObjectNum objtype, float expected_height) const;
+		std::vector< GoalInfo > getInfo(const std::vector< std::vector< cv::Point > > &contours, const std::vector<DepthInfo> &depth_maxs, ObjectNum objtype) const;
 };
@@ -114,6 +114,30 @@ namespace zv_utils {
 		return sum / count;
 	}
 
+	float avgOfDepthMat(const cv::Mat& img, const cv::Mat& mask)
+	{
+		CV_Assert(img.size() == mask.size());
+		double sum = 0.0;
+		unsigned count = 0;
+		for (int j = 0; j < img.rows; j++) //for each row
+		{
+			const float *ptr_img  = img.ptr<float>(j);
+			const uchar *ptr_mask = mask.ptr<uchar>(j);
+
+			for (int i = 0; i < img.cols; i++) //for each pixel in row
+			{
+				if (ptr_mask[i] && !(isnan(ptr_img[i]) || isinf(ptr_img[i]) || (ptr_img[i] <= 0)))
+				{
+					sum += ptr_img[i];
+					count += 1;
+				}
+			}
+		}
+		if (count == 0)
+			return -1;
+		return sum / count;
+	}
+
 	void shrinkRect(cv::Rect &rect_in, float shrink_factor) {
 
 		rect_in.tl() = rect_in.tl() + cv::Point(shrink_factor/2.0 * rect_in.width, shrink_factor/2.0 * rect_in.height);
@@ -18,6 +18,8 @@ namespace zv_utils {
 
 std::pair<float, float> minOfDepthMat(const cv::Mat& img, const cv::Mat& mask, const cv::Rect& bound_rect, int range);
 float avgOfDepthMat(const cv::Mat& img, const cv::Mat& mask, const cv::Rect& bound_rect);
+//img and mask already cropped to the region of interest, e.g. depth(rect) and a rect sized mask
+float avgOfDepthMat(const cv::Mat& img, const cv::Mat& mask);
 void shrinkRect(cv::Rect &rect_in, float shrink_factor);
 
 //void printIsometry(const Eigen::Transform<double, 3, Eigen::Isometry> m);
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cmath>
+#include "depthstats.hpp"
+
+using namespace cv;
+
+DepthStats::DepthStats(bool sum_squares) :
+	_sum_squares(sum_squares)
+{
+}
+
+// One pass over the depth image filling all of the integral
+// images at once, skipping missing depth values
+void DepthStats::compute(const Mat &depth)
+{
+	compute(depth, Rect(Point(0, 0), depth.size()));
+}
+
+void DepthStats::compute(const Mat &full_depth, const Rect &roi)
+{
+	CV_Assert(full_depth.type() == CV_32FC1);
+	_roi = roi & Rect(Point(0, 0), full_depth.size());
+	const Mat depth(full_depth(_roi));
+	_sum.create(depth.rows + 1, depth.cols + 1, CV_64FC1);
+	_count.create(depth.rows + 1, depth.cols + 1, CV_32SC1);
+	if (_sum_squares)
+		_sq_sum.create(depth.rows + 1, depth.cols + 1, CV_64FC1);
+
+	// Top row and left column are 0 so a rect starting at
+	// the edge of the image doesn't need special cases
+	_sum.row(0).setTo(Scalar(0));
+	_count.row(0).setTo(Scalar(0));
+	if (_sum_squares)
+		_sq_sum.row(0).setTo(Scalar(0));
+
+	for (int y = 0; y < depth.rows; y++)
+	{
+		const float *in = depth.ptr<float>(y);
+		const double *sum_above = _sum.ptr<double>(y);
+		const int *count_above = _count.ptr<int>(y);
+		const double *sq_sum_above = _sum_squares ? _sq_sum.ptr<double>(y) : NULL;
+		double *sum = _sum.ptr<double>(y + 1);
+		int *count = _count.ptr<int>(y + 1);
+		double *sq_sum = _sum_squares ? _sq_sum.ptr<double>(y + 1) : NULL;
+
+		double row_sum = 0;
+		double row_sq_sum = 0;
+		int row_count = 0;
+		sum[0] = 0;
+		count[0] = 0;
+		if (sq_sum)
+			sq_sum[0] = 0;
+		for (int x = 0; x < depth.cols; x++)
+		{
+			const float d = in[x];
+			if (!(std::isnan(d) || std::isinf(d) || (d <= 0)))
+			{
+				row_sum += d;
+				row_sq_sum += (double)d * d;
+				row_count += 1;
+			}
+			sum[x + 1] = sum_above[x + 1] + row_sum;
+			count[x + 1] = count_above[x + 1] + row_count;
+			if (sq_sum)
+				sq_sum[x + 1] = sq_sum_above[x + 1] + row_sq_sum;
+		}
+	}
+}
+
+// Clip to the area covered and move into integral image coordinates
+Rect DepthStats::clip(const Rect &rect) const
+{
+	return (rect & _roi) - _roi.tl();
+}
+
+template <class T>
+T DepthStats::rectSum(const Mat &integral, const Rect &rect) const
+{
+	return integral.at<T>(rect.y + rect.height, rect.x + rect.width)
+		 - integral.at<T>(rect.y,               rect.x + rect.width)
+		 - integral.at<T>(rect.y + rect.height, rect.x)
+		 + integral.at<T>(rect.y,               rect.x);
+}
+
+DepthRectStats DepthStats::rectStats(const Rect &rect) const
+{
+	DepthRectStats stats;
+	stats.mean = -1;
+	stats.variance = 0;
+	stats.valid_ratio = 0;
+	stats.count = 0;
+
+	const Rect r(clip(rect));
+	if (r.area() <= 0)
+		return stats;
+
+	stats.count = rectSum<int>(_count, r);
+	stats.valid_ratio = (float)stats.count / r.area();
+	if (stats.count == 0)
+		return stats;
+
+	const double mean = rectSum<double>(_sum, r) / stats.count;
+	stats.mean = mean;
+	if (_sum_squares)
+		stats.variance = std::max(rectSum<double>(_sq_sum, r) / stats.count - mean * mean, 0.);
+	return stats;
+}
+
+float DepthStats::mean(const Rect &rect) const
+{
+	const Rect r(clip(rect));
+	if (r.area() <= 0)
+		return -1;
+	const int n = rectSum<int>(_count, r);
+	if (n == 0)
+		return -1;
+	return rectSum<double>(_sum, r) / n;
+}
+
+int DepthStats::count(const Rect &rect) const
+{
+	const Rect r(clip(rect));
+	if (r.area() <= 0)
+		return 0;
+	return rectSum<int>(_count, r);
+}
+
+Size DepthStats::size(void) const
+{
+	return _roi.size();
+}
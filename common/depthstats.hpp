@@ -0,0 +1,49 @@
+#pragma once
+// Per frame integral images of valid depth, so the mean, variance
+// and fraction of valid pixels in any rectangle of the depth image
+// are O(1) lookups. Build once per frame with compute() then query as
+// many rects as needed from any detector working on that frame.
+// Depth values which are nan, inf or <= 0 are treated as missing
+#include <opencv2/core/core.hpp>
+
+struct DepthRectStats
+{
+	float mean;        // -1 if there are no valid pixels
+	float variance;    // only filled in if sum of squares is enabled
+	float valid_ratio; // valid pixels / pixels in rect
+	int   count;       // valid pixels
+};
+
+class DepthStats
+{
+	public:
+		DepthStats(bool sum_squares = false);
+
+		// depth is CV_32FC1
+		void compute(const cv::Mat &depth);
+		// Only build the integral images over roi, for when only
+		// part of the frame is being looked at. Queries are still
+		// in full image coordinates
+		void compute(const cv::Mat &depth, const cv::Rect &roi);
+
+		// rect is clipped to the image, or roi
+		DepthRectStats rectStats(const cv::Rect &rect) const;
+		float mean(const cv::Rect &rect) const;
+		int   count(const cv::Rect &rect) const;
+
+		// Size of the area covered, the whole image unless
+		// compute was given a roi
+		cv::Size size(void) const;
+		cv::Rect roi(void) const { return _roi; }
+
+	private:
+		bool     _sum_squares;
+		cv::Rect _roi;
+		cv::Mat  _sum;    // CV_64FC1, (rows+1) x (cols+1) of roi
+		cv::Mat  _sq_sum; // CV_64FC1, empty unless _sum_squares
+		cv::Mat  _count;  // CV_32SC1
+
+		cv::Rect clip(const cv::Rect &rect) const;
+		template <class T>
+		T rectSum(const cv::Mat &integral, const cv::Rect &rect) const;
+};
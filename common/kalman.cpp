@@ -99,6 +99,12 @@ Point3f TKalmanFilter::GetPrediction()
 	return Point3f(prediction.at<float>(0),prediction.at<float>(1),prediction.at<float>(2)); 
 }
 //---------------------------------------------------------------------------
+Point3f TKalmanFilter::PeekPrediction() const
+{
+	Mat prediction = kalman.transitionMatrix * kalman.statePost;
+	return Point3f(prediction.at<float>(0),prediction.at<float>(1),prediction.at<float>(2)); 
+}
+//---------------------------------------------------------------------------
 Point3f TKalmanFilter::Update(const Point3f &p)
 {
 	Mat measurement(3, 1, CV_32F);
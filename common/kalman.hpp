@@ -8,6 +8,8 @@ class TKalmanFilter
 	public:
 		TKalmanFilter(const cv::Point3f &p, float dt = 0.05, float Accel_noise_mag = 0.5);
 		cv::Point3f GetPrediction();
+		// What GetPrediction would return, without advancing the filter
+		cv::Point3f PeekPrediction() const;
 		cv::Point3f Update(const cv::Point3f &p);
 	//	void adjustPrediction(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot);
 		void adjustPrediction(const cv::Point3f &delta_pos);
@@ -0,0 +1,386 @@
+// Jonker-Volgenant linear assignment, following
+//   R. Jonker and A. Volgenant, "A Shortest Augmenting Path Algorithm for
+//   Dense and Sparse Linear Assignment Problems", Computing 38, 1987
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "lapjv.hpp"
+
+using namespace std;
+
+LAPJVSolver::LAPJVSolver(void)
+{
+}
+
+double LAPJVSolver::solve(const double *cost, int rows, int cols, vector<int> &assignment)
+{
+	assignment.assign(rows, -1);
+	if ((rows == 0) || (cols == 0))
+		return 0;
+
+	_rows.resize(rows);
+	for (int i = 0; i < rows; i++)
+		_rows[i] = i;
+	_cols.resize(cols);
+	for (int i = 0; i < cols; i++)
+		_cols[i] = i;
+	return solveSubset(cost, cols, &_rows[0], rows, &_cols[0], cols,
+					   numeric_limits<double>::infinity(), &assignment[0]);
+}
+
+double LAPJVSolver::solve(const vector<vector<double> > &cost, vector<int> &assignment)
+{
+	const int rows = cost.size();
+	const int cols = rows ? cost[0].size() : 0;
+	_flat.resize(rows * cols);
+	for (int r = 0; r < rows; r++)
+		copy(cost[r].begin(), cost[r].begin() + cols, _flat.begin() + r * cols);
+	return solve(_flat.empty() ? NULL : &_flat[0], rows, cols, assignment);
+}
+
+int LAPJVSolver::findRoot(int node)
+{
+	while (_parent[node] != node)
+	{
+		_parent[node] = _parent[_parent[node]];
+		node = _parent[node];
+	}
+	return node;
+}
+
+double LAPJVSolver::solveGated(const double *cost, int rows, int cols, double gate, vector<int> &assignment)
+{
+	assignment.assign(rows, -1);
+	if ((rows == 0) || (cols == 0))
+		return 0;
+
+	// Rows and columns are nodes 0..rows-1 and rows..rows+cols-1.
+	// Any pair which can be matched joins their groups. Nothing
+	// outside a group can affect the best matching inside it.
+	const int nodes = rows + cols;
+	_parent.resize(nodes);
+	for (int i = 0; i < nodes; i++)
+		_parent[i] = i;
+	for (int r = 0; r < rows; r++)
+	{
+		const double *row = cost + r * cols;
+		for (int c = 0; c < cols; c++)
+		{
+			if (isfinite(row[c]) && (row[c] <= gate))
+			{
+				const int a = findRoot(r);
+				const int b = findRoot(rows + c);
+				if (a != b)
+					_parent[a] = b;
+			}
+		}
+	}
+
+	// Sort nodes by group, group g is _index[_start[g] .. _start[g+1]-1]
+	_start.assign(nodes + 1, 0);
+	for (int i = 0; i < nodes; i++)
+	{
+		_parent[i] = findRoot(i);
+		_start[_parent[i] + 1] += 1;
+	}
+	for (int i = 0; i < nodes; i++)
+		_start[i + 1] += _start[i];
+	_index.resize(nodes);
+	_free.assign(_start.begin(), _start.end() - 1);
+	for (int i = 0; i < nodes; i++)
+		_index[_free[_parent[i]]++] = i;
+
+	double total = 0;
+	for (int g = 0; g < nodes; g++)
+	{
+		// Groups which are a lone row or column have
+		// nothing to match with, skip them
+		if ((_start[g + 1] - _start[g]) < 2)
+			continue;
+		_rows.clear();
+		_cols.clear();
+		for (int i = _start[g]; i < _start[g + 1]; i++)
+		{
+			if (_index[i] < rows)
+				_rows.push_back(_index[i]);
+			else
+				_cols.push_back(_index[i] - rows);
+		}
+		total += solveSubset(cost, cols, &_rows[0], _rows.size(), &_cols[0], _cols.size(),
+							 gate, &assignment[0]);
+	}
+	return total;
+}
+
+double LAPJVSolver::solveSubset(const double *cost, int stride,
+								const int *rows, int nrows,
+								const int *cols, int ncols,
+								double gate, int *assignment)
+{
+	// Pad to square with zero cost dummy rows or columns. Pairs
+	// which aren't allowed cost more than the whole range of allowed
+	// solutions, so the solver only picks one when it has to
+	const int n = max(nrows, ncols);
+	_cost.assign(n * n, 0);
+	double max_abs = 0;
+	for (int r = 0; r < nrows; r++)
+	{
+		const double *row = cost + rows[r] * stride;
+		for (int c = 0; c < ncols; c++)
+		{
+			const double value = row[cols[c]];
+			if (isfinite(value) && (value <= gate))
+				max_abs = max(max_abs, fabs(value));
+		}
+	}
+	const double forbidden = (2. * n + 1.) * (max_abs + 1.);
+	for (int r = 0; r < nrows; r++)
+	{
+		const double *row = cost + rows[r] * stride;
+		double *dest = &_cost[r * n];
+		for (int c = 0; c < ncols; c++)
+		{
+			const double value = row[cols[c]];
+			dest[c] = (isfinite(value) && (value <= gate)) ? value : forbidden;
+		}
+	}
+
+	lapjv(n);
+
+	double total = 0;
+	for (int r = 0; r < nrows; r++)
+	{
+		const int c = _x[r];
+		if ((c < ncols) && (_cost[r * n + c] != forbidden))
+		{
+			assignment[rows[r]] = cols[c];
+			total += _cost[r * n + c];
+		}
+	}
+	return total;
+}
+
+void LAPJVSolver::lapjv(int n)
+{
+	const double big = numeric_limits<double>::max();
+	const double *c = &_cost[0];
+
+	_v.resize(n);
+	_d.resize(n);
+	_x.assign(n, -1);
+	_y.assign(n, -1);
+	_free.resize(n);
+	_collist.resize(n);
+	_pred.resize(n);
+	_matches.assign(n, 0);
+
+	if (n == 1)
+	{
+		_x[0] = 0;
+		_y[0] = 0;
+		return;
+	}
+
+	// Column reduction - assign each column to its cheapest row,
+	// rows picked more than once keep the column with the lowest price
+	for (int j = n - 1; j >= 0; j--)
+	{
+		double min = c[j];
+		int imin = 0;
+		for (int i = 1; i < n; i++)
+		{
+			if (c[i * n + j] < min)
+			{
+				min = c[i * n + j];
+				imin = i;
+			}
+		}
+		_v[j] = min;
+		if (++_matches[imin] == 1)
+		{
+			_x[imin] = j;
+			_y[j] = imin;
+		}
+		else if (_v[j] < _v[_x[imin]])
+		{
+			const int j1 = _x[imin];
+			_x[imin] = j;
+			_y[j] = imin;
+			_y[j1] = -1;
+		}
+		else
+			_y[j] = -1;
+	}
+
+	// Reduction transfer from rows which got exactly one column
+	int numfree = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (_matches[i] == 0)
+			_free[numfree++] = i;
+		else if (_matches[i] == 1)
+		{
+			const int j1 = _x[i];
+			double min = big;
+			for (int j = 0; j < n; j++)
+				if ((j != j1) && ((c[i * n + j] - _v[j]) < min))
+					min = c[i * n + j] - _v[j];
+			_v[j1] -= min;
+		}
+	}
+
+	// Augmenting row reduction, twice
+	for (int loop = 0; loop < 2; loop++)
+	{
+		int k = 0;
+		const int prvnumfree = numfree;
+		numfree = 0;
+		while (k < prvnumfree)
+		{
+			const int i = _free[k++];
+
+			// Lowest and second lowest reduced cost in the row
+			double umin = c[i * n] - _v[0];
+			double usubmin = big;
+			int j1 = 0;
+			int j2 = 0;
+			for (int j = 1; j < n; j++)
+			{
+				const double h = c[i * n + j] - _v[j];
+				if (h < usubmin)
+				{
+					if (h >= umin)
+					{
+						usubmin = h;
+						j2 = j;
+					}
+					else
+					{
+						usubmin = umin;
+						umin = h;
+						j2 = j1;
+						j1 = j;
+					}
+				}
+			}
+
+			int i0 = _y[j1];
+			if (umin < usubmin)
+				_v[j1] -= usubmin - umin;
+			else if (i0 >= 0)
+			{
+				j1 = j2;
+				i0 = _y[j2];
+			}
+
+			_x[i] = j1;
+			_y[j1] = i;
+			if (i0 >= 0)
+			{
+				// Row bumped off the column gets another go right
+				// away if the price went down, otherwise next pass
+				if (umin < usubmin)
+					_free[--k] = i0;
+				else
+					_free[numfree++] = i0;
+			}
+		}
+	}
+
+	// Augment each remaining free row along a shortest path
+	for (int f = 0; f < numfree; f++)
+	{
+		const int freerow = _free[f];
+		for (int j = 0; j < n; j++)
+		{
+			_d[j] = c[freerow * n + j] - _v[j];
+			_pred[j] = freerow;
+			_collist[j] = j;
+		}
+
+		// _collist[0 .. low-1] are done, [low .. up-1] are at
+		// the current minimum distance, [up .. n-1] are still to scan
+		int low = 0;
+		int up = 0;
+		int last = 0;
+		int endofpath = -1;
+		double min = 0;
+		while (endofpath < 0)
+		{
+			if (up == low)
+			{
+				last = low - 1;
+				min = _d[_collist[up++]];
+				for (int k = up; k < n; k++)
+				{
+					const int j = _collist[k];
+					const double h = _d[j];
+					if (h <= min)
+					{
+						if (h < min)
+						{
+							up = low;
+							min = h;
+						}
+						_collist[k] = _collist[up];
+						_collist[up++] = j;
+					}
+				}
+				for (int k = low; k < up; k++)
+				{
+					if (_y[_collist[k]] < 0)
+					{
+						endofpath = _collist[k];
+						break;
+					}
+				}
+			}
+
+			if (endofpath < 0)
+			{
+				const int j1 = _collist[low++];
+				const int i = _y[j1];
+				const double h = c[i * n + j1] - _v[j1] - min;
+				for (int k = up; k < n; k++)
+				{
+					const int j = _collist[k];
+					const double v2 = c[i * n + j] - _v[j] - h;
+					if (v2 < _d[j])
+					{
+						_pred[j] = i;
+						if (v2 == min)
+						{
+							if (_y[j] < 0)
+							{
+								endofpath = j;
+								break;
+							}
+							_collist[k] = _collist[up];
+							_collist[up++] = j;
+						}
+						_d[j] = v2;
+					}
+				}
+			}
+		}
+
+		// Update prices of the columns already scanned
+		for (int k = 0; k <= last; k++)
+		{
+			const int j1 = _collist[k];
+			_v[j1] += _d[j1] - min;
+		}
+
+		// Flip assignments along the path back to the free row
+		int i;
+		do
+		{
+			i = _pred[endofpath];
+			_y[endofpath] = i;
+			const int j1 = endofpath;
+			endofpath = _x[i];
+			_x[i] = j1;
+		}
+		while (i != freerow);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+// Linear assignment using the Jonker-Volgenant shortest augmenting path
+// algorithm (LAPJV). Finds the minimum total cost way of pairing rows
+// with columns of a cost matrix, e.g. tracks with detections.
+//
+// Compared to AssignmentProblemSolver in hungarian.hpp :
+//  - the cost matrix is passed in as one flat row major array
+//  - all working memory is kept in the solver between calls, so
+//    reusing one solver frame to frame doesn't allocate once it has
+//    seen the largest problem
+//  - solveGated() never pairs entries above a threshold, and splits the
+//    problem into independent groups of rows and columns which can
+//    reach each other within that threshold. Each group is solved on
+//    its own, which is much cheaper than one big problem when targets
+//    are spread out. If everything is within the gate of something else
+//    it ends up as one group, and is no faster than solve()
+//
+// Rectangular matrices are padded to square with zero cost dummy rows
+// or columns. Entries which aren't allowed get a cost larger than any
+// possible allowed solution, so they're only used if there's no other
+// choice, and then reported as unassigned.
+#include <vector>
+
+class LAPJVSolver
+{
+	public:
+		LAPJVSolver(void);
+
+		// cost is rows x cols, row major. Entries which are nan or
+		// infinite are never paired. assignment[row] is set to the
+		// column paired with that row, or -1. Returns the total cost
+		// of the pairs in assignment
+		double solve(const double *cost, int rows, int cols, std::vector<int> &assignment);
+
+		// Same as AssignmentProblemSolver::Solve, cost[row][col]
+		double solve(const std::vector<std::vector<double> > &cost, std::vector<int> &assignment);
+
+		// As solve(), with entries above gate never paired either
+		double solveGated(const double *cost, int rows, int cols, double gate, std::vector<int> &assignment);
+
+	private:
+		// Solve the sub-problem made up of the rows and cols listed,
+		// filling in assignment for those rows. Entries which aren't
+		// finite or are above gate are never paired
+		double solveSubset(const double *cost, int stride,
+						   const int *rows, int nrows,
+						   const int *cols, int ncols,
+						   double gate, int *assignment);
+
+		// Square problem in _cost, result in _x
+		void lapjv(int n);
+
+		int findRoot(int node);
+
+		// Working memory, kept between calls
+		std::vector<double> _cost;    // n x n
+		std::vector<double> _v;       // column prices
+		std::vector<double> _d;       // shortest path lengths
+		std::vector<int>    _x;       // row -> column
+		std::vector<int>    _y;       // column -> row
+		std::vector<int>    _free;    // unassigned rows
+		std::vector<int>    _collist; // columns, ordered by d
+		std::vector<int>    _pred;    // row preceding each column in the path
+		std::vector<int>    _matches;
+
+		// For splitting gated problems into groups
+		std::vector<int>    _parent;  // union-find over rows then cols
+		std::vector<int>    _index;   // rows / cols ordered by group
+		std::vector<int>    _start;   // start of each group in _index
+		std::vector<int>    _rows;
+		std::vector<int>    _cols;
+		std::vector<double> _flat;    // for the vector of vectors solve()
+};
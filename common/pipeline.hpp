@@ -0,0 +1,372 @@
+#pragma once
+// Runs a series of stages on a stream of frames with each stage in its
+// own thread, so e.g. thresholding frame N+1 overlaps with finding goals
+// in frame N. Stages are connected by small bounded queues with a
+// single producer and single consumer, so no locks are needed to pass
+// frames along.
+//
+// Each stage's input queue has a policy for when it is full :
+//  - Block      : the previous stage waits for room
+//  - DropNewest : the frame being added is dropped
+//  - KeepLatest : the stage only ever sees the most recent frame,
+//                 anything it didn't get to in time is dropped
+// Vision stages generally want KeepLatest - a stale frame is worth
+// less than a new one.
+//
+// Idle workers sleep on a condition variable until a frame arrives, so
+// they cost nothing between frames.
+//
+// If start() isn't called, push() runs every stage in the caller's
+// thread instead, which makes it easy to switch between the two.
+//
+// Frame type T needs to be default constructible and movable.
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class DropPolicy
+{
+	Block,
+	DropNewest,
+	KeepLatest
+};
+
+struct StageStats
+{
+	std::string name;
+	uint64_t    frames;     // frames run through the stage
+	uint64_t    dropped;    // frames dropped before reaching the stage
+	uint64_t    rejected;   // frames the stage itself stopped
+	double      total_time; // seconds
+	double      max_time;   // seconds
+};
+
+// Single producer, single consumer ring buffer
+template <class T>
+class SPSCQueue
+{
+	public:
+		explicit SPSCQueue(size_t capacity) :
+			_slots(capacity + 1),
+			_head(0),
+			_tail(0)
+		{
+		}
+
+		// Moves from item if there was room
+		bool push(T &item)
+		{
+			const size_t tail = _tail.load(std::memory_order_relaxed);
+			const size_t next = (tail + 1) % _slots.size();
+			if (next == _head.load(std::memory_order_acquire))
+				return false;
+			_slots[tail] = std::move(item);
+			_tail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T &item)
+		{
+			const size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire))
+				return false;
+			item = std::move(_slots[head]);
+			_head.store((head + 1) % _slots.size(), std::memory_order_release);
+			return true;
+		}
+
+		bool empty(void) const
+		{
+			return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+		}
+
+		bool full(void) const
+		{
+			const size_t next = (_tail.load(std::memory_order_acquire) + 1) % _slots.size();
+			return next == _head.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::vector<T> _slots;
+		// Padding keeps producer and consumer indexes off
+		// the same cache line
+		std::atomic<size_t> _head;
+		char                _pad[64];
+		std::atomic<size_t> _tail;
+};
+
+// Holds at most one frame. Adding a frame replaces any the consumer
+// hasn't picked up yet
+template <class T>
+class LatestSlot
+{
+	public:
+		LatestSlot(void) : _slot(nullptr) {}
+		~LatestSlot()
+		{
+			delete _slot.exchange(nullptr);
+		}
+
+		// Returns false if an older frame was replaced
+		bool push(T &item)
+		{
+			T *old = _slot.exchange(new T(std::move(item)), std::memory_order_acq_rel);
+			delete old;
+			return old == nullptr;
+		}
+
+		bool pop(T &item)
+		{
+			std::unique_ptr<T> p(_slot.exchange(nullptr, std::memory_order_acq_rel));
+			if (!p)
+				return false;
+			item = std::move(*p);
+			return true;
+		}
+
+		bool empty(void) const
+		{
+			return _slot.load(std::memory_order_acquire) == nullptr;
+		}
+
+	private:
+		std::atomic<T *> _slot;
+};
+
+template <class T>
+class Pipeline
+{
+	public:
+		// Return false to stop the frame going any further
+		typedef std::function<bool(T &)> StageFunction;
+
+		Pipeline(void) : _running(false) {}
+		~Pipeline() { stop(); }
+
+		Pipeline(const Pipeline &) = delete;
+		Pipeline &operator=(const Pipeline &) = delete;
+
+		// queue_size and policy are for this stage's input queue
+		void addStage(const std::string &name, const StageFunction &function,
+					  DropPolicy policy = DropPolicy::KeepLatest, size_t queue_size = 2)
+		{
+			std::unique_ptr<Stage> stage(new Stage(name, function, policy, queue_size));
+			_stages.push_back(std::move(stage));
+		}
+
+		// One worker thread per stage
+		void start(void)
+		{
+			if (_running)
+				return;
+			_running = true;
+			for (size_t i = 0; i < _stages.size(); i++)
+				_stages[i]->thread = std::thread(&Pipeline::worker, this, i);
+		}
+
+		void stop(void)
+		{
+			if (!_running)
+				return;
+			_running = false;
+			for (auto &stage : _stages)
+			{
+				wake(*stage, stage->frame_ready);
+				wake(*stage, stage->space_ready);
+			}
+			for (auto &stage : _stages)
+				if (stage->thread.joinable())
+					stage->thread.join();
+		}
+
+		bool running(void) const { return _running; }
+
+		// Feed a frame to the first stage. Moves from frame.
+		// Returns false if it, or an older frame, was dropped
+		bool push(T &frame)
+		{
+			if (_stages.empty())
+				return false;
+			if (!_running)
+			{
+				for (size_t i = 0; i < _stages.size(); i++)
+					if (!runStage(*_stages[i], frame))
+						break;
+				return true;
+			}
+			return forward(*_stages[0], frame);
+		}
+
+		std::vector<StageStats> stats(void) const
+		{
+			std::vector<StageStats> ret;
+			for (const auto &stage : _stages)
+			{
+				std::lock_guard<std::mutex> l(stage->stats_mutex);
+				ret.push_back(stage->stats);
+			}
+			return ret;
+		}
+
+	private:
+		struct Stage
+		{
+			Stage(const std::string &name, const StageFunction &function, DropPolicy policy, size_t queue_size) :
+				function(function),
+				policy(policy),
+				queue(queue_size)
+			{
+				stats.name = name;
+				stats.frames = 0;
+				stats.dropped = 0;
+				stats.rejected = 0;
+				stats.total_time = 0;
+				stats.max_time = 0;
+			}
+
+			StageFunction      function;
+			DropPolicy         policy;
+			SPSCQueue<T>       queue;
+			LatestSlot<T>      latest;
+			std::thread        thread;
+			mutable std::mutex stats_mutex;
+			StageStats         stats;
+
+			// Frames themselves are passed without locking, this is
+			// only so the worker and a blocked producer can sleep
+			std::mutex              wait_mutex;
+			std::condition_variable frame_ready; // something to pop
+			std::condition_variable space_ready; // room in queue
+		};
+
+		// Taking the mutex before notifying means a waiter which has
+		// just checked its condition can't miss the wakeup
+		static void wake(Stage &stage, std::condition_variable &cv)
+		{
+			{
+				std::lock_guard<std::mutex> l(stage.wait_mutex);
+			}
+			cv.notify_all();
+		}
+
+		void countDrop(Stage &stage)
+		{
+			std::lock_guard<std::mutex> l(stage.stats_mutex);
+			stage.stats.dropped += 1;
+		}
+
+		bool forward(Stage &stage, T &frame)
+		{
+			switch (stage.policy)
+			{
+				case DropPolicy::KeepLatest:
+					{
+						const bool kept = stage.latest.push(frame);
+						wake(stage, stage.frame_ready);
+						if (kept)
+							return true;
+					}
+					break;
+				case DropPolicy::DropNewest:
+					if (stage.queue.push(frame))
+					{
+						wake(stage, stage.frame_ready);
+						return true;
+					}
+					break;
+				case DropPolicy::Block:
+					while (!stage.queue.push(frame))
+					{
+						std::unique_lock<std::mutex> l(stage.wait_mutex);
+						stage.space_ready.wait(l, [this, &stage]() { return !_running || !stage.queue.full(); });
+						if (!_running)
+							return false;
+					}
+					wake(stage, stage.frame_ready);
+					return true;
+			}
+			countDrop(stage);
+			return false;
+		}
+
+		bool pop(Stage &stage, T &frame)
+		{
+			if (stage.policy == DropPolicy::KeepLatest)
+				return stage.latest.pop(frame);
+			if (!stage.queue.pop(frame))
+				return false;
+			if (stage.policy == DropPolicy::Block)
+				wake(stage, stage.space_ready);
+			return true;
+		}
+
+		bool empty(const Stage &stage) const
+		{
+			if (stage.policy == DropPolicy::KeepLatest)
+				return stage.latest.empty();
+			return stage.queue.empty();
+		}
+
+		bool runStage(Stage &stage, T &frame)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			const bool ret = stage.function(frame);
+			const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			std::lock_guard<std::mutex> l(stage.stats_mutex);
+			stage.stats.frames += 1;
+			if (!ret)
+				stage.stats.rejected += 1;
+			stage.stats.total_time += elapsed;
+			if (elapsed > stage.stats.max_time)
+				stage.stats.max_time = elapsed;
+			return ret;
+		}
+
+		void worker(size_t index)
+		{
+			Stage &stage = *_stages[index];
+			T frame;
+			while (_running)
+			{
+				if (!pop(stage, frame))
+				{
+					std::unique_lock<std::mutex> l(stage.wait_mutex);
+					stage.frame_ready.wait(l, [this, &stage]() { return !_running || !empty(stage); });
+					continue;
+				}
+				if (runStage(stage, frame) && ((index + 1) < _stages.size()))
+					forward(*_stages[index + 1], frame);
+			}
+		}
+
+		std::vector<std::unique_ptr<Stage>> _stages;
+		std::atomic<bool>                   _running;
+};
+
+// One line per stage : frames, drops, mean and max time
+inline std::string formatStageStats(const std::vector<StageStats> &stats)
+{
+	std::string ret;
+	char line[256];
+	for (const auto &s : stats)
+	{
+		snprintf(line, sizeof(line), "%s : %lu frames, %lu dropped, %lu rejected, mean %.2f msec, max %.2f msec\n",
+				s.name.c_str(),
+				static_cast<unsigned long>(s.frames),
+				static_cast<unsigned long>(s.dropped),
+				static_cast<unsigned long>(s.rejected),
+				s.frames ? (1000. * s.total_time / s.frames) : 0.,
+				1000. * s.max_time);
+		ret += line;
+	}
+	return ret;
+}
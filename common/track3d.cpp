@@ -1,8 +1,8 @@
 #include <iostream>
 #include <limits>
+#include <cassert>
 
 #include "track3d.hpp"
-#include "hungarian.hpp"
 
 using namespace std;
 using namespace cv;
@@ -87,198 +87,166 @@ static Rect worldToScreenCoords(const Point3f &_position, const ObjectType &_typ
 			return Rect(topLeft.x, topLeft.y, cvRound(screen_size.x), cvRound(screen_size.y));
 }
 */
-TrackedObject::TrackedObject(int               id,
-							 const ObjectType &type_in,
-							 const Rect       &screen_position,
-							 double            avg_depth,
-							 const Point2f    &fov_size,
-							 const Size       &frame_size,
-							 float             camera_elevation,
-							 float             dt,
-							 float             accel_noise_mag,
-							 size_t            historyLength) :
-		type_(type_in),
-		detectHistory_(historyLength),
-		positionHistory_(historyLength),
-		KF_(type_.screenToWorldCoords(screen_position, avg_depth, fov_size, frame_size, camera_elevation),
-			dt, accel_noise_mag),
-		missedFrameCount_(0),
-		cameraElevation_(camera_elevation)
-{
-	setPosition(screen_position, avg_depth, fov_size, frame_size);
-	setDetected();
+// Kalman filter process and measurement noise. Matches the filter in
+// kalman.cpp - constant velocity, with velocity decaying by half each step
+const float kfVelocityDecay = 0.5f;
+const float kfMeasurementNoise = 0.1f;
+const float kfInitialCovariance = 0.1f;
 
-	// Label with base-26 letter ID (A, B, C .. Z, AA, AB, AC, etc)
+string trackedObjectLabel(int id)
+{
+	string label;
 	do
 	{
-		id_ += (char)(id % 26 + 'A');
+		label += (char)(id % 26 + 'A');
 		id /= 26;
 	}
 	while (id != 0);
-	reverse(id_.begin(), id_.end());
+	reverse(label.begin(), label.end());
+	return label;
 }
 
-
-#if 0
-TrackedObject::~TrackedObject()
+//Create a tracked object list
+// those stay constant for the entire length of the run
+TrackedObjectList::TrackedObjectList(const Size &imageSize,
+									 const Point2f &fovSize,
+									 float cameraElevation,
+									 float dt,
+									 float accelNoiseMag,
+									 size_t historyLength) :
+	nextId_(0),
+	imageSize_(imageSize),
+	fovSize_(fovSize),
+	cameraElevation_(cameraElevation),
+	dt_(dt),
+	accelNoiseMag_(accelNoiseMag),
+	historyLength_(historyLength),
+	gatedAssignment_(false)
 {
+	// Detect history is a bitmask
+	assert((historyLength_ > 0) && (historyLength_ <= 32));
 }
-#endif
-
-// Set the position based on x,y,z coords
 
-void TrackedObject::setPosition(const Point3f &new_position)
+// Types are compared by contour, which is slow, so only
+// do it once per detection to find its index in the table
+uint16_t TrackedObjectList::typeIndex(const ObjectType &type)
 {
-	position_ = new_position;
-	addToPositionHistory(position_);
+	for (size_t i = 0; i < typeTable_.size(); i++)
+		if (typeTable_[i] == type)
+			return i;
+	typeTable_.push_back(type);
+	return typeTable_.size() - 1;
 }
 
-// Set the position based on a rect on the screen and depth info from the zed
-void TrackedObject::setPosition(const Rect &screen_position, double avg_depth,
-		                        const Point2f &fov_size, const Size &frame_size)
+void TrackedObjectList::addObject(const ObjectType &type, const Rect &screen_position, double avg_depth)
 {
-	setPosition(type_.screenToWorldCoords(screen_position, avg_depth, fov_size, frame_size, cameraElevation_));
+	const uint16_t type_index = typeIndex(type);
+	const Point3f position(typeTable_[type_index].screenToWorldCoords(screen_position, avg_depth, fovSize_, imageSize_, cameraElevation_));
+
+	ids_.push_back(nextId_++);
+	types_.push_back(type_index);
+	positions_.push_back(position);
+	detectHistory_.push_back(0);
+	detectHistorySize_.push_back(0);
+	missedFrameCount_.push_back(0);
+	positionHistory_.resize(positionHistory_.size() + historyLength_);
+	positionHead_.push_back(0);
+	positionCount_.push_back(0);
+
+	kfPosPre_.push_back(position);
+	kfVelPre_.push_back(Point3f());
+	kfPosPost_.push_back(position);
+	kfVelPost_.push_back(Point3f());
+	const Covariance zero = {0, 0, 0};
+	const Covariance initial = {kfInitialCovariance, 0, kfInitialCovariance};
+	kfCovPre_.push_back(zero);
+	kfCovPost_.push_back(initial);
+
+	const size_t index = ids_.size() - 1;
+	setPosition(index, position);
+	setDetected(index, true);
 }
 
-#if 0
-void TrackedObject::adjustPosition(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot)
+// Set the position and keep a history of
+// the most recent positions of the object
+void TrackedObjectList::setPosition(size_t index, const Point3f &position)
 {
-	//Eigen::AngleAxisd rot(0.5*M_PI, Eigen::Vector3d::UnitZ());
-
-	Eigen::Vector3d old_pos_vec(_position.x, _position.y, _position.z);
-	Eigen::Vector3d new_pos_vec = delta_robot * old_pos_vec;
-
-	position_ = Point3f(new_pos_vec[0], new_pos_vec[1], new_pos_vec[2]);
+	positions_[index] = position;
 
-	for (auto it = positionHistory_.begin(); it != positionHistory_.end(); ++it)
-	{
-		Eigen::Vector3d old_pos_vector(it->x, it->y, it->z);
-		Eigen::Vector3d new_pos_vector = delta_robot * old_pos_vector;
-		*it = Point3f(new_pos_vector[0], new_pos_vector[1], new_pos_vector[2]);
-	}
-}
-#endif
-void TrackedObject::adjustPosition(const Mat &transform_mat, float depth, const Point2f &fov_size, const Size &frame_size)
-{
-	//get the position of the object on the screen
-	Rect screen_rect = getScreenPosition(fov_size,frame_size);
-	Point screen_pos(screen_rect.tl().x + screen_rect.width / 2, screen_rect.tl().y + screen_rect.height / 2);
-
-	//create a matrix to hold positon for matrix multiplication
-	Mat pos_mat(3,1,CV_64FC1);
-	pos_mat.at<double>(0,0) = screen_pos.x;
-	pos_mat.at<double>(0,1) = screen_pos.y;
-	pos_mat.at<double>(0,2) = 1.0;
-
-	//correct the position
-	Mat new_screen_pos_mat(3,1,CV_64FC1);
-	new_screen_pos_mat = transform_mat * pos_mat;
-	Point new_screen_pos(new_screen_pos_mat.at<double>(0),new_screen_pos_mat.at<double>(1));
-
-	//create a dummy bounding rect because setPosition requires a bounding rect as an input rather than a point
-	Rect new_screen_rect(new_screen_pos.x,new_screen_pos.y,0,0);
-	setPosition(new_screen_rect,depth,fov_size,frame_size);
-	//update the history
-	for (auto it = positionHistory_.begin(); it != positionHistory_.end(); ++it)
-	{
-		screen_rect = type_.worldToScreenCoords(*it,fov_size,frame_size, cameraElevation_);
-		screen_pos = Point(screen_rect.tl().x + screen_rect.width / 2, screen_rect.tl().y + screen_rect.height / 2);
-		pos_mat.at<double>(0,0) = screen_pos.x;
-		pos_mat.at<double>(0,1) = screen_pos.y;
-		pos_mat.at<double>(0,2) = 1.0;
-		Mat new_screen_pos_mat = transform_mat * pos_mat;
-		Point new_screen_pos(new_screen_pos_mat.at<double>(0),new_screen_pos_mat.at<double>(1));
-		Rect new_screen_rect(new_screen_pos.x,new_screen_pos.y,0,0);
-		*it = type_.screenToWorldCoords(new_screen_rect, depth, fov_size, frame_size, cameraElevation_);
-	}
+	positionHistory_[index * historyLength_ + positionHead_[index]] = position;
+	positionHead_[index] = (positionHead_[index] + 1) % historyLength_;
+	if (positionCount_[index] < historyLength_)
+		positionCount_[index] += 1;
 }
 
-// Mark the object as detected in this frame
-void TrackedObject::setDetected(void)
+// Mark the object as detected or not in this frame
+void TrackedObjectList::setDetected(size_t index, bool detected)
 {
-	detectHistory_.push_back(true);
-	missedFrameCount_ = 0;
+	const uint32_t mask = (historyLength_ == 32) ? 0xffffffff : ((1U << historyLength_) - 1);
+	detectHistory_[index] = ((detectHistory_[index] << 1) | (detected ? 1 : 0)) & mask;
+	if (detectHistorySize_[index] < historyLength_)
+		detectHistorySize_[index] += 1;
+	if (detected)
+		missedFrameCount_[index] = 0;
+	else
+		missedFrameCount_[index] += 1;
 }
 
-// Clear the object detect flag for this frame.
-// Probably should only happen when moving to a new
-// frame, but may be useful in other cases
-void TrackedObject::clearDetected(void)
+static int popCount(uint32_t bits)
 {
-	detectHistory_.push_back(false);
-	missedFrameCount_ += 1;
+	int count = 0;
+	for (; bits; bits &= bits - 1)
+		count += 1;
+	return count;
 }
 
-bool TrackedObject::tooManyMissedFrames(void) const
+bool TrackedObjectList::tooManyMissedFrames(size_t index) const
 {
 	// Hard limit on the number of consecutive missed
 	// frames before dropping a track
-	if (missedFrameCount_ > missedFrameCountMax)
+	if (missedFrameCount_[index] > missedFrameCountMax)
 		return true;
 
 	// Be more aggressive about dropping tracks which
 	// haven't been around long - kill them off if 
 	// they are seen in less than 33% of frames
-	if (detectHistory_.size() <= 10)
+	const size_t history_size = detectHistorySize_[index];
+	if (history_size <= 10)
 	{
-		size_t detectCount = 0;
-		for (auto it = detectHistory_.begin();  it != detectHistory_.end(); ++it)
-			if (*it)
-				detectCount += 1;
-		if (((double)detectCount / detectHistory_.size()) <= 0.34)
+		const size_t detect_count = popCount(detectHistory_[index]);
+		if (((double)detect_count / history_size) <= 0.34)
 			return true;
 	}
 	return false;
 }
 
-// Keep a history of the most recent positions
-// of the object in question
-void TrackedObject::addToPositionHistory(const Point3f &pt)
-{
-	positionHistory_.push_back(pt);
-}
-
-// Return a vector of points of the position history
-// of the object (hopefully) relative to current screen location
-vector <Point> TrackedObject::getScreenPositionHistory(const Point2f &fov_size, const Size &frame_size) const
-{
-	vector <Point> ret;
-
-	for (auto it = positionHistory_.begin(); it != positionHistory_.end(); ++it)
-	{
-		Rect screen_rect(type_.worldToScreenCoords(*it,fov_size,frame_size, cameraElevation_));
-		ret.push_back(Point(cvRound(screen_rect.x + screen_rect.width / 2.),cvRound( screen_rect.y + screen_rect.height / 2.)));
-	}
-	return ret;
-}
-
 const double minDisplayRatio = 0.3;
 
-// Return the percent of last detectHistory_.capacity() frames
+// Return the percent of last historyLength_ frames
 // the object was seen
-double TrackedObject::getDetectedRatio(void) const
+double TrackedObjectList::getDetectedRatio(size_t index) const
 {
+	const size_t history_size = detectHistorySize_[index];
+	const size_t capacity = historyLength_;
+
 	// Need at least 2 frames to believe there's something real
-	if (detectHistory_.size() <= 1)
+	if (history_size <= 1)
 		return 0.01;
 
 	// Don't display stuff which hasn't been detected recently.
-	if (missedFrameCount_ >= 3)
+	if (missedFrameCount_[index] >= 3)
 		return 0.01;
 
-	size_t detectCount = 0;
-	for (auto it = detectHistory_.begin();  it != detectHistory_.end(); ++it)
-		if (*it)
-			detectCount += 1;
+	const size_t detect_count = popCount(detectHistory_[index]);
 
 	// For newly added tracks make sure only 1 frame is missed at most
 	// while the first quarter of the buffer is filled and at most
 	// two are missed while filling up to half the size of the buffer
-	if (detectHistory_.size() < (detectHistory_.capacity()/2))
+	if (history_size < (capacity/2))
 	{
-		if (detectCount < (detectHistory_.size() - 2))
+		if (detect_count < (history_size - 2))
 			return 0.01;
-		if ((detectHistory_.size() <= (detectHistory_.capacity()/4)) && (detectCount < (detectHistory_.size() - 1)))
+		if ((history_size <= (capacity/4)) && (detect_count < (history_size - 1)))
 			return 0.01;
 
 		// Ramp up from minDisplayRatio so that at 10 hits it will
@@ -291,113 +259,154 @@ double TrackedObject::getDetectedRatio(void) const
 		// 7:7 = 45%
 		// 8:8 = 47.5%
 		// 9:9 = 50%
-		double endRatio =  (detectHistory_.capacity() / 2.0 - (detectHistory_.size() - detectCount)) / detectHistory_.capacity();
-		return minDisplayRatio + (detectHistory_.size() - 2.0) * (endRatio - minDisplayRatio) / (detectHistory_.capacity() / 2.0 - 2.0);
+		double endRatio =  (capacity / 2.0 - (history_size - detect_count)) / capacity;
+		return minDisplayRatio + (history_size - 2.0) * (endRatio - minDisplayRatio) / (capacity / 2.0 - 2.0);
 	}
-	double detectRatio = (double)detectCount / detectHistory_.capacity();
+	double detectRatio = (double)detect_count / capacity;
 	return detectRatio;
 }
 
-
-Rect TrackedObject::getScreenPosition(const Point2f &fov_size, const Size &frame_size) const
+Rect TrackedObjectList::getScreenPosition(size_t index) const
 {
-	return type_.worldToScreenCoords(position_, fov_size, frame_size, cameraElevation_);
+	return getType(index).worldToScreenCoords(positions_[index], fovSize_, imageSize_, cameraElevation_);
 }
 
-
-//fit the contour of the object into the rect of it and return the area of that
-//kinda gimmicky but pretty cool and might have uses in the future
-double TrackedObject::contourArea(const Point2f &fov_size, const Size &frame_size) const
+Rect TrackedObjectList::getPredictedScreenPosition(size_t index) const
 {
-	Rect screen_position = getScreenPosition(fov_size, frame_size);
-	float scale_factor_x = (float)screen_position.width / type_.width();
-	float scale_factor_y = (float)screen_position.height / type_.height();
-	float scale_factor   = min(scale_factor_x, scale_factor_y);
-
-	vector<Point2f> scaled_contour;
-	for(size_t i = 0; i < type_.shape().size(); i++)
-	{
-		scaled_contour.push_back(type_.shape()[i] * scale_factor);
-	}
-
-	return cv::contourArea(scaled_contour);
+	const Point3f prediction(kfPosPost_[index] + dt_ * kfVelPost_[index]);
+	return getType(index).worldToScreenCoords(prediction, fovSize_, imageSize_, cameraElevation_);
 }
 
-Point3f TrackedObject::predictKF(void)
+// Kalman predict step, per axis :
+//   x' = x + v * dt
+//   v' = v * kfVelocityDecay
+// with the covariance updated as P' = F P F^T + Q
+Point3f TrackedObjectList::predictKF(size_t index)
 {
-	return KF_.GetPrediction();
+	const float dt = dt_;
+	const float a  = kfVelocityDecay;
+	const float q  = accelNoiseMag_;
+
+	kfPosPre_[index] = kfPosPost_[index] + dt * kfVelPost_[index];
+	kfVelPre_[index] = a * kfVelPost_[index];
+
+	const Covariance &p = kfCovPost_[index];
+	Covariance &pre = kfCovPre_[index];
+	pre.pp = p.pp + 2 * dt * p.pv + dt * dt * p.vv + q * powf(dt, 4) / 4;
+	pre.pv = a * (p.pv + dt * p.vv)                + q * powf(dt, 3) / 2;
+	pre.vv = a * a * p.vv                          + q * dt * dt;
+
+	// Same as OpenCV - if a correction doesn't follow,
+	// the prediction is the best estimate
+	kfPosPost_[index] = kfPosPre_[index];
+	kfVelPost_[index] = kfVelPre_[index];
+	kfCovPost_[index] = pre;
+	return kfPosPre_[index];
 }
 
-
-Point3f TrackedObject::updateKF(Point3f pt)
+// Kalman correct step using a measured position
+Point3f TrackedObjectList::updateKF(size_t index, const Point3f &pt)
 {
-	return KF_.Update(pt);
+	const Covariance &pre = kfCovPre_[index];
+	const float s  = pre.pp + kfMeasurementNoise;
+	const float kp = pre.pp / s;
+	const float kv = pre.pv / s;
+
+	const Point3f innovation(pt - kfPosPre_[index]);
+	kfPosPost_[index] = kfPosPre_[index] + kp * innovation;
+	kfVelPost_[index] = kfVelPre_[index] + kv * innovation;
+
+	Covariance &post = kfCovPost_[index];
+	post.pp = pre.pp - kp * pre.pp;
+	post.pv = pre.pv - kp * pre.pv;
+	post.vv = pre.vv - kv * pre.pv;
+	return kfPosPost_[index];
 }
 
-#if 0
-void TrackedObject::adjustKF(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot)
+void TrackedObjectList::adjustKF(size_t index, const Point3f &delta_pos)
 {
-	KF_.adjustPrediction(delta_robot);
+	kfPosPre_[index] += delta_pos;
 }
-#endif
-void TrackedObject::adjustKF(Point3f delta_pos)
+
+void TrackedObjectList::adjustPosition(size_t index, const Mat &transform_mat, float depth)
 {
-	KF_.adjustPrediction(delta_pos);
-}
+	const ObjectType &type = getType(index);
 
+	//get the position of the object on the screen
+	Rect screen_rect = getScreenPosition(index);
+	Point screen_pos(screen_rect.tl().x + screen_rect.width / 2, screen_rect.tl().y + screen_rect.height / 2);
 
-//Create a tracked object list
-// those stay constant for the entire length of the run
-TrackedObjectList::TrackedObjectList(const Size &imageSize, const Point2f &fovSize, float cameraElevation) :
-	detectCount_(0),
-	imageSize_(imageSize),
-	fovSize_(fovSize),
-	cameraElevation_(cameraElevation)
-{
-}
-#if 0
-// Adjust position for camera motion between frames using fovis
-void TrackedObjectList::adjustLocation(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot)
-{
-	for (auto it = list_.begin(); it != list_.end(); ++it)
+	//create a matrix to hold positon for matrix multiplication
+	Mat pos_mat(3,1,CV_64FC1);
+	pos_mat.at<double>(0,0) = screen_pos.x;
+	pos_mat.at<double>(0,1) = screen_pos.y;
+	pos_mat.at<double>(0,2) = 1.0;
+
+	//correct the position
+	Mat new_screen_pos_mat(3,1,CV_64FC1);
+	new_screen_pos_mat = transform_mat * pos_mat;
+	Point new_screen_pos(new_screen_pos_mat.at<double>(0),new_screen_pos_mat.at<double>(1));
+
+	//create a dummy bounding rect because screenToWorldCoords requires a bounding rect as an input rather than a point
+	Rect new_screen_rect(new_screen_pos.x,new_screen_pos.y,0,0);
+	setPosition(index, type.screenToWorldCoords(new_screen_rect, depth, fovSize_, imageSize_, cameraElevation_));
+
+	//update the history
+	Point3f *history = &positionHistory_[index * historyLength_];
+	for (size_t i = 0; i < positionCount_[index]; i++)
 	{
-		it->adjustPosition(delta_robot);
-		it->adjustKF(delta_robot);
+		screen_rect = type.worldToScreenCoords(history[i],fovSize_,imageSize_, cameraElevation_);
+		screen_pos = Point(screen_rect.tl().x + screen_rect.width / 2, screen_rect.tl().y + screen_rect.height / 2);
+		pos_mat.at<double>(0,0) = screen_pos.x;
+		pos_mat.at<double>(0,1) = screen_pos.y;
+		pos_mat.at<double>(0,2) = 1.0;
+		Mat new_screen_pos_mat = transform_mat * pos_mat;
+		Point new_screen_pos(new_screen_pos_mat.at<double>(0),new_screen_pos_mat.at<double>(1));
+		Rect new_screen_rect(new_screen_pos.x,new_screen_pos.y,0,0);
+		history[i] = type.screenToWorldCoords(new_screen_rect, depth, fovSize_, imageSize_, cameraElevation_);
 	}
 }
-#endif
+
 // Adjust position for camera motion between frames using optical flow
 void TrackedObjectList::adjustLocation(const Mat &transform_mat)
 {
-	for (auto it = list_.begin(); it != list_.end(); ++it)
+	for (size_t i = 0; i < size(); i++)
 	{
 		//measure the amount that the position changed and apply the same change to the kalman filter
-		Point3f old_pos = it->getPosition();
+		const Point3f old_pos = positions_[i];
 		//compute r and use it for depth (assume depth doesn't change)
-		float r = sqrt(it->getPosition().x * it->getPosition().x + it->getPosition().y * it->getPosition().y + it->getPosition().z * it->getPosition().z);
-		it->adjustPosition(transform_mat, r, fovSize_, imageSize_);
-		Point3f delta_pos = it->getPosition() - old_pos;
-
-		it->adjustKF(delta_pos);
+		const float r = sqrt(old_pos.x * old_pos.x + old_pos.y * old_pos.y + old_pos.z * old_pos.z);
+		adjustPosition(i, transform_mat, r);
+		adjustKF(i, positions_[i] - old_pos);
 	}
 }
 
-// Get position history for each tracked object
+// Get position history for each tracked object, oldest first
 vector<vector<Point>> TrackedObjectList::getScreenPositionHistories(void) const
 {
-	vector<vector<Point>> ret;
-	for (auto it = list_.begin(); it != list_.end(); ++it)
-		ret.push_back(it->getScreenPositionHistory(fovSize_, imageSize_));
+	vector<vector<Point>> ret(size());
+	for (size_t i = 0; i < size(); i++)
+	{
+		const ObjectType &type = getType(i);
+		const Point3f *history = &positionHistory_[i * historyLength_];
+		const size_t count = positionCount_[i];
+		const size_t oldest = (positionHead_[i] + historyLength_ - count) % historyLength_;
+		for (size_t j = 0; j < count; j++)
+		{
+			const Rect screen_rect(type.worldToScreenCoords(history[(oldest + j) % historyLength_], fovSize_, imageSize_, cameraElevation_));
+			ret[i].push_back(Point(cvRound(screen_rect.x + screen_rect.width / 2.),cvRound( screen_rect.y + screen_rect.height / 2.)));
+		}
+	}
 	return ret;
 }
 
 // Simple printout of list into stdout
 void TrackedObjectList::print(void) const
 {
-	for (auto it = list_.cbegin(); it != list_.cend(); ++it)
+	for (size_t i = 0; i < size(); i++)
 	{
-		cout << it->getId() << " location ";
-		Point3f position = it->getPosition();
+		cout << trackedObjectLabel(ids_[i]) << " location ";
+		const Point3f &position = positions_[i];
 		cout << "(" << position.x << "," << position.y << "," << position.z << ")" << endl;
 	}
 }
@@ -405,17 +414,78 @@ void TrackedObjectList::print(void) const
 // Return list of detect info for external processing
 void TrackedObjectList::getDisplay(vector<TrackedObjectDisplay> &displayList) const
 {
-	displayList.clear();
-	TrackedObjectDisplay tod;
-	for (auto it = list_.cbegin(); it != list_.cend(); ++it)
+	displayList.resize(size());
+	for (size_t i = 0; i < size(); i++)
+	{
+		TrackedObjectDisplay &tod = displayList[i];
+		tod.id       = ids_[i];
+		tod.rect     = getScreenPosition(i);
+		tod.ratio    = getDetectedRatio(i);
+		tod.position = positions_[i];
+		tod.name     = getType(i).name();
+	}
+}
+
+size_t TrackedObjectList::missedCount(void) const
+{
+	size_t missed = 0;
+	for (size_t i = 0; i < size(); i++)
+		if (missedFrameCount_[i] != 0)
+			missed += 1;
+	return missed;
+}
+
+// Remove tracks which haven't been seen in a while, keeping
+// the rest in order. Each array is compacted in place
+void TrackedObjectList::removeLost(void)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < size(); i++)
 	{
-		tod.id       = it->getId();
-		tod.rect     = it->getScreenPosition(fovSize_, imageSize_);
-		tod.ratio    = it->getDetectedRatio();
-		tod.position = it->getPosition();
-		tod.name	 = it->getType().name();
-		displayList.push_back(tod);
+		if (tooManyMissedFrames(i))
+		{
+#ifdef VERBOSE_TRACK
+			cout << "Dropping " << trackedObjectLabel(ids_[i]) << endl;
+#endif
+			continue;
+		}
+		if (kept != i)
+		{
+			ids_[kept]              = ids_[i];
+			types_[kept]            = types_[i];
+			positions_[kept]        = positions_[i];
+			detectHistory_[kept]    = detectHistory_[i];
+			detectHistorySize_[kept]      = detectHistorySize_[i];
+			missedFrameCount_[kept] = missedFrameCount_[i];
+			copy(positionHistory_.begin() + i * historyLength_,
+				 positionHistory_.begin() + (i + 1) * historyLength_,
+				 positionHistory_.begin() + kept * historyLength_);
+			positionHead_[kept]     = positionHead_[i];
+			positionCount_[kept]    = positionCount_[i];
+			kfPosPre_[kept]         = kfPosPre_[i];
+			kfVelPre_[kept]         = kfVelPre_[i];
+			kfPosPost_[kept]        = kfPosPost_[i];
+			kfVelPost_[kept]        = kfVelPost_[i];
+			kfCovPre_[kept]         = kfCovPre_[i];
+			kfCovPost_[kept]        = kfCovPost_[i];
+		}
+		kept += 1;
 	}
+	ids_.resize(kept);
+	types_.resize(kept);
+	positions_.resize(kept);
+	detectHistory_.resize(kept);
+	detectHistorySize_.resize(kept);
+	missedFrameCount_.resize(kept);
+	positionHistory_.resize(kept * historyLength_);
+	positionHead_.resize(kept);
+	positionCount_.resize(kept);
+	kfPosPre_.resize(kept);
+	kfVelPre_.resize(kept);
+	kfPosPost_.resize(kept);
+	kfVelPost_.resize(kept);
+	kfCovPre_.resize(kept);
+	kfCovPost_.resize(kept);
 }
 
 const double dist_thresh_ = 1.0; // FIX ME!
@@ -429,151 +499,230 @@ void TrackedObjectList::processDetect(const vector<Rect> &detectedRects,
 									  const vector<float> &depths,
 									  const vector<ObjectType> &types)
 {
-	vector<Point3f> detectedPositions;
 #ifdef VERBOSE_TRACK
-	if (detectedRects.size() || list_.size())
+	if (detectedRects.size() || size())
 		cout << "---------- Start of process detect --------------" << endl;
 	print();
 	if (detectedRects.size() > 0)
 		cout << detectedRects.size() << " detected objects" << endl;
 #endif
-	for (size_t i = 0; i < detectedRects.size(); i++)
+	const size_t tracks = size();                    // number of tracked objects from prev frames
+	const size_t detections = detectedRects.size(); // number of detections this frame
+
+	detectedPositions_.resize(detections);
+	detectedTypes_.resize(detections);
+	for (size_t i = 0; i < detections; i++)
 	{
-		detectedPositions.push_back(
-				types[i].screenToWorldCoords(detectedRects[i], depths[i], fovSize_, imageSize_, cameraElevation_));
+		detectedTypes_[i] = typeIndex(types[i]);
+		detectedPositions_[i] =
+				typeTable_[detectedTypes_[i]].screenToWorldCoords(detectedRects[i], depths[i], fovSize_, imageSize_, cameraElevation_);
 #ifdef VERBOSE_TRACK
-		cout << "Detected rect [" << i << "] = " << detectedRects[i] << " positions[" << detectedPositions.size() - 1 << "]:" << detectedPositions[detectedPositions.size()-1] << endl;
+		cout << "Detected rect [" << i << "] = " << detectedRects[i] << " positions[" << i << "]:" << detectedPositions_[i] << endl;
 #endif
 	}
 	// TODO :: Combine overlapping detections into one?
 
 	// Maps tracks to the closest new detected object.
 	// assignment[track] = index of closest detection
-	vector<int> assignment;
-	if (list_.size())
+	assignment_.assign(tracks, -1);
+	if (tracks && detections)
 	{
-		size_t tracks = list_.size();		          // number of tracked objects from prev frames
-		size_t detections = detectedPositions.size(); // number of detections this frame
-
-		//Cost[t][d] is the distance between old tracked location t
-		//and newly detected object d's position 
-		vector< vector<double> > Cost(tracks,vector<double>(detections));
+		//Cost[t * detections + d] is the distance between old tracked
+		//location t and newly detected object d's position
+		cost_.resize(tracks * detections);
 
 		// Calculate cost for each track->pair combo
 		// The cost here is just the distance between them
-		// Also check to see if the types are the same, if they are not then set the cost extremely high so that it's never matched
-		auto it = list_.cbegin();
-		for(size_t t = 0; t < tracks;  ++t, ++it)
+		// Also check to see if the types are the same, if they are not then the cost is infinite so that it's never matched
+		for(size_t t = 0; t < tracks;  ++t)
 		{
-			// Point3f prediction=tracks[t]->prediction;
-			// cout << prediction << endl;
+			double *row = &cost_[t * detections];
+			const Point3f &position = positions_[t];
+			const uint16_t type = types_[t];
 			for(size_t d = 0; d < detections; d++)
 			{
-				const ObjectType it_type = it->getType();
-				if(types[d] == it_type) {
-					Point3f diff = it->getPosition() - detectedPositions[d];
-					Cost[t][d] = sqrtf(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z);
+				if(detectedTypes_[d] == type) {
+					const Point3f diff = position - detectedPositions_[d];
+					row[d] = sqrtf(diff.x * diff.x + diff.y * diff.y + diff.z * diff.z);
 				} else {
-					Cost[t][d] = numeric_limits<double>::max();
+					row[d] = numeric_limits<double>::infinity();
 				}
 			}
 		}
 
 		// Solving assignment problem (find minimum-cost assignment
 		// between tracks and previously-predicted positions)
-		AssignmentProblemSolver APS;
-		APS.Solve(Cost, assignment, AssignmentProblemSolver::optimal);
+		if (gatedAssignment_)
+			solver_.solveGated(&cost_[0], tracks, detections, dist_thresh_, assignment_);
+		else
+			solver_.solve(&cost_[0], tracks, detections, assignment_);
 
 #ifdef VERBOSE_TRACK
 		// assignment[i] holds the index of the detection assigned
 		// to track i.  assignment[i] is -1 if no detection was
 		// matchedto that particular track
-		cout << "After APS : "<<endl;
-		for(size_t i = 0; i < assignment.size(); i++)
-			cout << i << ":" << assignment[i] << endl;
+		cout << "After LAPJV : "<<endl;
+		for(size_t i = 0; i < assignment_.size(); i++)
+			cout << i << ":" << assignment_[i] << endl;
 #endif
 		// clear assignment from pairs with large distance
-		for(size_t i = 0; i < assignment.size(); i++)
-			if ((assignment[i] != -1) && (Cost[i][assignment[i]] > dist_thresh_))
-				assignment[i] = -1;
+		for(size_t i = 0; i < assignment_.size(); i++)
+			if ((assignment_[i] != -1) && (cost_[i * detections + assignment_[i]] > dist_thresh_))
+				assignment_[i] = -1;
 	}
 
 	// Search for unassigned detects and start new tracks for them.
 	// This will also handle the case where no tracks are present,
 	// since assignment will be empty in that case - everything gets added
-	for(size_t i = 0; i < detectedPositions.size(); i++)
+	detectionUsed_.assign(detections, 0);
+	for (size_t t = 0; t < tracks; t++)
+		if (assignment_[t] != -1)
+			detectionUsed_[assignment_[t]] = 1;
+	for(size_t i = 0; i < detections; i++)
 	{
-		if (find(assignment.begin(), assignment.end(), i) == assignment.end())
+		if (!detectionUsed_[i])
 		{
 #ifdef VERBOSE_TRACK
 			cout << "New assignment created " << i << endl;
 #endif
-			list_.push_back(TrackedObject(detectCount_++, types[i], detectedRects[i], depths[i], fovSize_, imageSize_, cameraElevation_));
-
-#ifdef VERBOSE_TRACK
-			cout << "New assignment finished" << endl;
-#endif
+			addObject(types[i], detectedRects[i], depths[i]);
 		}
 	}
 
-	auto tr = list_.begin();
-	auto as = assignment.begin();
-	while ((tr != list_.end()) && (as != assignment.end()))
+	// Only the tracks from previous frames, new ones
+	// have already been set from their detection
+	for (size_t t = 0; t < tracks; t++)
 	{
-		// If track updated less than one time, than filter state is not correct.
-#ifdef VERBOSE_TRACK
-		cout << "Predict: " << endl;
-#endif
-		Point3f prediction = tr->predictKF();
+		const Point3f prediction = predictKF(t);
 #ifdef VERBOSE_TRACK
 		cout << "prediction:" << prediction << endl;
 #endif
 
-		if(*as != -1) // If we have assigned detect, then update using its coordinates
+		if(assignment_[t] != -1) // If we have assigned detect, then update using its coordinates
 		{
-#ifdef VERBOSE_TRACK
-			cout << "Update match: " << endl;
-#endif
-			tr->setPosition(tr->updateKF(detectedPositions[*as]));
-#ifdef VERBOSE_TRACK
-			cout << tr->getScreenPosition(fovSize_, imageSize_) << endl;
-#endif
-			tr->setDetected();
+			setPosition(t, updateKF(t, detectedPositions_[assignment_[t]]));
+			setDetected(t, true);
 		}
 		else          // if not continue using predictions
 		{
+			setPosition(t, updateKF(t, prediction));
+			setDetected(t, false);
+		}
 #ifdef VERBOSE_TRACK
-			cout << "Update no match: " << endl;
+		cout << getScreenPosition(t) << endl;
 #endif
-			tr->setPosition(tr->updateKF(prediction));
+	}
+
+	removeLost();
 #ifdef VERBOSE_TRACK
-			cout << tr->getScreenPosition(fovSize_, imageSize_) << endl;
+	print();
+	if (detectedRects.size() || size())
+		cout << "---------- End of process detect --------------" << endl;
 #endif
-			tr->clearDetected();
-		}
+}
 
-		++tr;
-		++as;
+// Search windows for the next frame, one per tracked object
+// then merged where they overlap
+void TrackedObjectList::getSearchWindows(vector<Rect> &windows, float margin, int minSize) const
+{
+	windows.clear();
+	const Rect frame(Point(0, 0), imageSize_);
+	for (size_t i = 0; i < size(); i++)
+	{
+		// Cover both where it is and where it is headed, in
+		// case the prediction is off
+		const Rect current(getScreenPosition(i));
+		const Rect predicted(getPredictedScreenPosition(i));
+		Rect window(current | predicted);
+
+		const int grow_x = max(cvRound(margin * max(current.width, predicted.width)), minSize);
+		const int grow_y = max(cvRound(margin * max(current.height, predicted.height)), minSize);
+		window = Rect(window.x - grow_x, window.y - grow_y,
+					  window.width + 2 * grow_x, window.height + 2 * grow_y) & frame;
+		if (window.area() > 0)
+			windows.push_back(window);
 	}
 
-	// Remove tracks which haven't been seen in a while
-	for (auto it = list_.begin(); it != list_.end(); )
+	// Merging two windows can make the result overlap
+	// another one, so repeat until nothing changes.
+	// There are only ever a handful of these
+	bool merged = true;
+	while (merged)
 	{
-		if (it->tooManyMissedFrames()) // For now just remove ones for
-		{                              // which detectList is empty
-#ifdef VERBOSE_TRACK
-			cout << "Dropping " << it->getId() << endl;
-#endif
-			it = list_.erase(it);
-		}
-		else
+		merged = false;
+		for (size_t i = 0; (i < windows.size()) && !merged; i++)
 		{
-			++it;
+			for (size_t j = i + 1; j < windows.size(); j++)
+			{
+				if ((windows[i] & windows[j]).area() > 0)
+				{
+					windows[i] |= windows[j];
+					windows.erase(windows.begin() + j);
+					merged = true;
+					break;
+				}
+			}
 		}
 	}
-#ifdef VERBOSE_TRACK
-	print();
-	if (detectedRects.size() || list_.size())
-		cout << "---------- End of process detect --------------" << endl;
-#endif
+}
+
+SearchWindowTracker::SearchWindowTracker(const Size &imageSize,
+										 const Point2f &fovSize,
+										 float cameraElevation,
+										 int fullFrameInterval,
+										 float windowMargin,
+										 float maxWindowFraction) :
+	list_(imageSize, fovSize, cameraElevation),
+	imageSize_(imageSize),
+	fullFrameInterval_(fullFrameInterval),
+	windowMargin_(windowMargin),
+	maxWindowFraction_(maxWindowFraction),
+	framesSinceFull_(0),
+	lost_(true)
+{
+}
+
+bool SearchWindowTracker::nextWindows(vector<Rect> &windows)
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	windows.clear();
+	// Keep asking for full frames until one has come back through
+	// update(), frames already in flight don't count
+	framesSinceFull_ += 1;
+	if (lost_ || windows_.empty() || (framesSinceFull_ >= fullFrameInterval_))
+		return false;
+	windows = windows_;
+	return true;
+}
+
+void SearchWindowTracker::update(const vector<Rect> &detectedRects,
+								 const vector<float> &depths,
+								 const vector<ObjectType> &types,
+								 bool fullFrame)
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	list_.processDetect(detectedRects, depths, types);
+
+	// Something tracked wasn't where it was expected to be,
+	// go back to looking everywhere
+	if (fullFrame)
+	{
+		framesSinceFull_ = 0;
+		lost_ = false;
+	}
+	else if (list_.missedCount())
+		lost_ = true;
+
+	list_.getSearchWindows(windows_, windowMargin_);
+	int area = 0;
+	for (size_t i = 0; i < windows_.size(); i++)
+		area += windows_[i].area();
+	if (area > (maxWindowFraction_ * imageSize_.area()))
+		windows_.clear();
+}
+
+void SearchWindowTracker::getDisplay(vector<TrackedObjectDisplay> &displayList) const
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	list_.getDisplay(displayList);
 }
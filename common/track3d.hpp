@@ -1,124 +1,31 @@
 #pragma once
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <list>
-//#include <Eigen/Geometry>
-#include <boost/circular_buffer.hpp>
-#include "kalman.hpp"
+#include <mutex>
+#include "lapjv.hpp"
 #include "objtype.hpp"
 
 const size_t TrackedObjectHistoryLength = 20;
 
-// Class to hold info on a tracked object
-// Keeps a history per previous <historyLength> frames
-// of whether the object was seen or not, and the
-// calcualated distance and angle for each
-// detection.
-// Keep track of position (in 3 dimensions) of last detection - used
-// to compare against new hits to see if this is the
-// same object.
-// Has method to compensate for robot rotation and translation with
-// data from the fovis code
-class TrackedObject
-{
-	public :
-		TrackedObject( int         id,
-				const ObjectType  &type_in,
-				const cv::Rect    &screen_position,
-				double             avg_depth,
-				const cv::Point2f &fov_size,
-				const cv::Size    &frame_size,
-				float              camera_elevation = 0.0,
-				float              dt = 0.5,
-				float              accel_noise_mag = 0.25,
-				size_t             historyLength = TrackedObjectHistoryLength);
-
-		//~TrackedObject();
-
-		// Mark the object as detected in this frame
-		void setDetected(void);
-
-		// Clear the object detect flag for this frame.
-		// Probably should only happen when moving to a new
-		// frame, but may be useful in other cases
-		void clearDetected(void);
-
-		// Return the percent of last N frames
-		// in which the object was seen
-		double getDetectedRatio(void) const;
-
-		bool tooManyMissedFrames(void) const;
-
-		//contour area is the area of the contour stored in ObjectType
-		//scaled into the bounding rect
-		//only different in cases where contour is not a rectangle
-		double contourArea(const cv::Point2f &fov_size, const cv::Size &frame_size) const; //P.S. underestimates slightly
-
-		// Update current object position based on a 3d position or
-		//input rect on screen and depth
-		void setPosition(const cv::Point3f &new_position);
-		void setPosition(const cv::Rect &screen_position, double avg_depth, const cv::Point2f &fov_size, const cv::Size &frame_size);
-
-		// Adjust tracked object position based on motion
-		// of the camera
-		//void adjustPosition(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot);
-		void adjustPosition(const cv::Mat &transform_mat, float depth, const cv::Point2f &fov_size, const cv::Size &frame_size);
-
-		//get position of a rect on the screen corresponding to the object size and location
-		//inverse of setPosition(Rect,depth)
-		cv::Rect getScreenPosition(const cv::Point2f &fov_size, const cv::Size &frame_size) const;
-		cv::Point3f getPosition(void) const { return position_; }
-
-		//void adjustKF(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot);
-		void adjustKF(cv::Point3f delta_pos);
-
-		cv::Point3f predictKF(void);
-		cv::Point3f updateKF(cv::Point3f pt);
-		std::vector<cv::Point> getScreenPositionHistory(const cv::Point2f &fov_size, const cv::Size &frame_size) const;
-
-		std::string getId(void) const { return id_; }
-		ObjectType getType(void) const { return type_; }
-
-	private :
-		ObjectType type_;
-
-		cv::Point3f position_; // last position of tracked object
-
-		// whether or not the object was seen in a given frame -
-		// used to flag entries in other history arrays as valid
-		// and to figure out which tracked objects are persistent
-		// enough to care about
-		boost::circular_buffer<bool> detectHistory_;
-		boost::circular_buffer<cv::Point3f> positionHistory_;
-
-		// Kalman filter for tracking and noise filtering
-		TKalmanFilter KF_;
-
-		std::string id_; //unique target ID - use a string rather than numbers so it isn't confused
-						 // with individual frame detect indexes
-		int missedFrameCount_;
-
-		float cameraElevation_;
-
-		void addToPositionHistory(const cv::Point3f &pt);
-};
-
 // Used to return info to display
 struct TrackedObjectDisplay
 {
-	std::string id;
+	int id;
 	cv::Rect rect;
 	double ratio;
 	cv::Point3f position;
 	std::string name;
 };
 
+// Base-26 letter label for a track id (A, B, C .. Z, BA, BB, etc)
+std::string trackedObjectLabel(int id);
+
 // Tracked object array -
 //
-// Need to create array of tracked objects.
 // For each frame,
-//   use fovis data to determine camera translation and rotation
+//   use optical flow data to determine camera translation and rotation
 //   update each object's position to "undo" that motion
 //   for each detected rectangle
 //      try to find a close match in the list of previously detected objects
@@ -130,19 +37,31 @@ struct TrackedObjectDisplay
 //   off the screen is has been rotated, etc.  Don't be too aggressive
 //   since we could rotate back and "refind" an object which has disappeared
 //
+// Objects are stored as a structure of arrays, one entry per object in
+// each, so per frame updates walk contiguous memory instead of chasing
+// list nodes. Each object keeps, for the last historyLength frames :
+//  - whether it was detected, as a bitmask
+//  - its position, in a fixed size ring
+// and a kalman filter on its position. Every axis uses the same
+// constant velocity model and noise, so the three axes always have the
+// same covariance and the filter is kept as per axis state plus one
+// shared 2x2 (position, velocity) covariance.
+// Objects are identified by an int, unique for the life of the list.
 class TrackedObjectList
 {
 	public :
 		// Create a tracked object list.  Set the object width in inches
 		// (feet, meters, parsecs, whatever) and imageWidth in pixels since
 		// those stay constant for the entire length of the run
-		TrackedObjectList(const cv::Size &imageSize, 
-						  const cv::Point2f &fovSize, 
-						  float cameraElevation = 0.0f);
-
-		// Adjust the angle of each tracked object based on
-		// the rotation of the robot straight from fovis
-		//void adjustLocation(const Eigen::Transform<double, 3, Eigen::Isometry> &delta_robot);
+		TrackedObjectList(const cv::Size &imageSize,
+						  const cv::Point2f &fovSize,
+						  float cameraElevation = 0.0f,
+						  float dt = 0.5f,
+						  float accelNoiseMag = 0.25f,
+						  size_t historyLength = TrackedObjectHistoryLength);
+
+		// Adjust the position of each tracked object based on
+		// the camera motion from optical flow
 		void adjustLocation(const cv::Mat &transform_mat);
 
 		// Get position history for each tracked object
@@ -160,13 +79,141 @@ class TrackedObjectList
 						   const std::vector<float> &depths,
 						   const std::vector<ObjectType> &types);
 
+		// Regions of the next frame each object should show up in,
+		// based on where it is now and where the kalman filter predicts
+		// it will be. Each is grown by margin times its size on every side
+		// and windows which overlap are merged so nothing is searched twice
+		void getSearchWindows(std::vector<cv::Rect> &windows, float margin, int minSize = 16) const;
+
+		// When set, tracks are only ever matched with detections close
+		// enough to be the same object, and groups of tracks far apart
+		// from each other are matched separately. Much faster with lots
+		// of spread out objects. Off by default, which matches every
+		// track it can and then drops the pairs which are too far apart
+		void setGatedAssignment(bool gated) { gatedAssignment_ = gated; }
+
+		size_t size(void) const { return ids_.size(); }
+		// Number of objects not matched by the last processDetect call
+		size_t missedCount(void) const;
+
+		// Per object accessors, index is 0 .. size()-1. Indexes
+		// change as objects are dropped, ids don't
+		int getId(size_t index) const { return ids_[index]; }
+		const ObjectType &getType(size_t index) const { return typeTable_[types_[index]]; }
+		cv::Point3f getPosition(size_t index) const { return positions_[index]; }
+		cv::Rect getScreenPosition(size_t index) const;
+		// Where the kalman filter expects the object to be on
+		// the screen next frame, without advancing the filter
+		cv::Rect getPredictedScreenPosition(size_t index) const;
+		// Percent of the last historyLength frames the object was seen in
+		double getDetectedRatio(size_t index) const;
+
 	private :
-		std::list<TrackedObject> list_; // list of currently valid detected objects
-		int detectCount_;               // ID of next object to be created
+		// Shared (position, velocity) covariance of the kalman filter
+		struct Covariance
+		{
+			float pp;
+			float pv;
+			float vv;
+		};
+
+		// Object state, one entry per object
+		std::vector<int>         ids_;
+		std::vector<uint16_t>    types_;          // index into typeTable_
+		std::vector<cv::Point3f> positions_;      // last position of tracked object
+		std::vector<uint32_t>    detectHistory_;  // bit 0 is the most recent frame
+		std::vector<uint8_t>     detectHistorySize_; // frames in detectHistory_
+		std::vector<int>         missedFrameCount_;
+		std::vector<cv::Point3f> positionHistory_; // historyLength_ entries per object
+		std::vector<uint8_t>     positionHead_;    // next slot to write
+		std::vector<uint8_t>     positionCount_;
+
+		// Kalman filter state, before and after a correction
+		std::vector<cv::Point3f> kfPosPre_;
+		std::vector<cv::Point3f> kfVelPre_;
+		std::vector<cv::Point3f> kfPosPost_;
+		std::vector<cv::Point3f> kfVelPost_;
+		std::vector<Covariance>  kfCovPre_;
+		std::vector<Covariance>  kfCovPost_;
+
+		// The handful of distinct object types seen, so comparing
+		// types and storing them per object is just an index
+		std::vector<ObjectType>  typeTable_;
+
+		int nextId_;               // ID of next object to be created
 
 		//values stay constant throughout the run but are needed for computing stuff
 		cv::Size    imageSize_;
 		cv::Point2f fovSize_;
 		float       cameraElevation_;
+		float       dt_;
+		float       accelNoiseMag_;
+		size_t      historyLength_;
+		bool        gatedAssignment_;
+
+		// Reused from frame to frame in processDetect
+		std::vector<cv::Point3f>          detectedPositions_;
+		std::vector<uint16_t>             detectedTypes_;
+		std::vector<double>               cost_; // tracks x detections
+		std::vector<int>                  assignment_;
+		std::vector<char>                 detectionUsed_;
+		LAPJVSolver                       solver_;
+
+		uint16_t typeIndex(const ObjectType &type);
+		void addObject(const ObjectType &type, const cv::Rect &screen_position, double avg_depth);
+		void setPosition(size_t index, const cv::Point3f &position);
+		void setDetected(size_t index, bool detected);
+		bool tooManyMissedFrames(size_t index) const;
+		void adjustPosition(size_t index, const cv::Mat &transform_mat, float depth);
+		void removeLost(void);
+
+		cv::Point3f predictKF(size_t index);
+		cv::Point3f updateKF(size_t index, const cv::Point3f &pt);
+		void adjustKF(size_t index, const cv::Point3f &delta_pos);
 };
 
+// Decides which parts of each frame a detector needs to look at. While
+// objects are being tracked only the windows around their predicted
+// positions are searched, so per frame cost goes with the number of
+// targets instead of the image size. The whole frame is searched :
+//   - every fullFrameInterval frames, to pick up new objects
+//   - when nothing is being tracked
+//   - after a tracked object wasn't found in its window
+//   - when the windows would cover most of the frame anyway
+// nextWindows and update are safe to call from different threads, e.g.
+// different stages of a Pipeline
+class SearchWindowTracker
+{
+	public :
+		SearchWindowTracker(const cv::Size &imageSize,
+							const cv::Point2f &fovSize,
+							float cameraElevation = 0.0f,
+							int fullFrameInterval = 15,
+							float windowMargin = 1.0f,
+							float maxWindowFraction = 0.5f);
+
+		// Fill in the windows to search in the next frame. Returns
+		// false, with windows empty, if the whole frame should be searched
+		bool nextWindows(std::vector<cv::Rect> &windows);
+
+		// Detections from a frame, and whether it was a full frame search.
+		// Only a full frame result resets the full frame interval and
+		// the lost state, not handing one out from nextWindows
+		void update(const std::vector<cv::Rect> &detectedRects,
+					const std::vector<float> &depths,
+					const std::vector<ObjectType> &types,
+					bool fullFrame);
+
+		void getDisplay(std::vector<TrackedObjectDisplay> &displayList) const;
+
+	private :
+		mutable std::mutex    mutex_;
+		TrackedObjectList     list_;
+		cv::Size              imageSize_;
+		int                   fullFrameInterval_;
+		float                 windowMargin_;
+		float                 maxWindowFraction_;
+		int                   framesSinceFull_;
+		bool                  lost_;
+		std::vector<cv::Rect> windows_; // from the last update
+};
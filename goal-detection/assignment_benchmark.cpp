@@ -0,0 +1,169 @@
+// Times the track to detection assignment solvers against each other -
+// the Hungarian AssignmentProblemSolver, LAPJVSolver on the full cost
+// matrix and LAPJVSolver gated at the tracker's match distance.
+// Costs are distances between objects scattered over a field and
+// noisy detections of them, with some missed and some false detections
+// thrown in, like TrackedObjectList::processDetect sees.
+//   assignment_benchmark [iterations] [object count] [object count] ...
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "hungarian.hpp"
+#include "lapjv.hpp"
+
+using namespace std;
+
+static const double gate = 1.0; // same as dist_thresh_ in track3d.cpp
+
+struct Point
+{
+	double x;
+	double y;
+};
+
+static double elapsed(const chrono::steady_clock::time_point &start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Total cost and number of pairs within gate
+static double assignmentCost(const vector<vector<double> > &cost, const vector<int> &assignment, int &matched)
+{
+	double total = 0;
+	matched = 0;
+	for (size_t r = 0; r < assignment.size(); r++)
+	{
+		if (assignment[r] < 0)
+			continue;
+		const double c = cost[r][assignment[r]];
+		total += c;
+		if (c <= gate)
+			matched += 1;
+	}
+	return total;
+}
+
+static int runBenchmark(int object_count, int iterations)
+{
+	// Field grows with the object count so objects are as crowded
+	// with 400 of them as with 10
+	mt19937 rng(12345);
+	uniform_real_distribution<double> field(0, 2 * sqrt((double)object_count));
+	normal_distribution<double> noise(0, .1);
+	uniform_real_distribution<double> chance(0, 1);
+
+	AssignmentProblemSolver hungarian;
+	LAPJVSolver lapjv;
+
+	vector<Point> tracks(object_count);
+	vector<Point> detections;
+	vector<vector<double> > cost;
+	vector<double> flat_cost;
+	vector<int> hungarian_assignment;
+	vector<int> dense_assignment;
+	vector<int> gated_assignment;
+
+	double hungarian_time = 0;
+	double dense_time = 0;
+	double gated_time = 0;
+	int mismatches = 0;
+	int hungarian_matched = 0;
+	int gated_matched = 0;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (int i = 0; i < object_count; i++)
+		{
+			tracks[i].x = field(rng);
+			tracks[i].y = field(rng);
+		}
+
+		// Miss ~10% of objects, add ~5% false detections
+		detections.clear();
+		for (int i = 0; i < object_count; i++)
+		{
+			if (chance(rng) < .1)
+				continue;
+			Point p = {tracks[i].x + noise(rng), tracks[i].y + noise(rng)};
+			detections.push_back(p);
+		}
+		const int false_count = max(object_count / 20, 1);
+		for (int i = 0; i < false_count; i++)
+		{
+			Point p = {field(rng), field(rng)};
+			detections.push_back(p);
+		}
+
+		const int rows = tracks.size();
+		const int cols = detections.size();
+		cost.resize(rows);
+		flat_cost.resize(rows * cols);
+		for (int r = 0; r < rows; r++)
+		{
+			cost[r].resize(cols);
+			for (int c = 0; c < cols; c++)
+			{
+				const double dx = tracks[r].x - detections[c].x;
+				const double dy = tracks[r].y - detections[c].y;
+				cost[r][c] = flat_cost[r * cols + c] = sqrt(dx * dx + dy * dy);
+			}
+		}
+
+		// Hungarian converts the matrix and allocates each call,
+		// which is part of what it costs in the tracker so count it
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		hungarian.Solve(cost, hungarian_assignment, AssignmentProblemSolver::optimal);
+		hungarian_time += elapsed(start);
+
+		start = chrono::steady_clock::now();
+		lapjv.solve(&flat_cost[0], rows, cols, dense_assignment);
+		dense_time += elapsed(start);
+
+		start = chrono::steady_clock::now();
+		lapjv.solveGated(&flat_cost[0], rows, cols, gate, gated_assignment);
+		gated_time += elapsed(start);
+
+		// Both full matrix solvers should find the same total cost.
+		// Gating can trade a cheaper total for more pairs within the
+		// gate, so it has to match at least as many
+		int matched;
+		int gated;
+		const double hungarian_cost = assignmentCost(cost, hungarian_assignment, matched);
+		const double dense_cost = assignmentCost(cost, dense_assignment, gated);
+		if (fabs(hungarian_cost - dense_cost) > 1e-6 * max(1., hungarian_cost))
+			mismatches += 1;
+		assignmentCost(cost, gated_assignment, gated);
+		if (gated < matched)
+			mismatches += 1;
+		hungarian_matched += matched;
+		gated_matched += gated;
+	}
+
+	cout << setw(6) << object_count << " objects : "
+		 << "hungarian " << setw(9) << 1000. * hungarian_time / iterations << " msec, "
+		 << "lapjv " << setw(9) << 1000. * dense_time / iterations << " msec, "
+		 << "lapjv gated " << setw(9) << 1000. * gated_time / iterations << " msec, "
+		 << "matched " << (double)hungarian_matched / iterations << " / " << (double)gated_matched / iterations
+		 << ", " << mismatches << " mismatches" << endl;
+	return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+	const int iterations = (argc > 1) ? atoi(argv[1]) : 50;
+	vector<int> object_counts;
+	for (int i = 2; i < argc; i++)
+		object_counts.push_back(atoi(argv[i]));
+	if (object_counts.empty())
+		object_counts = {10, 50, 100, 200, 400};
+
+	cout << fixed << setprecision(3);
+	int mismatches = 0;
+	for (size_t i = 0; i < object_counts.size(); i++)
+		mismatches += runBenchmark(object_counts[i], iterations);
+	return mismatches ? 1 : 0;
+}
@@ -36,7 +36,7 @@ int main(int argc, char **argv)
 		frameTicker.mark();
 
 		gd.findBoilers(image, depth);
-		gd.drawOnFrame(image, gd.getContours(image));
+		gd.drawOnFrame(image);
 
 		stringstream ss;
 		ss << fixed << setprecision(2) << cap->FPS() << "C:" << frameTicker.getFPS() << "GD FPS";
@@ -0,0 +1,109 @@
+// Times GoalDetector::findBoilers on recorded frames, comparing the
+// sorted pair search against testing every pair of candidates.
+// Extra small green blobs can be drawn into each frame to mimic a noisy
+// threshold image with lots of candidate contours.
+//   goal_detect_benchmark file.zms [noise blobs per frame] [max frames]
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <opencv2/opencv.hpp>
+
+#include "zmsin.hpp"
+#include "GoalDetector.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Small bright green rectangles, taller than wide and big enough
+// to make it past the size checks in GoalDetector::getInfo
+static void addNoise(Mat &image, RNG &rng, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const int width  = rng.uniform(8, 20);
+		const int height = rng.uniform(width, 3 * width);
+		const int x = rng.uniform(1, max(2, image.cols - width - 1));
+		const int y = rng.uniform(1, max(2, image.rows - height - 1));
+		rectangle(image, Rect(x, y, width, height), Scalar(0, 255, 0), CV_FILLED);
+	}
+}
+
+static double runDetector(GoalDetector &gd, const Mat &image, const Mat &depth)
+{
+	const int64 start = getTickCount();
+	gd.findBoilers(image, depth);
+	return (getTickCount() - start) / getTickFrequency();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		cerr << "Usage : " << argv[0] << " file.zms [noise blobs per frame] [max frames]" << endl;
+		return -1;
+	}
+	const int noise = (argc > 2) ? atoi(argv[2]) : 0;
+	const int max_frames = (argc > 3) ? atoi(argv[3]) : -1;
+
+	ZMSIn cap(argv[1]);
+	if (!cap.isOpened())
+	{
+		cerr << "Error opening " << argv[1] << endl;
+		return -1;
+	}
+
+	const Point2f fov(cap.getCameraParams().fov.x, cap.getCameraParams().fov.y);
+	const Size frame_size(cap.width(), cap.height());
+	GoalDetector sorted(fov, frame_size, false);
+	GoalDetector exhaustive(fov, frame_size, false);
+	exhaustive.setExhaustivePairSearch(true);
+
+	// GoalDetector is very chatty, keep that out of the timing
+	cout.setstate(ios::badbit);
+
+	RNG rng(12345);
+	Mat image;
+	Mat depth;
+	int frames = 0;
+	int found = 0;
+	int mismatches = 0;
+	double sorted_time = 0;
+	double exhaustive_time = 0;
+	while (((max_frames < 0) || (frames < max_frames)) && cap.getFrame(image, depth))
+	{
+		Mat noisy = image.clone();
+		addNoise(noisy, rng, noise);
+
+		// Alternate which goes first so neither one
+		// always gets the warm cache
+		if (frames & 1)
+		{
+			sorted_time += runDetector(sorted, noisy, depth);
+			exhaustive_time += runDetector(exhaustive, noisy, depth);
+		}
+		else
+		{
+			exhaustive_time += runDetector(exhaustive, noisy, depth);
+			sorted_time += runDetector(sorted, noisy, depth);
+		}
+
+		if ((sorted.Valid() != exhaustive.Valid()) ||
+			(sorted.goal_rect() != exhaustive.goal_rect()))
+			mismatches += 1;
+		if (sorted.Valid())
+			found += 1;
+		frames += 1;
+	}
+
+	cerr << fixed << setprecision(3);
+	cerr << frames << " frames, " << noise << " noise blobs per frame, goal found in " << found << endl;
+	if (frames > 0)
+	{
+		cerr << "sorted pair search     : " << 1000. * sorted_time / frames << " msec / frame" << endl;
+		cerr << "exhaustive pair search : " << 1000. * exhaustive_time / frames << " msec / frame" << endl;
+		if (sorted_time > 0)
+			cerr << "speedup                : " << exhaustive_time / sorted_time << "x" << endl;
+	}
+	cerr << mismatches << " frames where the results differ" << endl;
+	return mismatches ? 1 : 0;
+}
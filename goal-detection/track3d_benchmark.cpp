@@ -0,0 +1,109 @@
+// Times TrackedObjectList::processDetect with lots of simulated objects
+// to check how the tracker scales. Objects wander around in front of
+// the camera, each frame some of them are missed and a few false
+// detections are thrown in.
+//   track3d_benchmark [frames] [object count] [object count] ...
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <opencv2/opencv.hpp>
+
+#include "track3d.hpp"
+
+using namespace cv;
+using namespace std;
+
+static const Size frame_size(1280, 720);
+static const Point2f fov(105. * M_PI / 180., 105. * M_PI / 180. * 720. / 1280.);
+
+// Random spot on the floor in front of the camera
+static Point3f randomPosition(RNG &rng)
+{
+	const float y = rng.uniform(2.f, 20.f);
+	const float x = rng.uniform(-y, y);
+	return Point3f(x, y, 0);
+}
+
+static void runBenchmark(int object_count, int frames)
+{
+	RNG rng(12345);
+	const ObjectType type(CUBE_2018);
+	TrackedObjectList tracked(frame_size, fov);
+
+	vector<Point3f> positions(object_count);
+	vector<Point3f> velocities(object_count);
+	for (int i = 0; i < object_count; i++)
+	{
+		positions[i] = randomPosition(rng);
+		velocities[i] = Point3f(rng.uniform(-.05f, .05f), rng.uniform(-.05f, .05f), 0);
+	}
+
+	vector<Rect> rects;
+	vector<float> depths;
+	vector<ObjectType> types;
+	double total_time = 0;
+	double max_time = 0;
+	size_t total_tracks = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		rects.clear();
+		depths.clear();
+		types.clear();
+		for (int i = 0; i < object_count; i++)
+		{
+			positions[i] += velocities[i];
+			if (positions[i].y < 1)
+				positions[i] = randomPosition(rng);
+
+			// Miss ~10% of objects each frame
+			if (rng.uniform(0.f, 1.f) < .1f)
+				continue;
+			rects.push_back(type.worldToScreenCoords(positions[i], fov, frame_size, 0));
+			depths.push_back(norm(positions[i]));
+			types.push_back(type);
+		}
+
+		// Plus a few false detections
+		const int false_count = max(object_count / 20, 1);
+		for (int i = 0; i < false_count; i++)
+		{
+			const Point3f position(randomPosition(rng));
+			rects.push_back(type.worldToScreenCoords(position, fov, frame_size, 0));
+			depths.push_back(norm(position));
+			types.push_back(type);
+		}
+
+		const int64 start = getTickCount();
+		tracked.processDetect(rects, depths, types);
+		const double elapsed = (getTickCount() - start) / getTickFrequency();
+
+		// The first frames just create tracks, leave them out
+		if (frame >= 10)
+		{
+			total_time += elapsed;
+			max_time = max(max_time, elapsed);
+			total_tracks += tracked.size();
+		}
+	}
+
+	const int timed_frames = max(frames - 10, 1);
+	cout << setw(6) << object_count << " objects : "
+		 << setw(9) << 1000. * total_time / timed_frames << " msec / frame avg, "
+		 << setw(9) << 1000. * max_time << " msec max, "
+		 << setw(7) << (double)total_tracks / timed_frames << " tracks avg" << endl;
+}
+
+int main(int argc, char **argv)
+{
+	const int frames = (argc > 1) ? atoi(argv[1]) : 200;
+	vector<int> object_counts;
+	for (int i = 2; i < argc; i++)
+		object_counts.push_back(atoi(argv[i]));
+	if (object_counts.empty())
+		object_counts = {10, 50, 100, 200, 400};
+
+	cout << fixed << setprecision(3);
+	for (size_t i = 0; i < object_counts.size(); i++)
+		runBenchmark(object_counts[i], frames);
+	return 0;
+}
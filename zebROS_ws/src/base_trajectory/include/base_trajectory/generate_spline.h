@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include <ros/ros.h>
+#include <trajectory_msgs/JointTrajectoryPoint.h>
+#include <base_trajectory/GenerateSpline.h>
+
+namespace base_trajectory
+{
+
+// Fits quintic splines through x, y, orientation waypoints - the work behind
+// the /base_trajectory/spline_gen service, callable directly by nodes which
+// link this library. period is the control loop period, used to build
+// the initial hold segment the path starts from.
+// Returns false if the points can't be turned into a trajectory
+bool generateSpline(const std::vector<trajectory_msgs::JointTrajectoryPoint> &points,
+					const ros::Duration &period,
+					GenerateSpline::Response &out_msg);
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+//Auto mode tables, loaded from the auto yaml on the parameter server or
+//from a precompiled auto bundle. Kept apart from autoInterpreterClient.h
+//so auto_bundle_compiler can be built without the client's dependencies
+#include <cstdint>
+#include <vector>
+
+#include <ros/ros.h>
+#include <swerve_point_generator/FullGenCoefs.h>
+#include <talon_swerve_drive_controller/auto_bundle.h>
+#include <trajectory_msgs/JointTrajectory.h>
+
+enum Action {do_nothing, deploy_intake, undeploy_intake, intake_cube, intake_no_arm, exchange_cube, default_config, intake_config, exchange_config, switch_config, low_scale_config, mid_scale_config, high_scale_config, over_back_config, custom_config, release_clamp, intake_open_down};
+
+struct ActionSetpoint
+{
+	double x;
+	double y;
+	bool up_or_down;
+
+};
+
+struct ActionStruct
+{
+    double time;
+    Action action;
+	ActionSetpoint action_setpoint;
+	int wait_action_id;
+	double wait_action_time;
+	int wait_profile_id;
+	//double wait_profile_time;
+};
+
+struct CmdVel
+{
+    double duration;
+    double x;
+    double y;
+};
+
+struct FullMode
+{
+	std::vector<swerve_point_generator::FullGenCoefs> srv_msgs;
+	int num_srv_msgs;
+	std::vector<ActionStruct> actions;
+	std::vector<int> wait_ids;
+	std::vector<uint32_t> bundle_profiles; //Profile table indexes when loaded from an auto bundle, srv_msgs is unused then
+	bool exists;
+
+	FullMode(void): exists(false), num_srv_msgs(0) {}
+};
+
+struct CmdVelMode
+{
+    std::vector<CmdVel> segments;
+    bool exists;
+
+	CmdVelMode(void): exists(false) {}
+};
+
+typedef std::vector<std::vector<std::vector<FullMode>>> ModeList;
+typedef std::vector<std::vector<std::vector<CmdVelMode>>> CmdVelList; //Also should maybe have another dimensition and wait for completions?
+
+struct Modes
+{
+    ModeList profiled_modes;
+    CmdVelList cmd_vel_modes;
+};
+
+Modes load_all_trajectories(int max_mode_num, int max_mode_cmd_vel, int max_start_pos_num, int max_wait_for_action_num, ros::NodeHandle &auto_data, ros::NodeHandle &cmd_vel_data);
+Modes load_auto_bundle(const auto_bundle::Reader &bundle, int max_mode_num, int max_mode_cmd_vel, int max_start_pos_num);
+// Entry of a mode table, or nullptr if the indexes are outside it
+const FullMode *find_profiled_mode(const ModeList &modes, int mode, int layout, int start_pos);
+const CmdVelMode *find_cmd_vel_mode(const CmdVelList &modes, int mode, int layout, int start_pos);
+trajectory_msgs::JointTrajectory bundle_joint_trajectory(const auto_bundle::Reader &bundle, uint32_t profile_index);
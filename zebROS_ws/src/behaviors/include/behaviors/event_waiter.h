@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "ros/ros.h"
+
+namespace behaviors
+{
+
+//Lets a thread sleep until something it is waiting on might have changed,
+//rather than polling at a fixed rate. Callbacks - subscribers, actionlib
+//done / feedback, preempt requests - call notify(). The waiting thread
+//rechecks its conditions each time waitUntil returns.
+//Every notify bumps a counter, and waitUntil returns right away if the
+//counter moved since the last time it returned, so a notify which lands
+//between checking conditions and going back to sleep is never lost.
+//Meant for a single waiting thread
+class EventWaiter
+{
+	public:
+		//max_wait bounds each sleep so ros::ok() and anything without a
+		//callback still gets checked now and then
+		explicit EventWaiter(const double max_wait = 0.1) :
+			max_wait_(max_wait),
+			count_(0),
+			seen_(0)
+		{
+		}
+
+		void notify(void)
+		{
+			{
+				std::lock_guard<std::mutex> l(mutex_);
+				count_ += 1;
+			}
+			cv_.notify_all();
+		}
+
+		//Blocks until notify is called or ros time reaches deadline (in
+		//seconds, same as ros::Time::now().toSec()), whichever is first.
+		//Returns true if woken by notify
+		bool waitUntil(const double deadline)
+		{
+			const double remaining = std::min(deadline - ros::Time::now().toSec(), max_wait_);
+			std::unique_lock<std::mutex> l(mutex_);
+			bool notified = count_ != seen_;
+			if (!notified && (remaining > 0))
+				notified = cv_.wait_for(l, std::chrono::duration<double>(remaining), [this]() { return count_ != seen_; });
+			seen_ = count_;
+			return notified;
+		}
+
+	private:
+		const double max_wait_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		uint64_t count_; //Number of notify calls
+		uint64_t seen_; //count_ as of the last waitUntil return
+};
+
+}
@@ -1,6 +1,8 @@
 #include <atomic>
+#include <future>
 
 #include <behaviors/autoInterpreterClient.h>
+#include <behaviors/event_waiter.h>
 #include <behaviors/IntakeAction.h>
 #include <behaviors/RobotAction.h>
 #include <realtime_tools/realtime_buffer.h>
@@ -16,6 +18,16 @@ std::atomic<bool> exit_auto; // robot is disabled or teleop started during auto_
 std::shared_ptr<actionlib::SimpleActionClient<behaviors::RobotAction>> ac;
 std::shared_ptr<actionlib::SimpleActionClient<behaviors::IntakeAction>> ac_intake;
 
+//Woken by anything run_auto might be waiting on - action servers finishing,
+//the profile queue moving on, auto ending
+behaviors::EventWaiter auto_events;
+
+template <class ResultConstPtr>
+void actionDoneCB(const actionlib::SimpleClientGoalState &/*state*/, const ResultConstPtr &/*result*/)
+{
+	auto_events.notify();
+}
+
 ros::ServiceClient point_gen;
 ros::ServiceClient swerve_control;
 
@@ -56,6 +68,10 @@ std::vector<double> auto_mode_status_vect = {1, 1, 1, 1};
 
 std::vector<std::vector<trajectory_msgs::JointTrajectory>> joint_trajectories;
 
+//Precompiled auto modes, if auto_params/auto_bundle is set. The swerve
+//controller loads the same file, so profiles are uploaded by index
+auto_bundle::Reader bundle;
+
 
 struct MatchData {
     MatchData():
@@ -203,7 +219,7 @@ bool intakeCube(const ActionSetpoint &action_setpoint) {
     goal.time_out = 15; //TODO config these
 	goal.wait_to_proceed = false;
 
-    ac->sendGoal(goal);
+    ac->sendGoal(goal, &actionDoneCB<behaviors::RobotResultConstPtr>);
     
     ROS_INFO("intake");
 }
@@ -215,7 +231,7 @@ bool intakeNoArm(void) {
     goal.time_out = 10; //TODO config this
     goal.wait_to_proceed = false; 
 
-    ac_intake->sendGoal(goal);
+    ac_intake->sendGoal(goal, &actionDoneCB<behaviors::IntakeResultConstPtr>);
     ROS_INFO("intake no arm");
     
 }
@@ -409,334 +425,31 @@ bool parkingConfig(void)
 	return true;
 }
 
-Modes load_all_trajectories(int max_mode_num, int max_mode_cmd_vel, int max_start_pos_num, int max_wait_for_action_num, ros::NodeHandle &auto_data, ros::NodeHandle &cmd_vel_data)
+//Publishes the state of each auto mode for the driver station. 0 means
+//the selected mode can't be run, anything else means it is usable, with
+//values below 1 showing how far along its generation is
+void publishAutoModeStatus(void)
 {
-	XmlRpc::XmlRpcValue mode_xml;
-	XmlRpc::XmlRpcValue actions_xml;
-
-	XmlRpc::XmlRpcValue cmd_vel_xml;
-
-	ModeList profiled_modes;
-    CmdVelList cmd_vel_modes;
-
-	profiled_modes.resize(max_mode_num + 1);
-	for(int mode = 0; mode <= max_mode_num; mode++)
-	{
-		profiled_modes[mode].resize(4);
-		for(int layout = 0; layout <= 3; layout++)
-		{
-			profiled_modes[mode][layout].resize(max_start_pos_num + 1);
-			for(int start_pos = 0; start_pos <= max_start_pos_num; start_pos++)
-			{
-				profiled_modes[mode][layout][start_pos].srv_msgs.resize(max_wait_for_action_num + 1);
-				std::string identifier("mode_"+std::to_string(mode)+"_layout_"+
-				std::to_string(layout)+"_start_"+std::to_string(start_pos));
-				
-				for(int wait_for_action = 0; wait_for_action <= max_wait_for_action_num; wait_for_action++)
-				{
-					std::string identifier_with_wait = identifier+ +"_wait_for_action_"+std::to_string(wait_for_action);
-					if(auto_data.getParam(identifier_with_wait, mode_xml))
-					{
-						//ROS_INFO_STREAM("Auto mode with identifier: " << identifier << " found");
-						//XmlRpc::XmlRpcValue &coefs_xml = mode_xml["coefs"];
-						//XmlRpc::XmlRpcValue &times_xml = mode_xml["times"];
-						const int num_splines = mode_xml.size();
-						//const int num_times = times_xml.size();
-						for(int num = 0; num<num_splines; num++) {
-							XmlRpc::XmlRpcValue &spline = mode_xml[num];
-							XmlRpc::XmlRpcValue &x = spline["x"];
-							XmlRpc::XmlRpcValue &y = spline["y"];
-							XmlRpc::XmlRpcValue &orient = spline["orient"];
-							//XmlRpc::XmlRpcValue &time = spline["time"];
-
-							swerve_point_generator::Coefs x_coefs;
-							swerve_point_generator::Coefs y_coefs;
-							swerve_point_generator::Coefs orient_coefs;
-							for(int i = 0; i<x.size(); i++) {
-								const double x_coef = x[i];
-								const double y_coef = y[i];
-								const double orient_coef = orient[i];
-
-								////ROS_WARN("%f", orient_coef);
-								x_coefs.spline.push_back(x_coef);
-								y_coefs.spline.push_back(y_coef);
-								orient_coefs.spline.push_back(orient_coef);
-							}
-							//const double t = time;
-							//profiled_modes[mode][layout][start_pos].times.push_back(t);
-							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_coefs.push_back(x_coefs);
-							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.y_coefs.push_back(y_coefs);
-							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.orient_coefs.push_back(orient_coefs);
-							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.end_points.push_back(num+1);
-						}
-						profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.initial_v = 0; 
-						profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.final_v = 0; 
-						profiled_modes[mode][layout][start_pos].exists = true; 
-						profiled_modes[mode][layout][start_pos].num_srv_msgs +=1; 
-
-						//ROS_WARN_STREAM("mode: " << mode << " layout: " << layout << " start_pos: " << start_pos);
-
-						XmlRpc::XmlRpcValue group_xml;
-						if(auto_data.getParam(identifier_with_wait + "_spline_group", group_xml))
-						{
-							//ROS_INFO_STREAM("Custom grouping for identifier: " << identifier << " found");
-							for(int i = 0; i < group_xml.size(); i++)
-							{	
-								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.spline_groups.push_back(group_xml[i]);
-							}
-							XmlRpc::XmlRpcValue wait_xml;
-							if(auto_data.getParam(identifier_with_wait + "_waits", wait_xml))
-							{
-								//ROS_INFO_STREAM("Custom waits for identifier: " << identifier << " found");
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.wait_before_group.push_back(wait_xml[i]);
-								}
-							}
-							else
-							{
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.wait_before_group.push_back(0.25);
-								}
-							}
-							XmlRpc::XmlRpcValue shift_xml;
-							if(auto_data.getParam(identifier_with_wait + "_t_shifts", shift_xml))
-							{
-								//ROS_INFO_STREAM("Custom shifts for identifier: " << identifier_with_wait << " found");
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.t_shift.push_back(shift_xml[i]);
-								}
-							}
-							else
-							{
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.t_shift.push_back(0);
-								}
-							}
-							XmlRpc::XmlRpcValue flip_xml;
-							if(auto_data.getParam(identifier_with_wait + "_flips", flip_xml))
-							{
-								//ROS_INFO_STREAM("Custom flips for identifier: " << identifier_with_wait << " found");
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									bool temp = flip_xml[i];
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.flip.push_back(temp);
-								}
-							}
-							else
-							{
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.flip.push_back(false);
-								}
-							}
-							XmlRpc::XmlRpcValue x_inverts_xml;
-							if(auto_data.getParam(identifier_with_wait + "_x_inverts", x_inverts_xml))
-							{
-								//ROS_INFO_STREAM("Custom x inverts for identifier: " << identifier_with_wait << " found");
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									bool temp = x_inverts_xml[i];
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_invert.push_back(temp);
-								}
-							}
-							else
-							{
-								for(int i = 0; i < group_xml.size(); i++)
-								{
-									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_invert.push_back(false);
-								}
-							}
-						}
-						else
-						{
-								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.flip.push_back(false);
-								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_invert.push_back(false);
-								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.spline_groups.push_back(num_splines);
-								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.wait_before_group.push_back(0.25);
-								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.t_shift.push_back(0);
-						}
-
-						
-					
-
-				}
-				
-
-			}
-			
-			if(auto_data.getParam(identifier+ "_actions", actions_xml))
-			{
-				//ROS_INFO_STREAM("Auto mode actions with identifier: " << identifier+"_actions" << " found");
-				const int num_actions = actions_xml.size();
-				profiled_modes[mode][layout][start_pos].actions.resize(num_actions);
-				for(int i = 0; i < max_wait_for_action_num; i++)
-				{
-					profiled_modes[mode][layout][start_pos].wait_ids.push_back(-1);
-				}
-
-				for(int num = 0; num<num_actions; num++) {
-					XmlRpc::XmlRpcValue &action = actions_xml[num];
-					XmlRpc::XmlRpcValue &time = action["time"];
-					
-					XmlRpc::XmlRpcValue &profile_wait_xml = action["profile_wait"];
-					XmlRpc::XmlRpcValue &action_waiter_xml = action["wait_for_action"];
-					XmlRpc::XmlRpcValue &action_waiter_duration_xml = action["wait_for_action_delay"];
-					XmlRpc::XmlRpcValue &profile_waiter_xml = action["wait_for_profile"];
-					//XmlRpc::XmlRpcValue &profile_waiter_duration_xml = action["wait_for_profile_delay"];
-					XmlRpc::XmlRpcValue &x_xml = action["x"];
-					XmlRpc::XmlRpcValue &y_xml = action["y"];
-					XmlRpc::XmlRpcValue &up_or_down_xml = action["up_or_down"];
-					const double profile_wait_double = profile_wait_xml;
-					int profile_wait = (int)profile_wait_double;
-
-					
-					const double action_waiter_double = action_waiter_xml;
-					int action_waiter = (int)action_waiter_double;
-
-				
-					
-					const double action_waiter_duration_double = action_waiter_duration_xml;
-					int action_waiter_duration = (int)action_waiter_duration_double;
-	
-
-					const double profile_waiter_double = profile_waiter_xml;
-					int profile_waiter = (int)profile_waiter_double;
-					
-					//TODO: add dur
-
-					profiled_modes[mode][layout][start_pos].actions[num].action_setpoint.x = x_xml;
-					profiled_modes[mode][layout][start_pos].actions[num].action_setpoint.y = y_xml;
-					profiled_modes[mode][layout][start_pos].actions[num].action_setpoint.up_or_down = up_or_down_xml;
-					
-					profiled_modes[mode][layout][start_pos].actions[num].wait_action_id = action_waiter;
-					profiled_modes[mode][layout][start_pos].actions[num].wait_action_time = action_waiter_duration_xml;
-
-				
-					profiled_modes[mode][layout][start_pos].actions[num].wait_profile_id = profile_waiter;
-					//profiled_modes[mode][layout][start_pos].actions[num].wait_profile_time = profile_waiter_duration_xml;
-
-					if(profile_wait >= 0)
-					{				
-						profiled_modes[mode][layout][start_pos].wait_ids[profile_wait] =  num;
-					}
-					//TODO: params
-					XmlRpc::XmlRpcValue &action_name = action["actions"];
-						//profiled_modes[mode][layout][start_pos].actions[num].actions.push_back(action_now);
-						if(action_name == "deploy_intake") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = deploy_intake;
-						}
-						else if(action_name == "undeploy_intake") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = undeploy_intake;
-						}
-						else if(action_name == "intake_cube") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = intake_cube;
-						}
-						else if(action_name == "exchange_cube") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = exchange_cube;
-						}
-						else if(action_name == "default_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = default_config;
-						}
-						else if(action_name == "intake_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = intake_config;
-						}
-						else if(action_name == "exchange_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = exchange_config;
-						}
-						else if(action_name == "switch_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = switch_config;
-						}
-						else if(action_name == "low_scale_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = low_scale_config;
-						}
-						else if(action_name == "mid_scale_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = mid_scale_config;
-						}
-						else if(action_name == "high_scale_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = high_scale_config;
-						}
-						else if(action_name == "over_back_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = over_back_config;
-						}
-						else if(action_name == "custom_config") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = custom_config;
-						}
-						else if(action_name == "release_clamp") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = release_clamp;
-						}
-						else if(action_name == "intake_open_down") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = intake_open_down;
-						}
-						else if(action_name == "intake_no_arm") {
-							profiled_modes[mode][layout][start_pos].actions[num].action = intake_no_arm;
-						}
-						else
-						{
-							//ROS_ERROR("action not found");
-						}
-						
-					//Exception handling?
-					const double time_now = time;
-					profiled_modes[mode][layout][start_pos].actions[num].time = time_now;
-					//const double t = time;
-					//profiled_modes[mode][layout][start_pos].times.push_back(t);
-				}
-			}
-			else
-			{
-				profiled_modes[mode][layout][start_pos].exists = false; 
-			}
-		}
-	}
+	std_msgs::Float64 state;
+	state.data = auto_mode_status_vect[0];
+	auto_state_0.publish(state);
+	state.data = auto_mode_status_vect[1];
+	auto_state_1.publish(state);
+	state.data = auto_mode_status_vect[2];
+	auto_state_2.publish(state);
+	state.data = auto_mode_status_vect[3];
+	auto_state_3.publish(state);
 }
 
-	cmd_vel_modes.resize(max_mode_cmd_vel + 1);
-    ROS_INFO("Loading cmd_vel params");
-	for(int mode = 0; mode <= max_mode_cmd_vel; mode++)
-	{
-		cmd_vel_modes[mode].resize(4);
-		for(int layout = 0; layout <= 1; layout++)
-		{
-            cmd_vel_modes[mode][layout+2].resize(max_start_pos_num + 1);
-			cmd_vel_modes[mode][layout].resize(max_start_pos_num + 1);
-			for(int start_pos = 0; start_pos <= max_start_pos_num; start_pos++)
-			{
-				std::string identifier("mode_"+std::to_string(mode)+"_layout_"+std::to_string(layout)+"_"+std::to_string(layout + 2)+"_start_"+std::to_string(start_pos));
-                
-                if(cmd_vel_data.getParam(identifier, cmd_vel_xml))
-				{
-					//ROS_INFO_STREAM("cmd vel mode with identifier: " << identifier << " found cmd vel");
-					const int num_segments = cmd_vel_xml.size();
-                    cmd_vel_modes[mode][layout][start_pos].segments.resize(num_segments);
-                    cmd_vel_modes[mode][layout+2][start_pos].segments.resize(num_segments);
-					for(int num = 0; num<num_segments; num++) {
-						XmlRpc::XmlRpcValue &segment = cmd_vel_xml[num];
-						const double x = segment["x"];
-						const double y = segment["y"];
-						const double duration = segment["duration"];
-                        cmd_vel_modes[mode][layout][start_pos].segments[num].x = x;
-                        cmd_vel_modes[mode][layout][start_pos].segments[num].y = y;
-                        cmd_vel_modes[mode][layout][start_pos].segments[num].duration = duration;
-                        
-                        cmd_vel_modes[mode][layout+2][start_pos].segments[num].x = x;
-                        cmd_vel_modes[mode][layout+2][start_pos].segments[num].y = y;
-                        cmd_vel_modes[mode][layout+2][start_pos].segments[num].duration = duration;
-                    }
-                    cmd_vel_modes[mode][layout][start_pos].exists = true; 
-                    cmd_vel_modes[mode][layout+2][start_pos].exists = true; 
-                    
-                }
-            }
-        }
-    }
-    Modes all_modes;
-    all_modes.profiled_modes = profiled_modes;
-    all_modes.cmd_vel_modes = cmd_vel_modes;
-	return all_modes;
+//Runs one point_gen request on its own connection so that several can be
+//in flight at once
+bool callPointGen(swerve_point_generator::FullGenCoefs &srv)
+{
+	ros::NodeHandle n;
+	std::map<std::string, std::string> service_connection_header;
+	service_connection_header["tcp_nodelay"] = "1";
+	ros::ServiceClient client = n.serviceClient<swerve_point_generator::FullGenCoefs>("/point_gen/command", false, service_connection_header);
+	return client.call(srv);
 }
 
 bool generateTrajectory(std::vector<FullMode> &trajectory, const std::vector<int> &start_buffer_ids, const std::vector<bool> &generate, std::vector<std::vector<trajectory_msgs::JointTrajectory>> &trajectory_msgs_pass_out)
@@ -745,56 +458,110 @@ bool generateTrajectory(std::vector<FullMode> &trajectory, const std::vector<int
 	ROS_ERROR_STREAM("num traj msgs: " << trajectory_msgs_pass_out.size());
 	trajectory_msgs_pass_out.resize(trajectory.size());
 
-
-    talon_swerve_drive_controller::MotionProfilePoints swerve_control_srv;
-    swerve_control_srv.request.wipe_all = false;
-    swerve_control_srv.request.buffer = true;
-    swerve_control_srv.request.brake = true;
-    swerve_control_srv.request.run    = false;
-    swerve_control_srv.request.change_queue   = false; 
-
+	//Every segment of every mode is sent to point_gen at once, so picking
+	//autos takes about as long as the slowest segment rather than the sum
+	//of all of them. Any requests still running when this returns early
+	//are waited on by the future destructors
+	std::vector<std::vector<std::future<bool>>> requests(trajectory.size());
 	for(size_t k = 0; k < trajectory.size(); k++)
 	{
-        
 		if(!generate[k]) continue;
 		trajectory_msgs_pass_out[k].clear();
-		auto_mode_status_vect[k] = 1;
 
 		//ROS_ERROR("DO WE fail here");
 		if(!trajectory[k].exists)
 		{
 			//TODO MAKE LIGHT GO RED ON DRIVERSTATION
 			ROS_ERROR("auto mode/layout/start selected which wasn't found in the yaml");
-            auto_mode_status_vect[k] = 0;
+			auto_mode_status_vect[k] = 0;
+			publishAutoModeStatus();
 			return false;
 		}
+		auto_mode_status_vect[k] = 1. / (trajectory[k].num_srv_msgs + 1);
 		ROS_WARN_STREAM("num srv msgs: " << trajectory[k].num_srv_msgs);
+		if(!trajectory[k].bundle_profiles.empty())
+			continue; //Already generated, nothing for point_gen to do
 		for(size_t i = 0; i < trajectory[k].num_srv_msgs; i++)
+		{
+			swerve_point_generator::FullGenCoefs &srv = trajectory[k].srv_msgs[i];
+			requests[k].push_back(std::async(std::launch::async, [&srv]() { return callPointGen(srv); }));
+		}
+	}
+	publishAutoModeStatus();
+
+	//Upload each profile to its controller slot as soon as it is ready
+	bool first_upload = true;
+	for(size_t k = 0; k < trajectory.size(); k++)
+	{
+		//Bundled profiles are already in the controller's copy of the
+		//bundle, so a whole mode goes over in one call by index
+		if(generate[k] && !trajectory[k].bundle_profiles.empty())
+		{
+			talon_swerve_drive_controller::MotionProfilePoints swerve_control_srv;
+			swerve_control_srv.request.wipe_all = false;
+			swerve_control_srv.request.buffer = true;
+			swerve_control_srv.request.brake = first_upload; //stop anything left running before overwriting slots
+			swerve_control_srv.request.run    = false;
+			swerve_control_srv.request.change_queue   = false;
+			swerve_control_srv.request.bundle_checksum = bundle.checksum();
+			for(size_t i = 0; i < trajectory[k].bundle_profiles.size(); i++)
+			{
+				swerve_control_srv.request.bundle_profiles.push_back(trajectory[k].bundle_profiles[i]);
+				swerve_control_srv.request.bundle_slots.push_back(i + start_buffer_ids[k]);
+				trajectory_msgs_pass_out[k].push_back(bundle_joint_trajectory(bundle, trajectory[k].bundle_profiles[i]));
+			}
+			if (!swerve_control.call(swerve_control_srv))
+			{
+				ROS_ERROR("swerve_control call() failed for bundled profiles in autoInterpreterClient generateTrajectory()");
+				auto_mode_status_vect[k] = 0;
+				publishAutoModeStatus();
+				return false;
+			}
+			first_upload = false;
+			auto_mode_status_vect[k] = 1;
+			publishAutoModeStatus();
+			ROS_ERROR("Succeeded in loading bundled Trajectory");
+			continue;
+		}
+		for(size_t i = 0; i < requests[k].size(); i++)
 		{
 			//ROS_WARN_STREAM("i: " << i << " k: " << k);
-			if (!point_gen.call(trajectory[k].srv_msgs[i]))
+			if (!requests[k][i].get())
 			{
 				ROS_ERROR("point_gen call failed in autoInterpreterClient generateTrajectory()");
+				auto_mode_status_vect[k] = 0;
+				publishAutoModeStatus();
 				return false;
 			}
+			talon_swerve_drive_controller::MotionProfilePoints swerve_control_srv;
+			swerve_control_srv.request.wipe_all = false;
+			swerve_control_srv.request.buffer = true;
+			swerve_control_srv.request.brake = first_upload; //stop anything left running before overwriting slots
+			swerve_control_srv.request.run    = false;
+			swerve_control_srv.request.change_queue   = false;
+
 			talon_swerve_drive_controller::SwervePointSet temp_holder;
 			temp_holder.dt = trajectory[k].srv_msgs[i].response.dt;
 			temp_holder.points = trajectory[k].srv_msgs[i].response.points;
 			temp_holder.slot = i + start_buffer_ids[k];
 			swerve_control_srv.request.profiles.push_back(temp_holder);
-					
-			trajectory_msgs_pass_out[k].push_back(trajectory[k].srv_msgs[i].response.joint_trajectory);
+			if (!swerve_control.call(swerve_control_srv))
+			{
+				ROS_ERROR("swerve_control call() failed in autoInterpreterClient generateTrajectory()");
+				auto_mode_status_vect[k] = 0;
+				publishAutoModeStatus();
+				return false;
+			}
+			first_upload = false;
 
-	
+			trajectory_msgs_pass_out[k].push_back(trajectory[k].srv_msgs[i].response.joint_trajectory);
+			auto_mode_status_vect[k] = (i + 2.) / (requests[k].size() + 1);
+			publishAutoModeStatus();
 		}
-        ROS_ERROR("Succeeded in generate Trajectory");
+		if (generate[k])
+			ROS_ERROR("Succeeded in generate Trajectory");
 		//ROS_ERROR_STREAM("num traj msgs sub msgs: " << trajectory_msgs_pass_out[k].size());
 	}
-    if (!swerve_control.call(swerve_control_srv))
-	{
-		ROS_ERROR("swerve_control call() failed in autoInterpreterClient generateTrajectory()");
-		return false;
-	}
 	return true;
 }
 
@@ -872,12 +639,16 @@ void match_data_cb(const frc_msgs::MatchSpecificData::ConstPtr &msg) {
 	// nice for testing to continue the code for
 	// debugging
 	if (!(msg->Autonomous && msg->Enabled))
+	{
 		exit_auto = true;
+		auto_events.notify();
+	}
 
 }
 
 void queue_slot_cb(const std_msgs::UInt16::ConstPtr &msg) {
     queue_slot.writeFromNonRT(msg->data);
+	auto_events.notify();
 
 }
 
@@ -1015,7 +786,7 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
     ros::Rate r(10);
     double start_time = ros::Time::now().toSec();
     while(!exit_auto && ros::Time::now().toSec() < start_time + initial_delay) {
-        r.sleep(); 
+        auto_events.waitUntil(start_time + initial_delay);
     }
     
 
@@ -1048,7 +819,7 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
     if(auto_select == 2) {
         double at_switch = ros::Time::now().toSec();
         while(!exit_auto && ros::Time::now().toSec() < at_switch + 1) {
-            r.sleep(); 
+            auto_events.waitUntil(at_switch + 1);
         }
         releaseClamp();
     }
@@ -1060,7 +831,6 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
     //ROS_WARN("auto entered");
     ROS_WARN("auto_select:[%d], layout:[%d], start_pos:[%d]", auto_select, layout, start_pos);
     exit_auto = false;
-    ros::Rate r(10);
 
     double start_time = ros::Time::now().toSec();
    
@@ -1080,7 +850,7 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
 	}
  
     while(!exit_auto && ros::Time::now().toSec() < start_time + initial_delay) {
-        r.sleep(); 
+        auto_events.waitUntil(start_time + initial_delay);
     }
 
     
@@ -1090,75 +860,65 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
     start_time = ros::Time::now().toSec();
     size_t num_actions = auto_run_data.actions.size();
 	size_t num_profs = auto_run_data.num_srv_msgs;
-    ros::Rate action_rate(20);
+	const double queue_retry_period = .05; //How long to wait before retrying a failed queue / run call
 		
 	int queued = -1;
-	std::vector<bool> finished;
+	std::vector<bool> finished(num_actions, false);
+	std::vector<double> time_finished(num_actions, DBL_MAX);
 
-	
-    for(size_t num = 0; num<num_actions; num++)
-	{
-		finished.push_back(false);
-	}
-	std::vector<double> time_finished;
+	//Latency trace - when each action was allowed to start (time and
+	//wait_action dependencies met) vs. when it was actually sent
+	std::vector<double> time_ready(num_actions, DBL_MAX);
+	std::vector<double> time_dispatched(num_actions, DBL_MAX);
 
-	
-    for(size_t num = 0; num<num_actions; num++)
-	{
-		time_finished.push_back(DBL_MAX);
-	}
-    for(size_t num = 0; num<num_actions; num++) {
+    for(size_t num = 0; num<num_actions && !exit_auto; num++) {
 
-		const double action_start_time = ros::Time::now().toSec();
-        //double curr_time = ros::Time::now().toSec();  //These two vars are the same..........
-        
-		
+		const ActionStruct &action = auto_run_data.actions[num];
+		const double scheduled_time = start_time + action.time;
 
 		bool dependencies_run =  false;
 
-		while(/*curr_time*/ (ros::Time::now().toSec() < (start_time + auto_run_data.actions[num].time)) || (!dependencies_run ) && !exit_auto) { //HOW DOES THIS LOOP EVER EXIT!!! (other than if auto ends)
+		//Each pass checks everything this action could be waiting on, then
+		//sleeps until a callback reports a change or the next known deadline
+		while(!exit_auto) {
 			
 			bool intake_action_lib_later_write = false;
 			bool robot_action_lib_later_write = false;
 			bool timed_out = false;
+			double deadline = DBL_MAX;
 			
-			//ROS_WARN_STREAM("Time check: " << (ros::Time::now().toSec() < (action_start_time + auto_run_data.actions[num].time)) <<  " dependency check: " << 	dependencies_run);
-				
-
-
 			if(num != 0)
 			{
 				for(int i = num - 1; i >= 0; i--)
 				{	
 					if(finished[i]) continue;
 					finished[i] = check_action_completion(auto_run_data.actions[i].action, intake_action_lib_later_write, robot_action_lib_later_write, timed_out);	
-				time_finished[i] = ros::Time::now().toSec();	
+					if(finished[i])
+					{
+						time_finished[i] = ros::Time::now().toSec();	
+						ROS_INFO_STREAM("auto trace : action " << i << " finished at " << time_finished[i] - start_time
+								<< " ran for " << time_finished[i] - time_dispatched[i]);
+					}
 					exit_auto = exit_auto || timed_out;	
 				}
 			}
-			if(auto_run_data.actions[num].wait_action_id >=0)
+			if(action.wait_action_id >=0)
 			{
-				dependencies_run = finished[auto_run_data.actions[num].wait_action_id] && ros::Time::now().toSec() - time_finished[auto_run_data.actions[num].wait_action_id] > auto_run_data.actions[num].wait_action_time;
-
+				const double wait_done_time = time_finished[action.wait_action_id] + action.wait_action_time;
+				dependencies_run = finished[action.wait_action_id] && ros::Time::now().toSec() > wait_done_time;
+				if(finished[action.wait_action_id] && !dependencies_run)
+					deadline = std::min(deadline, wait_done_time);
+				dependencies_run = dependencies_run && *(queue_slot.readFromRT()) >= action.wait_profile_id; //TODO: add support a wait here maybe
 			}
 			else
 			{
 				dependencies_run = true; 	
 			} 
-			if(auto_run_data.actions[num].wait_action_id >=0)
-			{
-				dependencies_run = dependencies_run && *(queue_slot.readFromRT()) >= auto_run_data.actions[num].wait_profile_id; //TODO: add support a wait here maybe
-			}
 
 			//ROS_WARN_STREAM("prof count: " << num_profs);
 			for(int i = 0; i < num_profs; i++)
 			{
-				//ROS_INFO_STREAM("start loop");
-				//ROS_INFO_STREAM("wait id: " << auto_run_data.wait_ids[i]);
 				if(i <= queued) continue;
-				//ROS_INFO_STREAM("running loop still");
-				//ROS_WARN_STREAM("here " << i << " and " << auto_run_data.wait_ids[i]);	
-				//ROS_INFO_STREAM("hypothetical id: " << auto_run_data.wait_ids[i]);
 				if(auto_run_data.wait_ids[i] != -1) ROS_WARN_STREAM(" hypothetical finish " << finished[auto_run_data.wait_ids[i]]);
 
 				if(auto_run_data.wait_ids[i] == -1 || finished[auto_run_data.wait_ids[i]])
@@ -1180,7 +940,7 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
 									
 							ROS_WARN("queue fail");
 							queued -= 1;
-							action_rate.sleep();
+							deadline = std::min(deadline, ros::Time::now().toSec() + queue_retry_period);
 							break;
 							//If we fail try again
 						}	
@@ -1189,7 +949,7 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
 					{
 						ROS_WARN("runTrajectory fail");
 						queued -= 1;
-						action_rate.sleep();
+						deadline = std::min(deadline, ros::Time::now().toSec() + queue_retry_period);
 						break;
 						//If we fail try again
 					}
@@ -1199,13 +959,44 @@ void run_auto(int auto_select, int layout, int start_pos, double initial_delay,
 					break;
 				}
 			}
-            action_rate.sleep();
-	
+
+			const double now = ros::Time::now().toSec();
+			if(dependencies_run && time_ready[num] == DBL_MAX)
+				time_ready[num] = std::max(now, scheduled_time);
+			if(dependencies_run && now >= scheduled_time)
+				break;
+			if(now < scheduled_time)
+				deadline = std::min(deadline, scheduled_time);
+
+			auto_events.waitUntil(deadline);
 		}
+		if(exit_auto)
+			break;
+
 		ROS_ERROR_STREAM("hypothetically running action: " << num);	
-        call_action(auto_run_data.actions[num].action, auto_run_data.actions[num].action_setpoint);
+		time_dispatched[num] = ros::Time::now().toSec();
+        call_action(action.action, action.action_setpoint);
+		ROS_INFO_STREAM("auto trace : action " << num << " scheduled " << action.time
+				<< " ready " << time_ready[num] - start_time
+				<< " dispatched " << time_dispatched[num] - start_time
+				<< " latency " << (time_dispatched[num] - time_ready[num]) * 1000. << " ms");
 	}
-	
+
+	double max_latency = 0;
+	double total_latency = 0;
+	size_t dispatched = 0;
+	for(size_t num = 0; num < num_actions; num++)
+	{
+		if(time_dispatched[num] == DBL_MAX)
+			continue;
+		const double latency = time_dispatched[num] - time_ready[num];
+		max_latency = std::max(max_latency, latency);
+		total_latency += latency;
+		dispatched += 1;
+	}
+	if(dispatched > 0)
+		ROS_INFO_STREAM("auto trace : " << dispatched << " of " << num_actions << " actions dispatched, mean latency "
+				<< total_latency / dispatched * 1000. << " ms, max " << max_latency * 1000. << " ms");
 }
 
 int main(int argc, char** argv) {
@@ -1286,9 +1077,15 @@ int main(int argc, char** argv) {
     if (!n_params_cmd_vel.getParam("num_cmd_vel_modes", num_cmd_vel_modes))
 		ROS_ERROR("Didn't read param num_cmd_vel_modes in autoInterpreterClient");
 	// Load trajectories before callbacks which use them can
-	// start
+	// start. A precompiled bundle skips both reading the yaml
+	// and generating profiles
     //ros::Duration(20).sleep();
-	Modes all_modes = load_all_trajectories(max_num_mode, max_num_cmd_vel, max_num_start, iterator, n_params_behaviors, n_params_cmd_vel);
+	std::string auto_bundle_path;
+	Modes all_modes;
+	if (n_params_behaviors.getParam("auto_bundle", auto_bundle_path) && !auto_bundle_path.empty() && bundle.open(auto_bundle_path))
+		all_modes = load_auto_bundle(bundle, max_num_mode, max_num_cmd_vel, max_num_start);
+	else
+		all_modes = load_all_trajectories(max_num_mode, max_num_cmd_vel, max_num_start, iterator, n_params_behaviors, n_params_cmd_vel);
     ModeList profiled_modes = all_modes.profiled_modes;
     CmdVelList cmd_vel_modes = all_modes.cmd_vel_modes;
 
@@ -1315,11 +1112,6 @@ int main(int argc, char** argv) {
     auto_state_2 = n.advertise<std_msgs::Float64>("/frcrobot/auto_state_controller_2/command", 1);
     auto_state_3 = n.advertise<std_msgs::Float64>("/frcrobot/auto_state_controller_3/command", 1);
 
-    std_msgs::Float64 state_0;
-    std_msgs::Float64 state_1;
-    std_msgs::Float64 state_2;
-    std_msgs::Float64 state_3;
-    
     ros::Subscriber auto_mode_sub = n.subscribe("autonomous_mode", 1, &auto_mode_cb);
     ros::Subscriber slot_sub = n.subscribe("profile_queue_num", 1, &queue_slot_cb);
     ros::Subscriber match_data_sub = n.subscribe("match_data", 1, &match_data_cb);
@@ -1434,18 +1226,32 @@ int main(int argc, char** argv) {
                     {
 						//ROS_ERROR_STREAM("actual mode: " << auto_mode_data.modes_[i] - num_cmd_vel_modes << " layout: " << i << " start: " << auto_mode_data.start_pos_); 
 
-                        out_to_generate.push_back(profiled_modes[auto_mode_data.modes_[i] - num_cmd_vel_modes][i][auto_mode_data.start_pos_]);
-						generate_for_this[i] = true;	
-						generate = true;
-                        auto_mode_status_vect[i]=1;
-						//any_change = true;
+                        const FullMode *full_mode = find_profiled_mode(profiled_modes, auto_mode_data.modes_[i] - num_cmd_vel_modes, i, auto_mode_data.start_pos_);
+                        if(full_mode) {
+                            out_to_generate.push_back(*full_mode);
+                            generate_for_this[i] = true;	
+                            generate = true;
+                            auto_mode_status_vect[i]=1;
+                            //any_change = true;
+                        }
+                        else {
+                            ROS_ERROR_STREAM("No auto mode " << auto_mode_data.modes_[i] << " for layout " << i << " start " << auto_mode_data.start_pos_ << ", not running an auto for this layout");
+                            out_to_generate.push_back(empty_full_mode);
+                            generate_for_this[i] = false;
+                            mode_buffered[i] = false;
+                            auto_mode_vect[i] = 0;
+                            delays_vect[i] = 0;
+                        }
                     }
                     else if (auto_mode_data.modes_[i] <= num_cmd_vel_modes-1 && (auto_mode_data.modes_[i] >= 0) &&
                         ((auto_mode_data.modes_[i] != auto_mode_vect[i]) || (auto_mode_data.start_pos_ != last_start_pos)))
                     {
                         out_to_generate.push_back(empty_full_mode);
 						generate_for_this[i] = false;	
-                        if(generateCmdVelTrajectory(cmd_vel_modes[auto_mode_data.modes_[i]][i][auto_mode_data.start_pos_])) {
+                        const CmdVelMode *cmd_vel_mode = find_cmd_vel_mode(cmd_vel_modes, auto_mode_data.modes_[i], i, auto_mode_data.start_pos_);
+                        if(!cmd_vel_mode)
+                            ROS_ERROR_STREAM("No cmd_vel auto mode " << auto_mode_data.modes_[i] << " for layout " << i << " start " << auto_mode_data.start_pos_ << ", not running an auto for this layout");
+                        if(cmd_vel_mode && generateCmdVelTrajectory(*cmd_vel_mode)) {
 							mode_buffered[i] = true;
                             auto_mode_status_vect[i]=1;
 
@@ -1578,16 +1384,24 @@ int main(int argc, char** argv) {
             if(in_auto && mode_buffered[layout] && match_data_received) { //if in auto with mode buffered run it
                 //ROS_INFO("Match data received and auto buffered");
                 if(auto_mode_vect[layout] > num_cmd_vel_modes-1) {
-                    run_auto(auto_mode_vect[layout], layout, start_pos, 
-                             delays_vect[layout], profiled_modes[auto_mode_vect[layout]-num_cmd_vel_modes][layout][start_pos], start_of_buffer_ids);
+                    const FullMode *full_mode = find_profiled_mode(profiled_modes, auto_mode_vect[layout]-num_cmd_vel_modes, layout, start_pos);
+                    if(full_mode)
+                        run_auto(auto_mode_vect[layout], layout, start_pos, 
+                                 delays_vect[layout], *full_mode, start_of_buffer_ids);
+                    else
+                        ROS_ERROR_STREAM("No auto mode " << auto_mode_vect[layout] << " for layout " << layout << " start " << start_pos << ", not running auto");
                 }
 
 
 
 
                 else if(auto_mode_vect[layout] >= 0) {
-                    run_auto(auto_mode_vect[layout], layout, start_pos, 
-                             delays_vect[layout], cmd_vel_modes[auto_mode_vect[layout]][layout][start_pos].segments);
+                    const CmdVelMode *cmd_vel_mode = find_cmd_vel_mode(cmd_vel_modes, auto_mode_vect[layout], layout, start_pos);
+                    if(cmd_vel_mode)
+                        run_auto(auto_mode_vect[layout], layout, start_pos, 
+                                 delays_vect[layout], cmd_vel_mode->segments);
+                    else
+                        ROS_ERROR_STREAM("No cmd_vel auto mode " << auto_mode_vect[layout] << " for layout " << layout << " start " << start_pos << ", not running auto");
                     
                 }
                 //ROS_ERROR_STREAM("Running Auto");
@@ -1603,15 +1417,7 @@ int main(int argc, char** argv) {
             auto_mode_status_vect[2] = 1;
             auto_mode_status_vect[3] = 1;
             */
-            state_0.data = auto_mode_status_vect[0];
-            state_1.data = auto_mode_status_vect[1];
-            state_2.data = auto_mode_status_vect[2];
-            state_3.data = auto_mode_status_vect[3];
-            
-            auto_state_0.publish(state_0);
-            auto_state_1.publish(state_1);
-            auto_state_2.publish(state_2);
-            auto_state_3.publish(state_3);
+            publishAutoModeStatus();
             r.sleep();
         
 		}
@@ -1,4 +1,5 @@
 #include "ros/ros.h"
+#include <algorithm>
 #include <atomic>
 
 #include <realtime_tools/realtime_buffer.h>
@@ -9,6 +10,7 @@
 #include "behaviors/RobotAction.h"
 #include "behaviors/IntakeAction.h"
 #include "behaviors/LiftAction.h"
+#include "behaviors/event_waiter.h"
 #include "elevator_controller/ElevatorControl.h"
 #include "elevator_controller/ElevatorControlS.h"
 #include "elevator_controller/Intake.h"
@@ -50,6 +52,9 @@ class autoAction
 		std::atomic<bool> high_cube_;
 		bool bottom_lim_ = false;
 		bool proceed;
+		//Woken by anything executeCB waits on - subscribers below,
+		//lift / intake actions finishing, preempt requests
+		behaviors::EventWaiter events_;
 #if 0
 		// Elevator odometry. Make this a struct so that
 		// reads from it get data which is consistent - avoid
@@ -105,6 +110,7 @@ class autoAction
 
 			//al_ = std::make_shared<actionlib::SimpleActionClient<behaviors::LiftAction>>("auto_interpreter_server_lift", true);
 			//ai_ = std::make_shared<actionlib::SimpleActionClient<behaviors::IntakeAction>>("auto_interpreter_server_intake", true);
+			as_.registerPreemptCallback(boost::bind(&behaviors::EventWaiter::notify, &events_));
 			as_.start();
 		}
 
@@ -114,8 +120,8 @@ class autoAction
 
 		void executeCB(const behaviors::RobotGoalConstPtr &goal)
 		{
-			ros::Rate r(10);
 			const double startTime = ros::Time::now().toSec();
+			const double deadline = startTime + goal->time_out;
 			bool aborted = false;
 			bool success = false;
 			bool timed_out = false;
@@ -131,12 +137,11 @@ class autoAction
 			{
 				//ROS_INFO("start of pickup cube");
 				std_srvs::SetBool srv_clamp;
-				ros::spinOnce();
 				behaviors::IntakeGoal goal_i;
 				goal_i.IntakeCube = true;
 				goal_i.time_out = 15;
 				goal_i.wait_to_proceed = goal->wait_to_proceed;
-				ai_.sendGoal(goal_i);
+				ai_.sendGoal(goal_i, boost::bind(&autoAction::actionDoneCallback<behaviors::IntakeResultConstPtr>, this, _1, _2));
 				srv_clamp.request.data = false;
 				if (!ClampSrv_.call(srv_clamp)) ROS_ERROR("Srv_ clamp call failed");
 				//If we aren't yet ready to drop, go to where we can drop
@@ -152,7 +157,7 @@ class autoAction
 				goal_l.y_tolerance = 1.0;
 				goal_l.x_tolerance = drop_x_tolerance;
 
-				al_.sendGoal(goal_l);
+				sendLiftGoal(goal_l);
 	
 				//loop till we get to where we can drop
 				double finish_time = 0;	
@@ -170,8 +175,7 @@ class autoAction
 					}
 					if (!aborted)
 					{
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(deadline);
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 						//time_out if the action times out
 						//if (al_.getState().isDone())
@@ -204,8 +208,7 @@ class autoAction
 					if (!aborted)
 					{
 						//ROS_WARN("lift unfinished in p2");
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(deadline);
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 						//time_out if the action times out
 						//if (al_.getState().isDone())
@@ -230,8 +233,7 @@ class autoAction
 					if (!aborted)
 					{
 						//ROS_WARN_STREAM("wait for drop etc t: " <<ros::Time::now().toSec() - finish_time );
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(std::min(deadline, finish_time + wait_stabilize_before_drop));
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 					}
 
@@ -249,8 +251,7 @@ class autoAction
 					if (!aborted)
 					{
 						ROS_WARN_STREAM("wait for drop etc t: " <<ros::Time::now().toSec() - finish_time );
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(deadline);
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 					}
 
@@ -307,7 +308,7 @@ class autoAction
 					goal_l.y_tolerance = 0.1;
 					goal_l.x_tolerance = 0.1;
 					//ROS_INFO("start of pickup cube 3");
-					al_.sendGoal(goal_l);
+					sendLiftGoal(goal_l);
 					while (!aborted && !timed_out)
 					{
 
@@ -320,8 +321,7 @@ class autoAction
 						}
 						if (!aborted)
 						{
-							r.sleep();
-							ros::spinOnce();
+							events_.waitUntil(deadline);
 							timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 
 							if (al_.getState().isDone())
@@ -348,7 +348,7 @@ class autoAction
 					goal_l.dist_tolerance = 0.1; //Tolerances are intentionally large, will require testing
 					goal_l.y_tolerance = 0.1;
 					goal_l.x_tolerance = 0.1;
-					al_.sendGoal(goal_l);
+					sendLiftGoal(goal_l);
 					while (!aborted && !timed_out)
 					{
 						//ROS_INFO("start of pickup cube 4");
@@ -361,8 +361,7 @@ class autoAction
 						}
 						if (!aborted)
 						{
-							r.sleep();
-							ros::spinOnce();
+							events_.waitUntil(deadline);
 							timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 
 							if (al_.getState().isDone())
@@ -409,8 +408,7 @@ class autoAction
 					}
 					if (!aborted)
 					{
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(std::min(deadline, clamp_time + wait_after_clamp));
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 					}
 				}
@@ -442,14 +440,13 @@ class autoAction
 						goal_l.dist_tolerance = goal->dist_tolerance;
 						goal_l.y_tolerance = goal->y_tolerance;
 						goal_l.x_tolerance = goal->x_tolerance;
-						al_.sendGoal(goal_l);
+						sendLiftGoal(goal_l);
 						break;
 
 					}
 					if (!aborted)
 					{
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(std::min(deadline, open_time + wait_after_open));
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 					}
 				}
@@ -466,8 +463,7 @@ class autoAction
 					}
 					if (!aborted)
 					{
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(deadline);
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 
 						if (al_.getState().isDone())
@@ -499,7 +495,7 @@ class autoAction
 				goal_l.y_tolerance = 0.1;
 				goal_l.x_tolerance = 0.1;
 
-				al_.sendGoal(goal_l);
+				sendLiftGoal(goal_l);
 
 				elevator_controller::Intake srvIntake;
 				srvIntake.request.power = 0;
@@ -521,8 +517,7 @@ class autoAction
 					}
 					if (!aborted)
 					{
-						r.sleep();
-						ros::spinOnce();
+						events_.waitUntil(deadline);
 						timed_out = timed_out || (ros::Time::now().toSec() - startTime) > goal->time_out;
 						//time_out if the action times out
 						if (al_.getState().isDone())
@@ -570,10 +565,21 @@ class autoAction
 			return;
 		}
 
+		void sendLiftGoal(const behaviors::LiftGoal &goal)
+		{
+			al_.sendGoal(goal, boost::bind(&autoAction::actionDoneCallback<behaviors::LiftResultConstPtr>, this, _1, _2));
+		}
+		template <class ResultConstPtr>
+		void actionDoneCallback(const actionlib::SimpleClientGoalState &/*state*/, const ResultConstPtr &/*result*/)
+		{
+			events_.notify();
+		}
+
 		// TODO : debounce code?
 		void bottomLimitCallback(const std_msgs::Bool &msg)
 		{
 			bottom_lim_ = msg.data;
+			events_.notify();
 		}
 		void cubeStateCallback(const elevator_controller::CubeState &msg)
 		{
@@ -582,6 +588,7 @@ class autoAction
 		void proceedCallback(const std_msgs::Bool &msg)
 		{
 			proceed = msg.data;
+			events_.notify();
 		}
 
 
@@ -0,0 +1,248 @@
+//Compiles the auto yaml into an auto bundle (see talon_swerve_drive_controller/auto_bundle.h)
+//so the robot doesn't have to read the yaml or generate profiles at startup.
+//Run it with the same auto and cmd_vel params the robot uses loaded, plus
+//point_gen and the swerve drive controller (sim is fine) to generate the profiles:
+//  rosrun behaviors auto_bundle_compiler _output:=/path/to/autos.bundle
+//then point both auto_params/auto_bundle and the swerve_drive_controller's
+//auto_bundle param at the copy of that file on the robot.
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+
+#include <behaviors/auto_modes.h>
+
+//Lays out a bundle in memory. Sections are appended 8 byte aligned and
+//referenced by their offset from the start of the file
+class bundle_writer
+{
+	public:
+		bundle_writer(void) : data_(sizeof(auto_bundle::FileHeader), 0) {}
+
+		template <class T>
+		uint64_t append(const T *items, size_t count)
+		{
+			data_.resize((data_.size() + 7) & ~static_cast<size_t>(7), 0);
+			const uint64_t offset = data_.size();
+			const uint8_t *bytes = reinterpret_cast<const uint8_t *>(items);
+			data_.insert(data_.end(), bytes, bytes + count * sizeof(T));
+			return offset;
+		}
+
+		bool write(const std::string &path, auto_bundle::FileHeader header)
+		{
+			data_.resize((data_.size() + 7) & ~static_cast<size_t>(7), 0);
+			memcpy(header.magic, auto_bundle::magic, sizeof(header.magic));
+			header.version = auto_bundle::version;
+			header.wheel_count = auto_bundle::wheel_count;
+			header.file_size = data_.size();
+			header.checksum = auto_bundle::fnv1a(data_.data() + sizeof(header), data_.size() - sizeof(header));
+			memcpy(data_.data(), &header, sizeof(header));
+
+			//Write to a temp file and rename, so a robot reading the old
+			//bundle never sees a partly written one
+			const std::string tmp_path = path + ".tmp";
+			{
+				std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+				out.write(reinterpret_cast<const char *>(data_.data()), data_.size());
+				if (!out)
+				{
+					ROS_ERROR_STREAM("Could not write " << tmp_path);
+					return false;
+				}
+			}
+			if (rename(tmp_path.c_str(), path.c_str()) != 0)
+			{
+				ROS_ERROR_STREAM("Could not rename " << tmp_path << " to " << path);
+				return false;
+			}
+			ROS_INFO_STREAM("Wrote " << data_.size() << " byte auto bundle to " << path << ", checksum " << std::hex << header.checksum);
+			return true;
+		}
+
+	private:
+		std::vector<uint8_t> data_;
+};
+
+bool generate(swerve_point_generator::FullGenCoefs &srv)
+{
+	ros::NodeHandle n;
+	ros::ServiceClient client = n.serviceClient<swerve_point_generator::FullGenCoefs>("/point_gen/command");
+	return client.call(srv);
+}
+
+int main(int argc, char **argv)
+{
+	ros::init(argc, argv, "auto_bundle_compiler");
+	ros::NodeHandle n;
+	ros::NodeHandle n_private("~");
+	ros::NodeHandle n_params_behaviors(n, "auto_params");
+	ros::NodeHandle n_params_cmd_vel(n, "cmd_vel_params");
+
+	std::string output;
+	if (!n_private.getParam("output", output))
+	{
+		ROS_ERROR("auto_bundle_compiler needs an output file, set with _output:=<path>");
+		return 1;
+	}
+
+	//Same params autoInterpreterClient reads to find the modes
+	int num_profile_slots = 0;
+	int max_num_mode = 0;
+	int max_num_cmd_vel = 0;
+	int max_num_start = 0;
+	if (!n_params_behaviors.getParam("num_profile_slots", num_profile_slots))
+		ROS_ERROR("Didn't read param num_profile_slots");
+	if (!n_params_behaviors.getParam("max_num_mode", max_num_mode))
+		ROS_ERROR("Didn't read param max_num_mode in auto_bundle_compiler");
+	if (!n_params_behaviors.getParam("max_num_start", max_num_start))
+		ROS_ERROR("Didn't read param max_num_start in auto_bundle_compiler");
+	if (!n_params_cmd_vel.getParam("max_num_mode", max_num_cmd_vel))
+		ROS_ERROR("Didn't read cmd_vel param max_num_mode in auto_bundle_compiler");
+	const int max_num_wait_for_action = num_profile_slots / 4;
+
+	Modes all_modes = load_all_trajectories(max_num_mode, max_num_cmd_vel, max_num_start, max_num_wait_for_action, n_params_behaviors, n_params_cmd_vel);
+
+	if (!ros::service::waitForService("/point_gen/command", 60))
+	{
+		ROS_ERROR("point_gen isn't running");
+		return 1;
+	}
+
+	bundle_writer writer;
+	std::vector<auto_bundle::ModeEntry> mode_entries;
+	std::vector<auto_bundle::CmdVelModeEntry> cmd_vel_entries;
+	std::vector<auto_bundle::ProfileEntry> profile_entries;
+
+	for (size_t mode = 0; mode < all_modes.profiled_modes.size(); mode++)
+	{
+		for (size_t layout = 0; layout < all_modes.profiled_modes[mode].size(); layout++)
+		{
+			for (size_t start_pos = 0; start_pos < all_modes.profiled_modes[mode][layout].size(); start_pos++)
+			{
+				FullMode &full_mode = all_modes.profiled_modes[mode][layout][start_pos];
+				if (!full_mode.exists)
+					continue;
+
+				//point_gen serves several requests at once, so send all of
+				//this mode's profiles together
+				std::vector<std::future<bool>> requests;
+				for (int i = 0; i < full_mode.num_srv_msgs; i++)
+				{
+					swerve_point_generator::FullGenCoefs &srv = full_mode.srv_msgs[i];
+					requests.push_back(std::async(std::launch::async, [&srv]() { return generate(srv); }));
+				}
+
+				auto_bundle::ModeEntry entry = auto_bundle::ModeEntry();
+				entry.mode = mode;
+				entry.layout = layout;
+				entry.start_pos = start_pos;
+				entry.profile_first = profile_entries.size();
+				entry.profile_count = full_mode.num_srv_msgs;
+				for (int i = 0; i < full_mode.num_srv_msgs; i++)
+				{
+					if (!requests[i].get())
+					{
+						ROS_ERROR_STREAM("point_gen failed for mode " << mode << " layout " << layout << " start " << start_pos << " profile " << i);
+						return 1;
+					}
+					const swerve_point_generator::FullGenCoefs::Response &res = full_mode.srv_msgs[i].response;
+
+					std::vector<auto_bundle::WheelPoint> points(res.points.size(), auto_bundle::WheelPoint());
+					for (size_t p = 0; p < res.points.size(); p++)
+					{
+						if ((res.points[p].drive_pos.size() != auto_bundle::wheel_count) || (res.points[p].hold.size() != auto_bundle::wheel_count))
+						{
+							ROS_ERROR_STREAM("point_gen returned a point for the wrong number of wheels");
+							return 1;
+						}
+						for (size_t k = 0; k < auto_bundle::wheel_count; k++)
+						{
+							points[p].drive_pos[k] = res.points[p].drive_pos[k];
+							points[p].drive_f[k] = res.points[p].drive_f[k];
+							points[p].steer_pos[k] = res.points[p].steer_pos[k];
+							points[p].steer_f[k] = res.points[p].steer_f[k];
+							points[p].hold[k] = res.points[p].hold[k];
+						}
+					}
+					const std::vector<trajectory_msgs::JointTrajectoryPoint> &traj_points = res.joint_trajectory.points;
+					std::vector<auto_bundle::PathPoint> path_points(traj_points.size(), auto_bundle::PathPoint());
+					for (size_t p = 0; p < traj_points.size(); p++)
+					{
+						path_points[p].time_from_start = traj_points[p].time_from_start.toSec();
+						for (size_t j = 0; (j < 3) && (j < traj_points[p].positions.size()); j++)
+							path_points[p].positions[j] = traj_points[p].positions[j];
+						for (size_t j = 0; (j < 3) && (j < traj_points[p].velocities.size()); j++)
+							path_points[p].velocities[j] = traj_points[p].velocities[j];
+					}
+
+					auto_bundle::ProfileEntry profile = auto_bundle::ProfileEntry();
+					profile.dt = res.dt;
+					profile.point_count = points.size();
+					profile.points_offset = writer.append(points.data(), points.size());
+					profile.path_point_count = path_points.size();
+					profile.path_points_offset = writer.append(path_points.data(), path_points.size());
+					profile_entries.push_back(profile);
+				}
+
+				std::vector<auto_bundle::ActionEntry> actions(full_mode.actions.size(), auto_bundle::ActionEntry());
+				for (size_t a = 0; a < full_mode.actions.size(); a++)
+				{
+					const ActionStruct &action = full_mode.actions[a];
+					actions[a].time = action.time;
+					actions[a].action = action.action;
+					actions[a].wait_action_id = action.wait_action_id;
+					actions[a].wait_action_time = action.wait_action_time;
+					actions[a].wait_profile_id = action.wait_profile_id;
+					actions[a].up_or_down = action.action_setpoint.up_or_down;
+					actions[a].x = action.action_setpoint.x;
+					actions[a].y = action.action_setpoint.y;
+				}
+				entry.action_count = actions.size();
+				entry.actions_offset = writer.append(actions.data(), actions.size());
+				const std::vector<int32_t> wait_ids(full_mode.wait_ids.begin(), full_mode.wait_ids.end());
+				entry.wait_id_count = wait_ids.size();
+				entry.wait_ids_offset = writer.append(wait_ids.data(), wait_ids.size());
+				mode_entries.push_back(entry);
+				ROS_INFO_STREAM("Compiled mode " << mode << " layout " << layout << " start " << start_pos
+								<< " : " << entry.profile_count << " profiles, " << entry.action_count << " actions");
+			}
+		}
+	}
+
+	for (size_t mode = 0; mode < all_modes.cmd_vel_modes.size(); mode++)
+	{
+		for (size_t layout = 0; layout < all_modes.cmd_vel_modes[mode].size(); layout++)
+		{
+			for (size_t start_pos = 0; start_pos < all_modes.cmd_vel_modes[mode][layout].size(); start_pos++)
+			{
+				const CmdVelMode &cmd_vel_mode = all_modes.cmd_vel_modes[mode][layout][start_pos];
+				if (!cmd_vel_mode.exists)
+					continue;
+				std::vector<auto_bundle::CmdVelSegment> segments(cmd_vel_mode.segments.size());
+				for (size_t s = 0; s < segments.size(); s++)
+				{
+					segments[s].duration = cmd_vel_mode.segments[s].duration;
+					segments[s].x = cmd_vel_mode.segments[s].x;
+					segments[s].y = cmd_vel_mode.segments[s].y;
+				}
+				auto_bundle::CmdVelModeEntry entry = auto_bundle::CmdVelModeEntry();
+				entry.mode = mode;
+				entry.layout = layout;
+				entry.start_pos = start_pos;
+				entry.segment_count = segments.size();
+				entry.segments_offset = writer.append(segments.data(), segments.size());
+				cmd_vel_entries.push_back(entry);
+			}
+		}
+	}
+
+	auto_bundle::FileHeader header = auto_bundle::FileHeader();
+	header.mode_count = mode_entries.size();
+	header.modes_offset = writer.append(mode_entries.data(), mode_entries.size());
+	header.cmd_vel_mode_count = cmd_vel_entries.size();
+	header.cmd_vel_modes_offset = writer.append(cmd_vel_entries.data(), cmd_vel_entries.size());
+	header.profile_count = profile_entries.size();
+	header.profiles_offset = writer.append(profile_entries.data(), profile_entries.size());
+	return writer.write(output, header) ? 0 : 1;
+}
@@ -0,0 +1,439 @@
+//Loads auto modes, either by walking the auto yaml on the parameter
+//server or from a precompiled auto bundle. Shared by autoInterpreterClient
+//and auto_bundle_compiler
+#include <algorithm>
+
+#include <XmlRpcValue.h>
+
+#include <behaviors/auto_modes.h>
+
+Modes load_all_trajectories(int max_mode_num, int max_mode_cmd_vel, int max_start_pos_num, int max_wait_for_action_num, ros::NodeHandle &auto_data, ros::NodeHandle &cmd_vel_data)
+{
+	XmlRpc::XmlRpcValue mode_xml;
+	XmlRpc::XmlRpcValue actions_xml;
+
+	XmlRpc::XmlRpcValue cmd_vel_xml;
+
+	ModeList profiled_modes;
+    CmdVelList cmd_vel_modes;
+
+	profiled_modes.resize(max_mode_num + 1);
+	for(int mode = 0; mode <= max_mode_num; mode++)
+	{
+		profiled_modes[mode].resize(4);
+		for(int layout = 0; layout <= 3; layout++)
+		{
+			profiled_modes[mode][layout].resize(max_start_pos_num + 1);
+			for(int start_pos = 0; start_pos <= max_start_pos_num; start_pos++)
+			{
+				profiled_modes[mode][layout][start_pos].srv_msgs.resize(max_wait_for_action_num + 1);
+				std::string identifier("mode_"+std::to_string(mode)+"_layout_"+
+				std::to_string(layout)+"_start_"+std::to_string(start_pos));
+				
+				for(int wait_for_action = 0; wait_for_action <= max_wait_for_action_num; wait_for_action++)
+				{
+					std::string identifier_with_wait = identifier+ +"_wait_for_action_"+std::to_string(wait_for_action);
+					if(auto_data.getParam(identifier_with_wait, mode_xml))
+					{
+						//ROS_INFO_STREAM("Auto mode with identifier: " << identifier << " found");
+						//XmlRpc::XmlRpcValue &coefs_xml = mode_xml["coefs"];
+						//XmlRpc::XmlRpcValue &times_xml = mode_xml["times"];
+						const int num_splines = mode_xml.size();
+						//const int num_times = times_xml.size();
+						for(int num = 0; num<num_splines; num++) {
+							XmlRpc::XmlRpcValue &spline = mode_xml[num];
+							XmlRpc::XmlRpcValue &x = spline["x"];
+							XmlRpc::XmlRpcValue &y = spline["y"];
+							XmlRpc::XmlRpcValue &orient = spline["orient"];
+							//XmlRpc::XmlRpcValue &time = spline["time"];
+
+							swerve_point_generator::Coefs x_coefs;
+							swerve_point_generator::Coefs y_coefs;
+							swerve_point_generator::Coefs orient_coefs;
+							for(int i = 0; i<x.size(); i++) {
+								const double x_coef = x[i];
+								const double y_coef = y[i];
+								const double orient_coef = orient[i];
+
+								////ROS_WARN("%f", orient_coef);
+								x_coefs.spline.push_back(x_coef);
+								y_coefs.spline.push_back(y_coef);
+								orient_coefs.spline.push_back(orient_coef);
+							}
+							//const double t = time;
+							//profiled_modes[mode][layout][start_pos].times.push_back(t);
+							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_coefs.push_back(x_coefs);
+							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.y_coefs.push_back(y_coefs);
+							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.orient_coefs.push_back(orient_coefs);
+							profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.end_points.push_back(num+1);
+						}
+						profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.initial_v = 0; 
+						profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.final_v = 0; 
+						profiled_modes[mode][layout][start_pos].exists = true; 
+						profiled_modes[mode][layout][start_pos].num_srv_msgs +=1; 
+
+						//ROS_WARN_STREAM("mode: " << mode << " layout: " << layout << " start_pos: " << start_pos);
+
+						XmlRpc::XmlRpcValue group_xml;
+						if(auto_data.getParam(identifier_with_wait + "_spline_group", group_xml))
+						{
+							//ROS_INFO_STREAM("Custom grouping for identifier: " << identifier << " found");
+							for(int i = 0; i < group_xml.size(); i++)
+							{	
+								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.spline_groups.push_back(group_xml[i]);
+							}
+							XmlRpc::XmlRpcValue wait_xml;
+							if(auto_data.getParam(identifier_with_wait + "_waits", wait_xml))
+							{
+								//ROS_INFO_STREAM("Custom waits for identifier: " << identifier << " found");
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.wait_before_group.push_back(wait_xml[i]);
+								}
+							}
+							else
+							{
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.wait_before_group.push_back(0.25);
+								}
+							}
+							XmlRpc::XmlRpcValue shift_xml;
+							if(auto_data.getParam(identifier_with_wait + "_t_shifts", shift_xml))
+							{
+								//ROS_INFO_STREAM("Custom shifts for identifier: " << identifier_with_wait << " found");
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.t_shift.push_back(shift_xml[i]);
+								}
+							}
+							else
+							{
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.t_shift.push_back(0);
+								}
+							}
+							XmlRpc::XmlRpcValue flip_xml;
+							if(auto_data.getParam(identifier_with_wait + "_flips", flip_xml))
+							{
+								//ROS_INFO_STREAM("Custom flips for identifier: " << identifier_with_wait << " found");
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									bool temp = flip_xml[i];
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.flip.push_back(temp);
+								}
+							}
+							else
+							{
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.flip.push_back(false);
+								}
+							}
+							XmlRpc::XmlRpcValue x_inverts_xml;
+							if(auto_data.getParam(identifier_with_wait + "_x_inverts", x_inverts_xml))
+							{
+								//ROS_INFO_STREAM("Custom x inverts for identifier: " << identifier_with_wait << " found");
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									bool temp = x_inverts_xml[i];
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_invert.push_back(temp);
+								}
+							}
+							else
+							{
+								for(int i = 0; i < group_xml.size(); i++)
+								{
+									profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_invert.push_back(false);
+								}
+							}
+						}
+						else
+						{
+								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.flip.push_back(false);
+								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.x_invert.push_back(false);
+								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.spline_groups.push_back(num_splines);
+								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.wait_before_group.push_back(0.25);
+								profiled_modes[mode][layout][start_pos].srv_msgs[wait_for_action].request.t_shift.push_back(0);
+						}
+
+						
+					
+
+				}
+				
+
+			}
+			
+			if(auto_data.getParam(identifier+ "_actions", actions_xml))
+			{
+				//ROS_INFO_STREAM("Auto mode actions with identifier: " << identifier+"_actions" << " found");
+				const int num_actions = actions_xml.size();
+				profiled_modes[mode][layout][start_pos].actions.resize(num_actions);
+				for(int i = 0; i < max_wait_for_action_num; i++)
+				{
+					profiled_modes[mode][layout][start_pos].wait_ids.push_back(-1);
+				}
+
+				for(int num = 0; num<num_actions; num++) {
+					XmlRpc::XmlRpcValue &action = actions_xml[num];
+					XmlRpc::XmlRpcValue &time = action["time"];
+					
+					XmlRpc::XmlRpcValue &profile_wait_xml = action["profile_wait"];
+					XmlRpc::XmlRpcValue &action_waiter_xml = action["wait_for_action"];
+					XmlRpc::XmlRpcValue &action_waiter_duration_xml = action["wait_for_action_delay"];
+					XmlRpc::XmlRpcValue &profile_waiter_xml = action["wait_for_profile"];
+					//XmlRpc::XmlRpcValue &profile_waiter_duration_xml = action["wait_for_profile_delay"];
+					XmlRpc::XmlRpcValue &x_xml = action["x"];
+					XmlRpc::XmlRpcValue &y_xml = action["y"];
+					XmlRpc::XmlRpcValue &up_or_down_xml = action["up_or_down"];
+					const double profile_wait_double = profile_wait_xml;
+					int profile_wait = (int)profile_wait_double;
+
+					
+					const double action_waiter_double = action_waiter_xml;
+					int action_waiter = (int)action_waiter_double;
+
+				
+					
+					const double action_waiter_duration_double = action_waiter_duration_xml;
+					int action_waiter_duration = (int)action_waiter_duration_double;
+	
+
+					const double profile_waiter_double = profile_waiter_xml;
+					int profile_waiter = (int)profile_waiter_double;
+					
+					//TODO: add dur
+
+					profiled_modes[mode][layout][start_pos].actions[num].action_setpoint.x = x_xml;
+					profiled_modes[mode][layout][start_pos].actions[num].action_setpoint.y = y_xml;
+					profiled_modes[mode][layout][start_pos].actions[num].action_setpoint.up_or_down = up_or_down_xml;
+					
+					profiled_modes[mode][layout][start_pos].actions[num].wait_action_id = action_waiter;
+					profiled_modes[mode][layout][start_pos].actions[num].wait_action_time = action_waiter_duration_xml;
+
+				
+					profiled_modes[mode][layout][start_pos].actions[num].wait_profile_id = profile_waiter;
+					//profiled_modes[mode][layout][start_pos].actions[num].wait_profile_time = profile_waiter_duration_xml;
+
+					if(profile_wait >= 0)
+					{				
+						profiled_modes[mode][layout][start_pos].wait_ids[profile_wait] =  num;
+					}
+					//TODO: params
+					XmlRpc::XmlRpcValue &action_name = action["actions"];
+						//profiled_modes[mode][layout][start_pos].actions[num].actions.push_back(action_now);
+						if(action_name == "deploy_intake") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = deploy_intake;
+						}
+						else if(action_name == "undeploy_intake") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = undeploy_intake;
+						}
+						else if(action_name == "intake_cube") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = intake_cube;
+						}
+						else if(action_name == "exchange_cube") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = exchange_cube;
+						}
+						else if(action_name == "default_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = default_config;
+						}
+						else if(action_name == "intake_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = intake_config;
+						}
+						else if(action_name == "exchange_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = exchange_config;
+						}
+						else if(action_name == "switch_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = switch_config;
+						}
+						else if(action_name == "low_scale_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = low_scale_config;
+						}
+						else if(action_name == "mid_scale_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = mid_scale_config;
+						}
+						else if(action_name == "high_scale_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = high_scale_config;
+						}
+						else if(action_name == "over_back_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = over_back_config;
+						}
+						else if(action_name == "custom_config") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = custom_config;
+						}
+						else if(action_name == "release_clamp") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = release_clamp;
+						}
+						else if(action_name == "intake_open_down") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = intake_open_down;
+						}
+						else if(action_name == "intake_no_arm") {
+							profiled_modes[mode][layout][start_pos].actions[num].action = intake_no_arm;
+						}
+						else
+						{
+							//ROS_ERROR("action not found");
+						}
+						
+					//Exception handling?
+					const double time_now = time;
+					profiled_modes[mode][layout][start_pos].actions[num].time = time_now;
+					//const double t = time;
+					//profiled_modes[mode][layout][start_pos].times.push_back(t);
+				}
+			}
+			else
+			{
+				profiled_modes[mode][layout][start_pos].exists = false; 
+			}
+		}
+	}
+}
+
+	cmd_vel_modes.resize(max_mode_cmd_vel + 1);
+    ROS_INFO("Loading cmd_vel params");
+	for(int mode = 0; mode <= max_mode_cmd_vel; mode++)
+	{
+		cmd_vel_modes[mode].resize(4);
+		for(int layout = 0; layout <= 1; layout++)
+		{
+            cmd_vel_modes[mode][layout+2].resize(max_start_pos_num + 1);
+			cmd_vel_modes[mode][layout].resize(max_start_pos_num + 1);
+			for(int start_pos = 0; start_pos <= max_start_pos_num; start_pos++)
+			{
+				std::string identifier("mode_"+std::to_string(mode)+"_layout_"+std::to_string(layout)+"_"+std::to_string(layout + 2)+"_start_"+std::to_string(start_pos));
+                
+                if(cmd_vel_data.getParam(identifier, cmd_vel_xml))
+				{
+					//ROS_INFO_STREAM("cmd vel mode with identifier: " << identifier << " found cmd vel");
+					const int num_segments = cmd_vel_xml.size();
+                    cmd_vel_modes[mode][layout][start_pos].segments.resize(num_segments);
+                    cmd_vel_modes[mode][layout+2][start_pos].segments.resize(num_segments);
+					for(int num = 0; num<num_segments; num++) {
+						XmlRpc::XmlRpcValue &segment = cmd_vel_xml[num];
+						const double x = segment["x"];
+						const double y = segment["y"];
+						const double duration = segment["duration"];
+                        cmd_vel_modes[mode][layout][start_pos].segments[num].x = x;
+                        cmd_vel_modes[mode][layout][start_pos].segments[num].y = y;
+                        cmd_vel_modes[mode][layout][start_pos].segments[num].duration = duration;
+                        
+                        cmd_vel_modes[mode][layout+2][start_pos].segments[num].x = x;
+                        cmd_vel_modes[mode][layout+2][start_pos].segments[num].y = y;
+                        cmd_vel_modes[mode][layout+2][start_pos].segments[num].duration = duration;
+                    }
+                    cmd_vel_modes[mode][layout][start_pos].exists = true; 
+                    cmd_vel_modes[mode][layout+2][start_pos].exists = true; 
+                    
+                }
+            }
+        }
+    }
+    Modes all_modes;
+    all_modes.profiled_modes = profiled_modes;
+    all_modes.cmd_vel_modes = cmd_vel_modes;
+	return all_modes;
+}
+
+// Tables are sized from the same params as load_all_trajectories, so a
+// mode or start position the bundle doesn't have is just an empty entry
+Modes load_auto_bundle(const auto_bundle::Reader &bundle, int max_mode_num, int max_mode_cmd_vel, int max_start_pos_num)
+{
+	const auto_bundle::FileHeader &header = bundle.header();
+
+	Modes all_modes;
+	all_modes.profiled_modes.assign(max_mode_num + 1, std::vector<std::vector<FullMode>>(4, std::vector<FullMode>(max_start_pos_num + 1)));
+	all_modes.cmd_vel_modes.assign(max_mode_cmd_vel + 1, std::vector<std::vector<CmdVelMode>>(4, std::vector<CmdVelMode>(max_start_pos_num + 1)));
+
+	for(size_t i = 0; i < header.mode_count; i++)
+	{
+		const auto_bundle::ModeEntry &entry = bundle.mode(i);
+		if((entry.mode < 0) || (entry.mode > max_mode_num) || (entry.layout < 0) || (entry.layout > 3) ||
+		   (entry.start_pos < 0) || (entry.start_pos > max_start_pos_num))
+		{
+			ROS_ERROR_STREAM("Skipping bundled auto mode with bad index mode: " << entry.mode << " layout: " << entry.layout << " start: " << entry.start_pos);
+			continue;
+		}
+		FullMode &full_mode = all_modes.profiled_modes[entry.mode][entry.layout][entry.start_pos];
+		full_mode.exists = true;
+		full_mode.num_srv_msgs = entry.profile_count;
+		full_mode.srv_msgs.resize(entry.profile_count);
+		for(uint32_t p = 0; p < entry.profile_count; p++)
+			full_mode.bundle_profiles.push_back(entry.profile_first + p);
+
+		const auto_bundle::ActionEntry *actions = bundle.actions(entry);
+		full_mode.actions.resize(entry.action_count);
+		for(size_t a = 0; a < entry.action_count; a++)
+		{
+			ActionStruct &action = full_mode.actions[a];
+			action.time = actions[a].time;
+			action.action = static_cast<Action>(actions[a].action);
+			action.action_setpoint.x = actions[a].x;
+			action.action_setpoint.y = actions[a].y;
+			action.action_setpoint.up_or_down = actions[a].up_or_down != 0;
+			action.wait_action_id = actions[a].wait_action_id;
+			action.wait_action_time = actions[a].wait_action_time;
+			action.wait_profile_id = actions[a].wait_profile_id;
+		}
+		const int32_t *wait_ids = bundle.waitIds(entry);
+		full_mode.wait_ids.assign(wait_ids, wait_ids + entry.wait_id_count);
+	}
+
+	for(size_t i = 0; i < header.cmd_vel_mode_count; i++)
+	{
+		const auto_bundle::CmdVelModeEntry &entry = bundle.cmdVelMode(i);
+		if((entry.mode < 0) || (entry.mode > max_mode_cmd_vel) || (entry.layout < 0) || (entry.layout > 3) ||
+		   (entry.start_pos < 0) || (entry.start_pos > max_start_pos_num))
+		{
+			ROS_ERROR_STREAM("Skipping bundled cmd_vel mode with bad index mode: " << entry.mode << " layout: " << entry.layout << " start: " << entry.start_pos);
+			continue;
+		}
+		CmdVelMode &cmd_vel_mode = all_modes.cmd_vel_modes[entry.mode][entry.layout][entry.start_pos];
+		cmd_vel_mode.exists = true;
+		const auto_bundle::CmdVelSegment *segments = bundle.segments(entry);
+		cmd_vel_mode.segments.resize(entry.segment_count);
+		for(size_t s = 0; s < entry.segment_count; s++)
+		{
+			cmd_vel_mode.segments[s].duration = segments[s].duration;
+			cmd_vel_mode.segments[s].x = segments[s].x;
+			cmd_vel_mode.segments[s].y = segments[s].y;
+		}
+	}
+	return all_modes;
+}
+
+const FullMode *find_profiled_mode(const ModeList &modes, int mode, int layout, int start_pos)
+{
+	if((mode < 0) || (static_cast<size_t>(mode) >= modes.size()) ||
+	   (layout < 0) || (static_cast<size_t>(layout) >= modes[mode].size()) ||
+	   (start_pos < 0) || (static_cast<size_t>(start_pos) >= modes[mode][layout].size()))
+		return nullptr;
+	return &modes[mode][layout][start_pos];
+}
+
+const CmdVelMode *find_cmd_vel_mode(const CmdVelList &modes, int mode, int layout, int start_pos)
+{
+	if((mode < 0) || (static_cast<size_t>(mode) >= modes.size()) ||
+	   (layout < 0) || (static_cast<size_t>(layout) >= modes[mode].size()) ||
+	   (start_pos < 0) || (static_cast<size_t>(start_pos) >= modes[mode][layout].size()))
+		return nullptr;
+	return &modes[mode][layout][start_pos];
+}
+
+trajectory_msgs::JointTrajectory bundle_joint_trajectory(const auto_bundle::Reader &bundle, uint32_t profile_index)
+{
+	const auto_bundle::ProfileEntry &profile = bundle.profile(profile_index);
+	const auto_bundle::PathPoint *path_points = bundle.pathPoints(profile);
+
+	trajectory_msgs::JointTrajectory trajectory;
+	trajectory.points.resize(profile.path_point_count);
+	for(size_t i = 0; i < profile.path_point_count; i++)
+	{
+		trajectory.points[i].positions.assign(path_points[i].positions, path_points[i].positions + 3);
+		trajectory.points[i].velocities.assign(path_points[i].velocities, path_points[i].velocities + 3);
+		trajectory.points[i].time_from_start = ros::Duration(path_points[i].time_from_start);
+	}
+	return trajectory;
+}
@@ -4,6 +4,7 @@
 #include <arm_controller/CurArmCommand.h>
 #include <arm_controller/SetArmState.h>
 #include <talon_state_controller/TalonState.h>
+#include <talon_state_controller/talon_state_index.h>
 
 
 double arm_angle_deadzone;
@@ -21,13 +22,15 @@ class ForearmAction
         ros::ServiceClient arm_cur_command_srv_;
 
         ros::Subscriber talon_states_sub;
+        talon_state_controller::TalonStateIndex talon_index_;
 
         double arm_angle;
         double arm_cur_command;
     public:
         ForearmAction(std::string name) :
             as_(nh_, name, boost::bind(&ForearmAction::executeCB, this, _1), false),
-            action_name_(name)
+            action_name_(name),
+            talon_index_({"arm_joint"})
         {
             std::map<std::string, std::string> service_connection_header;
             service_connection_header["tcp_nodelay"] = "1";
@@ -86,22 +89,11 @@ class ForearmAction
         }
         void talonStateCallback(const talon_state_controller::TalonState &talon_state)
         {
-            static size_t arm_master_idx = std::numeric_limits<size_t>::max();
-
-            if (arm_master_idx >= talon_state.name.size())
-            {    
-                for (size_t i = 0; i < talon_state.name.size(); i++) 
-                {
-                    if (talon_state.name[i] == "arm_joint")
-                    {
-                        arm_master_idx = i; 
-                        break;
-                    }
-                }
-            }    
-
-            else {
-                arm_angle = talon_state.position[arm_master_idx];
+            if (talon_index_.update(talon_state))
+            {
+                const auto position = talon_index_.column(talon_state.position);
+                if (position.valid(0))
+                    arm_angle = position[0];
             }
         }
 };
@@ -1,6 +1,7 @@
 #include "ros/ros.h"
 #include "actionlib/server/simple_action_server.h"
 #include "behaviors/IntakeAction.h"
+#include "behaviors/event_waiter.h"
 #include "intake_controller/IntakeSrv.h"
 #include "sensor_msgs/JointState.h"
 #include <atomic>
@@ -24,12 +25,14 @@ class IntakeAction {
 	ros::Subscriber cube_state_;
 	ros::Subscriber proceed_;
 	bool proceed;
+	behaviors::EventWaiter events_; //woken by joint states and preempt requests
 
     public:
         IntakeAction(const std::string &name) :
             as_(nh_, name, boost::bind(&IntakeAction::executeCB, this, _1), false),
             action_name_(name)
         {
+            as_.registerPreemptCallback(boost::bind(&behaviors::EventWaiter::notify, &events_));
             as_.start();
             std::map<std::string, std::string> service_connection_header;
             service_connection_header["tcp_nodelay"] = "1";
@@ -43,7 +46,6 @@ class IntakeAction {
         }
 
         void executeCB(const behaviors::IntakeGoalConstPtr &goal) {
-            ros::Rate r(10);
             double start_time = ros::Time::now().toSec();
             bool timed_out = false;
             bool preempted = false;
@@ -59,8 +61,6 @@ class IntakeAction {
                 if(!intake_srv_.call(srv)) 
                     ROS_ERROR("Srv intake call failed in auto interpreter server intake");
 
-                ros::spinOnce();
-
                 cube_state_true_count = 0;
                 while(!success && !timed_out && !preempted) {
                     success = cube_state_true_count > linebreak_debounce_iterations;
@@ -69,9 +69,8 @@ class IntakeAction {
                         as_.setPreempted();
                         preempted = true;
                     }
-                    if (!preempted) {
-                        r.sleep();
-                        ros::spinOnce();
+                    if (!success && !preempted) {
+                        events_.waitUntil(start_time + goal->timeout);
                         timed_out = (ros::Time::now().toSec()-start_time) > goal->timeout;
                     }
                 }
@@ -94,9 +93,8 @@ class IntakeAction {
 					preempted = true;
 			    	}
 
-			    	if (!preempted) {
-					r.sleep();
-					ros::spinOnce();
+			    	if (!wait_done && !preempted) {
+					events_.waitUntil(start_time_extra + 1);
 				}
 			}
 		}
@@ -120,7 +118,6 @@ class IntakeAction {
                 srv.request.intake_in = true;
                 if(!intake_srv_.call(srv)) 
                     ROS_ERROR("Srv intake call failed in auto interpreter server intake");
-                ros::spinOnce();
 
                 success = false; //assume didn't succeed until we know it succeeded
                 while(!success && !timed_out && !preempted) {
@@ -131,9 +128,8 @@ class IntakeAction {
                         as_.setPreempted();
                         preempted = true;
                     }
-                    if (!preempted) {
-                        r.sleep();
-                        ros::spinOnce();
+                    if (!success && !preempted) {
+                        events_.waitUntil(start_time + goal->timeout);
                         timed_out = (ros::Time::now().toSec()-start_time) > goal->timeout;
                     }
                 }
@@ -148,9 +144,8 @@ class IntakeAction {
                         as_.setPreempted();
                         preempted = true;
                     }
-                    if (!preempted) {
-                        r.sleep();
-                        ros::spinOnce();
+                    if (!wait_done && !preempted) {
+                        events_.waitUntil(std::min(start_time_extra + 1, start_time + goal->timeout));
                         timed_out = (ros::Time::now().toSec()-start_time) > goal->timeout;
                     }
                 }
@@ -216,6 +211,7 @@ class IntakeAction {
 			cube_state_true_count = 0;
 			cube_state_false_count += 1;
 		}
+		events_.notify();
 	}
 };
 
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+//Predictive compressor scheduling. The compressor pulls 10+ amps, which
+//is enough to tip the battery into a brownout when it lines up with the
+//drive base accelerating hard. Instead of running whenever pressure is
+//below the cutoff, it runs when drive current is predicted to be low for
+//the next few seconds, unless pressure is getting too low to wait.
+//
+//Everything is updated in O(1) per callback with fixed size state :
+// - a linearly weighted average of the last N PDP current samples, kept
+//   with running sums instead of re-summing the window
+// - fast and slow EWMAs of current, their difference being the trend
+// - an EWMA of current per match time bucket, carried over from match to
+//   match since drivers tend to hit the same parts of a match hard
+// - an EWMA of the pressure slope
+namespace compressor_scheduler
+{
+
+//Linearly weighted moving average over the last Size samples - the newest
+//sample gets weight Size, the oldest weight 1
+template <size_t Size>
+class WeightedWindow
+{
+	public:
+		WeightedWindow(void) : head_(0), count_(0), sum_(0), weighted_sum_(0)
+		{
+			values_.fill(0);
+		}
+
+		void add(const double value)
+		{
+			if (count_ < Size)
+			{
+				count_ += 1;
+				weighted_sum_ += count_ * value;
+				sum_ += value;
+			}
+			else
+			{
+				//Every remaining sample drops one weight step, the
+				//oldest (weight 1) drops out entirely
+				weighted_sum_ += Size * value - sum_;
+				sum_ += value - values_[head_];
+			}
+			values_[head_] = value;
+			head_ = (head_ + 1) % Size;
+		}
+
+		double average(void) const
+		{
+			return count_ ? weighted_sum_ / (count_ * (count_ + 1) / 2.) : 0;
+		}
+
+	private:
+		std::array<double, Size> values_;
+		size_t head_;
+		size_t count_;
+		double sum_;
+		double weighted_sum_;
+};
+
+struct Config
+{
+	double compressor_current    = 12;   //A, subtracted from PDP current while running
+	double low_current           = 40;   //A, predicted drive current to start below
+	double high_current          = 80;   //A, predicted drive current to stop above
+	double prediction_horizon    = 2;    //s, how far ahead to predict current
+	double fast_time_constant    = .25;  //s
+	double slow_time_constant    = 3;    //s
+	double bucket_weight         = .5;   //blend of match time history vs recent current
+	double min_voltage           = 9;    //V, don't start below this
+	double brownout_voltage      = 7;    //V, counted in the match stats
+	double min_pressure          = 60;   //psi, always run below this
+	double max_pressure          = 120;  //psi, never run above this
+	double target_final_pressure = 45;   //psi, run if the trend says we'd end below this
+	double min_switch_time       = 1.5;  //s, minimum time between on / off changes
+	double end_game_time         = 30;   //s, match time left to stop running at, saving current for the climb
+};
+
+//Per match results, so scheduling changes can be compared match to match
+struct MatchStats
+{
+	double time              = 0; //s with FMS connected
+	double compressor_time   = 0; //s compressor commanded on
+	double high_current_time = 0; //s compressor on while drive current was above high_current
+	double min_voltage       = 1e9;
+	double voltage_sum       = 0;
+	double on_voltage_sum    = 0;
+	size_t samples           = 0;
+	size_t on_samples        = 0;
+	size_t brownouts         = 0; //drops below brownout_voltage
+	double start_pressure    = 0;
+	double end_pressure      = 0;
+};
+
+class Scheduler
+{
+	public:
+		static const size_t MatchBuckets = 32; //~5 sec each over a 150 sec match
+
+		explicit Scheduler(const Config &config) :
+			config_(config),
+			fast_current_(0),
+			slow_current_(0),
+			last_current_stamp_(-1),
+			pressure_((config.min_pressure + config.max_pressure) / 2.), //until the sensor reports, run on current alone
+			pressure_slope_(0),
+			last_pressure_stamp_(-1),
+			voltage_(12),
+			below_brownout_(false),
+			match_time_(-1),
+			running_(false),
+			last_switch_stamp_(-1e9)
+		{
+			bucket_current_.fill(0);
+			bucket_seen_.fill(false);
+		}
+
+		//stamp is in seconds, total_current the PDP total
+		void addCurrent(const double stamp, const double total_current, const double voltage)
+		{
+			const double drive_current = std::max(total_current - (running_ ? config_.compressor_current : 0), 0.);
+			window_.add(drive_current);
+			if (last_current_stamp_ < 0)
+			{
+				fast_current_ = drive_current;
+				slow_current_ = drive_current;
+			}
+			else
+			{
+				const double dt = std::max(stamp - last_current_stamp_, 0.);
+				fast_current_ += ewmaAlpha(dt, config_.fast_time_constant) * (drive_current - fast_current_);
+				slow_current_ += ewmaAlpha(dt, config_.slow_time_constant) * (drive_current - slow_current_);
+
+				const size_t b = bucket(match_time_);
+				if (b < MatchBuckets)
+				{
+					if (!bucket_seen_[b])
+					{
+						bucket_current_[b] = drive_current;
+						bucket_seen_[b] = true;
+					}
+					else
+						bucket_current_[b] += ewmaAlpha(dt, config_.slow_time_constant) * (drive_current - bucket_current_[b]);
+				}
+				if (match_time_ > 0)
+					updateStats(dt, drive_current);
+			}
+			voltage_ = voltage;
+			last_current_stamp_ = stamp;
+		}
+
+		void addPressure(const double stamp, const double pressure)
+		{
+			if ((last_pressure_stamp_ >= 0) && (stamp > last_pressure_stamp_))
+			{
+				const double dt = stamp - last_pressure_stamp_;
+				const double slope = (pressure - pressure_) / dt;
+				pressure_slope_ += ewmaAlpha(dt, config_.slow_time_constant) * (slope - pressure_slope_);
+			}
+			pressure_ = pressure;
+			last_pressure_stamp_ = stamp;
+		}
+
+		//Returns true if a match just ended, with its stats in stats()
+		bool setMatchTime(const double match_time)
+		{
+			const bool in_match = match_time > 0;
+			const bool was_in_match = match_time_ > 0;
+			match_time_ = match_time;
+			if (in_match && !was_in_match)
+			{
+				stats_ = MatchStats();
+				stats_.start_pressure = pressure_;
+			}
+			else if (!in_match && was_in_match)
+			{
+				stats_.end_pressure = pressure_;
+				return true;
+			}
+			return false;
+		}
+
+		//Drive current expected over the next prediction_horizon seconds
+		double predictedCurrent(void) const
+		{
+			const double trend = (fast_current_ - slow_current_) / std::max(config_.slow_time_constant - config_.fast_time_constant, 1e-3);
+			const double recent = std::max(std::max(window_.average(), fast_current_ + trend * config_.prediction_horizon), 0.);
+			const size_t b = bucket(match_time_ - config_.prediction_horizon);
+			if ((b < MatchBuckets) && bucket_seen_[b])
+				return (1 - config_.bucket_weight) * recent + config_.bucket_weight * bucket_current_[b];
+			return recent;
+		}
+
+		//Decide whether the compressor should run, call at a fixed rate
+		bool update(const double stamp)
+		{
+			bool run;
+			const double predicted = predictedCurrent();
+			const bool force_off = (pressure_ >= config_.max_pressure) ||
+				((match_time_ > 0) && (match_time_ <= config_.end_game_time));
+			const bool force_on = !force_off && (pressure_ < config_.min_pressure);
+			if (force_off)
+				run = false;
+			else if (force_on || endPressureLow())
+				run = true;
+			else if (running_)
+				run = (predicted < config_.high_current) && (voltage_ > config_.brownout_voltage);
+			else
+				run = (predicted < config_.low_current) && (voltage_ > config_.min_voltage);
+
+			//Don't chatter, other than for the hard limits
+			if ((run != running_) && !force_off && !force_on &&
+				((stamp - last_switch_stamp_) < config_.min_switch_time))
+				run = running_;
+			if (run != running_)
+				last_switch_stamp_ = stamp;
+			running_ = run;
+			return running_;
+		}
+
+		//For when something else is deciding, so the current model and
+		//match stats still know what the compressor is doing
+		void setRunning(const double stamp, const bool running)
+		{
+			if (running != running_)
+				last_switch_stamp_ = stamp;
+			running_ = running;
+		}
+
+		bool running(void) const { return running_; }
+		const MatchStats &stats(void) const { return stats_; }
+
+	private:
+		static double ewmaAlpha(const double dt, const double time_constant)
+		{
+			return 1. - exp(-dt / std::max(time_constant, 1e-3));
+		}
+
+		//Match time counts down from 150 sec
+		static size_t bucket(const double match_time)
+		{
+			if (match_time <= 0)
+				return MatchBuckets;
+			return std::min(static_cast<size_t>(match_time / 5.), MatchBuckets - 1);
+		}
+
+		//Projects the pressure trend to the end of the match
+		bool endPressureLow(void) const
+		{
+			if ((match_time_ <= config_.end_game_time) || (pressure_slope_ >= 0))
+				return false;
+			return (pressure_ + pressure_slope_ * match_time_) < config_.target_final_pressure;
+		}
+
+		void updateStats(const double dt, const double drive_current)
+		{
+			stats_.time += dt;
+			stats_.samples += 1;
+			stats_.voltage_sum += voltage_;
+			stats_.min_voltage = std::min(stats_.min_voltage, voltage_);
+			if (running_)
+			{
+				stats_.compressor_time += dt;
+				stats_.on_samples += 1;
+				stats_.on_voltage_sum += voltage_;
+				if (drive_current > config_.high_current)
+					stats_.high_current_time += dt;
+			}
+			const bool below = voltage_ < config_.brownout_voltage;
+			if (below && !below_brownout_)
+				stats_.brownouts += 1;
+			below_brownout_ = below;
+		}
+
+		Config config_;
+
+		WeightedWindow<60> window_;
+		double fast_current_;
+		double slow_current_;
+		double last_current_stamp_;
+		std::array<double, MatchBuckets> bucket_current_;
+		std::array<bool, MatchBuckets> bucket_seen_;
+
+		double pressure_;
+		double pressure_slope_; //psi / sec
+		double last_pressure_stamp_;
+
+		double voltage_;
+		bool below_brownout_;
+		double match_time_;
+
+		bool running_;
+		double last_switch_stamp_;
+
+		MatchStats stats_;
+};
+
+}
@@ -1,5 +1,7 @@
 #include <atomic>
+#include <memory>
 #include "compressor_control_node/regulate_compressor.h"
+#include "compressor_control_node/compressor_scheduler.h"
 
 static std::atomic<double> pressure_;
 static std::atomic<double> match_time_;
@@ -8,6 +10,28 @@ static std::atomic<double> weighted_average_current_;
 static bool is_auto_ = false; //0 for auto, one or greater for anything else
 static std::atomic<bool> disable_;
 
+//Only touched from callbacks and the main loop, both in the main thread
+static std::unique_ptr<compressor_scheduler::Scheduler> scheduler_;
+
+//Header stamps can be left empty by some publishers
+static double stampToSec(const ros::Time &stamp)
+{
+	return stamp.isZero() ? ros::Time::now().toSec() : stamp.toSec();
+}
+
+static void logMatchStats(const compressor_scheduler::MatchStats &stats)
+{
+	ROS_INFO_STREAM("regulate_compressor match stats :"
+			<< " match time " << stats.time
+			<< " compressor on " << stats.compressor_time
+			<< " on at high current " << stats.high_current_time
+			<< " min voltage " << ((stats.samples > 0) ? stats.min_voltage : 0)
+			<< " mean voltage " << ((stats.samples > 0) ? stats.voltage_sum / stats.samples : 0)
+			<< " mean voltage compressor on " << ((stats.on_samples > 0) ? stats.on_voltage_sum / stats.on_samples : 0)
+			<< " brownouts " << stats.brownouts
+			<< " pressure " << stats.start_pressure << " -> " << stats.end_pressure);
+}
+
 int main(int argc, char **argv) {
 	ros::init(argc, argv, "compressor_regulator");
 	ros::NodeHandle n;
@@ -45,6 +69,37 @@ int main(int argc, char **argv) {
 	max_end_game_use_ *= 60./(tank_count_ * tank_volume_); //converting into tank pressure
 	max_match_non_end_use_ *= 60./(tank_count_ * tank_volume_); //converting into tank pressure
 
+	//reactive runs whenever the match allows it, predictive runs when
+	//drive current is predicted to be low - see compressor_scheduler.h.
+	//Neither runs during auto
+	std::string scheduling_mode = "reactive";
+	n_params.getParam("scheduling_mode", scheduling_mode);
+	const bool predictive = scheduling_mode == "predictive";
+	if (!predictive && (scheduling_mode != "reactive"))
+		ROS_ERROR_STREAM("Unknown scheduling_mode " << scheduling_mode << " in regulate_compressor, using reactive");
+
+	ros::NodeHandle n_predictive(n, "predictive_params");
+	compressor_scheduler::Config config;
+	config.target_final_pressure = target_final_pressure_;
+	n_predictive.getParam("compressor_current", config.compressor_current);
+	n_predictive.getParam("low_current", config.low_current);
+	n_predictive.getParam("high_current", config.high_current);
+	n_predictive.getParam("prediction_horizon", config.prediction_horizon);
+	n_predictive.getParam("fast_time_constant", config.fast_time_constant);
+	n_predictive.getParam("slow_time_constant", config.slow_time_constant);
+	n_predictive.getParam("bucket_weight", config.bucket_weight);
+	n_predictive.getParam("min_voltage", config.min_voltage);
+	n_predictive.getParam("brownout_voltage", config.brownout_voltage);
+	n_predictive.getParam("min_pressure", config.min_pressure);
+	n_predictive.getParam("max_pressure", config.max_pressure);
+	n_predictive.getParam("min_switch_time", config.min_switch_time);
+	n_predictive.getParam("end_game_time", config.end_game_time);
+	double update_rate = 10;
+	n_predictive.getParam("update_rate", update_rate);
+
+	//Built for both modes so reactive matches get stats to compare against
+	scheduler_.reset(new compressor_scheduler::Scheduler(config));
+
 	ros::Publisher CompressorCommand = n.advertise<std_msgs::Float64>("/frcrobot/compressor_controller/command", 1);
 
 	ros::Subscriber pressure_sub_ = n.subscribe("/frcrobot/joint_states", 1, &pressureCallback);
@@ -57,17 +112,25 @@ int main(int argc, char **argv) {
 	weighted_average_current_ = 0;
 	disable_ = false;
 
-	ros::Rate r(1); //1 hz
-	bool run_last_tick; // TODO : initialize me
+	ros::Rate r(predictive ? update_rate : 1);
+	bool run_last_tick = false;
 	while(ros::ok())
 	{
 		ros::spinOnce();
 		std_msgs::Float64 holder_msg;
 		const double this_match_time = match_time_.load(std::memory_order_relaxed);
 		const double this_pressure = pressure_.load(std::memory_order_relaxed);
+		const double now = ros::Time::now().toSec();
+		bool scheduled = false;
 		if(fms_connected_.load(std::memory_order_relaxed) && !disable_.load(std::memory_order_relaxed) )
 		{
-			if(!is_auto_ && this_match_time > 30 /*&& (this_pressure < 110 || (run_last_tick && this_pressure < 120))*/)
+			if(predictive && !is_auto_)
+			{
+				run_last_tick = scheduler_->update(now);
+				holder_msg.data = run_last_tick ? 1 : 0;
+				scheduled = true;
+			}
+			else if(!is_auto_ && this_match_time > 30 /*&& (this_pressure < 110 || (run_last_tick && this_pressure < 120))*/)
 			{
 				//const double sensor_estimated = (this_match_time-30) * (120 - this_pressure) / (150 - this_match_time);
 				//FIX ABOVE SO IT TAKES INTO ACCOUNT REFILLS, and maybe use?
@@ -127,6 +190,9 @@ int main(int argc, char **argv) {
 			run_last_tick = true;
 		}
 
+		if(!scheduled)
+			scheduler_->setRunning(now, run_last_tick);
+
 		CompressorCommand.publish(holder_msg);
 
 		r.sleep();
@@ -148,7 +214,10 @@ void pressureCallback(const sensor_msgs::JointState &joint_state)
 	}
 
 	if(pressure_sensor_index < joint_state.position.size())
+	{
 		pressure_.store(joint_state.position[pressure_sensor_index], std::memory_order_relaxed);
+		scheduler_->addPressure(stampToSec(joint_state.header.stamp), joint_state.position[pressure_sensor_index]);
+	}
 	if(disable_index < joint_state.position.size())
 		disable_.store(joint_state.position[disable_index], std::memory_order_relaxed);
 }
@@ -158,25 +227,16 @@ void matchDataCallback(const frc_msgs::MatchSpecificData &matchData)
 	match_time_.store(matchData.matchTimeRemaining, std::memory_order_relaxed);
 	fms_connected_.store(matchData.matchTimeRemaining >= 0, std::memory_order_relaxed);
 	is_auto_ = matchData.Autonomous;
+	if(scheduler_->setMatchTime(matchData.matchTimeRemaining))
+		logMatchStats(scheduler_->stats());
 }
 
-// consider a boost::circular_buffer
 void currentCallback(const frc_msgs::PDPData &msg)
 {
-	static std::vector<double> currents;
-
-	if(currents.size() > 60)
-		currents.erase(currents.begin());
+	static compressor_scheduler::WeightedWindow<60> currents;
 
-	currents.push_back(msg.totalCurrent);
-
-	double temp_weighted_average_current = 0;
-	int divider = currents.size() * (1 + currents.size())/2;
-	for(size_t i = 0; i < currents.size(); i++)
-	{
-		temp_weighted_average_current += currents[i] * (i+1.0)/divider;
-	}
-	//ROS_INFO_STREAM("current weigted avg: " << temp_weighted_average_current);
-	weighted_average_current_.store(temp_weighted_average_current, std::memory_order_relaxed);
+	currents.add(msg.totalCurrent);
+	//ROS_INFO_STREAM("current weigted avg: " << currents.average());
+	weighted_average_current_.store(currents.average(), std::memory_order_relaxed);
+	scheduler_->addCurrent(stampToSec(msg.header.stamp), msg.totalCurrent, msg.voltage);
 }
-
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// Replaces cvtColor(BGR2HSV) + inRange() with a table lookup straight
+// from BGR. The table has one bit per possible BGR colour (2MB) and is
+// built by running every colour through the same cvtColor + inRange, so
+// the mask is identical to the HSV version. It is only rebuilt when the
+// thresholds change, e.g. from the tuning trackbars.
+class HSVThresholdLUT
+{
+	public:
+		HSVThresholdLUT(void) :
+			bits_(1 << 21, 0),
+			valid_(false)
+		{
+		}
+
+		void update(const cv::Scalar &lo, const cv::Scalar &hi)
+		{
+			if (valid_ && (lo == lo_) && (hi == hi_))
+				return;
+
+			// One 256x256 slice of green x red per blue value
+			cv::Mat bgr(256, 256, CV_8UC3);
+			cv::Mat hsv;
+			cv::Mat in_range;
+			for (int b = 0; b < 256; b++)
+			{
+				for (int g = 0; g < 256; g++)
+				{
+					cv::Vec3b *row = bgr.ptr<cv::Vec3b>(g);
+					for (int r = 0; r < 256; r++)
+						row[r] = cv::Vec3b(b, g, r);
+				}
+				cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+				cv::inRange(hsv, lo, hi, in_range);
+
+				uint8_t *bits = &bits_[b << 13];
+				for (int g = 0; g < 256; g++)
+				{
+					const uchar *row = in_range.ptr<uchar>(g);
+					for (int r = 0; r < 256; r += 8)
+					{
+						uint8_t byte = 0;
+						for (int k = 0; k < 8; k++)
+							if (row[r + k])
+								byte |= 1 << k;
+						bits[(g << 5) | (r >> 3)] = byte;
+					}
+				}
+			}
+			lo_ = lo;
+			hi_ = hi;
+			valid_ = true;
+		}
+
+		// mask is 255 where the pixel is in range, 0 otherwise.
+		// Rows are split across threads
+		void apply(const cv::Mat &bgr, cv::Mat &mask) const
+		{
+			CV_Assert(valid_ && (bgr.type() == CV_8UC3));
+			mask.create(bgr.size(), CV_8UC1);
+			cv::parallel_for_(cv::Range(0, bgr.rows), ApplyBody(bits_, bgr, mask));
+		}
+
+	private:
+		class ApplyBody : public cv::ParallelLoopBody
+		{
+			public:
+				ApplyBody(const std::vector<uint8_t> &bits, const cv::Mat &bgr, cv::Mat &mask) :
+					bits_(bits),
+					bgr_(bgr),
+					mask_(mask)
+				{
+				}
+
+				void operator()(const cv::Range &range) const
+				{
+					const uint8_t *bits = bits_.data();
+					for (int y = range.start; y < range.end; y++)
+					{
+						const uchar *in = bgr_.ptr<uchar>(y);
+						uchar *out = mask_.ptr<uchar>(y);
+						for (int x = 0; x < bgr_.cols; x++, in += 3)
+						{
+							const uint32_t index = (in[0] << 16) | (in[1] << 8) | in[2];
+							out[x] = ((bits[index >> 3] >> (index & 7)) & 1) ? 255 : 0;
+						}
+					}
+				}
+
+			private:
+				const std::vector<uint8_t> &bits_;
+				const cv::Mat              &bgr_;
+				cv::Mat                    &mask_;
+		};
+
+		std::vector<uint8_t> bits_;
+		cv::Scalar           lo_;
+		cv::Scalar           hi_;
+		bool                 valid_;
+};
@@ -16,13 +16,17 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
+#include <memory>
 #include <sstream>
 #include <vector>
 
 #include "track3d.hpp"
 #include "objtype.hpp"
 #include "kalman.hpp"
-#include "hungarian.hpp"
+#include "depthstats.hpp"
+#include "pipeline.hpp"
+
+#include "cube_detection/hsv_threshold_lut.h"
 
 //#include "vid_reader.cpp"
 
@@ -59,6 +63,13 @@ int pixelError = .06;
 //max: 193695.3745 * .2226^x + 9000
 
 static bool down_sample = false;
+
+// Tracking mode - only search around where cubes are expected to be
+static bool tracking = false;
+static int tracking_full_frame_interval = 15;
+static double tracking_window_margin = 1.0;
+static std::unique_ptr<SearchWindowTracker> search_windows;
+static HSVThresholdLUT threshold_lut;
 //This funtion along with the commented out slider code is useful when getting new HSV values for the threshold
 //To get the trackbars active, comment out the lines marked "mark1", uncomment the lines marked "mark2",
 //multiline comment from "markS" to "markE"
@@ -79,128 +90,182 @@ void cubeDivision(Rect boundRect, Rect vRect){
 
 }
 */
-void callback(const ImageConstPtr &frameMsg, const ImageConstPtr &depthMsg)
+// One synced RGB / depth pair working its way through the pipeline
+struct CubeFrame
 {
-	cv_bridge::CvImageConstPtr cvFrame = cv_bridge::toCvShare(frameMsg, sensor_msgs::image_encodings::BGR8);
-	cv_bridge::CvImageConstPtr cvDepth = cv_bridge::toCvShare(depthMsg, sensor_msgs::image_encodings::TYPE_32FC1); 
-	
-	// Avoid copies by using pointers to RGB and depth info
-	// These pointers are either to the original data or to
-	// the downsampled data, depending on the down_sample flag
-	const Mat *framePtr = &cvFrame->image;
-	const Mat *depthPtr = &cvDepth->image;
-	
-
-	// To hold downsampled images, if necessary
-	Mat frame;
+	ImageConstPtr frameMsg;
+	ImageConstPtr depthMsg;
+	// Keep the converted images alive, image / depth
+	// may just point at their data
+	cv_bridge::CvImageConstPtr cvFrame;
+	cv_bridge::CvImageConstPtr cvDepth;
+	Mat image;
 	Mat depth;
-
- 	Mat gray;
-	Mat thresh;
-
-	// Downsample for speed purposes
-	if (down_sample)
-	{
-		pyrDown(*framePtr, frame);
-		pyrDown(*depthPtr, depth);
-
-		framePtr = &frame;
-		depthPtr = &depth;
-		
-	}
-	Mat hsv;
 	Mat threshold;
-	Mat contour;
-	
-	// Create a kernel that we will use to sharpen our image
-   	Mat kernel = (Mat_<float>(3,3) <<
-        	          1,  1, 1,
-        	          1, -8, 1,
-        	          1,  1, 1); 
-    	//Mat imgLaplacian;
-    	//filter2D(frame, imgLaplacian, CV_32F, kernel);
-    	//Mat sharp;
-	//frame.convertTo(sharp, CV_32F);
-    	//Mat imgResult = sharp - imgLaplacian;
-    	// convert back to 8bits gray scale
-    	//imgResult.convertTo(imgResult, CV_8UC3);
-    	//imgLaplacian.convertTo(imgLaplacian, CV_8UC3);
-   	// imshow( "Laplace Filtered Image", imgLaplacian);
-    	//imshow( "New Sharped Image", imgResult);
-
-	cvtColor(*framePtr,hsv,COLOR_BGR2HSV);
-	cvtColor(*framePtr, gray, COLOR_BGR2GRAY);
-	inRange(hsv, Scalar(hLo,sLo,vLo),Scalar(hUp,255,255),threshold); //mark2
-
-	erode(threshold,threshold,getStructuringElement(MORPH_ELLIPSE,Size(7,7)));
-	dilate(threshold,threshold,getStructuringElement(MORPH_ELLIPSE,Size(7,7)));
-
-	dilate(threshold,threshold,getStructuringElement(MORPH_ELLIPSE,Size(6,6)));
-	erode(threshold,threshold,getStructuringElement(MORPH_ELLIPSE,Size(5,5)));
-
-	blur(gray, gray, Size(3,3));
-
+	// Parts of the image searched, the whole image
+	// unless tracking found somewhere to look
+	vector<Rect> windows;
+	bool full_frame = true;
 	vector<vector<Point> > contours;
+	vector<int> contour_window; // index into windows
 	vector<Vec4i> rank;
+	vector<vector<Point>> contours_poly;
+	vector<Rect> boundRect;
+	vector<float> contourDepth;
+};
 
-	findContours(threshold, contours, rank, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0,0));
+static Pipeline<CubeFrame> pipeline;
 
-	vector<vector<Point>> contours_poly(contours.size());
-	vector<Rect> boundRect(contours.size());
-	vector<float> contourDepth;
-	vector<int> approxPoly;
-	Mat drawing = Mat::zeros(threshold.size(),CV_8UC3);
+// Convert from ROS messages and threshold
+bool thresholdStage(CubeFrame &f)
+{
+	f.cvFrame = cv_bridge::toCvShare(f.frameMsg, sensor_msgs::image_encodings::BGR8);
+	f.cvDepth = cv_bridge::toCvShare(f.depthMsg, sensor_msgs::image_encodings::TYPE_32FC1); 
 
-	cube_detection::CubeDetection cd_msg;
+	// Downsample for speed purposes, otherwise
+	// use the message data directly to avoid copies
+	if (down_sample)
+	{
+		pyrDown(f.cvFrame->image, f.image);
+		pyrDown(f.cvDepth->image, f.depth);
+	}
+	else
+	{
+		f.image = f.cvFrame->image;
+		f.depth = f.cvDepth->image;
+	}
 
-	
-	const ObjectType objType = CUBE_2018;
-	const float hFov = 105.;
-	const Point2f fov(hFov * (M_PI / 180.), hFov * (M_PI / 180.) * ((float)framePtr->rows / framePtr->cols));
-	float camera_elevation = 0.0;
+	if (tracking && !search_windows)
+	{
+		const float hFov = 105.;
+		const Point2f fov(hFov * (M_PI / 180.), hFov * (M_PI / 180.) * ((float)f.image.rows / f.image.cols));
+		search_windows.reset(new SearchWindowTracker(f.image.size(), fov, 0.0f,
+					tracking_full_frame_interval, tracking_window_margin));
+	}
+	f.full_frame = !search_windows || !search_windows->nextWindows(f.windows);
+	if (f.full_frame)
+		f.windows.assign(1, Rect(Point(0, 0), f.image.size()));
+
+	// Outside of the search windows the threshold image is left blank
+	f.threshold.create(f.image.size(), CV_8UC1);
+	if (!f.full_frame)
+		f.threshold.setTo(Scalar(0));
+
+	// Colour threshold straight from BGR, same result as
+	// converting to HSV and running inRange on that
+	threshold_lut.update(Scalar(hLo,sLo,vLo),Scalar(hUp,255,255)); //mark2
+
+	// Erode + dilate with the same element is an open
+	static const Mat open_element(getStructuringElement(MORPH_ELLIPSE,Size(7,7)));
+	static const Mat dilate_element(getStructuringElement(MORPH_ELLIPSE,Size(6,6)));
+	static const Mat erode_element(getStructuringElement(MORPH_ELLIPSE,Size(5,5)));
+	for (size_t w = 0; w < f.windows.size(); w++)
+	{
+		Mat threshold(f.threshold(f.windows[w]));
+		threshold_lut.apply(f.image(f.windows[w]), threshold);
+		// BORDER_ISOLATED so windows don't read pixels outside
+		// of themselves, which are blank or another window's
+		morphologyEx(threshold,threshold,MORPH_OPEN,open_element,Point(-1,-1),1,BORDER_CONSTANT|BORDER_ISOLATED);
+
+		dilate(threshold,threshold,dilate_element,Point(-1,-1),1,BORDER_CONSTANT|BORDER_ISOLATED);
+		erode(threshold,threshold,erode_element,Point(-1,-1),1,BORDER_CONSTANT|BORDER_ISOLATED);
+	}
+	return true;
+}
 
+// Find contours and the depth of each
+bool contourStage(CubeFrame &f)
+{
+	vector<vector<Point> > window_contours;
+	vector<Vec4i> window_rank;
+	for (size_t w = 0; w < f.windows.size(); w++)
+	{
+		// findContours modifies its input, keep the
+		// threshold image intact for visualization
+		Mat threshold(visualization ? f.threshold(f.windows[w]).clone() : f.threshold(f.windows[w]));
+		findContours(threshold, window_contours, window_rank, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, f.windows[w].tl());
+
+		// Hierarchy entries index into this window's
+		// contours, shift them to match the combined list
+		const int base = f.contours.size();
+		for (size_t i = 0; i < window_rank.size(); i++)
+		{
+			Vec4i r = window_rank[i];
+			for (int j = 0; j < 4; j++)
+				if (r[j] >= 0)
+					r[j] += base;
+			f.rank.push_back(r);
+		}
+		f.contours.insert(f.contours.end(), window_contours.begin(), window_contours.end());
+		f.contour_window.resize(f.contours.size(), w);
+	}
 
+	const vector<vector<Point> > &contours = f.contours;
+	f.contours_poly.resize(contours.size());
+	f.boundRect.resize(contours.size());
 	for(size_t i = 0; i < contours.size(); i++)
 	{
-		approxPolyDP(Mat(contours[i]),contours_poly[i], 3, true);
-		boundRect[i] = boundingRect(Mat(contours_poly[i]));
+		approxPolyDP(Mat(contours[i]),f.contours_poly[i], 3, true);
+		f.boundRect[i] = boundingRect(Mat(f.contours_poly[i]));
 		
 	}
 
+	// Mean of the valid depth in the center third of each bounding rect,
+	// with depth stats only built for windows which have contours in them.
+	// Only this stage's thread touches depth_stats
+	static vector<DepthStats> depth_stats;
+	if (depth_stats.size() < f.windows.size())
+		depth_stats.resize(f.windows.size());
+	int computed = -1;
 	for(size_t i = 0; i < contours.size(); i++)
 	{
-		const float x = boundRect[i].x + (boundRect[i].width/2);
-		const float y = boundRect[i].y + (boundRect[i].height/2);
-		vector<float> depth_sample;
-		for(size_t idx = boundRect[i].width/3; idx < (boundRect[i].width/3)*2; idx++){
-			for(size_t idy = boundRect[i].height/3; idy < (boundRect[i].height/3)*2; idy++){
-				float depthAtPixel = depthPtr->at<float>(boundRect[i].y + idy, boundRect[i].x + idx);
-				depth_sample.push_back(depthAtPixel);			
-			}
+		const int w = f.contour_window[i];
+		if (w != computed)
+		{
+			depth_stats[w].compute(f.depth, f.windows[w]);
+			computed = w;
 		}
-		float depth_sum;
-		
-		for(size_t id = 0; id < depth_sample.size(); id++){
-			depth_sum = depth_sum + depth_sample[id];
+		const Rect &br = f.boundRect[i];
+		const Rect center(br.x + br.width/3, br.y + br.height/3, br.width/3, br.height/3);
+		f.contourDepth.push_back(depth_stats[w].mean(center));
+	}		
+	return true;
+}
 
-		}
-		for(size_t ind = 0; ind < depth_sample.size(); ind++){
-			if(isnan(depth_sample[ind]) == 0) {
-				contourDepth.push_back(depth_sum/depth_sample.size());
-				//ROS_INFO_STREAM(depth_sum/depth_sample.size() << endl);
-			}
-		}
+// Filter contours by size and shape, then publish the ones left
+bool classifyStage(CubeFrame &f)
+{
+	const ImageConstPtr &frameMsg = f.frameMsg;
+	const Mat *framePtr = &f.image;
+	const Mat &threshold = f.threshold;
+	const vector<vector<Point> > &contours = f.contours;
+	const vector<Vec4i> &rank = f.rank;
+	const vector<vector<Point>> &contours_poly = f.contours_poly;
+	const vector<Rect> &boundRect = f.boundRect;
+	const vector<float> &contourDepth = f.contourDepth;
+	vector<int> approxPoly;
+	Mat drawing = Mat::zeros(threshold.size(),CV_8UC3);
+
+	cube_detection::CubeDetection cd_msg;
+	vector<Rect> tracked_rects;
+	vector<float> tracked_depths;
 
-	}		
 	
+	const ObjectType objType = CUBE_2018;
+	const float hFov = 105.;
+	const Point2f fov(hFov * (M_PI / 180.), hFov * (M_PI / 180.) * ((float)framePtr->rows / framePtr->cols));
+	float camera_elevation = 0.0;
+
 	
 		cd_msg.header.seq = frameMsg->header.seq;
 		cd_msg.header.stamp = frameMsg->header.stamp;
 		cd_msg.header.frame_id = frameMsg->header.frame_id;
 	for(size_t i = 0; i< contours.size(); i++)
 	{
-		
-		
+		// No depth data to size or place it with
+		if (contourDepth[i] <= 0)
+			continue;
+
 		double minArea = sqrt(193695.3745 * (pow(0.2226,contourDepth[i]))) + minTrans; 
 		//double maxArea = sqrt(193695.3745 * (pow(0.2226,contourDepth[i])) + maxTrans); 
 		double areaRect = boundRect[i].height * boundRect[i].width;
@@ -311,6 +376,20 @@ void callback(const ImageConstPtr &frameMsg, const ImageConstPtr &depthMsg)
 			cd_msg.location.push_back(world_location_in);
 			cd_msg.angle = atan(world_location.y/world_location.x);
 		}
+
+		// Anything which made it this far is a cube
+		tracked_rects.push_back(boundRect[i]);
+		tracked_depths.push_back(contourDepth[i]);
+	}
+
+	// Track the cubes found, so the next frames
+	// only have to look where they are headed
+	if (search_windows)
+	{
+		search_windows->update(tracked_rects, tracked_depths, vector<ObjectType>(tracked_rects.size(), objType), f.full_frame);
+		if (!f.full_frame)
+			for (size_t w = 0; w < f.windows.size(); w++)
+				rectangle(drawing, f.windows[w], Scalar(0,255,255), 1);
 	}
 
 
@@ -335,8 +414,25 @@ void callback(const ImageConstPtr &frameMsg, const ImageConstPtr &depthMsg)
 
 	}
 	pub.publish(cd_msg);
-	waitKey(5);
+	if (visualization)
+		waitKey(5);
+	return true;
+}
 
+// Hand the frame to the pipeline and get back to
+// receiving messages. If the pipeline isn't started
+// this runs every stage here instead
+void callback(const ImageConstPtr &frameMsg, const ImageConstPtr &depthMsg)
+{
+	CubeFrame f;
+	f.frameMsg = frameMsg;
+	f.depthMsg = depthMsg;
+	pipeline.push(f);
+}
+
+void statsCallback(const ros::TimerEvent &)
+{
+	ROS_INFO_STREAM("cube_detect pipeline stats :\n" << formatStageStats(pipeline.stats()));
 }
 
 int main(int argc, char **argv)
@@ -360,9 +456,39 @@ int main(int argc, char **argv)
 	
 	nh.getParam("visualization", visualization);
 
-	
+	// Build the colour lookup now rather than on the first frame
+	threshold_lut.update(Scalar(hLo,sLo,vLo),Scalar(hUp,255,255));
+
+	// Run each stage in its own thread, so thresholding the next
+	// frame overlaps with classifying contours in this one.
+	// The visualization trackbars change the threshold from the
+	// highgui thread, so keep everything in the callback then
+	bool use_pipeline = true;
+	int pipeline_queue_size = 2;
+	double pipeline_stats_period = 10.;
+	nh.getParam("pipeline", use_pipeline);
+	nh.getParam("pipeline_queue_size", pipeline_queue_size);
+	nh.getParam("pipeline_stats_period", pipeline_stats_period);
+	nh.getParam("tracking", tracking);
+	nh.getParam("tracking_full_frame_interval", tracking_full_frame_interval);
+	nh.getParam("tracking_window_margin", tracking_window_margin);
+
+	// Only the most recent frame is worth looking at, so each
+	// stage drops anything it falls behind on. Publishing keeps
+	// everything it is given, in order
+	pipeline.addStage("threshold", thresholdStage, DropPolicy::KeepLatest);
+	pipeline.addStage("contours", contourStage, DropPolicy::KeepLatest);
+	pipeline.addStage("classify", classifyStage, DropPolicy::Block, pipeline_queue_size);
+	if (use_pipeline && !visualization)
+		pipeline.start();
+	ros::Timer stats_timer;
+	if (pipeline_stats_period > 0)
+		stats_timer = nh.createTimer(ros::Duration(pipeline_stats_period), statsCallback);
 
 	ros::spin();
 
+	pipeline.stop();
+	search_windows.reset();
+
 	return 0;
 }
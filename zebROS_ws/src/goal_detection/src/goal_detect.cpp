@@ -12,6 +12,7 @@
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2_ros/transform_broadcaster.h>
 #include <tf2_ros/transform_listener.h>
+#include <tf2_ros/message_filter.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
 #include <std_msgs/Header.h>
@@ -21,9 +22,13 @@
 
 #include "goal_detection/GoalDetection.h"
 
+#include <atomic>
+#include <memory>
 #include <sstream>
 
 #include "GoalDetector.hpp"
+#include "pipeline.hpp"
+#include "track3d.hpp"
 
 using namespace cv;
 using namespace std;
@@ -31,121 +36,234 @@ using namespace sensor_msgs;
 using namespace message_filters;
 
 static ros::Publisher pub;
+static ros::Publisher debug_image_pub;
 static GoalDetector *gd = NULL;
 static bool batch = true;
 static bool down_sample = false;
 
-void callback(const ImageConstPtr &frameMsg, const ImageConstPtr &depthMsg)
+// Tracking mode - only search around where the goal is expected to be
+static bool tracking = false;
+static int tracking_full_frame_interval = 15;
+static double tracking_window_margin = 1.0;
+static std::unique_ptr<SearchWindowTracker> search_windows;
+
+// Kept for the life of the node so there's transform history to
+// look up the odom -> camera transform at the time the image was taken
+static std::shared_ptr<tf2_ros::Buffer> tf_buffer;
+static std::shared_ptr<tf2_ros::TransformListener> tf_listener;
+// Holds camera -> goal transforms until odom -> camera is available
+// at their timestamp, rather than blocking the image callback
+static std::shared_ptr<tf2_ros::MessageFilter<geometry_msgs::TransformStamped>> odom_filter;
+// odom_filter can call back both from the pipeline thread adding to it
+// and from the thread spinning its callback queue
+static std::atomic<size_t> projected_count(0);
+static std::atomic<size_t> dropped_count(0);
+
+// Called once the odom -> camera transform at the goal's stamp is known
+void odomProjectionCallback(const geometry_msgs::TransformStampedConstPtr &transformStamped)
 {
-	cv_bridge::CvImageConstPtr cvFrame = cv_bridge::toCvShare(frameMsg, sensor_msgs::image_encodings::BGR8);
-	cv_bridge::CvImageConstPtr cvDepth = cv_bridge::toCvShare(depthMsg, sensor_msgs::image_encodings::TYPE_32FC1);
+	geometry_msgs::TransformStamped transformStampedOdomCamera;
+	try
+	{
+		transformStampedOdomCamera = tf_buffer->lookupTransform("odom", transformStamped->header.frame_id,
+									 transformStamped->header.stamp);
+	}
+	catch (tf2::TransformException &ex)
+	{
+		dropped_count += 1;
+		ROS_WARN_THROTTLE(1, "goal_detect : %s", ex.what());
+		return;
+	}
 
-	// Avoid copies by using pointers to RGB and depth info
-	// These pointers are either to the original data or to
-	// the downsampled data, depending on the down_sample flag
-	const Mat *framePtr = &cvFrame->image;
-	const Mat *depthPtr = &cvDepth->image;
+	geometry_msgs::TransformStamped transformStampedOdomGoal;
 
-	// To hold downsampled images, if necessary
-	Mat frame;
-	Mat depth;
+	tf2::doTransform(*transformStamped, transformStampedOdomGoal, transformStampedOdomCamera);
 
-	// Downsample for speed purposes
-	if (down_sample)
-	{
-		pyrDown(*framePtr, frame);
+	static tf2_ros::TransformBroadcaster br;
+	br.sendTransform(transformStampedOdomGoal);
+	projected_count += 1;
+}
 
-		pyrDown(*depthPtr, depth);
+// Called when a goal is dropped from the filter queue without
+// the transform showing up, or is too old for the buffer
+void odomProjectionFailure(const geometry_msgs::TransformStampedConstPtr &transformStamped,
+						   tf2_ros::filter_failure_reasons::FilterFailureReason reason)
+{
+	dropped_count += 1;
+	ROS_WARN_THROTTLE(1, "goal_detect : dropped goal projection at %f, reason %d : %zu dropped, %zu projected",
+			transformStamped->header.stamp.toSec(), static_cast<int>(reason), dropped_count.load(), projected_count.load());
+}
 
-		// And update pointers to use the downsampled
-		// versions of the RGB and depth data
-		framePtr = &frame;
-		depthPtr = &depth;
+// One synced RGB / depth pair working its way through the pipeline
+struct GoalDetectFrame
+{
+	ImageConstPtr frameMsg;
+	ImageConstPtr depthMsg;
+	// Keep the converted images alive, goal.image / depth
+	// may just point at their data
+	cv_bridge::CvImageConstPtr cvFrame;
+	cv_bridge::CvImageConstPtr cvDepth;
+	GoalFrame goal;
+	bool found = false;
+	bool full_frame = true; // false if only goal.search_windows were searched
+};
+
+static Pipeline<GoalDetectFrame> pipeline;
+
+// Convert from ROS messages, downsampling if requested
+bool convertStage(GoalDetectFrame &f)
+{
+	f.cvFrame = cv_bridge::toCvShare(f.frameMsg, sensor_msgs::image_encodings::BGR8);
+	f.cvDepth = cv_bridge::toCvShare(f.depthMsg, sensor_msgs::image_encodings::TYPE_32FC1);
+
+	// Downsample for speed purposes, otherwise
+	// use the message data directly to avoid copies
+	if (down_sample)
+	{
+		pyrDown(f.cvFrame->image, f.goal.image);
+		pyrDown(f.cvDepth->image, f.goal.depth);
+	}
+	else
+	{
+		f.goal.image = f.cvFrame->image;
+		f.goal.depth = f.cvDepth->image;
 	}
 
 	// Initialize goal detector object the first time
 	// through here. Use the size of the frame
-	// grabbed from the ZED messages
+	// grabbed from the ZED messages. Later stages only
+	// see this frame after it is set
 	if (gd == NULL)
 	{
 		const float hFov = 105.;
 		const Point2f fov(hFov * (M_PI / 180.),
-						  hFov * (M_PI / 180.) * ((float)framePtr->rows / framePtr->cols));
-		gd = new GoalDetector(fov, framePtr->size(), !batch);
+						  hFov * (M_PI / 180.) * ((float)f.goal.image.rows / f.goal.image.cols));
+		gd = new GoalDetector(fov, f.goal.image.size(), !batch);
+		if (tracking)
+			search_windows.reset(new SearchWindowTracker(f.goal.image.size(), fov, 0.0f,
+						tracking_full_frame_interval, tracking_window_margin));
 	}
-	gd->findBoilers(*framePtr, *depthPtr);
-	Mat tempFrame(framePtr->clone());
-	gd->drawOnFrame(tempFrame, gd->getContours(tempFrame));
+	f.full_frame = !search_windows || !search_windows->nextWindows(f.goal.search_windows);
+	return true;
+}
 
-	const Point3f pt = gd->goal_pos();
+// The detection stages let frames with nothing in them through
+// so a not-valid message still goes out for every frame
+bool thresholdStage(GoalDetectFrame &f)
+{
+	f.found = gd->thresholdStage(f.goal);
+	return true;
+}
+
+bool measureStage(GoalDetectFrame &f)
+{
+	if (f.found)
+		f.found = gd->measureStage(f.goal);
+	if (f.found)
+		gd->pairStage(f.goal);
+	return true;
+}
+
+bool publishStage(GoalDetectFrame &f)
+{
+	const Point3f pt = f.goal.valid ? f.goal.goal_pos : Point3f();
 
 	goal_detection::GoalDetection gd_msg;
-	gd_msg.header.seq = frameMsg->header.seq;
-	gd_msg.header.stamp = frameMsg->header.stamp;
-	gd_msg.header.frame_id = frameMsg->header.frame_id;
+	gd_msg.header.seq = f.frameMsg->header.seq;
+	gd_msg.header.stamp = f.frameMsg->header.stamp;
+	gd_msg.header.frame_id = f.frameMsg->header.frame_id;
 	gd_msg.location.x = pt.x;
 	gd_msg.location.y = pt.y;
 	gd_msg.location.z = pt.z;
-	gd_msg.valid = gd->Valid();
+	gd_msg.valid = f.goal.valid;
 	pub.publish(gd_msg);
 
-	if (!batch)
+	// Track each piece of tape, so the next frames
+	// only have to look where they are headed
+	if (search_windows)
+	{
+		vector<Rect> rects;
+		vector<float> depths;
+		vector<ObjectType> types;
+		if (f.goal.valid)
+		{
+			const float depth = cv::norm(f.goal.goal_pos);
+			rects.push_back(f.goal.goal_left_rect);
+			rects.push_back(f.goal.goal_right_rect);
+			depths.assign(2, depth);
+			types.assign(2, ObjectType(TOP_TAPE_2017));
+		}
+		search_windows->update(rects, depths, types, f.full_frame);
+	}
+
+	// Debug drawing reuses the contours from the threshold stage,
+	// and is skipped unless something is looking at the result
+	const bool publish_debug = debug_image_pub.getNumSubscribers() > 0;
+	if (publish_debug || !batch)
 	{
-		Mat thisFrame(framePtr->clone());
-		gd->drawOnFrame(thisFrame, gd->getContours(cvFrame->image));
-		imshow("Image", thisFrame);
-		waitKey(5);
+		cv_bridge::CvImage debug_image(f.frameMsg->header, sensor_msgs::image_encodings::BGR8);
+		f.goal.image.copyTo(debug_image.image);
+		gd->drawOnFrame(debug_image.image, f.goal);
+		for (size_t i = 0; i < f.goal.search_windows.size(); i++)
+			rectangle(debug_image.image, f.goal.search_windows[i], Scalar(0,255,255), 1);
+		if (publish_debug)
+			debug_image_pub.publish(debug_image.toImageMsg());
+		if (!batch)
+		{
+			imshow("Image", debug_image.image);
+			waitKey(5);
+		}
 	}
 
 	if (gd_msg.valid == false)
 	{
-		return;
+		return true;
 	}
 
 	//Transform between goal frame and odometry/map.
 	static tf2_ros::TransformBroadcaster br;
-	geometry_msgs::TransformStamped transformStamped;
+	geometry_msgs::TransformStampedPtr transformStamped(new geometry_msgs::TransformStamped);
 
-	transformStamped.header.stamp = ros::Time::now();
-	transformStamped.header.frame_id = cvFrame->header.frame_id;
-	transformStamped.child_frame_id = "goal";
+	// Stamp with the image time, so the odom projection uses
+	// where the camera was when this frame was grabbed
+	transformStamped->header.stamp = f.frameMsg->header.stamp;
+	transformStamped->header.frame_id = f.cvFrame->header.frame_id;
+	transformStamped->child_frame_id = "goal";
 
-	transformStamped.transform.translation.x = gd_msg.location.x;
-	transformStamped.transform.translation.y = gd_msg.location.y;
-	transformStamped.transform.translation.z = gd_msg.location.z;
+	transformStamped->transform.translation.x = gd_msg.location.x;
+	transformStamped->transform.translation.y = gd_msg.location.y;
+	transformStamped->transform.translation.z = gd_msg.location.z;
 
 	tf2::Quaternion q;
 	q.setRPY(0, 0, 0);
 
-	transformStamped.transform.rotation.x = q.x();
-	transformStamped.transform.rotation.y = q.y();
-	transformStamped.transform.rotation.z = q.z();
-	transformStamped.transform.rotation.w = q.w();
-
-	br.sendTransform(transformStamped);
+	transformStamped->transform.rotation.x = q.x();
+	transformStamped->transform.rotation.y = q.y();
+	transformStamped->transform.rotation.z = q.z();
+	transformStamped->transform.rotation.w = q.w();
 
-	//Transform between a fixed frame and the goal.
-	tf2_ros::Buffer tfBuffer;
-	tf2_ros::TransformListener tfListener(tfBuffer);
+	br.sendTransform(*transformStamped);
 
-	geometry_msgs::TransformStamped transformStampedOdomCamera;
-	try
-	{
-		transformStampedOdomCamera = tfBuffer.lookupTransform("odom", cvFrame->header.frame_id,
-									 ros::Time(0));
-	}
-	catch (tf2::TransformException &ex)
-	{
-		ROS_WARN("%s", ex.what());
-		ros::Duration(1.0).sleep();
-		return;
-	}
-
-	geometry_msgs::TransformStamped transformStampedOdomGoal;
+	//Transform between a fixed frame and the goal, once
+	//odom -> camera at this stamp is available
+	odom_filter->add(transformStamped);
+	return true;
+}
 
-	tf2::doTransform(transformStamped, transformStampedOdomGoal, transformStampedOdomCamera);
+// Hand the frame to the pipeline and get back to
+// receiving messages. If the pipeline isn't started
+// this runs every stage here instead
+void callback(const ImageConstPtr &frameMsg, const ImageConstPtr &depthMsg)
+{
+	GoalDetectFrame f;
+	f.frameMsg = frameMsg;
+	f.depthMsg = depthMsg;
+	pipeline.push(f);
+}
 
-	br.sendTransform(transformStampedOdomGoal);
+void statsCallback(const ros::TimerEvent &)
+{
+	ROS_INFO_STREAM("goal_detect pipeline stats :\n" << formatStageStats(pipeline.stats()));
 }
 
 int main(int argc, char **argv)
@@ -160,6 +278,30 @@ int main(int argc, char **argv)
 	nh.getParam("sub_rate", sub_rate);
 	nh.getParam("pub_rate", pub_rate);
 	nh.getParam("batch", batch);
+	double tf_cache_time = 10.;
+	int tf_queue_size = 10;
+	nh.getParam("tf_cache_time", tf_cache_time);
+	nh.getParam("tf_queue_size", tf_queue_size);
+	// Run each stage in its own thread, so e.g. thresholding
+	// the next frame overlaps with pairing up goals in this one.
+	// Without batch, GoalDetector's trackbars change its settings
+	// from the highgui thread, so keep everything in the callback then
+	bool use_pipeline = true;
+	int pipeline_queue_size = 2;
+	double pipeline_stats_period = 10.;
+	nh.getParam("pipeline", use_pipeline);
+	nh.getParam("pipeline_queue_size", pipeline_queue_size);
+	nh.getParam("pipeline_stats_period", pipeline_stats_period);
+	nh.getParam("tracking", tracking);
+	nh.getParam("tracking_full_frame_interval", tracking_full_frame_interval);
+	nh.getParam("tracking_window_margin", tracking_window_margin);
+
+	tf_buffer = std::make_shared<tf2_ros::Buffer>(ros::Duration(tf_cache_time));
+	tf_listener = std::make_shared<tf2_ros::TransformListener>(*tf_buffer);
+	odom_filter = std::make_shared<tf2_ros::MessageFilter<geometry_msgs::TransformStamped>>(*tf_buffer, "odom", tf_queue_size, nh);
+	odom_filter->registerCallback(odomProjectionCallback);
+	odom_filter->registerFailureCallback(odomProjectionFailure);
+
 	message_filters::Subscriber<Image> frame_sub(nh, "/zed_goal/left/image_rect_color", sub_rate);
 	message_filters::Subscriber<Image> depth_sub(nh, "/zed_goal/depth/depth_registered", sub_rate);
 
@@ -170,9 +312,30 @@ int main(int argc, char **argv)
 
 	// Set up publisher
 	pub = nh.advertise<goal_detection::GoalDetection>("goal_detect_msg", pub_rate);
+	debug_image_pub = nh.advertise<sensor_msgs::Image>("goal_detect_debug_image", 1);
+
+	// Only the most recent frame is worth looking at, so each
+	// stage drops anything it falls behind on. Publishing keeps
+	// everything it is given, in order
+	pipeline.addStage("convert", convertStage, DropPolicy::KeepLatest);
+	pipeline.addStage("threshold", thresholdStage, DropPolicy::KeepLatest);
+	pipeline.addStage("measure", measureStage, DropPolicy::KeepLatest);
+	pipeline.addStage("publish", publishStage, DropPolicy::Block, pipeline_queue_size);
+	if (use_pipeline && batch)
+		pipeline.start();
+	ros::Timer stats_timer;
+	if (pipeline_stats_period > 0)
+		stats_timer = nh.createTimer(ros::Duration(pipeline_stats_period), statsCallback);
 
 	ros::spin();
 
+	pipeline.stop();
+
+	ROS_INFO("goal_detect : %zu goal projections to odom, %zu dropped", projected_count.load(), dropped_count.load());
+	odom_filter.reset();
+	tf_listener.reset();
+	tf_buffer.reset();
+	search_windows.reset();
 	delete gd;
 
 	return 0;
@@ -1,9 +1,14 @@
 #include <ros/ros.h>
 #include <cube_detection/CubeDetection.h>
 #include <swerve_point_generator/FullGenCoefs.h>
+#include <swerve_point_generator/point_generator.h>
+#include <swerve_point_generator/profile_streamer.h>
 #include <talon_swerve_drive_controller/MotionProfilePoints.h>
 #include <base_trajectory/GenerateSpline.h>
+#include <base_trajectory/generate_spline.h>
+#include <talon_swerve_drive_controller/WheelPos.h>
 #include <talon_state_controller/TalonState.h>
+#include <talon_state_controller/talon_state_index.h>
 #include <robot_visualizer/ProfileFollower.h>
 #include <std_msgs/Bool.h>
 #include <std_srvs/Empty.h>
@@ -12,14 +17,17 @@
 
 ros::Subscriber cube_sub;
 ros::ServiceServer cmd_service;
-ros::ServiceClient point_gen;
+swerve_profile::point_generator generator;
+swerve_profile::stream_settings stream_settings;
+ros::Duration spline_period;
+ros::ServiceClient wheel_pos;
 ros::ServiceClient swerve_controller;
-ros::ServiceClient spline_gen;
 ros::ServiceClient VisualizeService;
 cube_detection::CubeDetection cube_location;
 cube_detection::CubeDetection qr_location;
 bool outOfPoints;
 ros::Subscriber talon_sub;
+talon_state_controller::TalonStateIndex talon_index({"bl_drive"});
 bool command;
 
 void cubeCallback(cube_detection::CubeDetection sub_location);
@@ -1,40 +1,57 @@
 #include "path_to_goal/path_to_goal.h"
 
-bool generateTrajectory(const base_trajectory::GenerateSpline &srvBaseTrajectory, swerve_point_generator::FullGenCoefs &traj)
+// Spline fitting, profiling and wheel space conversion all happen in this
+// process instead of hopping through spline_gen and point_gen. Points are
+// streamed to slot 0 of the swerve controller as they are converted, so the
+// robot starts moving before the whole profile is generated
+bool generateTrajectory(const base_trajectory::GenerateSpline::Response &spline, swerve_point_generator::FullGenCoefs::Response &traj)
 {
 	ROS_INFO_STREAM("started generateTrajectory");
-	traj.request.orient_coefs.resize(1);
-	traj.request.x_coefs.resize(1);
-	traj.request.y_coefs.resize(1);
+	swerve_point_generator::FullGenCoefs::Request req;
+	req.orient_coefs.resize(1);
+	req.x_coefs.resize(1);
+	req.y_coefs.resize(1);
 
-	for(size_t i = 0; i < srvBaseTrajectory.response.orient_coefs[0].spline.size(); i++)
+	for(size_t i = 0; i < spline.orient_coefs[0].spline.size(); i++)
 	{
-		traj.request.orient_coefs[0].spline.push_back(srvBaseTrajectory.response.orient_coefs[1].spline[i]);
-		traj.request.x_coefs[0].spline.push_back(srvBaseTrajectory.response.x_coefs[1].spline[i]);
-		traj.request.y_coefs[0].spline.push_back(srvBaseTrajectory.response.y_coefs[1].spline[i]);
+		req.orient_coefs[0].spline.push_back(spline.orient_coefs[1].spline[i]);
+		req.x_coefs[0].spline.push_back(spline.x_coefs[1].spline[i]);
+		req.y_coefs[0].spline.push_back(spline.y_coefs[1].spline[i]);
 	}
 
-	traj.request.spline_groups.push_back(1);
-	traj.request.wait_before_group.push_back(.16);
-	traj.request.t_shift.push_back(0);
-	traj.request.flip.push_back(false);
-	traj.request.end_points.push_back(1);
-	traj.request.end_points.resize(1);
-	traj.request.end_points[0] = srvBaseTrajectory.response.end_points[1];
-	traj.request.initial_v = 0;
-	traj.request.final_v = 0;
-	traj.request.x_invert.push_back(0);
-
-	if(!point_gen.call(traj))
+	req.spline_groups.push_back(1);
+	req.wait_before_group.push_back(.16);
+	req.t_shift.push_back(0);
+	req.flip.push_back(false);
+	req.end_points.push_back(spline.end_points[1]);
+	req.initial_v = 0;
+	req.final_v = 0;
+	req.x_invert.push_back(0);
+
+	talon_swerve_drive_controller::WheelPos pos_msg;
+	if (!wheel_pos.call(pos_msg) || (pos_msg.response.positions.size() < WHEELCOUNT))
+	{
+		ROS_ERROR("path_to_goal : failed to get wheel positions from swerve controller");
 		return false;
-	else
-		return true;
+	}
+	std::array<double, WHEELCOUNT> cur_pos;
+	for (size_t i = 0; i < WHEELCOUNT; i++)
+		cur_pos[i] = pos_msg.response.positions[i];
+
+	swerve_profile::profile_streamer streamer(swerve_controller, stream_settings, traj.points, generator.dt(), 0);
+	if (!generator.generate(req, cur_pos, traj, [&streamer](bool flush) { return streamer.send(flush); }))
+	{
+		streamer.abort();
+		return false;
+	}
+	return true;
 }
 
-bool runTrajectory(const swerve_point_generator::FullGenCoefs::Response &traj)
+// The profile has already been streamed to the controller and is running,
+// this just shows it
+void visualizeTrajectory(const swerve_point_generator::FullGenCoefs::Response &traj)
 {
-    ROS_INFO_STREAM("started runTrajectory");
-    //visualization stuff
+    ROS_INFO_STREAM("started visualizeTrajectory");
     robot_visualizer::ProfileFollower srv_viz_msg;
     srv_viz_msg.request.joint_trajectories.push_back(traj.joint_trajectory);
 
@@ -48,19 +65,6 @@ bool runTrajectory(const swerve_point_generator::FullGenCoefs::Response &traj)
     {
         ROS_ERROR("succeded in call to viz srv");
     }
-
-    talon_swerve_drive_controller::MotionProfilePoints swerve_control_srv;
-    swerve_control_srv.request.profiles.resize(1);
-    swerve_control_srv.request.profiles[0].points = traj.points;
-    swerve_control_srv.request.profiles[0].dt = 0.02;
-    swerve_control_srv.request.buffer = true;
-    swerve_control_srv.request.run = true;
-    swerve_control_srv.request.profiles[0].slot = 0;
-
-    if (!swerve_controller.call(swerve_control_srv))
-        return false;
-    else
-        return true;
 }
 
 class PathAction
@@ -91,7 +95,7 @@ public:
 		base_trajectory::GenerateSpline srvBaseTrajectory;
 		srvBaseTrajectory.request.points.resize(1);
 
-		swerve_point_generator::FullGenCoefs traj;
+		swerve_point_generator::FullGenCoefs::Response traj;
 
 		ros::Duration time_to_run = ros::Duration(goal->time_to_run); //TODO: make this an actual thing
 
@@ -117,21 +121,18 @@ public:
                 srvBaseTrajectory.request.points[0].time_from_start = time_to_run;
 
 		bool running = false;
-		if(!spline_gen.call(srvBaseTrajectory))
+		if(!base_trajectory::generateSpline(srvBaseTrajectory.request.points, spline_period, srvBaseTrajectory.response))
 		{
-			ROS_ERROR_STREAM("spline_gen died");
+			ROS_ERROR_STREAM("generateSpline died");
 			success = false;
 		}
-		else if (!generateTrajectory(srvBaseTrajectory, traj))
+		else if (!generateTrajectory(srvBaseTrajectory.response, traj))
 		{
 			ROS_ERROR_STREAM("generateTrajectory died");
 			success = false;
 		}
-		else if (!runTrajectory(traj.response))
-		{
-			ROS_ERROR_STREAM("runTrajectory died");
-			success = false;
-		}
+		else
+			visualizeTrajectory(traj);
 
 		ros::Rate r(10);
 		const double startTime = ros::Time::now().toSec();
@@ -166,16 +167,28 @@ int main(int argc, char** argv)
 {
 	ros::init(argc, argv, "path_server");
 	ros::NodeHandle n;
-	PathAction path("path_server", n);
+	ros::NodeHandle n_private("~");
+
+	// Same settings base_trajectory and point_gen use
+	double loop_hz;
+	n_private.param<double>("loop_hz", loop_hz, 50.);
+	spline_period = ros::Duration(1.0 / loop_hz);
+	if (!generator.init(ros::NodeHandle(n, "swerve_drive_controller"), n_private))
+	{
+		ROS_ERROR("path_to_goal : could not initialize point generator");
+		return -1;
+	}
+	stream_settings.read(n_private);
 
 	std::map<std::string, std::string> service_connection_header;
-	service_connection_header["tcp_nodelay"] = 1;
-	point_gen = n.serviceClient<swerve_point_generator::FullGenCoefs>("/point_gen/command", false, service_connection_header);
+	service_connection_header["tcp_nodelay"] = "1";
+	wheel_pos = n.serviceClient<talon_swerve_drive_controller::WheelPos>("/frcrobot/swerve_drive_controller/wheel_pos", false, service_connection_header);
 	swerve_controller = n.serviceClient<talon_swerve_drive_controller::MotionProfilePoints>("/frcrobot/swerve_drive_controller/run_profile", false, service_connection_header);
-	spline_gen = n.serviceClient<base_trajectory::GenerateSpline>("/base_trajectory/spline_gen", false, service_connection_header);
 	VisualizeService = n.serviceClient<robot_visualizer::ProfileFollower>("/frcrobot/visualize_auto", false, service_connection_header);
 	talon_sub = n.subscribe("/frcrobot/talon_states", 10, talonStateCallback);
 
+	PathAction path("path_server", n);
+
 	ros::spin();
 
 	return 0;
@@ -183,21 +196,10 @@ int main(int argc, char** argv)
 
 void talonStateCallback(const talon_state_controller::TalonState &talon_state)
 {
-	static size_t bl_drive_idx = std::numeric_limits<size_t>::max();
-
-	if (bl_drive_idx >= talon_state.name.size())
+	if (talon_index.update(talon_state))
 	{
-		for (size_t i = 0; i < talon_state.name.size(); i++)
-		{
-			if(talon_state.name[i] == "bl_drive")
-			{
-				bl_drive_idx = i;
-				break;
-			}
-		}
+		const auto profile_status = talon_index.column(talon_state.custom_profile_status);
+		if (profile_status.valid(0))
+			outOfPoints = profile_status[0].outOfPoints;
 	}
-
-	if (bl_drive_idx < talon_state.custom_profile_status.size())
-		outOfPoints = talon_state.custom_profile_status[bl_drive_idx].outOfPoints;
 }
-
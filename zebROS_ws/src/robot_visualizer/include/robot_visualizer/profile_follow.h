@@ -2,10 +2,18 @@
 #include <ros/console.h>
 #include <robot_visualizer/ProfileFollower.h>
 #include <robot_visualizer/RobotVisualizeState.h>
+#include <robot_visualizer/ProfileTracking.h>
+#include <robot_visualizer/profile_tracker.h>
 #include <talon_state_controller/TalonState.h>
+#include <talon_state_controller/talon_state_index.h>
 //#include <trajectory_msgs/JointTrajh>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
 bool follow_service(robot_visualizer::ProfileFollower::Request &req, robot_visualizer::ProfileFollower::Response &res);
 
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <ros/ros.h>
+#include <trajectory_msgs/JointTrajectory.h>
+#include <robot_visualizer/ProfileTracking.h>
+
+//Compares the drive wheels against the profile the swerve controller is
+//running. Commanded wheel speed and distance travelled are worked out once
+//per point when the trajectories arrive, so each talon_states sample is a
+//direct index by time since the slot started plus a few adds - nothing is
+//stored per sample, only running sums, so memory doesn't grow with match
+//length. Wheels can flip direction rather than turn past 90 degrees, so
+//speeds and distances are compared as magnitudes
+namespace profile_tracker
+{
+
+static const size_t WHEELS = 4;
+
+//RMS and max of an error signal, O(1) per sample
+class RunningError
+{
+	public:
+		RunningError(void) { reset(); }
+		void reset(void)
+		{
+			count_ = 0;
+			sum_sq_ = 0;
+			max_abs_ = 0;
+		}
+		void add(const double error)
+		{
+			count_ += 1;
+			sum_sq_ += error * error;
+			max_abs_ = std::max(max_abs_, std::fabs(error));
+		}
+		double rms(void) const { return count_ ? sqrt(sum_sq_ / count_) : 0; }
+		double max(void) const { return max_abs_; }
+
+	private:
+		size_t count_;
+		double sum_sq_;
+		double max_abs_;
+};
+
+class ProfileTracker
+{
+	public:
+		//wheel_coords are the swerve controller's wheel_coords, in the
+		//order of its speed joint list. rotations_to_meters converts drive
+		//talon position / speed into wheel surface distance / speed
+		ProfileTracker(const std::array<Eigen::Vector2d, WHEELS> &wheel_coords,
+					   double rotations_to_meters, double dt);
+
+		//Replaces the commanded profiles, trajectories[i] runs in slot start_id + i
+		void setTrajectories(const std::vector<trajectory_msgs::JointTrajectory> &trajectories, int start_id);
+
+		//Call with every talon_states sample. running / slot are from the
+		//drive talons' custom profile status
+		void addSample(const ros::Time &stamp, bool running, int slot,
+					   const std::array<double, WHEELS> &position,
+					   const std::array<double, WHEELS> &speed);
+
+		//True once, right after a slot stops running
+		bool finished(void);
+		bool running(void) const { return running_; }
+		void fillSummary(robot_visualizer::ProfileTracking &msg) const;
+
+	private:
+		struct Commanded
+		{
+			//Per point, WHEELS values each
+			std::vector<double> speed;
+			std::vector<double> distance;
+			size_t points;
+		};
+
+		void startSlot(const ros::Time &stamp, int slot, const std::array<double, WHEELS> &position);
+
+		std::array<Eigen::Vector2d, WHEELS> wheel_coords_;
+		double rotations_to_meters_;
+		double dt_;
+
+		std::vector<Commanded> commanded_;
+		int start_id_;
+
+		bool running_;
+		bool finished_;
+		int slot_;
+		ros::Time slot_start_;
+		ros::Time last_stamp_;
+		size_t samples_;
+		std::array<double, WHEELS> last_position_;
+		std::array<double, WHEELS> distance_;
+		std::array<RunningError, WHEELS> speed_error_;
+		std::array<RunningError, WHEELS> distance_error_;
+};
+
+}
@@ -3,14 +3,22 @@
 #include <geometry_msgs/Point32.h>
 #include <geometry_msgs/PolygonStamped.h>
 #include <geometry_msgs/Polygon.h>
+#include <visualization_msgs/MarkerArray.h>
 #include <Eigen/Dense>
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <ros/ros.h>
 #include <ros/console.h>
 #include <robot_visualizer/RobotVisualizeState.h>
 
-void rotate_polygon(geometry_msgs::Polygon &poly, double angle);
-void translate_polygon(geometry_msgs::Polygon &poly, double x, double y);
+struct RobotShape
+{
+	Eigen::Matrix2Xd vertices; // robot, then arm, then intake outline
+	visualization_msgs::MarkerArray markers; // one line strip per outline
+};
+
+void build_robot_shapes(void);
 void plot_robot_cb(const robot_visualizer::RobotVisualizeState &robot_viz);
+void publish_robot_cb(const ros::TimerEvent &event);
 
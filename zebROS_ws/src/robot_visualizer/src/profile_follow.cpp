@@ -4,9 +4,9 @@ robot_visualizer::ProfileFollower::Request local_req;
 ros::ServiceServer follow_srv;
 ros::Subscriber talon_sub;
 ros::Publisher robot_state_pub;
+ros::Publisher tracking_pub;
 bool msg_recieved = false;
-
-int index_talon = -1;
+bool new_request = false;
 
 bool running;
 int slot_run;
@@ -18,42 +18,157 @@ double x_offset = 0.5955;
 double y_offset = 4.59;
 double theta_offset = M_PI/2;
 
+std::shared_ptr<profile_tracker::ProfileTracker> tracker;
+std::vector<std::string> drive_names;
+// Column 0 is the talon custom profile status is read from, 1.. the drive
+// talons in drive_names order
+std::shared_ptr<talon_state_controller::TalonStateIndex> talon_index;
+
+// Reads drive geometry from the swerve controller's config so tracking
+// errors are in m and m/s
+bool init_tracker(const ros::NodeHandle &controller_nh, double dt)
+{
+	std::vector<std::string> speed_joints;
+	if (!controller_nh.getParam("speed", speed_joints) || (speed_joints.size() != profile_tracker::WHEELS))
+	{
+		ROS_ERROR("profile_follow : could not read speed joint list, profile tracking disabled");
+		return false;
+	}
+	drive_names.clear();
+	for (const auto &joint : speed_joints)
+	{
+		std::string talon_name;
+		if (!controller_nh.getParam(joint + "/joint", talon_name))
+		{
+			ROS_ERROR_STREAM("profile_follow : could not read " << joint << "/joint, profile tracking disabled");
+			return false;
+		}
+		drive_names.push_back(talon_name);
+	}
+
+	double wheel_radius;
+	double encoder_to_rotations;
+	if (!controller_nh.getParam("wheel_radius", wheel_radius) ||
+		!controller_nh.getParam("ratio_encoder_to_rotations", encoder_to_rotations))
+	{
+		ROS_ERROR("profile_follow : could not read wheel_radius / ratio_encoder_to_rotations, profile tracking disabled");
+		return false;
+	}
+	std::array<Eigen::Vector2d, profile_tracker::WHEELS> wheel_coords;
+	for (size_t k = 0; k < profile_tracker::WHEELS; k++)
+	{
+		if (!controller_nh.getParam("wheel_coords" + std::to_string(k + 1) + "x", wheel_coords[k][0]) ||
+			!controller_nh.getParam("wheel_coords" + std::to_string(k + 1) + "y", wheel_coords[k][1]))
+		{
+			ROS_ERROR("profile_follow : could not read wheel_coords, profile tracking disabled");
+			return false;
+		}
+	}
+	tracker = std::make_shared<profile_tracker::ProfileTracker>(wheel_coords, wheel_radius * encoder_to_rotations, dt);
+	return true;
+}
+
+void publish_tracking(void)
+{
+	robot_visualizer::ProfileTracking msg;
+	tracker->fillSummary(msg);
+	msg.wheel_names = drive_names;
+	tracking_pub.publish(msg);
+}
+
 int main(int argc, char **argv) {
     ros::init(argc, argv, "profile_follow");
     ros::NodeHandle n;
 
 	follow_srv = n.advertiseService("/frcrobot/visualize_auto", &follow_service);
-	talon_sub = n.subscribe("/frcrobot/talon_states", 1, &talon_cb);
+	// Queue enough talon_states to cover a loop iteration, profile tracking
+	// wants every sample
+	talon_sub = n.subscribe("/frcrobot/talon_states", 20, &talon_cb);
 	robot_state_pub = n.advertise<robot_visualizer::RobotVisualizeState>("/frcrobot/robot_viz_state", 1);
+	tracking_pub = n.advertise<robot_visualizer::ProfileTracking>("/frcrobot/profile_tracking", 5);
+
+
+	// talon_states comes in at 100Hz, but the visualizer only needs a
+	// pose this often - and only when the profile has moved on
+	ros::NodeHandle n_private("~");
+	double publish_rate;
+	if (!n_private.getParam("publish_rate", publish_rate))
+		publish_rate = 10;
+	int last_slot = -1;
+	size_t last_index = std::numeric_limits<size_t>::max();
+
+	// Point spacing of the profiles the controller runs, same as point_gen's
+	double profile_dt;
+	if (!n_private.getParam("profile_dt", profile_dt))
+		profile_dt = .02;
+	double tracking_summary_rate;
+	if (!n_private.getParam("tracking_summary_rate", tracking_summary_rate))
+		tracking_summary_rate = 1;
+	init_tracker(ros::NodeHandle(n, "swerve_drive_controller"), profile_dt);
+
+	// Every talon in the swerve drive runs the same profile slots, so
+	// any of them will do for status
+	std::vector<std::string> talon_names;
+	std::string status_talon;
+	if (!n_private.getParam("profile_status_talon", status_talon))
+	{
+		if (drive_names.empty())
+			ROS_ERROR("profile_follow : no drive talons found and profile_status_talon not set");
+		else
+			status_talon = drive_names[0];
+	}
+	talon_names.push_back(status_talon);
+	talon_names.insert(talon_names.end(), drive_names.begin(), drive_names.end());
+	talon_index = std::make_shared<talon_state_controller::TalonStateIndex>(talon_names);
+	ros::Time last_summary = ros::Time::now();
 
-
-	ros::Rate rate(50);
+	ros::Rate rate(std::max(publish_rate, 0.1));
 	while(ros::ok())
 	{
 		rate.sleep();
 		ros::spinOnce();
+		if (tracker)
+		{
+			// Final summary when a slot finishes, periodic ones while running
+			const ros::Time now = ros::Time::now();
+			if (tracker->finished() ||
+				(tracker->running() && ((now - last_summary).toSec() >= 1.0 / std::max(tracking_summary_rate, 0.01))))
+			{
+				publish_tracking();
+				last_summary = now;
+			}
+		}
 		//ROS_ERROR("running");
 		if(!msg_recieved) {continue;}
 		//ROS_WARN("4");
 		if(!(running && slot_run >= local_req.start_id)) {continue;}
+		if((slot_run - local_req.start_id) >= static_cast<int>(local_req.joint_trajectories.size())) {continue;}
+		if(slot_run >= static_cast<int>(remaining_points.size())) {continue;}
 
 		//ROS_WARN("5");
+		const auto &points = local_req.joint_trajectories[slot_run - local_req.start_id].points;
+		if(static_cast<size_t>(remaining_points[slot_run]) >= points.size()) {continue;}
+		const size_t index = points.size() - remaining_points[slot_run] - 1;
+		if((slot_run == last_slot) && (index == last_index) && !new_request) {continue;}
+		new_request = false;
+		last_slot = slot_run;
+		last_index = index;
 
 		static int count = 0;
 		count++;
 		if(count % 50 == 0)
 		{
 			ROS_INFO_STREAM("running?: " << running << " slot: " << slot_run << " start_id: " << local_req.start_id << " traj size: " << local_req.joint_trajectories.size() );
-		    ROS_INFO_STREAM(" indexing at: " << local_req.joint_trajectories[slot_run - local_req.start_id].points.size() - remaining_points[slot_run] - 1 << " remaining points: " << remaining_points[slot_run] << " total_points: " <<  local_req.joint_trajectories[slot_run - local_req.start_id].points.size());
+		    ROS_INFO_STREAM(" indexing at: " << index << " remaining points: " << remaining_points[slot_run] << " total_points: " <<  points.size());
 		}
 
-		state_msg.x = x_offset + local_req.joint_trajectories[slot_run - local_req.start_id].points[local_req.joint_trajectories[slot_run - local_req.start_id].points.size() - remaining_points[slot_run] - 1 ].positions[1];
+		state_msg.x = x_offset + points[index].positions[1];
 
 		//ROS_WARN("1");
-		state_msg.y = y_offset - local_req.joint_trajectories[slot_run - local_req.start_id].points[local_req.joint_trajectories[slot_run - local_req.start_id].points.size() - remaining_points[slot_run] - 1  ].positions[0];
+		state_msg.y = y_offset - points[index].positions[0];
 		//ROS_WARN("2");
 
-		state_msg.theta = theta_offset + local_req.joint_trajectories[slot_run - local_req.start_id].points[local_req.joint_trajectories[slot_run - local_req.start_id].points.size() - remaining_points[slot_run] - 1 ].positions[2];
+		state_msg.theta = theta_offset + points[index].positions[2];
 		//ROS_WARN("3");
 
 		state_msg.arm_pos = 1;
@@ -69,32 +184,46 @@ bool follow_service(robot_visualizer::ProfileFollower::Request &req, robot_visua
 	msg_recieved = true;
 	ROS_ERROR_STREAM("srv_Called_real with size: "<< req.joint_trajectories.size());
 
-	local_req = req;
+	// Nothing else uses the request, take its trajectories instead of copying them
+	local_req.start_id = req.start_id;
+	local_req.joint_trajectories.swap(req.joint_trajectories);
+	new_request = true;
+	if (tracker)
+		tracker->setTrajectories(local_req.joint_trajectories, local_req.start_id);
 	return true;
 }
 
 void talon_cb(const talon_state_controller::TalonState &msg)
 {
-	if(index_talon == -1)
+	if (!talon_index)
+		return;
+	talon_index->update(msg);
+	const auto profile_status = talon_index->column(msg.custom_profile_status);
+	if (!profile_status.valid(0))
 	{
-		for(size_t i = 0; i < msg.can_id.size(); i++)
-		{
-			ROS_INFO_STREAM("id: " << msg.can_id[i]);
-			if(msg.can_id[i] == 14)
-			{
-				index_talon = i;
-				break;
-			}
-		}
-		if(index_talon == -1)
+		ROS_ERROR_STREAM_THROTTLE(5, "profile_follow : talon " << talon_index->names()[0] << " not found");
+		return;
+	}
+	running = profile_status[0].running;
+	slot_run = profile_status[0].slotRunning;
+	time_remaining = profile_status[0].remainingTime;
+	remaining_points = profile_status[0].remainingPoints;
+
+	if (!tracker)
+		return;
+	const auto position_col = talon_index->column(msg.position);
+	const auto speed_col = talon_index->column(msg.speed);
+	std::array<double, profile_tracker::WHEELS> position;
+	std::array<double, profile_tracker::WHEELS> speed;
+	for (size_t k = 0; k < profile_tracker::WHEELS; k++)
+	{
+		if (!position_col.valid(k + 1) || !speed_col.valid(k + 1))
 		{
-			ROS_ERROR("id 14 talon not found");
+			ROS_ERROR_STREAM_THROTTLE(5, "profile_follow : drive talon " << talon_index->names()[k + 1] << " not found");
 			return;
 		}
+		position[k] = position_col[k + 1];
+		speed[k] = speed_col[k + 1];
 	}
-	running = msg.custom_profile_status[index_talon].running;
-	slot_run = msg.custom_profile_status[index_talon].slotRunning;
-	time_remaining = msg.custom_profile_status[index_talon].slotRunning;
-	remaining_points = msg.custom_profile_status[index_talon].remainingPoints;
+	tracker->addSample(msg.header.stamp, running, slot_run, position, speed);
 }
-
@@ -0,0 +1,156 @@
+#include "robot_visualizer/profile_tracker.h"
+
+namespace profile_tracker
+{
+
+ProfileTracker::ProfileTracker(const std::array<Eigen::Vector2d, WHEELS> &wheel_coords,
+							   double rotations_to_meters, double dt) :
+	wheel_coords_(wheel_coords),
+	rotations_to_meters_(rotations_to_meters),
+	dt_(dt),
+	start_id_(0),
+	running_(false),
+	finished_(false),
+	slot_(-1),
+	samples_(0)
+{
+}
+
+void ProfileTracker::setTrajectories(const std::vector<trajectory_msgs::JointTrajectory> &trajectories, int start_id)
+{
+	commanded_.clear();
+	commanded_.resize(trajectories.size());
+	start_id_ = start_id;
+	for (size_t t = 0; t < trajectories.size(); t++)
+	{
+		const auto &points = trajectories[t].points;
+		Commanded &c = commanded_[t];
+		c.points = points.size();
+		c.speed.resize(points.size() * WHEELS);
+		c.distance.resize(points.size() * WHEELS);
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			double vx = 0;
+			double vy = 0;
+			double omega = 0;
+			double theta = 0;
+			if (points[i].velocities.size() >= 3)
+			{
+				vx = points[i].velocities[0];
+				vy = points[i].velocities[1];
+				omega = points[i].velocities[2];
+			}
+			if (points[i].positions.size() >= 3)
+				theta = points[i].positions[2];
+
+			//Profile velocities are field relative, wheel speeds are
+			//the robot relative velocity plus the rotation about the center
+			const Eigen::Vector2d v = Eigen::Rotation2Dd(-theta) * Eigen::Vector2d(vx, vy);
+			for (size_t k = 0; k < WHEELS; k++)
+			{
+				const Eigen::Vector2d wheel_v = v + omega * Eigen::Vector2d(-wheel_coords_[k][1], wheel_coords_[k][0]);
+				const double speed = wheel_v.norm();
+				c.speed[i * WHEELS + k] = speed;
+				c.distance[i * WHEELS + k] = (i == 0) ? 0 :
+					c.distance[(i - 1) * WHEELS + k] + (speed + c.speed[(i - 1) * WHEELS + k]) / 2. * dt_;
+			}
+		}
+	}
+	running_ = false;
+	slot_ = -1;
+}
+
+void ProfileTracker::startSlot(const ros::Time &stamp, int slot, const std::array<double, WHEELS> &position)
+{
+	running_ = true;
+	finished_ = false;
+	slot_ = slot;
+	slot_start_ = stamp;
+	last_stamp_ = stamp;
+	samples_ = 0;
+	last_position_ = position;
+	distance_.fill(0);
+	for (size_t k = 0; k < WHEELS; k++)
+	{
+		speed_error_[k].reset();
+		distance_error_[k].reset();
+	}
+}
+
+void ProfileTracker::addSample(const ros::Time &stamp, bool running, int slot,
+							   const std::array<double, WHEELS> &position,
+							   const std::array<double, WHEELS> &speed)
+{
+	const int index = slot - start_id_;
+	const bool tracked = running && (index >= 0) && (static_cast<size_t>(index) < commanded_.size());
+	if (!tracked || (running_ && (slot != slot_)))
+	{
+		if (running_)
+		{
+			running_ = false;
+			finished_ = true;
+		}
+		if (!tracked)
+			return;
+	}
+	if (!running_)
+	{
+		startSlot(stamp, slot, position);
+		return;
+	}
+
+	const Commanded &c = commanded_[index];
+	if (c.points == 0)
+		return;
+	//The controller plays one point per dt from the start of the slot
+	const double elapsed = (stamp - slot_start_).toSec();
+	const size_t point = std::min(static_cast<size_t>(std::max(elapsed / dt_, 0.)), c.points - 1);
+
+	for (size_t k = 0; k < WHEELS; k++)
+	{
+		distance_[k] += std::fabs(position[k] - last_position_[k]) * rotations_to_meters_;
+		last_position_[k] = position[k];
+		speed_error_[k].add(std::fabs(speed[k]) * rotations_to_meters_ - c.speed[point * WHEELS + k]);
+		distance_error_[k].add(distance_[k] - c.distance[point * WHEELS + k]);
+	}
+	last_stamp_ = stamp;
+	samples_ += 1;
+}
+
+bool ProfileTracker::finished(void)
+{
+	const bool ret = finished_;
+	finished_ = false;
+	return ret;
+}
+
+void ProfileTracker::fillSummary(robot_visualizer::ProfileTracking &msg) const
+{
+	msg.header.stamp = last_stamp_;
+	msg.slot = slot_;
+	msg.running = running_;
+	msg.elapsed = (last_stamp_ - slot_start_).toSec();
+	msg.samples = samples_;
+	msg.speed_rms_error.resize(WHEELS);
+	msg.speed_max_error.resize(WHEELS);
+	msg.distance_rms_error.resize(WHEELS);
+	msg.distance_max_error.resize(WHEELS);
+	msg.distance_error.resize(WHEELS);
+	for (size_t k = 0; k < WHEELS; k++)
+	{
+		msg.speed_rms_error[k] = speed_error_[k].rms();
+		msg.speed_max_error[k] = speed_error_[k].max();
+		msg.distance_rms_error[k] = distance_error_[k].rms();
+		msg.distance_max_error[k] = distance_error_[k].max();
+	}
+	const int index = slot_ - start_id_;
+	if ((index >= 0) && (static_cast<size_t>(index) < commanded_.size()) && commanded_[index].points)
+	{
+		const Commanded &c = commanded_[index];
+		const size_t point = std::min(static_cast<size_t>(std::max(msg.elapsed / dt_, 0.)), c.points - 1);
+		for (size_t k = 0; k < WHEELS; k++)
+			msg.distance_error[k] = distance_[k] - c.distance[point * WHEELS + k];
+	}
+}
+
+}
@@ -16,12 +16,25 @@ double arm_pivot_position;
 
 double cube = 13. * 2.54 / 100.;
 
-ros::Publisher robot_pub, arm_pub, intake_pub;
+ros::Publisher marker_pub;
 ros::Subscriber robot_state_sub;
+ros::Timer publish_timer;
 
 geometry_msgs::PolygonStamped robot_poly;
 std::vector<geometry_msgs::PolygonStamped> arm_polys, intake_polys;
 
+// Robot, arm and intake outlines for every arm / intake position, in robot
+// coordinates. Each one is a single 2xN block of vertices so placing the
+// robot on the field is one matrix multiply plus a translation
+std::vector<RobotShape> robot_shapes;
+
+// Latest state from the callback, rendered and published by the timer
+robot_visualizer::RobotVisualizeState latest_state;
+bool latest_state_valid = false;
+bool latest_state_new = false;
+robot_visualizer::RobotVisualizeState published_state;
+bool published_state_valid = false;
+
 
 int main(int argc, char **argv) {
     ros::init(argc, argv, "robot_visualize");
@@ -56,11 +69,13 @@ int main(int argc, char **argv) {
 	if (!n_params.getParam("arm_pivot_position", arm_pivot_position))
         ROS_ERROR("Could not read arm_pivot_position in robot_visualize");
 
-	arm_pub = n.advertise<geometry_msgs::PolygonStamped>("arm_state_viz", 10);
-	intake_pub = n.advertise<geometry_msgs::PolygonStamped>("intake_state_viz", 10);
-	robot_pub = n.advertise<geometry_msgs::PolygonStamped>("robot_state_viz", 10);
+	double publish_rate;
+	if (!n_params.getParam("publish_rate", publish_rate))
+		publish_rate = 10;
 
-	robot_state_sub = n.subscribe("/frcrobot/robot_viz_state", 1, &plot_robot_cb);
+	// Latched, since nothing is published while the robot is still. Rviz
+	// connecting after that would otherwise show nothing until it moves
+	marker_pub = n.advertise<visualization_msgs::MarkerArray>("robot_viz_markers", 1, true);
 
 
 	intake_polys.resize(2);
@@ -175,45 +190,105 @@ int main(int argc, char **argv) {
 	intake_polys[1].polygon.points[7].x = -cos(intake_angle_out)*intake_length + intake_width / 2;
 	intake_polys[1].polygon.points[7].y = sin(intake_angle_out)*intake_length + intake_position;
 
+	build_robot_shapes();
+
+	robot_state_sub = n.subscribe("/frcrobot/robot_viz_state", 1, &plot_robot_cb);
+	publish_timer = n.createTimer(ros::Duration(1.0 / std::max(publish_rate, 0.1)), &publish_robot_cb);
+
 	ros::spin();
 }
 
-void rotate_polygon(geometry_msgs::Polygon &poly, double angle)
+static void append_points(const geometry_msgs::Polygon &poly, std::vector<Eigen::Vector2d> &points)
+{
+	for (const auto &p : poly.points)
+		points.push_back(Eigen::Vector2d(p.x, p.y));
+}
+
+static visualization_msgs::Marker make_outline_marker(int id, size_t point_count)
 {
-	for(size_t  i = 0; i < poly.points.size(); i++)
+	visualization_msgs::Marker marker;
+	marker.header.frame_id = "/robot_viz";
+	marker.ns = "robot_viz";
+	marker.id = id;
+	marker.type = visualization_msgs::Marker::LINE_STRIP;
+	marker.action = visualization_msgs::Marker::ADD;
+	marker.pose.orientation.w = 1;
+	marker.scale.x = .02;
+	marker.color.r = 1;
+	marker.color.a = 1;
+	marker.points.resize(point_count);
+	return marker;
+}
+
+void build_robot_shapes(void)
+{
+	robot_shapes.clear();
+	robot_shapes.resize(arm_polys.size() * intake_polys.size());
+	for (size_t arm = 0; arm < arm_polys.size(); arm++)
 	{
-		Eigen::Rotation2Dd r(angle);
-		Eigen::Vector2d point = {poly.points[i].x, poly.points[i].y};
-		point = r.toRotationMatrix() * point;
-		poly.points[i].x = point[0];
-		poly.points[i].y = point[1];
+		for (size_t intake = 0; intake < intake_polys.size(); intake++)
+		{
+			RobotShape &shape = robot_shapes[arm * intake_polys.size() + intake];
+			const geometry_msgs::Polygon *outlines[3] = {&robot_poly.polygon, &arm_polys[arm].polygon, &intake_polys[intake].polygon};
+
+			std::vector<Eigen::Vector2d> points;
+			for (size_t i = 0; i < 3; i++)
+			{
+				append_points(*outlines[i], points);
+				shape.markers.markers.push_back(make_outline_marker(i, outlines[i]->points.size()));
+			}
+			shape.vertices.resize(2, points.size());
+			for (size_t i = 0; i < points.size(); i++)
+				shape.vertices.col(i) = points[i];
+		}
 	}
 }
 
-void translate_polygon(geometry_msgs::Polygon &poly, double x, double y)
+void plot_robot_cb(const robot_visualizer::RobotVisualizeState &robot_viz)
 {
-	for(size_t i = 0; i < poly.points.size(); i++)
+	if ((robot_viz.arm_pos < 0) || (static_cast<size_t>(robot_viz.arm_pos) >= arm_polys.size()) ||
+		(robot_viz.intake_pos < 0) || (static_cast<size_t>(robot_viz.intake_pos) >= intake_polys.size()))
 	{
-		poly.points[i].x = poly.points[i].x + x;
-		poly.points[i].y = poly.points[i].y + y;
+		ROS_ERROR_STREAM_THROTTLE(1, "robot_visualize : invalid arm_pos " << robot_viz.arm_pos << " or intake_pos " << robot_viz.intake_pos);
+		return;
 	}
+	latest_state = robot_viz;
+	latest_state_valid = true;
+	latest_state_new = true;
 }
 
-void plot_robot_cb(const robot_visualizer::RobotVisualizeState &robot_viz)
+// Only renders at publish_rate, and only if the robot has moved since the
+// last message went out
+void publish_robot_cb(const ros::TimerEvent &/*event*/)
 {
-	std::vector<geometry_msgs::PolygonStamped> pub_polys;
-	pub_polys.push_back(robot_poly);
-	pub_polys.push_back(arm_polys[robot_viz.arm_pos]);
-	pub_polys.push_back(intake_polys[robot_viz.intake_pos]);
+	if (!latest_state_valid || !latest_state_new || (marker_pub.getNumSubscribers() == 0))
+		return;
+	latest_state_new = false;
+	if (published_state_valid &&
+		(latest_state.x == published_state.x) &&
+		(latest_state.y == published_state.y) &&
+		(latest_state.theta == published_state.theta) &&
+		(latest_state.arm_pos == published_state.arm_pos) &&
+		(latest_state.intake_pos == published_state.intake_pos))
+		return;
 
-	for(size_t i = 0; i < pub_polys.size(); i++)
-	{
-		rotate_polygon(pub_polys[i].polygon, robot_viz.theta);
-		translate_polygon(pub_polys[i].polygon, robot_viz.x, robot_viz.y);
+	RobotShape &shape = robot_shapes[latest_state.arm_pos * intake_polys.size() + latest_state.intake_pos];
+	const Eigen::Matrix2d rotation = Eigen::Rotation2Dd(latest_state.theta).toRotationMatrix();
+	const Eigen::Matrix2Xd field = (rotation * shape.vertices).colwise() + Eigen::Vector2d(latest_state.x, latest_state.y);
 
-		pub_polys[i].header.stamp = ros::Time::now();
+	const ros::Time now = ros::Time::now();
+	size_t col = 0;
+	for (auto &marker : shape.markers.markers)
+	{
+		marker.header.stamp = now;
+		for (auto &p : marker.points)
+		{
+			p.x = field(0, col);
+			p.y = field(1, col);
+			col += 1;
+		}
 	}
-	robot_pub.publish(pub_polys[0]);
-	arm_pub.publish(pub_polys[1]);
-	intake_pub.publish(pub_polys[2]);
+	marker_pub.publish(shape.markers);
+	published_state = latest_state;
+	published_state_valid = true;
 }
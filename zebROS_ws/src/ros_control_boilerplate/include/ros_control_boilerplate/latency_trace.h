@@ -0,0 +1,285 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <ros/ros.h>
+
+//Input to actuator latency tracing. Each joystick sample published by the
+//hw interface is a trace, identified by its header seq and stamp (the
+//origin). The stages it passes through record a timestamp for each hop :
+//
+//  JoystickRead      hw interface read() publishes joystick_states
+//  TeleopReceive     teleop evaluateCommands gets it
+//  TeleopPublish     teleop publishes cmd_vel_stamped, carrying the header
+//  ControllerReceive swerve drive controller cmd_vel callback
+//  ControllerUpdate  first update() to use the command
+//  TalonWrite        hw interface write() after the Talon Set() calls
+//
+//Recording is a few atomics and a copy into a fixed size ring, so it is
+//safe to call from the control loop. A background thread drains the ring
+//to a CSV file, one per process. Nothing is recorded unless start() was
+//called, which the nodes do only if their latency_trace_file param is set.
+//Feed all the CSV files to latency_report to get per-hop latency stats.
+//Hops on different machines are compared using ros::Time, so the clocks
+//need to be synced (they are on the robot, through chrony)
+namespace latency_trace
+{
+
+enum Hop : uint8_t
+{
+	JoystickRead,
+	TeleopReceive,
+	TeleopPublish,
+	ControllerReceive,
+	ControllerUpdate,
+	TalonWrite,
+	HopCount
+};
+
+inline const char *hopName(const uint8_t hop)
+{
+	static const char *names[HopCount] =
+	{
+		"joystick_read",
+		"teleop_receive",
+		"teleop_publish",
+		"controller_receive",
+		"controller_update",
+		"talon_write"
+	};
+	return (hop < HopCount) ? names[hop] : "unknown";
+}
+
+struct Record
+{
+	uint32_t seq;    //trace id, the joystick header seq
+	uint8_t  hop;
+	double   origin; //joystick header stamp, seconds
+	double   stamp;  //time this hop was reached, seconds
+};
+
+//Fixed size multi-producer, single consumer ring. Writers never block - if
+//the reader falls behind by more than Size records the oldest ones are
+//overwritten and counted as dropped. Each slot carries the index it holds
+//plus one (0 while it is being written) so the reader can tell a finished
+//record from one being filled in or overwritten
+template <size_t Size>
+class Ring
+{
+	static_assert((Size & (Size - 1)) == 0, "Ring size must be a power of 2");
+
+	public:
+		Ring(void) : head_(0), tail_(0), dropped_(0)
+		{
+			for (auto &s : slots_)
+				s.index.store(0, std::memory_order_relaxed);
+		}
+
+		void push(const Record &record)
+		{
+			const uint64_t i = head_.fetch_add(1, std::memory_order_relaxed);
+			Slot &s = slots_[i & (Size - 1)];
+			s.index.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			s.record = record;
+			s.index.store(i + 1, std::memory_order_release);
+		}
+
+		//Called from a single reader thread. Passes each finished record
+		//in order to f and returns how many were passed
+		template <class F>
+		size_t drain(F f)
+		{
+			size_t count = 0;
+			const uint64_t head = head_.load(std::memory_order_acquire);
+			while (tail_ < head)
+			{
+				Slot &s = slots_[tail_ & (Size - 1)];
+				const uint64_t index = s.index.load(std::memory_order_acquire);
+				if (index < tail_ + 1)
+					break; //still being written, pick it up next time
+				if (index == tail_ + 1)
+				{
+					const Record record = s.record;
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (s.index.load(std::memory_order_relaxed) == index)
+					{
+						f(record);
+						count += 1;
+					}
+					else
+						dropped_ += 1;
+				}
+				else
+					dropped_ += 1; //overwritten by a newer record
+				tail_ += 1;
+			}
+			return count;
+		}
+
+		uint64_t dropped(void) const { return dropped_; }
+
+	private:
+		struct Slot
+		{
+			std::atomic<uint64_t> index;
+			Record record;
+		};
+		std::array<Slot, Size> slots_;
+		std::atomic<uint64_t> head_;
+		uint64_t tail_;    //reader only
+		uint64_t dropped_; //reader only
+};
+
+//One per process - the controllers are plugins loaded into the hw
+//interface process, so they share this with it
+class Tracer
+{
+	public:
+		static Tracer &instance(void)
+		{
+			static Tracer tracer;
+			return tracer;
+		}
+
+		~Tracer(void) { stop(); }
+
+		bool start(const std::string &path)
+		{
+			std::lock_guard<std::mutex> l(mutex_);
+			if (running_)
+				return true;
+			out_.open(path, std::ios::trunc);
+			if (!out_)
+			{
+				ROS_ERROR_STREAM("latency_trace : could not open " << path);
+				return false;
+			}
+			out_ << "seq,hop,origin,stamp" << std::endl;
+			out_.precision(9);
+			out_ << std::fixed;
+			running_ = true;
+			enabled_.store(true, std::memory_order_release);
+			thread_ = std::thread(&Tracer::drainThread, this);
+			ROS_INFO_STREAM("latency_trace : writing to " << path);
+			return true;
+		}
+
+		void stop(void)
+		{
+			{
+				std::lock_guard<std::mutex> l(mutex_);
+				if (!running_)
+					return;
+				running_ = false;
+				enabled_.store(false, std::memory_order_release);
+			}
+			cv_.notify_one();
+			thread_.join();
+			drainToFile();
+			out_.close();
+		}
+
+		bool enabled(void) const { return enabled_.load(std::memory_order_relaxed); }
+
+		void record(const uint32_t seq, const ros::Time &origin, const Hop hop, const ros::Time &stamp)
+		{
+			if (!enabled())
+				return;
+			Record r;
+			r.seq = seq;
+			r.hop = hop;
+			r.origin = origin.toSec();
+			r.stamp = stamp.toSec();
+			ring_.push(r);
+		}
+
+		void record(const uint32_t seq, const ros::Time &origin, const Hop hop)
+		{
+			if (enabled())
+				record(seq, origin, hop, ros::Time::now());
+		}
+
+		//Hands a trace from a controller's update() to the hw interface's
+		//write() in the same control loop iteration
+		void setPending(const uint32_t seq, const ros::Time &origin)
+		{
+			pending_origin_.store(origin.toSec(), std::memory_order_relaxed);
+			pending_seq_.store(seq, std::memory_order_relaxed);
+			pending_.store(true, std::memory_order_release);
+		}
+
+		void recordPending(const Hop hop)
+		{
+			if (!pending_.exchange(false, std::memory_order_acquire))
+				return;
+			record(pending_seq_.load(std::memory_order_relaxed),
+				   ros::Time(pending_origin_.load(std::memory_order_relaxed)), hop);
+		}
+
+	private:
+		Tracer(void) : enabled_(false), running_(false), pending_(false), pending_seq_(0), pending_origin_(0) {}
+		Tracer(const Tracer &) = delete;
+		Tracer &operator=(const Tracer &) = delete;
+
+		void drainThread(void)
+		{
+			std::unique_lock<std::mutex> l(mutex_);
+			while (running_)
+			{
+				cv_.wait_for(l, std::chrono::milliseconds(100));
+				drainToFile();
+			}
+		}
+
+		void drainToFile(void)
+		{
+			ring_.drain([this](const Record &r)
+			{
+				out_ << r.seq << "," << hopName(r.hop) << "," << r.origin << "," << r.stamp << "\n";
+			});
+			out_.flush();
+			const uint64_t dropped = ring_.dropped();
+			if (dropped != last_dropped_)
+			{
+				ROS_WARN_STREAM("latency_trace : dropped " << dropped - last_dropped_ << " records");
+				last_dropped_ = dropped;
+			}
+		}
+
+		Ring<4096> ring_;
+		std::atomic<bool> enabled_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::thread thread_;
+		bool running_;
+		std::ofstream out_;
+		uint64_t last_dropped_ = 0;
+
+		std::atomic<bool> pending_;
+		std::atomic<uint32_t> pending_seq_;
+		std::atomic<double> pending_origin_;
+};
+
+//Starts tracing to the file named by param_name, if that param is set
+inline void startFromParam(const ros::NodeHandle &nh, const std::string &param_name = "latency_trace_file")
+{
+	std::string path;
+	if (nh.getParam(param_name, path) && !path.empty())
+		Tracer::instance().start(path);
+}
+
+inline void record(const uint32_t seq, const ros::Time &origin, const Hop hop)
+{
+	Tracer::instance().record(seq, origin, hop);
+}
+
+}
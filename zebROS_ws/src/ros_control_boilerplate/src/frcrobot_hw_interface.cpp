@@ -72,6 +72,7 @@
 
 #include <tf2/LinearMath/Matrix3x3.h>
 #include "ros_control_boilerplate/frcrobot_hw_interface.h"
+#include "ros_control_boilerplate/latency_trace.h"
 
 //HAL / wpilib includes
 #include <HALInitializer.h>
@@ -1313,6 +1314,10 @@ void FRCRobotHWInterface::read(ros::Duration &/*elapsed_time*/)
 			frc::SmartDashboard::PutBoolean("death_1", auto_state_1_ != 0);
 			frc::SmartDashboard::PutBoolean("death_2", auto_state_2_ != 0);
 			frc::SmartDashboard::PutBoolean("death_3", auto_state_3_ != 0);
+			frc::SmartDashboard::PutNumber("auto_progress_0", auto_state_0_);
+			frc::SmartDashboard::PutNumber("auto_progress_1", auto_state_1_);
+			frc::SmartDashboard::PutNumber("auto_progress_2", auto_state_2_);
+			frc::SmartDashboard::PutNumber("auto_progress_3", auto_state_3_);
 
 			std::shared_ptr<nt::NetworkTable> driveTable = NetworkTable::GetTable("SmartDashboard");  //Access Smart Dashboard Variables
 			if (driveTable && realtime_pub_nt_->trylock())
@@ -1489,6 +1494,9 @@ void FRCRobotHWInterface::read(ros::Duration &/*elapsed_time*/)
 			joystick_left_last_[0] = joystick_left;
 			joystick_right_last_[0] = joystick_right;
 
+			// seq and stamp identify this sample for latency tracing
+			m.header.seq += 1;
+			latency_trace::record(m.header.seq, m.header.stamp, latency_trace::JoystickRead);
 			realtime_pub_joystick_->unlockAndPublish();
 		}
 		clock_gettime(CLOCK_MONOTONIC, &end_time);
@@ -2972,6 +2980,10 @@ void FRCRobotHWInterface::write(ros::Duration &elapsed_time)
 	iteration_count[time_idx] += 1;
 	time_idx += 1;
 #endif
+	// Talon Set() calls are all done, finish the trace (if any) handed
+	// over by the controllers' update() this iteration
+	latency_trace::Tracer::instance().recordPending(latency_trace::TalonWrite);
+
 	std::stringstream s;
 	for (int i = 0; i < time_idx; i++)
 		s << time_sum[i]/iteration_count[i] << " ";
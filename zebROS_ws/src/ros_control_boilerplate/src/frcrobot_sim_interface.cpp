@@ -38,6 +38,7 @@ For a more detailed simulation example, see sim_hw_interface.cpp
 */
 
 #include <ros_control_boilerplate/frcrobot_sim_interface.h>
+#include <ros_control_boilerplate/latency_trace.h>
 #include <ros_control_boilerplate/nextVelocity.h>
 #include <termios.h>
 
@@ -478,6 +479,8 @@ void TeleopJointsKeyboard::keyboardLoop()
 		if (dirty)
 		{
 			cmd_.header.stamp = ros::Time::now();
+			cmd_.header.seq += 1;
+			latency_trace::record(cmd_.header.seq, cmd_.header.stamp, latency_trace::JoystickRead);
 			joints_pub_.publish(cmd_);
 			cmd_last_ = cmd_;
 		}
@@ -1182,6 +1185,8 @@ void FRCRobotSimInterface::write(ros::Duration &elapsed_time)
 		}
 	}
 	//ROS_INFO_STREAM_THROTTLE(1, s.str());
+
+	latency_trace::Tracer::instance().recordPending(latency_trace::TalonWrite);
 }
 
 }  // namespace
@@ -38,6 +38,7 @@
 */
 
 #include <ros_control_boilerplate/generic_hw_control_loop.h>
+#include <ros_control_boilerplate/latency_trace.h>
 
 // ROS parameter loading
 #include <rosparam_shortcuts/rosparam_shortcuts.h>
@@ -58,6 +59,9 @@ GenericHWControlLoop::GenericHWControlLoop(
 	error += !rosparam_shortcuts::get(name_, rpsnh, "cycle_time_error_threshold", cycle_time_error_threshold_);
 	rosparam_shortcuts::shutdownIfError(name_, error);
 
+	// Optional, records input to actuator latency - see latency_trace.h
+	latency_trace::startFromParam(rpsnh);
+
 	// Get current time for use with first update
 	clock_gettime(CLOCK_MONOTONIC, &last_time_);
 
@@ -0,0 +1,148 @@
+// Reads the CSV files written by latency_trace.h (one per process) and prints
+// the latency distribution of each hop, both from the joystick sample and from
+// the previous hop the trace reached.
+//   latency_report frcrobot_hw.csv teleop.csv
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ros_control_boilerplate/latency_trace.h>
+
+namespace
+{
+
+struct Trace
+{
+	double origin;
+	double stamps[latency_trace::HopCount];
+	bool   seen[latency_trace::HopCount];
+};
+
+int hopIndex(const std::string &name)
+{
+	for (uint8_t h = 0; h < latency_trace::HopCount; h++)
+		if (name == latency_trace::hopName(h))
+			return h;
+	return -1;
+}
+
+bool readFile(const std::string &path, std::map<std::pair<uint32_t, double>, Trace> &traces)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		std::cerr << "Could not open " << path << std::endl;
+		return false;
+	}
+	std::string line;
+	std::getline(in, line); // header
+	size_t line_number = 1;
+	while (std::getline(in, line))
+	{
+		line_number += 1;
+		std::stringstream ss(line);
+		std::string seq_str;
+		std::string hop_str;
+		std::string origin_str;
+		std::string stamp_str;
+		if (!std::getline(ss, seq_str, ',') || !std::getline(ss, hop_str, ',') ||
+			!std::getline(ss, origin_str, ',') || !std::getline(ss, stamp_str))
+		{
+			std::cerr << path << ":" << line_number << " : malformed line" << std::endl;
+			continue;
+		}
+		const int hop = hopIndex(hop_str);
+		if (hop < 0)
+		{
+			std::cerr << path << ":" << line_number << " : unknown hop " << hop_str << std::endl;
+			continue;
+		}
+		const double origin = std::stod(origin_str);
+		auto it = traces.find(std::make_pair(static_cast<uint32_t>(std::stoul(seq_str)), origin));
+		if (it == traces.end())
+		{
+			Trace t;
+			t.origin = origin;
+			std::fill(std::begin(t.seen), std::end(t.seen), false);
+			it = traces.emplace(std::make_pair(static_cast<uint32_t>(std::stoul(seq_str)), origin), t).first;
+		}
+		// A joystick sample can reach a hop more than once (e.g. teleop
+		// republishing the same command), only the first time counts
+		if (!it->second.seen[hop])
+		{
+			it->second.stamps[hop] = std::stod(stamp_str);
+			it->second.seen[hop] = true;
+		}
+	}
+	return true;
+}
+
+void printStats(const char *name, std::vector<double> &v)
+{
+	if (v.empty())
+	{
+		printf("%-20s %8d\n", name, 0);
+		return;
+	}
+	std::sort(v.begin(), v.end());
+	double sum = 0;
+	for (const auto d : v)
+		sum += d;
+	auto percentile = [&v](double p) { return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))]; };
+	printf("%-20s %8zu %9.2f %9.2f %9.2f %9.2f %9.2f\n", name, v.size(), sum / v.size() * 1000.,
+		   percentile(.5) * 1000., percentile(.9) * 1000., percentile(.99) * 1000., v.back() * 1000.);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage : " << argv[0] << " <latency trace csv> [more csv files...]" << std::endl;
+		return 1;
+	}
+
+	std::map<std::pair<uint32_t, double>, Trace> traces;
+	for (int i = 1; i < argc; i++)
+		if (!readFile(argv[i], traces))
+			return 1;
+
+	std::vector<double> from_origin[latency_trace::HopCount];
+	std::vector<double> from_previous[latency_trace::HopCount];
+	size_t complete = 0;
+	for (const auto &t : traces)
+	{
+		int previous = -1;
+		for (uint8_t h = 0; h < latency_trace::HopCount; h++)
+		{
+			if (!t.second.seen[h])
+				continue;
+			from_origin[h].push_back(t.second.stamps[h] - t.second.origin);
+			if (previous >= 0)
+				from_previous[h].push_back(t.second.stamps[h] - t.second.stamps[previous]);
+			previous = h;
+		}
+		if (t.second.seen[latency_trace::TalonWrite])
+			complete += 1;
+	}
+
+	printf("%zu traces, %zu reached the talons\n", traces.size(), complete);
+	const char *columns = "%-20s %8s %9s %9s %9s %9s %9s\n";
+	printf("\nFrom joystick sample (ms)\n");
+	printf(columns, "hop", "count", "mean", "p50", "p90", "p99", "max");
+	for (uint8_t h = 0; h < latency_trace::HopCount; h++)
+		printStats(latency_trace::hopName(h), from_origin[h]);
+	printf("\nFrom previous hop (ms)\n");
+	printf(columns, "hop", "count", "mean", "p50", "p90", "p99", "max");
+	for (uint8_t h = 1; h < latency_trace::HopCount; h++)
+		printStats(latency_trace::hopName(h), from_previous[h]);
+	return 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <swerve_math/Swerve.h>
+#include <swerve_point_generator/FullGenCoefs.h>
+#include <swerve_point_generator/profile_cache.h>
+#include <swerve_point_generator/profiler.h>
+
+namespace swerve_profile
+{
+
+//Turns spline groups (a FullGenCoefs request) into wheel space points the
+//swerve drive controller can run. This is everything point_gen does apart
+//from talking to the controller, so nodes which plan their own paths can
+//link it and skip the service round trip.
+//Safe to call generate from multiple threads at once after init
+class point_generator
+{
+	public:
+		//Called as converted points are added to res.points while
+		//generating, and once more at the end with flush set.
+		//Returning false aborts generation
+		typedef std::function<bool(bool flush)> point_sink;
+
+		point_generator(void);
+
+		//Reads drive base geometry and feed forward gains from the swerve
+		//drive controller's params (controller_nh), and generator settings -
+		//gen_threads, profiler, stream_chunk_points, profile_cache_file,
+		//profile_cache_max_entries - from settings_nh
+		bool init(const ros::NodeHandle &controller_nh, const ros::NodeHandle &settings_nh);
+
+		//cur_pos is the current steering position of each wheel, from the
+		//controller's wheel_pos service. If sink is set the first group is
+		//converted chunk by chunk as it is generated so the caller can start
+		//sending points to the controller before the rest are done
+		bool generate(const swerve_point_generator::FullGenCoefs::Request &req,
+					  const std::array<double, WHEELCOUNT> &cur_pos,
+					  swerve_point_generator::FullGenCoefs::Response &res,
+					  const point_sink &sink = point_sink());
+
+		double dt(void) const { return dt_; }
+
+	private:
+		//Inputs needed to generate the raw profile of one spline group
+		struct group_splines
+		{
+			std::vector<spline_coefs> x_splines;
+			std::vector<spline_coefs> y_splines;
+			std::vector<spline_coefs> orient_splines;
+			std::vector<double> end_points;
+			double t_shift;
+			bool flip_dirc;
+		};
+		class wheel_space_converter;
+
+		bool build_groups(const swerve_point_generator::FullGenCoefs::Request &req, std::vector<group_splines> &groups) const;
+		profile_key make_profile_key(const group_splines &group, const double initial_v, const double final_v) const;
+		void generate_groups(const std::vector<group_splines> &groups, const size_t first_group,
+							 const double initial_v, const double final_v,
+							 std::vector<swerve_point_generator::GenerateSwerveProfile::Response> &profiles);
+		bool stream_groups(const swerve_point_generator::FullGenCoefs::Request &req, const std::vector<group_splines> &groups,
+						   wheel_space_converter &converter, const point_sink &sink,
+						   std::vector<swerve_point_generator::GenerateSwerveProfile::Response> &profiles);
+
+		std::shared_ptr<swerve> swerve_math_;
+		std::shared_ptr<swerve_profiler> profile_gen_;
+		double dt_;
+
+		//Feed forward gains
+		double f_v_;
+		double f_s_;
+		double f_a_;
+		double f_s_s_;
+		double f_s_v_;
+
+		int gen_threads_;
+		std::string profiler_type_;
+		int stream_chunk_points_; //Forward pass points per chunk handed to sink
+
+		profile_cache cache_;
+		//Profiler constraints and wheel geometry, these are part of every cache key
+		std::vector<double> robot_key_vals_;
+};
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <swerve_point_generator/GenerateSwerveProfile.h> //ROS Service data type
+#include <swerve_point_generator/profiler.h>
+
+namespace swerve_profile
+{
+
+//Builds up the key a profile is stored under. Everything which changes
+//the generated profile has to be added - splines, end points, constraints
+//and robot geometry
+class profile_key
+{
+	public:
+		profile_key(void);
+
+		void add(const double val);
+		void add(const std::vector<double> &vals);
+		void add(const std::vector<spline_coefs> &splines);
+
+		uint64_t hash(void) const
+		{
+			return hash_;
+		}
+
+		//Raw bytes of every value added, compared on a cache hit so
+		//a hash collision can't return the wrong profile
+		const std::vector<uint8_t> &bytes(void) const
+		{
+			return bytes_;
+		}
+
+	private:
+		//64 bit FNV-1a over the raw bytes of each value added
+		uint64_t hash_;
+		std::vector<uint8_t> bytes_;
+};
+
+//Content-addressed cache of generated profiles. Lives in memory and is
+//mirrored to a binary file on disk so that profiles survive restarts.
+//New entries are appended to the file as they are added.
+//Holds at most max_entries profiles, dropping the least recently used.
+//The file is compacted down to the entries in memory when it is loaded
+//and whenever appends have grown it well past that.
+//Safe to call from multiple threads at once
+class profile_cache
+{
+	public:
+		explicit profile_cache(size_t max_entries = 1000);
+
+		void set_max_entries(size_t max_entries);
+
+		//Reads in any previously saved profiles. File is created if it
+		//doesn't exist, and thrown away if it was written by an
+		//incompatible version. A corrupt or cut off entry and anything
+		//after it is dropped
+		bool load(const std::string &file_name);
+
+		bool get(const profile_key &key, swerve_point_generator::GenerateSwerveProfile::Response &profile);
+		void put(const profile_key &key, const swerve_point_generator::GenerateSwerveProfile::Response &profile);
+
+		size_t size(void);
+
+	private:
+		//Bump this whenever the profiler changes what it generates
+		//for a given input, otherwise stale profiles will be used
+		static const uint32_t file_version_ = 3;
+
+		struct entry
+		{
+			uint64_t hash;
+			std::vector<uint8_t> key;
+			swerve_point_generator::GenerateSwerveProfile::Response profile;
+		};
+		typedef std::list<entry> entry_list;
+
+		//Adds or replaces an entry as the most recently used
+		void insert(entry &&e);
+		void evict(void);
+		bool append_to_file(const entry &e, const std::vector<uint8_t> &buffer);
+		//Writes every entry in memory to a new file, oldest first, then
+		//renames it over the old one so a crash can't leave it half written
+		bool rewrite_file(void);
+
+		std::mutex mutex_;
+		std::string file_name_;
+		size_t max_entries_;
+		size_t file_entries_; //Entries in the file, including ones evicted since
+		entry_list entries_; //Most recently used at the front
+		std::unordered_map<uint64_t, entry_list::iterator> index_;
+};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <ros/ros.h>
+#include <talon_swerve_drive_controller/SwervePoint.h>
+
+namespace swerve_profile
+{
+
+//How converted points are batched up when streaming them to the controller
+struct stream_settings
+{
+	int chunk_points = 10;     //Converted points per send
+	double lookahead = .3;     //Seconds buffered in the controller before it starts running
+	double min_period = .02;   //Minimum time between sends, keeps the controller's command queue from overflowing
+
+	//stream_chunk_points, stream_lookahead, stream_min_period
+	void read(const ros::NodeHandle &nh);
+};
+
+//Sends wheel space points to a profile slot in the swerve controller as
+//they are converted. The first send replaces whatever was in the slot,
+//later sends append to it. The slot is run with the first send, but the
+//controller holds off until lookahead seconds are buffered.
+//Use send as point_generator::generate's point_sink, e.g.
+//  [&streamer](bool flush) { return streamer.send(flush); }
+class profile_streamer
+{
+	public:
+		//points is the generate response's points, filled in as they
+		//are converted. swerve_control is the controller's run_profile
+		profile_streamer(ros::ServiceClient &swerve_control,
+						 const stream_settings &settings,
+						 const std::vector<talon_swerve_drive_controller::SwervePoint> &points,
+						 double dt, uint8_t slot);
+
+		//Sends new points once enough have built up, or everything left if flush
+		bool send(bool flush);
+
+		//Stops the robot if the rest of the profile can't be generated
+		void abort(void);
+
+	private:
+		ros::ServiceClient &swerve_control_;
+		const stream_settings &settings_;
+		const std::vector<talon_swerve_drive_controller::SwervePoint> &points_;
+		double dt_;
+		size_t sent_; //Points already sent to the controller
+		uint8_t slot_;
+		ros::Time last_send_;
+};
+
+}
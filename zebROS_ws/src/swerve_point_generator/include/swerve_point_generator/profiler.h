@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include <Eigen/Dense>
@@ -82,6 +84,33 @@ auto operator<<(std::ostream &os, const T &t) -> decltype(t.print(os), os)
 	return os;
 }
 
+//Splines, their derivatives and arc length info for the whole path
+struct path_geometry
+{
+	std::vector<spline_coefs> x_splines;
+	std::vector<spline_coefs> y_splines;
+	std::vector<spline_coefs> orient_splines;
+	std::vector<spline_coefs> x_splines_first_deriv;
+	std::vector<spline_coefs> y_splines_first_deriv;
+	std::vector<spline_coefs> orient_splines_first_deriv;
+	std::vector<spline_coefs> x_splines_second_deriv;
+	std::vector<spline_coefs> y_splines_second_deriv;
+	std::vector<spline_coefs> orient_splines_second_deriv;
+	std::vector<double> end_points;
+	std::vector<double> dtds_by_spline;
+	std::vector<double> arc_length_by_spline;
+	double total_arc;
+	std::function<double(double)> t_of_s; //Spline parameter t at a given arc length
+	path_geometry(void):
+		total_arc(0)
+	{
+	}
+};
+
+//Receives each chunk of points as the forward pass produces them.
+//Returning false aborts generation
+typedef std::function<bool(const swerve_point_generator::GenerateSwerveProfile::Response &chunk)> chunk_callback;
+
 class swerve_profiler
 {
 	public:
@@ -89,6 +118,13 @@ class swerve_profiler
 		swerve_profiler(double max_wheel_dist, double max_wheel_mid_accel, double max_wheel_vel,
 						double max_steering_accel, double max_steering_vel, double dt, double ang_accel_conv,
 						double max_wheel_brake_accel);
+		virtual ~swerve_profiler(void) {}
+
+		//Copy of this profiler, including which velocity solver it uses
+		virtual std::shared_ptr<swerve_profiler> clone(void) const
+		{
+			return std::make_shared<swerve_profiler>(*this);
+		}
 
 		//Generates full profile. Has some spline manipulation options
 		bool generate_profile(std::vector<spline_coefs> x_splines,
@@ -98,21 +134,35 @@ class swerve_profiler
 							  const std::vector<double> &end_points, double t_shift, bool flip_dirc);
 		//swerve_point_generator::GenerateSwerveProfile::Response is part of ROS custom service data type
 
-	private:
+		//Hands forward pass output to callback every chunk_points points
+		//while generate_profile runs, so the start of a profile can be used
+		//before the end is generated. The full profile is still returned
+		//in out_msg. An empty callback turns this off
+		void set_chunk_callback(const size_t chunk_points, const chunk_callback &callback);
+
+	protected:
+		//Runs the velocity solver over the parametrized path and appends the
+		//resulting points to out_msg. Overridden by alternate profilers
+		virtual bool run_passes(const path_geometry &path, const double initial_v, const double final_v,
+								swerve_point_generator::GenerateSwerveProfile::Response &out_msg);
+
 		//Gets all the information for the path_point struct
-		void comp_point_characteristics(const std::vector<spline_coefs> &x_splines,
-										const std::vector<spline_coefs> &y_splines,
-										const std::vector<spline_coefs> &x_splines_first_deriv,
-										const std::vector<spline_coefs> &y_splines_first_deriv,
-										const std::vector<spline_coefs> &x_splines_second_deriv,
-										const std::vector<spline_coefs> &y_splines_second_deriv,
-										const std::vector<spline_coefs> &orient_splines,
-										const std::vector<spline_coefs> &orient_splines_first_deriv,
-										const std::vector<spline_coefs> &orient_splines_second_deriv, path_point &holder_point,
-										const std::vector<double> &end_points, const std::vector<double> &dtds_by_spline,
-										const std::vector<double> &arc_length_by_spline, const double t,
-										const double arc_length);
-		//TODO: consider putting some of these things together in structs
+		void comp_point_characteristics(const path_geometry &path, path_point &holder_point,
+										const double t, const double arc_length);
+
+		//Saves a point's position and velocity values to a flat array
+		void save_point(const path_point &point, const double v, std::vector<double> &values) const;
+
+		//Copies points saved by save_point into out_msg, returns how many
+		int write_points(const std::vector<double> &values,
+						 swerve_point_generator::GenerateSwerveProfile::Response &out_msg) const;
+		//Same, for only points [begin, end)
+		int write_points(const std::vector<double> &values, const size_t begin, const size_t end,
+						 swerve_point_generator::GenerateSwerveProfile::Response &out_msg) const;
+
+		//Passes points saved since the last chunk to the chunk callback once
+		//there are enough of them, or whatever is left if flush is set
+		bool emit_chunk(const std::vector<double> &values, const bool flush);
 
 		//Creates cubic spline interpolation
 		tk::spline parametrize_spline(const std::vector<spline_coefs> &x_spline,
@@ -121,7 +171,7 @@ class swerve_profiler
 									  std::vector<double> &arc_length_by_spline);
 
 		//Calculates a point on some spline
-		void calc_point(const spline_coefs &spline, const double t, double &returner);
+		void calc_point(const spline_coefs &spline, const double t, double &returner) const;
 
 		//Applies constraints to solve for next velocity
 		bool solve_for_next_V(const path_point &path, const double path_length, double &current_v,
@@ -144,5 +194,11 @@ class swerve_profiler
 		double t_total_; //Total time
 		double ang_accel_conv_; //c_a
 		double max_wheel_brake_accel_; //a_max for slowing down
+
+		chunk_callback chunk_callback_;
+		size_t chunk_points_; //Points per chunk handed to chunk_callback_
+		size_t chunk_start_; //First point not yet handed to chunk_callback_
+
+		static const size_t values_per_point_ = 6; //Entries per point used by save_point
 };
 }
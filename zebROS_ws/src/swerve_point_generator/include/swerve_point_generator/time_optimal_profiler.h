@@ -0,0 +1,44 @@
+#pragma once
+
+#include <swerve_point_generator/profiler.h>
+
+namespace swerve_profile
+{
+
+//Alternate velocity solver using phase plane integration. The path is
+//sampled on a fixed arc length grid, the maximum velocity allowed by the
+//wheel velocity and centripetal limits is found at each sample, then
+//v^2 is integrated backwards at max braking and forwards at max
+//acceleration, each pass clamped by the previous one. Wheel acceleration
+//is limited with a friction circle, so the acceleration left over for
+//speeding up or slowing down along the path shrinks as the path curves.
+//The result is time-optimal for the given limits, up to grid resolution
+class time_optimal_profiler : public swerve_profiler
+{
+	public:
+		time_optimal_profiler(double max_wheel_dist, double max_wheel_mid_accel, double max_wheel_vel,
+							  double max_steering_accel, double max_steering_vel, double dt, double ang_accel_conv,
+							  double max_wheel_brake_accel);
+
+		std::shared_ptr<swerve_profiler> clone(void) const override
+		{
+			return std::make_shared<time_optimal_profiler>(*this);
+		}
+
+	protected:
+		bool run_passes(const path_geometry &path, const double initial_v, const double final_v,
+						swerve_point_generator::GenerateSwerveProfile::Response &out_msg) override;
+
+	private:
+		//Highest velocity at a point allowed by wheel velocity and
+		//centripetal acceleration limits
+		double max_velocity(const path_point &point) const;
+
+		//Acceleration along the path still available at velocity squared
+		//v_squared after the normal component of wheel acceleration is
+		//taken out of max_accel
+		double tangential_accel(const path_point &point, const double v_squared, const double max_accel) const;
+
+		double ds_; //Arc length grid spacing
+};
+}
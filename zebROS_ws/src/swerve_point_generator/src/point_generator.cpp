@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <thread>
+
+#include <swerve_point_generator/point_generator.h>
+#include <swerve_point_generator/time_optimal_profiler.h>
+
+namespace swerve_profile
+{
+
+point_generator::point_generator(void) :
+	dt_(.02),
+	f_v_(0),
+	f_s_(0),
+	f_a_(0),
+	f_s_s_(0),
+	f_s_v_(0),
+	gen_threads_(1),
+	stream_chunk_points_(10)
+{
+}
+
+bool point_generator::init(const ros::NodeHandle &controller_nh, const ros::NodeHandle &settings_nh)
+{
+	//double wheel_radius;
+	bool invert_wheel_angle = false;
+	swerveVar::ratios drive_ratios;
+	swerveVar::encoderUnits units;
+	swerveVar::driveModel model;
+	double max_accel = 0;
+	double max_brake_accel = 0;
+	double ang_accel_conv = 0;
+
+	if (!controller_nh.getParam("f_s", f_s_))
+		ROS_ERROR("Could not read f_s in point_generator");
+	if (!controller_nh.getParam("f_a", f_a_))
+		ROS_ERROR("Could not read f_a in point_generator");
+	if (!controller_nh.getParam("f_v", f_v_))
+		ROS_ERROR("Could not read f_v in point_generator");
+	if (!controller_nh.getParam("f_s_v", f_s_v_))
+		ROS_ERROR("Could not read f_s_v in point_generator");
+	if (!controller_nh.getParam("f_s_s", f_s_s_))
+		ROS_ERROR("Could not read f_s_s in point_generator");
+
+	if (!controller_nh.getParam("wheel_radius", model.wheelRadius))
+		ROS_ERROR("Could not read wheel_radius in point_generator");
+	if (!controller_nh.getParam("max_accel", max_accel))
+		ROS_ERROR("Could not read max_accel in point_generator");
+	if (!controller_nh.getParam("max_brake_accel", max_brake_accel))
+		ROS_ERROR("Could not read max_brake_accel in point_generator");
+	if (!controller_nh.getParam("ang_accel_conv", ang_accel_conv))
+		ROS_ERROR("Could not read ang_accel_conv in point_generator");
+	if (!controller_nh.getParam("max_speed", model.maxSpeed))
+		ROS_ERROR("Could not read max_speed in point_generator");
+	if (!controller_nh.getParam("mass", model.mass))
+		ROS_ERROR("Could not read mass in point_generator");
+	if (!controller_nh.getParam("motor_free_speed", model.motorFreeSpeed))
+		ROS_ERROR("Could not read motor_free_speed in point_generator");
+	if (!controller_nh.getParam("motor_stall_torque", model.motorStallTorque))
+		ROS_ERROR("Could not read motor_stall_torque in point_generator");
+	// TODO : why not just use the number of wheels read from yaml?
+	if (!controller_nh.getParam("motor_quantity", model.motorQuantity))
+		ROS_ERROR("Could not read motor_quantity in point_generator");
+	if (!controller_nh.getParam("invert_wheel_angle", invert_wheel_angle))
+		ROS_ERROR("Could not read invert_wheel_angle in point_generator");
+	if (!controller_nh.getParam("ratio_encoder_to_rotations", drive_ratios.encodertoRotations))
+		ROS_ERROR("Could not read ratio_encoder_to_rotations in point_generator");
+	if (!controller_nh.getParam("ratio_motor_to_rotations", drive_ratios.motortoRotations))
+		ROS_ERROR("Could not read ratio_motor_to_rotations in point_generator");
+	if (!controller_nh.getParam("ratio_motor_to_steering", drive_ratios.motortoSteering))
+		ROS_ERROR("Could not read ratio_motor_to_steering in point_generator");
+	if (!controller_nh.getParam("encoder_drive_get_V_units", units.rotationGetV))
+		ROS_ERROR("Could not read encoder_drive_get_V_units in point_generator");
+	if (!controller_nh.getParam("encoder_drive_get_P_units", units.rotationGetP))
+		ROS_ERROR("Could not read encoder_drive_get_P_units in point_generator");
+	if (!controller_nh.getParam("encoder_drive_set_V_units", units.rotationSetV))
+		ROS_ERROR("Could not read encoder_drive_set_V_units in point_generator");
+	if (!controller_nh.getParam("encoder_drive_set_P_units", units.rotationSetP))
+		ROS_ERROR("Could not read encoder_drive_set_P_units in point_generator");
+	if (!controller_nh.getParam("encoder_steering_get_units", units.steeringGet))
+		ROS_ERROR("Could not read encoder_steering_get_units in point_generator");
+	if (!controller_nh.getParam("encoder_steering_set_units", units.steeringSet))
+		ROS_ERROR("Could not read encoder_steering_set_units in point_generator");
+	std::array<Eigen::Vector2d, WHEELCOUNT> wheel_coords;
+	if (!controller_nh.getParam("wheel_coords1x", wheel_coords[0][0]))
+		ROS_ERROR("Could not read wheel_coords1x in point_generator");
+	if (!controller_nh.getParam("wheel_coords2x", wheel_coords[1][0]))
+		ROS_ERROR("Could not read wheel_coords2x in point_generator");
+	if (!controller_nh.getParam("wheel_coords3x", wheel_coords[2][0]))
+		ROS_ERROR("Could not read wheel_coords3x in point_generator");
+	if (!controller_nh.getParam("wheel_coords4x", wheel_coords[3][0]))
+		ROS_ERROR("Could not read wheel_coords4x in point_generator");
+	if (!controller_nh.getParam("wheel_coords1y", wheel_coords[0][1]))
+		ROS_ERROR("Could not read wheel_coords1y in point_generator");
+	if (!controller_nh.getParam("wheel_coords2y", wheel_coords[1][1]))
+		ROS_ERROR("Could not read wheel_coords2y in point_generator");
+	if (!controller_nh.getParam("wheel_coords3y", wheel_coords[2][1]))
+		ROS_ERROR("Could not read wheel_coords3y in point_generator");
+	if (!controller_nh.getParam("wheel_coords4y", wheel_coords[3][1]))
+		ROS_ERROR("Could not read wheel_coords4y in point_generator");
+
+	XmlRpc::XmlRpcValue wheel_list;
+	if (!controller_nh.getParam("steering", wheel_list) || (wheel_list.getType() != XmlRpc::XmlRpcValue::TypeArray))
+	{
+		ROS_ERROR("Could not read steering joint list in point_generator");
+		return false;
+	}
+	std::vector<double> offsets;
+	for (int i = 0; i < wheel_list.size(); ++i)
+	{
+		const std::string wheel_name = static_cast<std::string>(wheel_list[i]);
+		ros::NodeHandle nh(controller_nh, wheel_name);
+		double dbl_val = 0;
+		if (!nh.getParam("offset", dbl_val))
+			ROS_ERROR_STREAM("Can not read offset for " << wheel_name);
+		offsets.push_back(dbl_val);
+	}
+
+	swerve_math_ = std::make_shared<swerve>(wheel_coords, offsets, invert_wheel_angle, drive_ratios, units, model);
+
+	if (!settings_nh.getParam("gen_threads", gen_threads_))
+		gen_threads_ = std::thread::hardware_concurrency();
+	// "adams_bashforth" is the original profiler, "time_optimal" uses phase plane integration
+	if (!settings_nh.getParam("profiler", profiler_type_))
+		profiler_type_ = "adams_bashforth";
+	if (!settings_nh.getParam("stream_chunk_points", stream_chunk_points_))
+		stream_chunk_points_ = 10;
+	if (profiler_type_ == "time_optimal")
+	{
+		profile_gen_ = std::make_shared<time_optimal_profiler>(hypot(wheel_coords[0][0], wheel_coords[0][1]), max_accel, model.maxSpeed, 1, 1, dt_, ang_accel_conv, max_brake_accel);
+	}
+	else
+	{
+		if (profiler_type_ != "adams_bashforth")
+			ROS_ERROR_STREAM("Unknown profiler " << profiler_type_ << " in point_generator, using adams_bashforth");
+		profiler_type_ = "adams_bashforth";
+		profile_gen_ = std::make_shared<swerve_profiler>(hypot(wheel_coords[0][0], wheel_coords[0][1]), max_accel, model.maxSpeed, 1, 1, dt_, ang_accel_conv, max_brake_accel); //Fix last val
+	}
+
+	robot_key_vals_ = {hypot(wheel_coords[0][0], wheel_coords[0][1]), max_accel, model.maxSpeed,
+					   dt_, ang_accel_conv, max_brake_accel};
+	for (const auto &coord : wheel_coords)
+	{
+		robot_key_vals_.push_back(coord[0]);
+		robot_key_vals_.push_back(coord[1]);
+	}
+	//Each node gets its own cache file by default. The cache isn't
+	//written with any locking, so two processes can't share a file
+	std::string cache_file;
+	if (!settings_nh.getParam("profile_cache_file", cache_file))
+	{
+		std::string node_name = ros::this_node::getName();
+		node_name.erase(0, node_name.find_first_not_of('/'));
+		std::replace(node_name.begin(), node_name.end(), '/', '_');
+		const char *home = getenv("HOME");
+		cache_file = std::string(home ? home : ".") + "/.ros/" + node_name + "_profile_cache.bin";
+	}
+	int cache_max_entries;
+	if (settings_nh.getParam("profile_cache_max_entries", cache_max_entries))
+		cache_.set_max_entries(std::max(cache_max_entries, 1));
+	cache_.load(cache_file);
+	return true;
+}
+
+profile_key point_generator::make_profile_key(const group_splines &group, const double initial_v, const double final_v) const
+{
+	profile_key key;
+	key.add(robot_key_vals_);
+	key.add(profiler_type_ == "time_optimal");
+	key.add(group.x_splines);
+	key.add(group.y_splines);
+	key.add(group.orient_splines);
+	key.add(group.end_points);
+	key.add(group.t_shift);
+	key.add(group.flip_dirc);
+	key.add(initial_v);
+	key.add(final_v);
+	return key;
+}
+
+//Splits the request's splines up into groups, with end points relative
+//to the start of each group
+bool point_generator::build_groups(const swerve_point_generator::FullGenCoefs::Request &req, std::vector<group_splines> &groups) const
+{
+	const size_t group_count = req.spline_groups.size();
+	if ((req.wait_before_group.size() < group_count) || (req.t_shift.size() < group_count) ||
+		(req.flip.size() < group_count) || (req.x_invert.size() < group_count))
+	{
+		ROS_ERROR("point_generator : per group arrays are shorter than spline_groups");
+		return false;
+	}
+	groups.clear();
+	groups.resize(group_count);
+	for (size_t s = 0; s < group_count; s++)
+	{
+		int priv_num = 0;
+		if (s > 0)
+		{
+			priv_num = req.spline_groups[s - 1];
+		}
+		if ((req.spline_groups[s] < priv_num) ||
+			(static_cast<size_t>(req.spline_groups[s]) > std::min({req.orient_coefs.size(), req.x_coefs.size(), req.y_coefs.size(), req.end_points.size()})))
+		{
+			ROS_ERROR_STREAM("point_generator : spline group " << s << " refers to splines which don't exist");
+			return false;
+		}
+		std::vector<spline_coefs> &x_splines = groups[s].x_splines;
+		std::vector<spline_coefs> &y_splines = groups[s].y_splines;
+		std::vector<spline_coefs> &orient_splines = groups[s].orient_splines;
+
+		const int neg_x = req.x_invert[s] ? -1 : 1;
+		std::vector<double> &end_points_holder = groups[s].end_points;
+		double shift_by = 0;
+		if (priv_num > 0)
+		{
+			shift_by = req.end_points[priv_num - 1];
+		}
+
+		for (int i = priv_num; i < req.spline_groups[s]; i++)
+		{
+			if ((req.orient_coefs[i].spline.size() < 6) || (req.x_coefs[i].spline.size() < 6) || (req.y_coefs[i].spline.size() < 6))
+			{
+				ROS_ERROR_STREAM("point_generator : spline " << i << " needs 6 coefficients");
+				return false;
+			}
+			orient_splines.push_back(spline_coefs(
+										 req.orient_coefs[i].spline[0] * neg_x,
+										 req.orient_coefs[i].spline[1] * neg_x,
+										 req.orient_coefs[i].spline[2] * neg_x,
+										 req.orient_coefs[i].spline[3] * neg_x,
+										 req.orient_coefs[i].spline[4] * neg_x,
+										 req.orient_coefs[i].spline[5] * neg_x));
+			ROS_INFO_STREAM("orient_coefs[" << i << "].spline=" << orient_splines.back());
+
+			x_splines.push_back(spline_coefs(
+									req.x_coefs[i].spline[0] * neg_x,
+									req.x_coefs[i].spline[1] * neg_x,
+									req.x_coefs[i].spline[2] * neg_x,
+									req.x_coefs[i].spline[3] * neg_x,
+									req.x_coefs[i].spline[4] * neg_x,
+									req.x_coefs[i].spline[5] * neg_x));
+			ROS_INFO_STREAM("x_coefs[" << i << "].spline=" << x_splines.back());
+
+			y_splines.push_back(spline_coefs(
+									req.y_coefs[i].spline[0],
+									req.y_coefs[i].spline[1],
+									req.y_coefs[i].spline[2],
+									req.y_coefs[i].spline[3],
+									req.y_coefs[i].spline[4],
+									req.y_coefs[i].spline[5]));
+			ROS_INFO_STREAM("y_coefs[" << i << "].spline=" << y_splines.back());
+
+			end_points_holder.push_back(req.end_points[i] - shift_by);
+		}
+
+		groups[s].t_shift = req.t_shift[s];
+		groups[s].flip_dirc = req.flip[s];
+		ROS_INFO_STREAM("req.initial_v: " << req.initial_v << " req.final_v: " << req.final_v << " t_shift: " << groups[s].t_shift);
+	}
+	return true;
+}
+
+//Spline groups don't depend on each other until they are converted to
+//wheel space, so their profiles are generated in parallel. Each worker
+//grabs the next unclaimed group and writes into that group's slot in
+//profiles, so the output order never depends on thread timing.
+//Workers get their own copy of the profiler since generate_profile
+//stores per-call state (t_shift_, flip_dirc_, ...) in the object.
+//Groups before first_group are skipped and left empty
+void point_generator::generate_groups(const std::vector<group_splines> &groups, const size_t first_group,
+									  const double initial_v, const double final_v,
+									  std::vector<swerve_point_generator::GenerateSwerveProfile::Response> &profiles)
+{
+	profiles.clear();
+	profiles.resize(groups.size());
+	if (first_group >= groups.size())
+		return;
+
+	std::atomic<size_t> next_group(first_group);
+	auto worker = [&]()
+	{
+		std::shared_ptr<swerve_profiler> profiler = profile_gen_->clone();
+		for (size_t s = next_group++; s < groups.size(); s = next_group++)
+		{
+			const profile_key key = make_profile_key(groups[s], initial_v, final_v);
+			if (cache_.get(key, profiles[s]))
+			{
+				ROS_INFO_STREAM("Using cached profile for spline group " << s);
+				continue;
+			}
+
+			if (profiler->generate_profile(groups[s].x_splines, groups[s].y_splines, groups[s].orient_splines,
+										   initial_v, final_v, profiles[s], groups[s].end_points,
+										   groups[s].t_shift, groups[s].flip_dirc))
+			{
+				cache_.put(key, profiles[s]);
+			}
+			else
+			{
+				ROS_ERROR_STREAM("generate_profile failed for spline group " << s);
+			}
+		}
+	};
+
+	const size_t thread_count = std::min(static_cast<size_t>(std::max(gen_threads_, 1)), groups.size() - first_group);
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < thread_count; i++)
+		threads.push_back(std::thread(worker));
+	worker(); // calling thread does its share too
+	for (auto &t : threads)
+		t.join();
+}
+
+//Converts raw x/y/orientation profile points into wheel space, one
+//spline group after another. Points can be added as they are generated -
+//each point is converted once the point after it is known, since the last
+//point of a group gets no feed forward. Steering positions and drive
+//distance carry over from one group to the next
+class point_generator::wheel_space_converter
+{
+	public:
+		wheel_space_converter(const point_generator &gen,
+							  const std::array<double, WHEELCOUNT> &cur_pos,
+							  std::vector<talon_swerve_drive_controller::SwervePoint> &out_points,
+							  std::vector<trajectory_msgs::JointTrajectoryPoint> &out_trajectory) :
+			gen_(gen),
+			cur_pos_(cur_pos),
+			out_points_(out_points),
+			out_trajectory_(out_trajectory),
+			wait_points_(0),
+			group_point_count_(0),
+			waited_(false)
+		{
+		}
+
+		//Starts a new group, which holds still for wait_points before moving
+		void start_group(const int wait_points)
+		{
+			pending_.clear();
+			wait_points_ = wait_points;
+			group_point_count_ = 0;
+			waited_ = false;
+		}
+
+		bool add_points(const std::vector<trajectory_msgs::JointTrajectoryPoint> &points)
+		{
+			for (const auto &point : points)
+			{
+				if ((point.positions.size() < 3) || (point.velocities.size() < 3))
+				{
+					ROS_ERROR("Not enough positions in point");
+					return false;
+				}
+				if (group_point_count_ == 0)
+					out_trajectory_.insert(out_trajectory_.end(), wait_points_, point);
+				out_trajectory_.push_back(point);
+				group_point_count_ += 1;
+
+				pending_.push_back(point);
+				if (!waited_ && (pending_.size() >= 2))
+					add_wait_points();
+				while (waited_ && (pending_.size() >= 3))
+				{
+					convert_point(pending_[0], pending_[1], false);
+					pending_.pop_front();
+				}
+			}
+			return true;
+		}
+
+		//Converts the final point of the group
+		bool end_group(void)
+		{
+			if (!waited_ || (pending_.size() < 2))
+			{
+				ROS_ERROR("Need at least 2 points");
+				return false;
+			}
+			convert_point(pending_[0], pending_[1], true);
+			pending_.clear();
+			return true;
+		}
+
+	private:
+		//Hold points at the start of the group, wheels pointed the way
+		//the first move goes
+		void add_wait_points(void)
+		{
+			std::array<bool, WHEELCOUNT> holder;
+			const std::array<Eigen::Vector2d, WHEELCOUNT> angles_positions  = gen_.swerve_math_->motorOutputs({pending_[1].positions[0] - pending_[0].positions[0], pending_[1].positions[1] - pending_[0].positions[1]}, pending_[1].positions[2] - pending_[0].positions[2], pending_[1].positions[2], false, holder, false, cur_pos_, false);
+			for (size_t k = 0; k < WHEELCOUNT; k++)
+				cur_pos_[k] = angles_positions[k][1];
+
+			for (int i = 0; i < wait_points_; i++)
+			{
+				talon_swerve_drive_controller::SwervePoint point;
+				for (size_t k = 0; k < WHEELCOUNT; k++)
+				{
+					point.hold.push_back(true);
+					point.drive_pos.push_back(out_points_.empty() ? angles_positions[k][0] : out_points_.back().drive_pos[k]);
+					point.drive_f.push_back(0);
+					point.steer_pos.push_back(angles_positions[k][1]);
+					point.steer_f.push_back(0);
+				}
+				out_points_.push_back(point);
+			}
+
+			for (size_t k = 0; k < WHEELCOUNT; k++)
+			{
+				prev_vels_[k] = 0;
+				prev_steer_pos_[k] = angles_positions[k][1];
+			}
+			waited_ = true;
+		}
+
+		void convert_point(const trajectory_msgs::JointTrajectoryPoint &from,
+						   const trajectory_msgs::JointTrajectoryPoint &to, const bool last)
+		{
+			std::array<bool, WHEELCOUNT> holder;
+			const std::array<Eigen::Vector2d, WHEELCOUNT> angles_positions  = gen_.swerve_math_->motorOutputs({to.positions[0] - from.positions[0], to.positions[1] - from.positions[1]}, to.positions[2] - from.positions[2], to.positions[2], false, holder, false, cur_pos_, false);
+			//TODO: angles on the velocity array below are superfluous, could remove
+			const std::array<Eigen::Vector2d, WHEELCOUNT> angles_velocities  = gen_.swerve_math_->motorOutputs({to.velocities[0], to.velocities[1]}, to.velocities[2], to.positions[2], false, holder, false, cur_pos_, false);
+			for (size_t k = 0; k < WHEELCOUNT; k++)
+				cur_pos_[k] = angles_positions[k][1];
+
+			talon_swerve_drive_controller::SwervePoint point;
+			for (size_t k = 0; k < WHEELCOUNT; k++)
+			{
+				point.hold.push_back(false);
+				point.drive_pos.push_back(angles_positions[k][0] + (out_points_.empty() ? 0 : out_points_.back().drive_pos[k]));
+
+				if (last)
+				{
+					point.drive_f.push_back(0);
+					point.steer_f.push_back(0);
+				}
+				else
+				{
+					int sign_v = angles_velocities[k][0] < 0 ? -1 : angles_velocities[k][0] > 0 ? 1 : 0;
+					point.drive_f.push_back(angles_velocities[k][0] * gen_.f_v_ + sign_v * gen_.f_s_ + gen_.f_a_ /* / ( -fabs(angles_velocities[k][0]) / (model.maxSpeed * 1.2) + 1.05 ) */ * (angles_velocities[k][0] - prev_vels_[k]) / gen_.dt_);
+					prev_vels_[k] = angles_velocities[k][0];
+
+					const double steer_v = (angles_positions[k][1] - prev_steer_pos_[k]) / gen_.dt_;
+					const int sign_steer_v = steer_v < 0 ? -1 : steer_v > 0 ? 1 : 0;
+					point.steer_f.push_back(steer_v * gen_.f_s_v_ + sign_steer_v * gen_.f_s_s_);
+				}
+
+				point.steer_pos.push_back(angles_positions[k][1]);
+				prev_steer_pos_[k] = angles_positions[k][1];
+			}
+			out_points_.push_back(point);
+		}
+
+		const point_generator &gen_;
+		std::array<double, WHEELCOUNT> cur_pos_;
+		std::array<double, WHEELCOUNT> prev_vels_;
+		std::array<double, WHEELCOUNT> prev_steer_pos_;
+		std::vector<talon_swerve_drive_controller::SwervePoint> &out_points_;
+		std::vector<trajectory_msgs::JointTrajectoryPoint> &out_trajectory_;
+		std::deque<trajectory_msgs::JointTrajectoryPoint> pending_; //Raw points not converted yet
+		int wait_points_;
+		size_t group_point_count_;
+		bool waited_; //Wait points for this group have been added
+};
+
+//Streaming version of generate + convert. The first group is generated
+//here, with forward pass output converted and handed to sink chunk by
+//chunk. The remaining groups are generated in the background meanwhile,
+//then converted in order once the first is done
+bool point_generator::stream_groups(const swerve_point_generator::FullGenCoefs::Request &req, const std::vector<group_splines> &groups,
+									wheel_space_converter &converter, const point_sink &sink,
+									std::vector<swerve_point_generator::GenerateSwerveProfile::Response> &profiles)
+{
+	std::thread rest_thread(&point_generator::generate_groups, this, std::cref(groups), 1, req.initial_v, req.final_v, std::ref(profiles));
+
+	swerve_point_generator::GenerateSwerveProfile::Response first_profile;
+	converter.start_group(round(req.wait_before_group[0] / dt_));
+	bool success;
+	const profile_key key = make_profile_key(groups[0], req.initial_v, req.final_v);
+	if (cache_.get(key, first_profile))
+	{
+		ROS_INFO("Using cached profile for spline group 0");
+		success = converter.add_points(first_profile.points);
+	}
+	else
+	{
+		std::shared_ptr<swerve_profiler> profiler = profile_gen_->clone();
+		profiler->set_chunk_callback(stream_chunk_points_,
+				[&](const swerve_point_generator::GenerateSwerveProfile::Response &chunk)
+				{
+					return converter.add_points(chunk.points) && sink(false);
+				});
+		success = profiler->generate_profile(groups[0].x_splines, groups[0].y_splines, groups[0].orient_splines,
+											 req.initial_v, req.final_v, first_profile, groups[0].end_points,
+											 groups[0].t_shift, groups[0].flip_dirc);
+		if (success)
+			cache_.put(key, first_profile);
+		else
+			ROS_ERROR("generate_profile failed for spline group 0");
+	}
+	success = success && converter.end_group() && sink(false);
+
+	rest_thread.join();
+	profiles[0] = first_profile;
+	for (size_t s = 1; success && (s < groups.size()); s++)
+	{
+		converter.start_group(round(req.wait_before_group[s] / dt_));
+		success = converter.add_points(profiles[s].points) && converter.end_group() && sink(false);
+	}
+	return success && sink(true);
+}
+
+bool point_generator::generate(const swerve_point_generator::FullGenCoefs::Request &req,
+							   const std::array<double, WHEELCOUNT> &cur_pos,
+							   swerve_point_generator::FullGenCoefs::Response &res,
+							   const point_sink &sink)
+{
+	if (!swerve_math_ || !profile_gen_)
+	{
+		ROS_ERROR("point_generator::generate called before init");
+		return false;
+	}
+	const int k_p = 1;
+	std::vector<group_splines> groups;
+	if (!build_groups(req, groups))
+		return false;
+
+	res.dt = dt_;
+	res.points.clear();
+	res.joint_trajectory.points.clear();
+	wheel_space_converter converter(*this, cur_pos, res.points, res.joint_trajectory.points);
+	std::vector<swerve_point_generator::GenerateSwerveProfile::Response> group_profiles;
+	if (sink && !groups.empty())
+	{
+		if (!stream_groups(req, groups, converter, sink, group_profiles))
+			return false;
+	}
+	else
+	{
+		generate_groups(groups, 0, req.initial_v, req.final_v, group_profiles);
+
+		//Size the output to exactly the wait points plus converted points of each group
+		size_t total_point_count = 0;
+		for (size_t s = 0; s < group_profiles.size(); s++)
+		{
+			if (group_profiles[s].points.size() < 2)
+			{
+				ROS_ERROR("Need at least 2 points");
+				return false;
+			}
+			const int n = round(req.wait_before_group[s] / dt_);
+			total_point_count += n + group_profiles[s].points.size() - k_p;
+		}
+		res.points.reserve(total_point_count);
+
+		//Convert the groups in order - wheel space conversion depends on
+		//the steering positions left over from the previous group
+		for (size_t s = 0; s < group_profiles.size(); s++)
+		{
+			converter.start_group(round(req.wait_before_group[s] / dt_));
+			if (!converter.add_points(group_profiles[s].points) || !converter.end_group())
+				return false;
+		}
+	}
+	if (!group_profiles.empty())
+		res.joint_trajectory.header = group_profiles.back().header;
+	ROS_INFO_STREAM("profile time: " << res.points.size() * dt_);
+	return true;
+}
+
+}
@@ -0,0 +1,361 @@
+#include <swerve_point_generator/profile_cache.h>
+#include <ros/console.h>
+#include <ros/serialization.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace swerve_profile
+{
+namespace
+{
+const char file_magic[8] = {'P', 'G', 'C', 'A', 'C', 'H', 'E', '\0'};
+
+void serialize_profile(const swerve_point_generator::GenerateSwerveProfile::Response &profile,
+					   std::vector<uint8_t> &buffer)
+{
+	buffer.resize(ros::serialization::serializationLength(profile));
+	ros::serialization::OStream stream(buffer.data(), buffer.size());
+	ros::serialization::serialize(stream, profile);
+}
+
+//Each entry is the key hash, the length of the key and its bytes, then
+//the length of the serialized profile and the serialized profile itself
+void write_entry(std::ofstream &out, const uint64_t hash, const std::vector<uint8_t> &key,
+				 const std::vector<uint8_t> &buffer)
+{
+	const uint32_t key_length = key.size();
+	const uint32_t length = buffer.size();
+	out.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+	out.write(reinterpret_cast<const char *>(&key_length), sizeof(key_length));
+	out.write(reinterpret_cast<const char *>(key.data()), key_length);
+	out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+	out.write(reinterpret_cast<const char *>(buffer.data()), length);
+}
+
+void write_header(std::ofstream &out, const uint32_t version)
+{
+	out.write(file_magic, sizeof(file_magic));
+	out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+}
+
+//Reads a length and then that many bytes, checking the length against
+//what is left of the file first so a corrupt one can't run off the end
+bool read_block(std::ifstream &in, const uint64_t file_size, std::vector<uint8_t> &buffer)
+{
+	uint32_t length;
+	in.read(reinterpret_cast<char *>(&length), sizeof(length));
+	if (!in || (length > (file_size - static_cast<uint64_t>(in.tellg()))))
+		return false;
+	buffer.resize(length);
+	in.read(reinterpret_cast<char *>(buffer.data()), length);
+	return static_cast<bool>(in);
+}
+
+//Steps through the lengths in a serialized profile. ROS deserialization
+//resizes each array before checking the stream has that much data, so a
+//corrupt count would otherwise try to allocate gigabytes
+class length_checker
+{
+	public:
+		length_checker(const std::vector<uint8_t> &buffer)
+			: left_(buffer.size())
+			, data_(buffer.data())
+		{
+		}
+
+		bool skip(const size_t bytes)
+		{
+			if (bytes > left_)
+				return false;
+			data_ += bytes;
+			left_ -= bytes;
+			return true;
+		}
+
+		//Reads an array count, checking there is room for that many
+		//elements of at least min_size bytes each
+		bool count(const size_t min_size, uint32_t &count)
+		{
+			if (left_ < sizeof(count))
+				return false;
+			memcpy(&count, data_, sizeof(count));
+			skip(sizeof(count));
+			return count <= (left_ / min_size);
+		}
+
+		//Skips an array (or string) of fixed size elements
+		bool array(const size_t size)
+		{
+			uint32_t n;
+			return count(size, n) && skip(n * size);
+		}
+
+		bool done(void) const
+		{
+			return left_ == 0;
+		}
+
+	private:
+		size_t left_;
+		const uint8_t *data_;
+};
+
+//Matches the layout of GenerateSwerveProfile::Response, bump file_version_
+//along with this if that changes
+bool check_profile_lengths(const std::vector<uint8_t> &buffer)
+{
+	length_checker c(buffer);
+	uint32_t n;
+	// header : seq, stamp, frame_id
+	if (!c.skip(sizeof(uint32_t) + 2 * sizeof(uint32_t)) || !c.array(1))
+		return false;
+	// joint_names
+	if (!c.count(sizeof(uint32_t), n))
+		return false;
+	for (uint32_t i = 0; i < n; i++)
+		if (!c.array(1))
+			return false;
+	// points : positions, velocities, accelerations, effort, time_from_start
+	if (!c.count(4 * sizeof(uint32_t) + 2 * sizeof(int32_t), n))
+		return false;
+	for (uint32_t i = 0; i < n; i++)
+		if (!c.array(sizeof(double)) || !c.array(sizeof(double)) ||
+			!c.array(sizeof(double)) || !c.array(sizeof(double)) ||
+			!c.skip(2 * sizeof(int32_t)))
+			return false;
+	return c.done();
+}
+}
+
+const uint32_t profile_cache::file_version_;
+
+profile_key::profile_key(void)
+	: hash_(14695981039346656037ULL)
+{
+}
+
+void profile_key::add(const double val)
+{
+	// Make 0 and -0 hash the same
+	const double v = (val == 0) ? 0 : val;
+	uint8_t bytes[sizeof(v)];
+	memcpy(bytes, &v, sizeof(v));
+	for (size_t i = 0; i < sizeof(bytes); i++)
+	{
+		hash_ ^= bytes[i];
+		hash_ *= 1099511628211ULL;
+	}
+	bytes_.insert(bytes_.end(), bytes, bytes + sizeof(bytes));
+}
+
+void profile_key::add(const std::vector<double> &vals)
+{
+	add(static_cast<double>(vals.size()));
+	for (const auto v : vals)
+		add(v);
+}
+
+void profile_key::add(const std::vector<spline_coefs> &splines)
+{
+	add(static_cast<double>(splines.size()));
+	for (const auto &s : splines)
+	{
+		add(s.a);
+		add(s.b);
+		add(s.c);
+		add(s.d);
+		add(s.e);
+		add(s.f);
+	}
+}
+
+profile_cache::profile_cache(size_t max_entries)
+	: max_entries_(std::max<size_t>(max_entries, 1))
+	, file_entries_(0)
+{
+}
+
+void profile_cache::set_max_entries(size_t max_entries)
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	max_entries_ = std::max<size_t>(max_entries, 1);
+	evict();
+}
+
+bool profile_cache::load(const std::string &file_name)
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	file_name_ = file_name;
+	entries_.clear();
+	index_.clear();
+	file_entries_ = 0;
+
+	std::ifstream in(file_name_, std::ios::binary | std::ios::ate);
+	bool rewrite = !in.is_open();
+	if (in.is_open())
+	{
+		const uint64_t file_size = in.tellg();
+		in.seekg(0);
+		char magic[sizeof(file_magic)];
+		uint32_t version;
+		in.read(magic, sizeof(magic));
+		in.read(reinterpret_cast<char *>(&version), sizeof(version));
+		if (!in || memcmp(magic, file_magic, sizeof(magic)) || (version != file_version_))
+		{
+			ROS_WARN_STREAM("Discarding profile cache " << file_name_ << " : unrecognized header or old version");
+			rewrite = true;
+		}
+		else
+		{
+			std::vector<uint8_t> buffer;
+			while (in.peek() != std::ifstream::traits_type::eof())
+			{
+				entry e;
+				in.read(reinterpret_cast<char *>(&e.hash), sizeof(e.hash));
+				if (!in || !read_block(in, file_size, e.key) || !read_block(in, file_size, buffer))
+				{
+					// Most likely a write was cut off by a crash or power loss
+					ROS_WARN_STREAM("Truncated entry in profile cache " << file_name_ << ", dropping it and the rest of the file");
+					rewrite = true;
+					break;
+				}
+				if (!check_profile_lengths(buffer))
+				{
+					ROS_WARN_STREAM("Corrupt entry in profile cache " << file_name_ << " (bad array length), dropping it and the rest of the file");
+					rewrite = true;
+					break;
+				}
+				try
+				{
+					ros::serialization::IStream stream(buffer.data(), buffer.size());
+					ros::serialization::deserialize(stream, e.profile);
+				}
+				catch (const ros::Exception &ex)
+				{
+					ROS_WARN_STREAM("Corrupt entry in profile cache " << file_name_ << " (" << ex.what() << "), dropping it and the rest of the file");
+					rewrite = true;
+					break;
+				}
+				file_entries_ += 1;
+				insert(std::move(e));
+			}
+		}
+		in.close();
+	}
+
+	// Compact away entries which were replaced or evicted
+	if (file_entries_ != entries_.size())
+		rewrite = true;
+	if (rewrite && !rewrite_file())
+	{
+		ROS_ERROR_STREAM("Could not create profile cache " << file_name_);
+		return false;
+	}
+	ROS_INFO_STREAM("Loaded " << entries_.size() << " profiles from " << file_name_);
+	return true;
+}
+
+bool profile_cache::get(const profile_key &key, swerve_point_generator::GenerateSwerveProfile::Response &profile)
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	const auto it = index_.find(key.hash());
+	if ((it == index_.end()) || (it->second->key != key.bytes()))
+		return false;
+	entries_.splice(entries_.begin(), entries_, it->second);
+	profile = it->second->profile;
+	return true;
+}
+
+void profile_cache::put(const profile_key &key, const swerve_point_generator::GenerateSwerveProfile::Response &profile)
+{
+	// Serialize outside the lock, it is the expensive part
+	std::vector<uint8_t> buffer;
+	serialize_profile(profile, buffer);
+
+	entry e;
+	e.hash = key.hash();
+	e.key = key.bytes();
+	e.profile = profile;
+
+	std::lock_guard<std::mutex> l(mutex_);
+	const auto it = index_.find(e.hash);
+	if ((it != index_.end()) && (it->second->key == e.key))
+		return;
+	if (!file_name_.empty())
+	{
+		if (append_to_file(e, buffer))
+			file_entries_ += 1;
+		else
+			ROS_ERROR_STREAM("Could not save profile to " << file_name_);
+	}
+	insert(std::move(e));
+	if (!file_name_.empty() && (file_entries_ > (2 * max_entries_)) && !rewrite_file())
+		ROS_ERROR_STREAM("Could not compact profile cache " << file_name_);
+}
+
+size_t profile_cache::size(void)
+{
+	std::lock_guard<std::mutex> l(mutex_);
+	return entries_.size();
+}
+
+void profile_cache::insert(entry &&e)
+{
+	const auto it = index_.find(e.hash);
+	if (it != index_.end())
+		entries_.erase(it->second);
+	entries_.push_front(std::move(e));
+	index_[entries_.front().hash] = entries_.begin();
+	evict();
+}
+
+void profile_cache::evict(void)
+{
+	while (entries_.size() > max_entries_)
+	{
+		index_.erase(entries_.back().hash);
+		entries_.pop_back();
+	}
+}
+
+bool profile_cache::append_to_file(const entry &e, const std::vector<uint8_t> &buffer)
+{
+	std::ofstream out(file_name_, std::ios::binary | std::ios::app);
+	if (!out)
+		return false;
+	write_entry(out, e.hash, e.key, buffer);
+	return static_cast<bool>(out);
+}
+
+bool profile_cache::rewrite_file(void)
+{
+	const std::string temp_name = file_name_ + ".tmp";
+	{
+		std::ofstream out(temp_name, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return false;
+		write_header(out, file_version_);
+		std::vector<uint8_t> buffer;
+		for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+		{
+			serialize_profile(it->profile, buffer);
+			write_entry(out, it->hash, it->key, buffer);
+		}
+		out.close();
+		if (!out)
+		{
+			std::remove(temp_name.c_str());
+			return false;
+		}
+	}
+	if (std::rename(temp_name.c_str(), file_name_.c_str()))
+	{
+		std::remove(temp_name.c_str());
+		return false;
+	}
+	file_entries_ = entries_.size();
+	return true;
+}
+}
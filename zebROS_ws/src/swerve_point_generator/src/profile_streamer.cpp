@@ -0,0 +1,68 @@
+#include <talon_swerve_drive_controller/MotionProfilePoints.h>
+
+#include <swerve_point_generator/profile_streamer.h>
+
+namespace swerve_profile
+{
+
+void stream_settings::read(const ros::NodeHandle &nh)
+{
+	nh.getParam("stream_chunk_points", chunk_points);
+	nh.getParam("stream_lookahead", lookahead);
+	nh.getParam("stream_min_period", min_period);
+}
+
+profile_streamer::profile_streamer(ros::ServiceClient &swerve_control,
+								   const stream_settings &settings,
+								   const std::vector<talon_swerve_drive_controller::SwervePoint> &points,
+								   double dt, uint8_t slot) :
+	swerve_control_(swerve_control),
+	settings_(settings),
+	points_(points),
+	dt_(dt),
+	sent_(0),
+	slot_(slot)
+{
+}
+
+bool profile_streamer::send(bool flush)
+{
+	const ros::Time now = ros::Time::now();
+	if (!flush && (((points_.size() - sent_) < static_cast<size_t>(settings_.chunk_points)) ||
+				   ((sent_ != 0) && ((now - last_send_).toSec() < settings_.min_period))))
+		return true;
+
+	talon_swerve_drive_controller::MotionProfilePoints swerve_control_srv;
+	swerve_control_srv.request.profiles.resize(1);
+	swerve_control_srv.request.profiles[0].points.assign(points_.begin() + sent_, points_.end());
+	swerve_control_srv.request.profiles[0].dt = dt_;
+	swerve_control_srv.request.profiles[0].slot = slot_;
+	swerve_control_srv.request.buffer = true;
+	swerve_control_srv.request.append = sent_ != 0;
+	swerve_control_srv.request.streaming = !flush;
+	//Run again with no lookahead at the end, in case the whole
+	//profile is shorter than the lookahead
+	swerve_control_srv.request.run = (sent_ == 0) || flush;
+	swerve_control_srv.request.run_slot = slot_;
+	swerve_control_srv.request.run_lookahead = flush ? 0 : settings_.lookahead;
+	if (!swerve_control_.call(swerve_control_srv))
+	{
+		ROS_ERROR("profile_streamer : failed to send streamed points to swerve controller");
+		return false;
+	}
+	sent_ = points_.size();
+	last_send_ = now;
+	return true;
+}
+
+void profile_streamer::abort(void)
+{
+	if (sent_ == 0)
+		return;
+	talon_swerve_drive_controller::MotionProfilePoints swerve_control_srv;
+	swerve_control_srv.request.brake = true;
+	if (!swerve_control_.call(swerve_control_srv))
+		ROS_ERROR("profile_streamer : failed to stop streamed profile");
+}
+
+}
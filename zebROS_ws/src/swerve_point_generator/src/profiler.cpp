@@ -17,10 +17,18 @@ swerve_profiler::swerve_profiler(double max_wheel_dist, double max_wheel_mid_acc
 	max_steering_vel_(max_steering_vel),
 	dt_(dt),
 	ang_accel_conv_(ang_accel_conv),
-	max_wheel_brake_accel_(max_wheel_brake_accel)
+	max_wheel_brake_accel_(max_wheel_brake_accel),
+	chunk_points_(0),
+	chunk_start_(0)
 {
 }
 
+void swerve_profiler::set_chunk_callback(const size_t chunk_points, const chunk_callback &callback)
+{
+	chunk_points_ = std::max(chunk_points, static_cast<size_t>(1));
+	chunk_callback_ = callback;
+}
+
 //Generation function
 bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 									   std::vector<spline_coefs> y_splines,
@@ -76,22 +84,16 @@ bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 	}
 
 	t_total_ = end_points[end_points.size() - 1]; //assumes t starts at 0
-	tk::spline spline;
 
 	ROS_WARN("generate_profile called");
 
-	double curr_v = final_v;
-	std::vector<double> velocities;
-	velocities.reserve(155 / dt_); //For full auto :)
-	std::vector<double> positions;
-	positions.reserve(155 / dt_); //For full auto :)
-
-	std::vector<spline_coefs> x_splines_first_deriv;
-	std::vector<spline_coefs> y_splines_first_deriv;
-	std::vector<spline_coefs> orient_splines_first_deriv;
-	std::vector<spline_coefs> x_splines_second_deriv;
-	std::vector<spline_coefs> y_splines_second_deriv;
-	std::vector<spline_coefs> orient_splines_second_deriv;
+	path_geometry path;
+	std::vector<spline_coefs> &x_splines_first_deriv = path.x_splines_first_deriv;
+	std::vector<spline_coefs> &y_splines_first_deriv = path.y_splines_first_deriv;
+	std::vector<spline_coefs> &orient_splines_first_deriv = path.orient_splines_first_deriv;
+	std::vector<spline_coefs> &x_splines_second_deriv = path.x_splines_second_deriv;
+	std::vector<spline_coefs> &y_splines_second_deriv = path.y_splines_second_deriv;
+	std::vector<spline_coefs> &orient_splines_second_deriv = path.orient_splines_second_deriv;
 	//Take dervitives of splines
 	for (size_t i = 0; i < x_splines.size(); i++)
 	{
@@ -127,13 +129,31 @@ bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 		std::reverse(y_splines_second_deriv.begin(), y_splines_second_deriv.end());
 		std::reverse(orient_splines_second_deriv.begin(), orient_splines_second_deriv.end());
 	}
+	path.x_splines = x_splines;
+	path.y_splines = y_splines;
+	path.orient_splines = orient_splines;
+	path.end_points = end_points;
 	//ROS_WARN("called2");
-	std::vector<double> dtds_for_spline;
-	std::vector<double> arc_length_for_spline;
-	double total_arc;
 	//Run spline parametrizing code - also gets dtds and arc lengths
-	spline = parametrize_spline(x_splines_first_deriv, y_splines_first_deriv, end_points,
-								total_arc, dtds_for_spline, arc_length_for_spline);
+	const tk::spline spline = parametrize_spline(x_splines_first_deriv, y_splines_first_deriv, end_points,
+							  path.total_arc, path.dtds_by_spline, path.arc_length_by_spline);
+	path.t_of_s = [spline](double s) { return spline(s); };
+
+	chunk_start_ = 0;
+	return run_passes(path, initial_v, final_v, out_msg);
+}
+
+//Original back pass / forward pass velocity solver
+bool swerve_profiler::run_passes(const path_geometry &path, const double initial_v, const double final_v,
+								 swerve_point_generator::GenerateSwerveProfile::Response &out_msg)
+{
+	const double total_arc = path.total_arc;
+	double curr_v = final_v;
+	std::vector<double> velocities;
+	velocities.reserve(155 / dt_); //For full auto :)
+	std::vector<double> positions;
+	positions.reserve(155 / dt_); //For full auto :)
+
 	int point_count = 0;
 	std::vector<double> accelerations;
 	path_point holder_point;
@@ -155,15 +175,12 @@ bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 		//if (point_count % 100 == 0)
 		//ROS_INFO_STREAM("num points: " << point_count );
 
-		const double t_raw2 = spline(i); //Get t value from the cubic spline interpolation of t vs arc length
+		const double t_raw2 = path.t_of_s(i); //Get t value from the cubic spline interpolation of t vs arc length
 		ROS_INFO_STREAM("curr_v: " << curr_v /*<< " i val: " << i << " t val: " << t_raw2 << " also: " << spline(i)*/);
 		//ROS_WARN("even_now");
 
 		//Compute all the path info
-		comp_point_characteristics(x_splines, y_splines, x_splines_first_deriv, y_splines_first_deriv,
-								   x_splines_second_deriv, y_splines_second_deriv, orient_splines, orient_splines_first_deriv,
-								   orient_splines_second_deriv, holder_point, end_points, dtds_for_spline, arc_length_for_spline,
-								   t_raw2, i);
+		comp_point_characteristics(path, holder_point, t_raw2, i);
 
 		//Solve for the next V using constraints
 		if (!solve_for_next_V(holder_point, total_arc, curr_v, i, max_wheel_brake_accel_, accelerations))
@@ -177,15 +194,26 @@ bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 	velocities.erase(velocities.end() - 1); //End must be erased
 	positions.erase(positions.end() - 1);
 
-	// TODO : check this - if point_count is initialized to
-	// non-0, it could run out of space below?
-	point_count = out_msg.points.size();
-	if (out_msg.points.size() == 0)
-		out_msg.points.resize(155 / dt_); //For full auto :)  TODO: optimize
+	// Back pass samples are in order of decreasing arc length. The forward
+	// pass only ever moves further along the path, so the back pass sample
+	// bracketing the current position is tracked with a cursor which only
+	// moves towards the front of the array - O(n) total instead of a
+	// rescan for each forward step
+	if (positions.size() < 2)
+	{
+		ROS_ERROR("Back pass produced too few points, path too short?");
+		return false;
+	}
+	size_t back_cursor = positions.size() - 2;
+
+	// Forward pass results are collected in one flat array - x, y,
+	// orientation and their velocities for each point - and copied
+	// into the output message once the final point count is known.
+	// The back pass point count is a good guess at the forward count
+	std::vector<double> forward_values;
+	forward_values.reserve((positions.size() + positions.size() / 4 + 16) * values_per_point_);
+
 	curr_v = initial_v;
-	double starting_point = positions.size() - 1;
-	ros::Duration now(0);
-	ros::Duration period(dt_);
 	//Same as back pass, but now forward
 
 	for (double i = 0; i < total_arc /* - .1*/;)
@@ -197,50 +225,33 @@ bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 			continue;
 		}
 
-		const double t_raw3 = spline(i);
+		const double t_raw3 = path.t_of_s(i);
 		ROS_INFO_STREAM("i val: " << i << " t val: " << t_raw3 << " curr v: " << curr_v);
 
-		comp_point_characteristics(x_splines, y_splines, x_splines_first_deriv, y_splines_first_deriv,
-								   x_splines_second_deriv, y_splines_second_deriv, orient_splines, orient_splines_first_deriv,
-								   orient_splines_second_deriv, holder_point, end_points, dtds_for_spline, arc_length_for_spline,
-								   t_raw3, i);
+		comp_point_characteristics(path, holder_point, t_raw3, i);
 
 		//save output values
-		out_msg.points[point_count].positions.push_back(holder_point.pos_x);
-		out_msg.points[point_count].positions.push_back(holder_point.pos_y);
-		out_msg.points[point_count].positions.push_back(holder_point.orientation);
-		out_msg.points[point_count].velocities.push_back(cos(holder_point.path_angle) * curr_v );
-		out_msg.points[point_count].velocities.push_back(sin(holder_point.path_angle) * curr_v );
-		out_msg.points[point_count].velocities.push_back(
-			holder_point.angular_velocity * curr_v / max_wheel_dist_);
-		//out_msg.points[point_count].velocities.push_back(holder_point.path_angle_deriv * (current_v));
-		out_msg.points[point_count].time_from_start = now;
-		//ROS_INFO_STREAM(now);
-		now += period;
-		point_count++;
+		save_point(holder_point, curr_v, forward_values);
+		if (!emit_chunk(forward_values, false))
+		{
+			return false;
+		}
 		ROS_ERROR_STREAM("1: " << curr_v);
 		if (!solve_for_next_V(holder_point, total_arc, curr_v, i, max_wheel_mid_accel_, accelerations)) //originally not the right number of arguments
 		{
 			return false;
 		}
 		ROS_ERROR_STREAM("2: " << curr_v);
-		for (size_t k = 0; k < positions.size(); k++)
-		{
-			if (starting_point - k < 0 || positions[starting_point - k] > i)
-			{
-				starting_point -= k;
-				break;
-			}
-			//Find point
-		}
-		//Make sure starting point doesn't go less than 1
-		coerce(starting_point, 1, 1000000000000);
+		//Find the back pass points on either side of i. Don't go less
+		//than 1, near the end of the path extrapolate from points 1 and 2
+		while ((back_cursor > 1) && (positions[back_cursor] <= i))
+			back_cursor -= 1;
 		//Linear interpolation to get vel cap
 
-		const double v_sp1 = velocities[starting_point + 1];
-		const double v_s   = velocities[starting_point];
-		const double p_sp1 = positions[starting_point + 1];
-		const double p_s   = positions[starting_point];
+		const double v_sp1 = velocities[back_cursor + 1];
+		const double v_s   = velocities[back_cursor];
+		const double p_sp1 = positions[back_cursor + 1];
+		const double p_s   = positions[back_cursor];
 		const double vel_cap = i * (v_s - v_sp1) / (p_s - p_sp1) -
 							   p_s * (v_s - v_sp1) / (p_s - p_sp1) + v_s;
 		//Keep below back pass
@@ -269,14 +280,72 @@ bool swerve_profiler::generate_profile(std::vector<spline_coefs> x_splines,
 	}
 	//ROS_WARN("called3");
 	//ROS_ERROR("finished raw generation");
+	if (!emit_chunk(forward_values, true))
+	{
+		return false;
+	}
+
+	point_count = write_points(forward_values, out_msg);
 	ROS_INFO_STREAM("time: " << point_count * dt_);
 	ROS_INFO_STREAM("total_arc: " << total_arc);
-	out_msg.points.erase(out_msg.points.begin() + point_count, out_msg.points.end());
 	ROS_ERROR_STREAM("p: " << out_msg.points.size());
 	ROS_INFO_STREAM("point_count in profiler: " << point_count);
 	return true;
 }
 
+//Output values for one point - x, y, orientation and their velocities
+void swerve_profiler::save_point(const path_point &point, const double v, std::vector<double> &values) const
+{
+	values.push_back(point.pos_x);
+	values.push_back(point.pos_y);
+	values.push_back(point.orientation);
+	values.push_back(cos(point.path_angle) * v);
+	values.push_back(sin(point.path_angle) * v);
+	values.push_back(point.angular_velocity * v / max_wheel_dist_);
+}
+
+//Append points saved by save_point to anything already in out_msg,
+//sized exactly to the number of points generated
+int swerve_profiler::write_points(const std::vector<double> &values,
+								  swerve_point_generator::GenerateSwerveProfile::Response &out_msg) const
+{
+	return write_points(values, 0, values.size() / values_per_point_, out_msg);
+}
+
+int swerve_profiler::write_points(const std::vector<double> &values, const size_t begin, const size_t end,
+								  swerve_point_generator::GenerateSwerveProfile::Response &out_msg) const
+{
+	const size_t first_point = out_msg.points.size();
+	const int point_count = end - begin;
+	out_msg.points.resize(first_point + point_count);
+	ros::Duration now(begin * dt_);
+	const ros::Duration period(dt_);
+	for (int p = 0; p < point_count; p++)
+	{
+		const double *point_values = &values[(begin + p) * values_per_point_];
+		trajectory_msgs::JointTrajectoryPoint &point = out_msg.points[first_point + p];
+		point.positions.assign(point_values, point_values + 3);
+		point.velocities.assign(point_values + 3, point_values + 6);
+		point.time_from_start = now;
+		now += period;
+	}
+	return point_count;
+}
+
+bool swerve_profiler::emit_chunk(const std::vector<double> &values, const bool flush)
+{
+	if (!chunk_callback_)
+		return true;
+	const size_t point_count = values.size() / values_per_point_;
+	if ((point_count <= chunk_start_) || (!flush && (point_count - chunk_start_ < chunk_points_)))
+		return true;
+
+	swerve_point_generator::GenerateSwerveProfile::Response chunk;
+	write_points(values, chunk_start_, point_count, chunk);
+	chunk_start_ = point_count;
+	return chunk_callback_(chunk);
+}
+
 bool swerve_profiler::coerce(double &val, const double min, const double max)
 {
 	if (val > max)
@@ -567,7 +636,7 @@ bool swerve_profiler::poly_solve(const double a, const double b, const double c,
 		return true;
 	}
 }
-void swerve_profiler::calc_point(const spline_coefs &spline, double t, double &returner)
+void swerve_profiler::calc_point(const spline_coefs &spline, double t, double &returner) const
 {
 	if (flip_dirc_)t = t_total_ - t;
 	t += t_shift_;
@@ -580,15 +649,21 @@ void swerve_profiler::calc_point(const spline_coefs &spline, double t, double &r
 	//ROS_INFO_STREAM("calc_point a:" << spline << " t:" << t << " f(t):" << returner);
 }
 
-void swerve_profiler::comp_point_characteristics(const std::vector<spline_coefs> &x_splines,
-		const std::vector<spline_coefs> &y_splines, const std::vector<spline_coefs> &x_splines_first_deriv,
-		const std::vector<spline_coefs> &y_splines_first_deriv, const std::vector<spline_coefs> &x_splines_second_deriv,
-		const std::vector<spline_coefs> &y_splines_second_deriv, const std::vector<spline_coefs> &orient_splines,
-		const std::vector<spline_coefs> &orient_splines_first_deriv,
-		const std::vector<spline_coefs> &orient_splines_second_deriv, path_point &holder_point,
-		const std::vector<double> &end_points, const std::vector<double> &dtds_by_spline,
-		const std::vector<double> &arc_length_by_spline, const double t, const double arc_length)
+void swerve_profiler::comp_point_characteristics(const path_geometry &path, path_point &holder_point,
+		const double t, const double arc_length)
 {
+	const std::vector<spline_coefs> &x_splines = path.x_splines;
+	const std::vector<spline_coefs> &y_splines = path.y_splines;
+	const std::vector<spline_coefs> &orient_splines = path.orient_splines;
+	const std::vector<spline_coefs> &x_splines_first_deriv = path.x_splines_first_deriv;
+	const std::vector<spline_coefs> &y_splines_first_deriv = path.y_splines_first_deriv;
+	const std::vector<spline_coefs> &orient_splines_first_deriv = path.orient_splines_first_deriv;
+	const std::vector<spline_coefs> &x_splines_second_deriv = path.x_splines_second_deriv;
+	const std::vector<spline_coefs> &y_splines_second_deriv = path.y_splines_second_deriv;
+	const std::vector<spline_coefs> &orient_splines_second_deriv = path.orient_splines_second_deriv;
+	const std::vector<double> &end_points = path.end_points;
+	const std::vector<double> &dtds_by_spline = path.dtds_by_spline;
+	const std::vector<double> &arc_length_by_spline = path.arc_length_by_spline;
 	size_t which_spline;
 	which_spline = 0;
 	//Find the spline based on t
@@ -0,0 +1,136 @@
+//Compares the original and time optimal profilers on a few
+//representative paths : prints generation runtime and resulting path time
+//rosrun swerve_point_generator profiler_benchmark [iterations]
+//Only quote numbers from a release catkin build on the robot's hardware
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ros/console.h>
+#include <swerve_point_generator/profiler.h>
+#include <swerve_point_generator/time_optimal_profiler.h>
+
+struct test_path
+{
+	std::string name;
+	std::vector<swerve_profile::spline_coefs> x_splines;
+	std::vector<swerve_profile::spline_coefs> y_splines;
+	std::vector<swerve_profile::spline_coefs> orient_splines;
+	std::vector<double> end_points;
+};
+
+//Quintic going from 0 to dist over t in [0, 1] with zero velocity
+//and acceleration at each end
+swerve_profile::spline_coefs smooth_step(const double dist)
+{
+	return swerve_profile::spline_coefs(6 * dist, -15 * dist, 10 * dist, 0, 0, 0);
+}
+
+std::vector<test_path> make_paths(void)
+{
+	std::vector<test_path> paths;
+
+	test_path straight;
+	straight.name = "straight 5m";
+	straight.x_splines.push_back(swerve_profile::spline_coefs(0, 0, 0, 0, 5, 0));
+	straight.y_splines.push_back(swerve_profile::spline_coefs());
+	straight.orient_splines.push_back(swerve_profile::spline_coefs());
+	straight.end_points.push_back(1);
+	paths.push_back(straight);
+
+	test_path s_curve;
+	s_curve.name = "s-curve 6m x 2m";
+	s_curve.x_splines.push_back(swerve_profile::spline_coefs(0, 0, 0, 0, 6, 0));
+	s_curve.y_splines.push_back(smooth_step(2));
+	s_curve.orient_splines.push_back(swerve_profile::spline_coefs());
+	s_curve.end_points.push_back(1);
+	paths.push_back(s_curve);
+
+	test_path s_curve_turn = s_curve;
+	s_curve_turn.name = "s-curve 6m x 2m, 90 deg turn";
+	s_curve_turn.orient_splines[0] = smooth_step(M_PI / 2);
+	paths.push_back(s_curve_turn);
+
+	test_path two_part;
+	two_part.name = "two splines, 8m";
+	two_part.x_splines.push_back(swerve_profile::spline_coefs(0, 0, 0, 0, 4, 0));
+	two_part.y_splines.push_back(smooth_step(1.5));
+	two_part.orient_splines.push_back(smooth_step(M_PI / 4));
+	two_part.x_splines.push_back(swerve_profile::spline_coefs(0, 0, 0, 0, 4, 0));
+	two_part.y_splines.push_back(smooth_step(-1.5));
+	two_part.orient_splines.push_back(smooth_step(-M_PI / 4));
+	two_part.end_points.push_back(1);
+	two_part.end_points.push_back(2);
+	//Second spline runs from t = 1 to 2, shift it to start where the first ended
+	for (auto &s : {&two_part.x_splines[1], &two_part.y_splines[1], &two_part.orient_splines[1]})
+	{
+		const swerve_profile::spline_coefs c = *s;
+		//p(t - 1) expanded into powers of t
+		s->a = c.a;
+		s->b = c.b - 5 * c.a;
+		s->c = c.c - 4 * c.b + 10 * c.a;
+		s->d = c.d - 3 * c.c + 6 * c.b - 10 * c.a;
+		s->e = c.e - 2 * c.d + 3 * c.c - 4 * c.b + 5 * c.a;
+		s->f = c.f - c.e + c.d - c.c + c.b - c.a;
+	}
+	two_part.x_splines[1].f += 4;
+	two_part.y_splines[1].f += 1.5;
+	two_part.orient_splines[1].f += M_PI / 4;
+	paths.push_back(two_part);
+
+	return paths;
+}
+
+int main(int argc, char **argv)
+{
+	const int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+
+	//Profilers log every point, keep that out of the timing
+	if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Fatal))
+		ros::console::notifyLoggerLevelsChanged();
+
+	//Values from 2018_swerve_drive.yaml
+	const double max_wheel_dist = hypot(0.28575, 0.28575);
+	const double max_accel = 2.0;
+	const double max_brake_accel = 2.5;
+	const double max_speed = 3.6;
+	const double ang_accel_conv = 1.0;
+	const double dt = .02;
+
+	std::vector<std::pair<std::string, std::shared_ptr<swerve_profile::swerve_profiler>>> profilers;
+	profilers.push_back(std::make_pair("adams_bashforth", std::make_shared<swerve_profile::swerve_profiler>(
+										   max_wheel_dist, max_accel, max_speed, 1, 1, dt, ang_accel_conv, max_brake_accel)));
+	profilers.push_back(std::make_pair("time_optimal", std::make_shared<swerve_profile::time_optimal_profiler>(
+										   max_wheel_dist, max_accel, max_speed, 1, 1, dt, ang_accel_conv, max_brake_accel)));
+
+	std::cout << std::left << std::setw(32) << "path" << std::setw(18) << "profiler"
+			  << std::setw(14) << "runtime (ms)" << "path time (s)" << std::endl;
+	for (const auto &path : make_paths())
+	{
+		for (const auto &p : profilers)
+		{
+			size_t point_count = 0;
+			bool ok = true;
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; ok && (i < iterations); i++)
+			{
+				swerve_point_generator::GenerateSwerveProfile::Response out_msg;
+				ok = p.second->generate_profile(path.x_splines, path.y_splines, path.orient_splines, 0, 0,
+												out_msg, path.end_points, 0, false);
+				point_count = out_msg.points.size();
+			}
+			const auto end = std::chrono::steady_clock::now();
+			const double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+			std::cout << std::setw(32) << path.name << std::setw(18) << p.first;
+			if (ok)
+				std::cout << std::setw(14) << std::fixed << std::setprecision(3) << ms << point_count * dt << std::endl;
+			else
+				std::cout << "failed" << std::endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include <swerve_point_generator/time_optimal_profiler.h>
+#include <ros/console.h>
+
+namespace swerve_profile
+{
+time_optimal_profiler::time_optimal_profiler(double max_wheel_dist, double max_wheel_mid_accel,
+		double max_wheel_vel, double max_steering_accel,
+		double max_steering_vel, double dt,
+		double ang_accel_conv, double max_wheel_brake_accel)
+	:
+	swerve_profiler(max_wheel_dist, max_wheel_mid_accel, max_wheel_vel, max_steering_accel,
+					max_steering_vel, dt, ang_accel_conv, max_wheel_brake_accel),
+	ds_(max_wheel_vel * dt / 4.) // a few grid points per output point even at top speed
+{
+}
+
+double time_optimal_profiler::max_velocity(const path_point &point) const
+{
+	//Wheel velocity limit, same as the one in solve_for_next_V - translation
+	//plus the wheel's share of rotation, worst case over the wheels
+	const double theta = fmod(fabs(point.path_angle - point.orientation), M_PI / 4);
+	const double w = fabs(point.angular_velocity);
+	const double v_wheel_max = sqrt(max_wheel_vel_ * max_wheel_vel_ /
+									(w * w + 1 + sqrt(2) * w * cos(theta) + sqrt(2) * w * sin(theta)));
+
+	//Centripetal limit - normal accel can't exceed what the wheels can do
+	//in either direction along the path, otherwise there'd be nothing
+	//left over to speed up or slow down
+	const double normal_per_v_squared = 1. / point.radius + point.angular_accel;
+	const double max_accel = std::min(max_wheel_mid_accel_, max_wheel_brake_accel_);
+	if (normal_per_v_squared <= 0)
+		return v_wheel_max;
+	return std::min(v_wheel_max, sqrt(max_accel / normal_per_v_squared));
+}
+
+double time_optimal_profiler::tangential_accel(const path_point &point, const double v_squared,
+		const double max_accel) const
+{
+	const double normal_accel = v_squared * (1. / point.radius + point.angular_accel);
+	const double remaining = max_accel * max_accel - normal_accel * normal_accel;
+	return (remaining > 0) ? sqrt(remaining) : 0;
+}
+
+bool time_optimal_profiler::run_passes(const path_geometry &path, const double initial_v, const double final_v,
+									   swerve_point_generator::GenerateSwerveProfile::Response &out_msg)
+{
+	const double total_arc = path.total_arc;
+	if ((total_arc <= 0) || (ds_ <= 0))
+	{
+		ROS_ERROR("time_optimal_profiler : path has no length");
+		return false;
+	}
+	const size_t grid_count = static_cast<size_t>(ceil(total_arc / ds_)) + 1;
+	const double ds = total_arc / (grid_count - 1);
+
+	//Path info and velocity limit at each grid point. Everything below
+	//works on u = v^2, which makes constant acceleration linear in s
+	std::vector<path_point> points(grid_count);
+	std::vector<double> u_limit(grid_count);
+	for (size_t k = 0; k < grid_count; k++)
+	{
+		const double s = std::min(k * ds, total_arc);
+		comp_point_characteristics(path, points[k], path.t_of_s(s), s);
+		const double v_max = max_velocity(points[k]);
+		u_limit[k] = v_max * v_max;
+	}
+	u_limit[0] = std::min(u_limit[0], initial_v * initial_v);
+	u_limit[grid_count - 1] = std::min(u_limit[grid_count - 1], final_v * final_v);
+
+	//Back pass - max braking working back from the end
+	std::vector<double> u(u_limit);
+	for (size_t k = grid_count - 1; k > 0; k--)
+	{
+		const double a = tangential_accel(points[k], u[k], max_wheel_brake_accel_);
+		u[k - 1] = std::min(u[k - 1], u[k] + 2. * ds * a);
+	}
+
+	//Forward pass - max acceleration, staying under the back pass
+	for (size_t k = 0; k < grid_count - 1; k++)
+	{
+		const double a = tangential_accel(points[k], u[k], max_wheel_mid_accel_);
+		u[k + 1] = std::min(u[k + 1], u[k] + 2. * ds * a);
+	}
+
+	//Resample at dt. Acceleration is constant between grid points, so
+	//walk the grid with a cursor and solve for s within each interval
+	std::vector<double> values;
+	values.reserve((static_cast<size_t>(total_arc / (max_wheel_vel_ * dt_)) + grid_count / 4 + 16) * values_per_point_);
+	size_t k = 0;
+	double segment_start_time = 0;
+	double v_k = sqrt(u[0]);
+	double v_k1 = sqrt(u[1]);
+	path_point holder_point;
+	for (double t = 0; ; t += dt_)
+	{
+		//Move to the interval containing t
+		bool done = false;
+		for (;;)
+		{
+			if ((v_k + v_k1) <= 0)
+			{
+				ROS_ERROR_STREAM("time_optimal_profiler : robot stops at s=" << k * ds << ", can't finish path");
+				return false;
+			}
+			const double segment_time = 2. * ds / (v_k + v_k1);
+			if (t < segment_start_time + segment_time)
+				break;
+			if (k + 2 >= grid_count)
+			{
+				done = true;
+				break;
+			}
+			segment_start_time += segment_time;
+			k += 1;
+			v_k = v_k1;
+			v_k1 = sqrt(u[k + 1]);
+		}
+		if (done)
+			break;
+
+		const double tau = t - segment_start_time;
+		const double a = (u[k + 1] - u[k]) / (2. * ds);
+		const double v = v_k + a * tau;
+		const double s = std::min(k * ds + v_k * tau + .5 * a * tau * tau, total_arc);
+
+		comp_point_characteristics(path, holder_point, path.t_of_s(s), s);
+		save_point(holder_point, v, values);
+		if (!emit_chunk(values, false))
+			return false;
+	}
+	if (!emit_chunk(values, true))
+		return false;
+
+	const int point_count = write_points(values, out_msg);
+	ROS_INFO_STREAM("time_optimal_profiler : time: " << point_count * dt_ << " total_arc: " << total_arc
+					<< " grid points: " << grid_count);
+	return true;
+}
+}
@@ -1642,17 +1642,19 @@ class TalonHWCommand
 			if (custom_profile_total_time_.size() <= slot)
 				custom_profile_total_time_.resize(slot + 1);
 
-			size_t prev_size = custom_profile_points_[slot].size();
+			// Times are cumulative, so each new point's time builds
+			// on the time of whatever was already in the slot
+			const size_t prev_size = custom_profile_points_[slot].size();
 			custom_profile_points_[slot].insert(custom_profile_points_[slot].end(), points.begin(), points.end());
-			for(; prev_size < custom_profile_points_.size(); prev_size++)
+			for(size_t i = 0; i < points.size(); i++)
 			{
-				if(prev_size != 0)
+				if((prev_size + i) != 0)
 				{
-					custom_profile_total_time_[slot].push_back(points[prev_size].duration + custom_profile_total_time_[slot][prev_size - 1]);
+					custom_profile_total_time_[slot].push_back(points[i].duration + custom_profile_total_time_[slot][prev_size + i - 1]);
 				}
 				else
 				{
-					custom_profile_total_time_[slot].push_back(points[prev_size].duration);
+					custom_profile_total_time_[slot].push_back(points[i].duration);
 				}
 			}
 
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <talon_state_controller/TalonState.h>
+
+namespace talon_state_controller
+{
+
+// Finds joints by name in TalonState messages. Create one with the joint
+// names a node cares about, call update() with each message, then read
+// fields through column() using the position of the joint in that list :
+//
+//   TalonStateIndex talons({"bl_drive", "arm_joint"});
+//   ...
+//   if (talons.update(msg))
+//   {
+//       const auto position = talons.column(msg.position);
+//       arm_angle = position[1];
+//   }
+//
+// The name -> index lookup is only redone when the message's name array
+// changes, so joints being added, removed or reordered are picked up
+// without redoing it on the usual messages. A hash of the names rules
+// out most changes, and a matching hash is confirmed against the names
+// themselves
+class TalonStateIndex
+{
+	public:
+		static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+		// A field of the message, indexed by position in the joint list
+		// instead of position in the message
+		template <class T>
+		class Column
+		{
+			public:
+				Column(const std::vector<T> &values, const std::vector<size_t> &indices) :
+					values_(values),
+					indices_(indices)
+				{
+				}
+
+				// False if the joint wasn't in the message or this field
+				// is shorter than the name array
+				bool valid(size_t joint) const
+				{
+					return (joint < indices_.size()) && (indices_[joint] < values_.size());
+				}
+
+				typename std::vector<T>::const_reference operator[](size_t joint) const
+				{
+					return values_[indices_[joint]];
+				}
+
+			private:
+				const std::vector<T> &values_;
+				const std::vector<size_t> &indices_;
+		};
+
+		explicit TalonStateIndex(const std::vector<std::string> &names) :
+			names_(names),
+			indices_(names.size(), std::numeric_limits<size_t>::max()),
+			layout_hash_(0),
+			layout_valid_(false),
+			all_found_(false)
+		{
+		}
+
+		// Call with every message before reading columns from it.
+		// Returns true if all of the joints are in the message
+		bool update(const TalonState &msg)
+		{
+			const size_t hash = hashNames(msg.name);
+			if (layout_valid_ && (hash == layout_hash_) && (msg.name == layout_names_))
+				return all_found_;
+
+			std::unordered_map<std::string, size_t> lookup;
+			lookup.reserve(msg.name.size());
+			for (size_t i = 0; i < msg.name.size(); i++)
+				lookup.emplace(msg.name[i], i);
+
+			all_found_ = true;
+			for (size_t j = 0; j < names_.size(); j++)
+			{
+				const auto it = lookup.find(names_[j]);
+				if (it == lookup.end())
+				{
+					indices_[j] = npos;
+					all_found_ = false;
+				}
+				else
+					indices_[j] = it->second;
+			}
+			layout_hash_ = hash;
+			layout_names_ = msg.name;
+			layout_valid_ = true;
+			return all_found_;
+		}
+
+		template <class T>
+		Column<T> column(const std::vector<T> &values) const
+		{
+			return Column<T>(values, indices_);
+		}
+
+		// Index of joint in the last message, npos if it wasn't there
+		size_t index(size_t joint) const
+		{
+			if (joint < indices_.size())
+				return indices_[joint];
+			return npos;
+		}
+
+		bool found(size_t joint) const { return index(joint) != npos; }
+		bool allFound(void) const { return all_found_; }
+		const std::vector<std::string> &names(void) const { return names_; }
+
+	private:
+		static size_t hashNames(const std::vector<std::string> &names)
+		{
+			std::hash<std::string> hasher;
+			size_t hash = names.size();
+			for (const auto &name : names)
+				hash ^= hasher(name) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+
+		std::vector<std::string> names_;
+		std::vector<size_t>      indices_;
+		size_t                   layout_hash_;
+		std::vector<std::string> layout_names_; // Name array the indices were found from
+		bool                     layout_valid_;
+		bool                     all_found_;
+};
+
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ros/console.h>
+
+//Precompiled auto modes. behaviors' auto_bundle_compiler turns the auto
+//yaml into one of these, with every profile already generated and converted
+//to wheel space. autoInterpreterClient and the swerve drive controller both
+//mmap the same file at startup - the client reads the action scripts and
+//tells the controller which bundled profiles to load into which slots, so
+//nothing is parsed or generated on the robot.
+//
+//Layout is a FileHeader followed by fixed size tables referenced by byte
+//offset from the start of the file. Everything is 8 byte aligned and in
+//host byte order - bundles are built and run on the same architecture.
+//Bump version whenever any of the structs below change
+namespace auto_bundle
+{
+
+const char magic[8] = {'F', 'R', 'C', 'A', 'U', 'T', 'O', 'B'};
+const uint32_t version = 1;
+const uint32_t wheel_count = 4;
+
+struct FileHeader
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t wheel_count;
+	uint64_t file_size;
+	uint64_t checksum;           //FNV-1a of everything after this header
+	uint32_t mode_count;
+	uint32_t cmd_vel_mode_count;
+	uint32_t profile_count;
+	uint32_t reserved;
+	uint64_t modes_offset;       //ModeEntry[mode_count]
+	uint64_t cmd_vel_modes_offset; //CmdVelModeEntry[cmd_vel_mode_count]
+	uint64_t profiles_offset;    //ProfileEntry[profile_count]
+};
+
+//One profiled auto mode : the profiles run in order, starting at
+//profile_first in the profile table, plus the action script
+struct ModeEntry
+{
+	int32_t  mode;
+	int32_t  layout;
+	int32_t  start_pos;
+	uint32_t profile_first;
+	uint32_t profile_count;
+	uint32_t action_count;
+	uint64_t actions_offset;     //ActionEntry[action_count]
+	uint32_t wait_id_count;
+	uint32_t reserved;
+	uint64_t wait_ids_offset;    //int32_t[wait_id_count], padded to 8 bytes
+};
+
+//Same fields as behaviors' ActionStruct. action is the behaviors Action enum
+struct ActionEntry
+{
+	double  time;
+	int32_t action;
+	int32_t wait_action_id;
+	double  wait_action_time;
+	int32_t wait_profile_id;
+	uint8_t up_or_down;
+	uint8_t reserved[3];
+	double  x;
+	double  y;
+};
+
+struct CmdVelModeEntry
+{
+	int32_t  mode;
+	int32_t  layout;
+	int32_t  start_pos;
+	uint32_t segment_count;
+	uint64_t segments_offset;    //CmdVelSegment[segment_count]
+};
+
+struct CmdVelSegment
+{
+	double duration;
+	double x;
+	double y;
+};
+
+struct ProfileEntry
+{
+	double   dt;
+	uint32_t point_count;
+	uint32_t path_point_count;
+	uint64_t points_offset;      //WheelPoint[point_count]
+	uint64_t path_points_offset; //PathPoint[path_point_count]
+};
+
+//One talon_swerve_drive_controller/SwervePoint. Steering positions are
+//whatever the wheels were at when the bundle was compiled; the controller
+//shifts each wheel by half turns to within a quarter turn of where it is
+//when the profile is loaded, reversing that wheel's drive on an odd number
+//of half turns, the same way point_gen picks steering angles
+struct WheelPoint
+{
+	double  drive_pos[wheel_count];
+	double  drive_f[wheel_count];
+	double  steer_pos[wheel_count];
+	double  steer_f[wheel_count];
+	uint8_t hold[wheel_count];
+	uint8_t reserved[8 - wheel_count % 8];
+};
+
+//Robot-space point from point_gen's joint_trajectory, for visualization
+struct PathPoint
+{
+	double time_from_start;
+	double positions[3];  //x, y, orientation
+	double velocities[3];
+};
+
+inline uint64_t fnv1a(const uint8_t *data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//Read-only view of a bundle file. open() checks the header, checksum
+//and every table range once, so the accessors below don't need to
+class Reader
+{
+	public:
+		Reader(void) : base_(nullptr), size_(0) {}
+		~Reader(void) { close(); }
+		Reader(const Reader &) = delete;
+		Reader &operator=(const Reader &) = delete;
+
+		bool open(const std::string &path)
+		{
+			close();
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				ROS_ERROR_STREAM("auto_bundle : could not open " << path << " : " << strerror(errno));
+				return false;
+			}
+			struct stat st;
+			if ((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(FileHeader)))
+			{
+				ROS_ERROR_STREAM("auto_bundle : " << path << " is too small to be a bundle");
+				::close(fd);
+				return false;
+			}
+			void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (addr == MAP_FAILED)
+			{
+				ROS_ERROR_STREAM("auto_bundle : mmap of " << path << " failed : " << strerror(errno));
+				return false;
+			}
+			base_ = static_cast<const uint8_t *>(addr);
+			size_ = st.st_size;
+			if (!validate(path))
+			{
+				close();
+				return false;
+			}
+			ROS_INFO_STREAM("auto_bundle : loaded " << path << " with " << header().mode_count << " modes, "
+							<< header().profile_count << " profiles, checksum " << std::hex << header().checksum);
+			return true;
+		}
+
+		void close(void)
+		{
+			if (base_)
+				munmap(const_cast<uint8_t *>(base_), size_);
+			base_ = nullptr;
+			size_ = 0;
+		}
+
+		bool isOpen(void) const { return base_ != nullptr; }
+		const FileHeader &header(void) const { return *at<FileHeader>(0); }
+		uint64_t checksum(void) const { return header().checksum; }
+
+		const ModeEntry &mode(size_t i) const { return at<ModeEntry>(header().modes_offset)[i]; }
+		const CmdVelModeEntry &cmdVelMode(size_t i) const { return at<CmdVelModeEntry>(header().cmd_vel_modes_offset)[i]; }
+		const ProfileEntry &profile(size_t i) const { return at<ProfileEntry>(header().profiles_offset)[i]; }
+
+		const ActionEntry *actions(const ModeEntry &m) const { return at<ActionEntry>(m.actions_offset); }
+		const int32_t *waitIds(const ModeEntry &m) const { return at<int32_t>(m.wait_ids_offset); }
+		const CmdVelSegment *segments(const CmdVelModeEntry &m) const { return at<CmdVelSegment>(m.segments_offset); }
+		const WheelPoint *points(const ProfileEntry &p) const { return at<WheelPoint>(p.points_offset); }
+		const PathPoint *pathPoints(const ProfileEntry &p) const { return at<PathPoint>(p.path_points_offset); }
+
+	private:
+		template <class T>
+		const T *at(uint64_t offset) const
+		{
+			return reinterpret_cast<const T *>(base_ + offset);
+		}
+
+		bool inRange(uint64_t offset, uint64_t count, size_t element_size) const
+		{
+			return (offset % 8 == 0) && (offset <= size_) && (count <= (size_ - offset) / element_size);
+		}
+
+		bool validate(const std::string &path) const
+		{
+			const FileHeader &h = header();
+			if (memcmp(h.magic, magic, sizeof(magic)) != 0)
+			{
+				ROS_ERROR_STREAM("auto_bundle : " << path << " is not an auto bundle");
+				return false;
+			}
+			if ((h.version != version) || (h.wheel_count != wheel_count))
+			{
+				ROS_ERROR_STREAM("auto_bundle : " << path << " is version " << h.version << " for " << h.wheel_count
+								 << " wheels, expected version " << version << " for " << wheel_count << " wheels - recompile it");
+				return false;
+			}
+			if ((h.file_size != size_) ||
+				(fnv1a(base_ + sizeof(FileHeader), size_ - sizeof(FileHeader)) != h.checksum))
+			{
+				ROS_ERROR_STREAM("auto_bundle : " << path << " is truncated or corrupt");
+				return false;
+			}
+			bool ok = inRange(h.modes_offset, h.mode_count, sizeof(ModeEntry)) &&
+					  inRange(h.cmd_vel_modes_offset, h.cmd_vel_mode_count, sizeof(CmdVelModeEntry)) &&
+					  inRange(h.profiles_offset, h.profile_count, sizeof(ProfileEntry));
+			for (size_t i = 0; ok && (i < h.mode_count); i++)
+			{
+				const ModeEntry &m = mode(i);
+				ok = (m.profile_first <= h.profile_count) && (m.profile_count <= h.profile_count - m.profile_first) &&
+					 inRange(m.actions_offset, m.action_count, sizeof(ActionEntry)) &&
+					 inRange(m.wait_ids_offset, m.wait_id_count, sizeof(int32_t));
+			}
+			for (size_t i = 0; ok && (i < h.cmd_vel_mode_count); i++)
+			{
+				const CmdVelModeEntry &m = cmdVelMode(i);
+				ok = inRange(m.segments_offset, m.segment_count, sizeof(CmdVelSegment));
+			}
+			for (size_t i = 0; ok && (i < h.profile_count); i++)
+			{
+				const ProfileEntry &p = profile(i);
+				ok = inRange(p.points_offset, p.point_count, sizeof(WheelPoint)) &&
+					 inRange(p.path_points_offset, p.path_point_count, sizeof(PathPoint));
+			}
+			if (!ok)
+				ROS_ERROR_STREAM("auto_bundle : " << path << " has a table outside the file");
+			return ok;
+		}
+
+		const uint8_t *base_;
+		size_t size_;
+};
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+namespace talon_swerve_drive_controller
+{
+
+//Keeps track of how much of each custom profile slot is buffered, and of
+//the slot being run, for profiles which are streamed to the controller in
+//chunks while the rest is still being generated.
+// - a run request with a lookahead is held until its slot has that many
+//   seconds buffered, so a stream doesn't run out of points right away
+// - a streamed profile which runs past the end of its buffered points
+//   before the next chunk arrives is reported as starved. The caller stops
+//   it, and the rest of that stream is dropped until the slot is buffered
+//   from scratch. Resuming once the next chunk arrived would jump straight
+//   to wherever the profile was meant to be by then
+//Times are in seconds. Only used from the controller's update thread
+class ProfileStreamTracker
+{
+	public:
+		ProfileStreamTracker(double grace = 0.1);
+
+		//Seconds past the buffered points before a stream counts as starved
+		void setGrace(double grace);
+
+		//False if points for slot are the rest of a stream which has
+		//already starved, and should be dropped
+		bool accept(int slot, bool append) const;
+
+		//seconds of points were loaded into slot, added to what is there
+		//if append or replacing it if not. streaming is true if more
+		//chunks are coming. Loading a fresh profile into the running slot
+		//means the next run of it starts a new run
+		void buffered(int slot, double seconds, bool append, bool streaming);
+
+		//Every slot was cleared
+		void wipe(void);
+
+		//Run slot once lookahead seconds of it are buffered. A run which
+		//isn't part of an append restarts the run clock, even for the slot
+		//which is already running
+		void requestRun(int slot, double lookahead, bool append);
+
+		//Slot to switch the talons to now, or -1 if there's nothing to
+		//start. The last chunk of a stream runs its slot again, which
+		//doesn't restart a profile which is already going
+		int startRun(double now);
+
+		//Call once per update with whether a custom profile is being run.
+		//True if the running stream has starved, in which case the caller
+		//stops the profile and calls stop()
+		bool checkStarved(double now, bool profile_running);
+
+		//Forget any pending or running profile
+		void stop(void);
+
+		int runningSlot(void) const;
+		double bufferedTime(int slot) const;
+
+	private:
+		double              grace_;
+		std::vector<double> buffered_time_;
+		std::vector<char>   streaming_; //More chunks are coming for the slot
+		int                 pending_run_slot_;
+		double              pending_run_lookahead_;
+		int                 running_slot_;
+		double              run_start_time_;
+		int                 starved_slot_;
+};
+
+}
@@ -49,6 +49,8 @@
 #include <talon_swerve_drive_controller/MotionProfile.h>
 #include <talon_swerve_drive_controller/WheelPos.h>
 #include <talon_swerve_drive_controller/MotionProfilePoints.h>
+#include <talon_swerve_drive_controller/auto_bundle.h>
+#include <talon_swerve_drive_controller/profile_stream_tracker.h>
 #include <talon_swerve_drive_controller/speed_limiter.h>
 #include <swerve_math/Swerve.h>
 #include <boost/circular_buffer.hpp>
@@ -154,8 +156,10 @@ class TalonSwerveDriveController
 			Eigen::Vector2d lin;
 			double ang;
 			ros::Time stamp;
+			uint32_t trace_seq;     //latency_trace id, only set for cmd_vel_stamped
+			ros::Time trace_origin; //0 if untraced
 
-			Commands() : lin({0.0, 0.0}), ang(0.0), stamp(0.0) {}
+			Commands() : lin({0.0, 0.0}), ang(0.0), stamp(0.0), trace_seq(0), trace_origin(0.0) {}
 		};
 		struct cmd_points
 		{	
@@ -174,17 +178,26 @@ class TalonSwerveDriveController
 			std::vector<cmd_points> profiles;
 			bool wipe_all;
 			bool buffer;
+			bool append;
+			bool streaming;
 			bool run;
 			bool brake;
 			int run_slot;
+			double run_lookahead;
 			bool change_queue;
 			std::vector<int> new_queue;
 			bool newly_set;
 			int id_counter;
-			full_profile_cmd() : wipe_all(false), buffer(false), run(false), brake(false),  run_slot(0), change_queue(false), newly_set(false), id_counter(0) {}
+			full_profile_cmd() : wipe_all(false), buffer(false), append(false), streaming(false), run(false), brake(false),  run_slot(0), run_lookahead(0.0), change_queue(false), newly_set(false), id_counter(0) {}
 		};
 				
+		//Written by the service thread, read by update(). update() only
+		//ever try_locks so it can't be held up by the service thread, and
+		//the service waits for room instead of overwriting a queued command
 		boost::circular_buffer<full_profile_cmd> full_profile_buffer_{10}; //likely more than needed
+		std::mutex full_profile_mutex_;
+		double profile_queue_timeout_; //Seconds the service waits for room before rejecting a request
+		bool popProfileCmd(full_profile_cmd &cmd);
 			
 		realtime_tools::RealtimeBuffer<bool> mode_;
 		//realtime_tools::RealtimeBuffer<bool> wipe_all_; //TODO, add this functionality
@@ -194,6 +207,8 @@ class TalonSwerveDriveController
 		Commands brake_struct_other_;
 		
 		ros::Subscriber sub_command_;
+		ros::Subscriber sub_command_stamped_;
+		ros::Time last_trace_origin_; //trace of the last command update() used
 
 
 
@@ -205,6 +220,15 @@ class TalonSwerveDriveController
 		std::array<std::array<hardware_interface::CustomProfilePoint, 2>, WHEELCOUNT> holder_points_;
 		std::array<std::array<std::vector<hardware_interface::CustomProfilePoint>, 2>, WHEELCOUNT> full_profile_;
 
+		//Buffered time and starvation of streamed profiles
+		ProfileStreamTracker profile_stream_;
+		void stopProfile(void);
+
+		//Precompiled auto profiles, loaded into slots by index through
+		//run_profile's bundle_profiles instead of sending every point
+		auto_bundle::Reader auto_bundle_;
+		bool bundleProfile(size_t index, int slot, cmd_points &out);
+
 
 	
 		realtime_tools::RealtimeBuffer<bool> run_;
@@ -273,6 +297,12 @@ class TalonSwerveDriveController
 		 * \param command Velocity command message (twist)
 		 */
 		void cmdVelCallback(const geometry_msgs::Twist &command);
+		/**
+		 * \brief Velocity command callback which also carries a latency trace
+		 * in the header, see ros_control_boilerplate/latency_trace.h
+		 */
+		void cmdVelStampedCallback(const geometry_msgs::TwistStamped &command);
+		void setVelocityCommand(const geometry_msgs::Twist &command, const uint32_t trace_seq, const ros::Time &trace_origin);
 		bool motionProfileService(talon_swerve_drive_controller::MotionProfilePoints::Request &req, talon_swerve_drive_controller::MotionProfilePoints::Response &res);
 		bool brakeService(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
 		bool wheelPosService(talon_swerve_drive_controller::WheelPos::Request &req, talon_swerve_drive_controller::WheelPos::Response &res);
@@ -0,0 +1,109 @@
+#include <algorithm>
+
+#include <talon_swerve_drive_controller/profile_stream_tracker.h>
+
+namespace talon_swerve_drive_controller
+{
+
+ProfileStreamTracker::ProfileStreamTracker(double grace) :
+	grace_(grace),
+	pending_run_slot_(-1),
+	pending_run_lookahead_(0.0),
+	running_slot_(-1),
+	run_start_time_(0.0),
+	starved_slot_(-1)
+{
+}
+
+void ProfileStreamTracker::setGrace(double grace)
+{
+	grace_ = grace;
+}
+
+bool ProfileStreamTracker::accept(int slot, bool append) const
+{
+	return !append || (starved_slot_ < 0) || (slot != starved_slot_);
+}
+
+void ProfileStreamTracker::buffered(int slot, double seconds, bool append, bool streaming)
+{
+	if (slot < 0)
+		return;
+	if (buffered_time_.size() <= static_cast<size_t>(slot))
+	{
+		buffered_time_.resize(slot + 1, 0.0);
+		streaming_.resize(slot + 1, 0);
+	}
+	buffered_time_[slot] = append ? buffered_time_[slot] + seconds : seconds;
+	streaming_[slot] = streaming;
+	if (!append)
+	{
+		if (slot == starved_slot_)
+			starved_slot_ = -1;
+		if (slot == running_slot_)
+			running_slot_ = -1;
+	}
+}
+
+void ProfileStreamTracker::wipe(void)
+{
+	std::fill(buffered_time_.begin(), buffered_time_.end(), 0.0);
+	std::fill(streaming_.begin(), streaming_.end(), 0);
+	starved_slot_ = -1;
+}
+
+void ProfileStreamTracker::requestRun(int slot, double lookahead, bool append)
+{
+	pending_run_slot_ = slot;
+	pending_run_lookahead_ = lookahead;
+	if (!append && (slot == running_slot_))
+		running_slot_ = -1;
+}
+
+int ProfileStreamTracker::startRun(double now)
+{
+	if ((pending_run_slot_ < 0) || (bufferedTime(pending_run_slot_) < pending_run_lookahead_))
+		return -1;
+	if (running_slot_ != pending_run_slot_)
+		run_start_time_ = now;
+	running_slot_ = pending_run_slot_;
+	pending_run_slot_ = -1;
+	return running_slot_;
+}
+
+bool ProfileStreamTracker::checkStarved(double now, bool profile_running)
+{
+	if (!profile_running)
+	{
+		running_slot_ = -1;
+		return false;
+	}
+	if ((running_slot_ < 0) ||
+		(static_cast<size_t>(running_slot_) >= streaming_.size()) ||
+		!streaming_[running_slot_])
+		return false;
+	if ((now - run_start_time_) <= (buffered_time_[running_slot_] + grace_))
+		return false;
+	starved_slot_ = running_slot_;
+	return true;
+}
+
+void ProfileStreamTracker::stop(void)
+{
+	pending_run_slot_ = -1;
+	running_slot_ = -1;
+}
+
+int ProfileStreamTracker::runningSlot(void) const
+{
+	return running_slot_;
+}
+
+double ProfileStreamTracker::bufferedTime(int slot) const
+{
+	if ((slot < 0) || (static_cast<size_t>(slot) >= buffered_time_.size()))
+		return 0.0;
+	return buffered_time_[slot];
+}
+
+}
@@ -34,6 +34,7 @@
  * Author: Bence Magyar
  */
 
+#include <algorithm>
 #include <cmath>
 
 #include <boost/assign.hpp>
@@ -44,7 +45,9 @@
 #include <urdf_parser/urdf_parser.h>
 #include <urdf/urdfdom_compatibility.h>
 
+#include <swerve_math/900Math.h>
 #include <talon_swerve_drive_controller/swerve_drive_controller.h>
+#include <ros_control_boilerplate/latency_trace.h>
 
 //TODO: include swerve stuff from C-Control
 using Eigen::Vector2d;
@@ -186,7 +189,8 @@ TalonSwerveDriveController::TalonSwerveDriveController() :
 	odom_frame_id_("odom"),
 	enable_odom_tf_(true),
 	wheel_joints_size_(0),
-	publish_cmd_(false)
+	publish_cmd_(false),
+	profile_queue_timeout_(0.5)
 
 	//model_({0, 0, 0, 0, 0, 0}),
 	//invertWheelAngle_(false),
@@ -246,6 +250,11 @@ bool TalonSwerveDriveController::init(hardware_interface::TalonCommandInterface
 						  << publish_rate << "Hz.");
 	publish_period_ = ros::Duration(1.0 / publish_rate);
 
+	controller_nh.param("profile_queue_timeout", profile_queue_timeout_, profile_queue_timeout_);
+	double profile_stream_grace = 0.1;
+	controller_nh.param("profile_stream_grace", profile_stream_grace, profile_stream_grace);
+	profile_stream_.setGrace(profile_stream_grace);
+
 
 
 
@@ -359,7 +368,14 @@ bool TalonSwerveDriveController::init(hardware_interface::TalonCommandInterface
 	}
 
 	sub_command_ = controller_nh.subscribe("cmd_vel", 1, &TalonSwerveDriveController::cmdVelCallback, this);
+	sub_command_stamped_ = controller_nh.subscribe("cmd_vel_stamped", 1, &TalonSwerveDriveController::cmdVelStampedCallback, this);
 	brake_serv_ = controller_nh.advertiseService("brake", &TalonSwerveDriveController::brakeService, this);
+	std::string auto_bundle_path;
+	if (controller_nh.getParam("auto_bundle", auto_bundle_path) && !auto_bundle_path.empty())
+	{
+		if (!auto_bundle_.open(auto_bundle_path))
+			ROS_ERROR_NAMED(name_, "Could not load auto bundle, autos will have to send their profile points");
+	}
 	motion_profile_serv_ = controller_nh.advertiseService("run_profile", &TalonSwerveDriveController::motionProfileService, this);
 	wheel_pos_serv_ = controller_nh.advertiseService("wheel_pos", &TalonSwerveDriveController::wheelPosService, this);
 	//sub_run_profile_ = controller_nh.subscribe("run_profile", 1, &TalonSwerveDriveController::runCallback, this);
@@ -623,28 +639,22 @@ void TalonSwerveDriveController::update(const ros::Time &time, const ros::Durati
 
 	//ROS_INFO_STREAM("mode: " << *(mode_.readFromRT())); 
 	
-	//For this to be thread safe, the assumption is that the serv is called relatively infrequently
-	if(full_profile_buffer_.size() != 0)
+	//Streamed profiles can queue up several commands per update, handle all of them
+	full_profile_cmd cur_prof_cmd;
+	while(popProfileCmd(cur_prof_cmd))
 	{
-		//WHERE BE THIS MUTEX
-		full_profile_cmd cur_prof_cmd = full_profile_buffer_.front();
-		full_profile_buffer_.pop_front(); 
+		//Rest of a stream which already ran out of points
+		if(!cur_prof_cmd.profiles.empty() &&
+		   !profile_stream_.accept(cur_prof_cmd.profiles[0].slot, cur_prof_cmd.append))
+		{
+			ROS_WARN_THROTTLE_NAMED(1.0, name_, "Dropping points streamed to slot %d after it ran out of points", cur_prof_cmd.profiles[0].slot);
+			continue;
+		}
+
 		if(cur_prof_cmd.brake)
 		{	
 			ROS_WARN("profile_reset");
-			//required for reset
-			for(size_t k = 0; k < WHEELCOUNT; k++)
-			{
-				steering_joints_[k].setCustomProfileRun(false);
-				speed_joints_[k].setCustomProfileRun(false);
-			}
-			brake_struct_other_.lin[0] = 0;
-			brake_struct_other_.lin[1] = 0;
-			brake_struct_other_.ang = 0;
-			brake_struct_other_.stamp = ros::Time::now();
-			ROS_WARN("called in controller");
-			command_.writeFromNonRT(brake_struct_other_);
-			mode_.writeFromNonRT (true);
+			stopProfile();
 		}
 
 		if(cur_prof_cmd.wipe_all)
@@ -660,6 +670,7 @@ void TalonSwerveDriveController::update(const ros::Time &time, const ros::Durati
 					steering_joints_[k].overwriteCustomProfilePoints(full_profile_[k][1], i);
 				}	
 			}
+			profile_stream_.wipe();
 		}
 
 		if(cur_prof_cmd.buffer)
@@ -672,36 +683,47 @@ void TalonSwerveDriveController::update(const ros::Time &time, const ros::Durati
 				ROS_INFO_STREAM("points: " << point_count2);
 				for(size_t i = 0; i < WHEELCOUNT; i++)
 				{
-					holder_points_[i][0].mode = cur_prof_cmd.profiles[p].hold[0][i] ? hardware_interface::TalonMode_PercentOutput : hardware_interface::TalonMode_Position;
-					holder_points_[i][1].mode = cur_prof_cmd.profiles[p].hold[0][i] ? hardware_interface::TalonMode_MotionMagic : hardware_interface::TalonMode_Position;
-					
-					holder_points_[i][0].pidSlot = 1;
-					holder_points_[i][1].pidSlot = cur_prof_cmd.profiles[p].hold[0][i] ? 0 : 1; //0 and 1 are the same right now
-
-					holder_points_[i][0].setpoint =  cur_prof_cmd.profiles[p].hold[0][i] ? 0 : cur_prof_cmd.profiles[p].drive_pos[0][i];
-					holder_points_[i][1].setpoint = cur_prof_cmd.profiles[p].steer_pos[0][i];
-
-					holder_points_[i][0].fTerm = cur_prof_cmd.profiles[p].hold[0][i] ? 0 : cur_prof_cmd.profiles[p].drive_f[0][i];
-					holder_points_[i][1].fTerm = cur_prof_cmd.profiles[p].hold[0][i] ? 0 : cur_prof_cmd.profiles[p].steer_f[0][i];
+					full_profile_[i][0].clear();
+					full_profile_[i][1].clear();
 
+					holder_points_[i][0].pidSlot = 1;
 					holder_points_[i][0].duration = cur_prof_cmd.profiles[p].dt;
 					holder_points_[i][1].duration = cur_prof_cmd.profiles[p].dt;
-				
-					holder_points_[i][0].zeroPos = true;
+					holder_points_[i][0].zeroPos = false;
 					holder_points_[i][1].zeroPos = false;
-					
-					full_profile_[i][0].clear();
-					full_profile_[i][1].clear();
-					
-					full_profile_[i][0].push_back(holder_points_[i][0]); //Rather than buffering like this we should write directly to full profile at some point
-					full_profile_[i][1].push_back(holder_points_[i][1]); //Rather than buffering like this we should write directly to full profile at some point
+				}
 
-					holder_points_[i][0].zeroPos = false;
+				//Appended points continue the profile already in the slot, so only
+				//a fresh profile zeroes drive position on its first point
+				int first_point = 0;
+				if(!cur_prof_cmd.append && point_count2 > 0)
+				{
+					for(size_t i = 0; i < WHEELCOUNT; i++)
+					{
+						holder_points_[i][0].mode = cur_prof_cmd.profiles[p].hold[0][i] ? hardware_interface::TalonMode_PercentOutput : hardware_interface::TalonMode_Position;
+						holder_points_[i][1].mode = cur_prof_cmd.profiles[p].hold[0][i] ? hardware_interface::TalonMode_MotionMagic : hardware_interface::TalonMode_Position;
+
+						holder_points_[i][1].pidSlot = cur_prof_cmd.profiles[p].hold[0][i] ? 0 : 1; //0 and 1 are the same right now
+
+						holder_points_[i][0].setpoint =  cur_prof_cmd.profiles[p].hold[0][i] ? 0 : cur_prof_cmd.profiles[p].drive_pos[0][i];
+						holder_points_[i][1].setpoint = cur_prof_cmd.profiles[p].steer_pos[0][i];
+
+						holder_points_[i][0].fTerm = cur_prof_cmd.profiles[p].hold[0][i] ? 0 : cur_prof_cmd.profiles[p].drive_f[0][i];
+						holder_points_[i][1].fTerm = cur_prof_cmd.profiles[p].hold[0][i] ? 0 : cur_prof_cmd.profiles[p].steer_f[0][i];
+
+						holder_points_[i][0].zeroPos = true;
+
+						full_profile_[i][0].push_back(holder_points_[i][0]); //Rather than buffering like this we should write directly to full profile at some point
+						full_profile_[i][1].push_back(holder_points_[i][1]); //Rather than buffering like this we should write directly to full profile at some point
+
+						holder_points_[i][0].zeroPos = false;
+					}
+					first_point = 1;
 				}
 
 				const int point_count = cur_prof_cmd.profiles[p].drive_pos.size();
 				ROS_INFO_STREAM("points: " << point_count);
-				for(int i = 1; i < point_count; i++)
+				for(int i = first_point; i < point_count; i++)
 				{
 					for(size_t k = 0; k < WHEELCOUNT; k++)
 					{
@@ -722,24 +744,42 @@ void TalonSwerveDriveController::update(const ros::Time &time, const ros::Durati
 					}
 				}
 				ROS_WARN("done1");
+				const int slot = cur_prof_cmd.profiles[p].slot;
 				for(size_t k = 0; k < WHEELCOUNT; k++)
 				{
-					speed_joints_[k].overwriteCustomProfilePoints(full_profile_[k][0], cur_prof_cmd.profiles[p].slot);
-					steering_joints_[k].overwriteCustomProfilePoints(full_profile_[k][1], cur_prof_cmd.profiles[p].slot);
+					if(cur_prof_cmd.append)
+					{
+						speed_joints_[k].pushCustomProfilePoints(full_profile_[k][0], slot);
+						steering_joints_[k].pushCustomProfilePoints(full_profile_[k][1], slot);
+					}
+					else
+					{
+						speed_joints_[k].overwriteCustomProfilePoints(full_profile_[k][0], slot);
+						steering_joints_[k].overwriteCustomProfilePoints(full_profile_[k][1], slot);
+					}
 				}	
 
+				profile_stream_.buffered(slot, point_count * cur_prof_cmd.profiles[p].dt,
+						cur_prof_cmd.append, cur_prof_cmd.streaming);
+
 				ROS_WARN("done");
 			}
 		}
 
 		if(cur_prof_cmd.run)
-		{	
+			profile_stream_.requestRun(cur_prof_cmd.run_slot, cur_prof_cmd.run_lookahead, cur_prof_cmd.append);
+
+		//Hold off on running until enough of the slot is buffered that
+		//the rest of a streamed profile can arrive before it is needed
+		const int run_slot = profile_stream_.startRun(time.toSec());
+		if(run_slot >= 0)
+		{
 			ROS_WARN("running from  controller");
 			mode_.writeFromNonRT(false); //Should be fine
 			for(size_t k = 0; k < WHEELCOUNT; k++)
 			{
-				steering_joints_[k].setCustomProfileSlot(cur_prof_cmd.run_slot);
-				speed_joints_[k].setCustomProfileSlot(cur_prof_cmd.run_slot);		
+				steering_joints_[k].setCustomProfileSlot(run_slot);
+				speed_joints_[k].setCustomProfileSlot(run_slot);		
 			}
 		}
 
@@ -753,6 +793,16 @@ void TalonSwerveDriveController::update(const ros::Time &time, const ros::Durati
 		}
 
 	}
+
+	//A streamed profile which gets to the end of its points with more
+	//still to come is stopped rather than left holding its last point
+	if(profile_stream_.checkStarved(time.toSec(), !*(mode_.readFromRT())))
+	{
+		const int slot = profile_stream_.runningSlot();
+		ROS_ERROR_NAMED(name_, "Streamed profile in slot %d ran out of points after %f seconds, stopping",
+				slot, profile_stream_.bufferedTime(slot));
+		stopProfile();
+	}
 	static double mode_last = ros::Time::now().toSec();
 	if(*(mode_.readFromRT()))
 	{
@@ -760,6 +810,13 @@ void TalonSwerveDriveController::update(const ros::Time &time, const ros::Durati
 		Commands curr_cmd = *(command_.readFromRT());
 		const double dt = (time - curr_cmd.stamp).toSec();
 
+		if (!curr_cmd.trace_origin.isZero() && (curr_cmd.trace_origin != last_trace_origin_))
+		{
+			last_trace_origin_ = curr_cmd.trace_origin;
+			latency_trace::record(curr_cmd.trace_seq, curr_cmd.trace_origin, latency_trace::ControllerUpdate);
+			latency_trace::Tracer::instance().setPending(curr_cmd.trace_seq, curr_cmd.trace_origin);
+		}
+
 		//ROS_INFO_STREAM("ang_vel_tar: " << curr_cmd.ang << " lin_vel_tar: " << curr_cmd.lin);
 
 		// Brake if cmd_vel has timeout:
@@ -927,14 +984,26 @@ void TalonSwerveDriveController::brake()
 
 
 void TalonSwerveDriveController::cmdVelCallback(const geometry_msgs::Twist &command)
+{
+	setVelocityCommand(command, 0, ros::Time(0));
+}
+
+void TalonSwerveDriveController::cmdVelStampedCallback(const geometry_msgs::TwistStamped &command)
+{
+	latency_trace::record(command.header.seq, command.header.stamp, latency_trace::ControllerReceive);
+	setVelocityCommand(command.twist, command.header.seq, command.header.stamp);
+}
+
+void TalonSwerveDriveController::setVelocityCommand(const geometry_msgs::Twist &command, const uint32_t trace_seq, const ros::Time &trace_origin)
 {
 	if (isRunning())
 	{
 		// check tha//t we don't have multiple publishers on the command topic
         //ROS_WARN("Time Difference: %f", ros::Time::now().toSec() - command->header.stamp.toSec());
-		if (!allow_multiple_cmd_vel_publishers_ && sub_command_.getNumPublishers() > 1)
+		const uint32_t num_publishers = sub_command_.getNumPublishers() + sub_command_stamped_.getNumPublishers();
+		if (!allow_multiple_cmd_vel_publishers_ && num_publishers > 1)
 		{
-			ROS_ERROR_STREAM_THROTTLE_NAMED(1.0, name_, "Detected " << sub_command_.getNumPublishers()
+			ROS_ERROR_STREAM_THROTTLE_NAMED(1.0, name_, "Detected " << num_publishers
 											<< " publishers. Only 1 publisher is allowed. Going to brake.");
 			brake();
 			return;
@@ -999,6 +1068,8 @@ void TalonSwerveDriveController::cmdVelCallback(const geometry_msgs::Twist &comm
 		command_struct_.lin[0] = command.linear.x;
 		command_struct_.lin[1] = command.linear.y;
 		command_struct_.stamp = ros::Time::now();
+		command_struct_.trace_seq = trace_seq;
+		command_struct_.trace_origin = trace_origin;
 		command_.writeFromNonRT (command_struct_);
 		
 		mode_.writeFromNonRT (true);
@@ -1020,6 +1091,37 @@ void TalonSwerveDriveController::cmdVelCallback(const geometry_msgs::Twist &comm
 	}
 }
 
+//Never blocks - if the service thread holds the lock, queued
+//commands are picked up next update
+bool TalonSwerveDriveController::popProfileCmd(full_profile_cmd &cmd)
+{
+	std::unique_lock<std::mutex> lock(full_profile_mutex_, std::try_to_lock);
+	if(!lock.owns_lock() || full_profile_buffer_.empty())
+		return false;
+	std::swap(cmd, full_profile_buffer_.front());
+	full_profile_buffer_.pop_front();
+	return true;
+}
+
+//Stops any running custom profile and holds the robot still
+void TalonSwerveDriveController::stopProfile(void)
+{
+	//required for reset
+	for(size_t k = 0; k < WHEELCOUNT; k++)
+	{
+		steering_joints_[k].setCustomProfileRun(false);
+		speed_joints_[k].setCustomProfileRun(false);
+	}
+	brake_struct_other_.lin[0] = 0;
+	brake_struct_other_.lin[1] = 0;
+	brake_struct_other_.ang = 0;
+	brake_struct_other_.stamp = ros::Time::now();
+	ROS_WARN("called in controller");
+	command_.writeFromNonRT(brake_struct_other_);
+	mode_.writeFromNonRT (true);
+	profile_stream_.stop();
+}
+
 bool TalonSwerveDriveController::motionProfileService(talon_swerve_drive_controller::MotionProfilePoints::Request &req, talon_swerve_drive_controller::MotionProfilePoints::Response &/*res*/)
 {
 	if (isRunning())
@@ -1041,7 +1143,26 @@ bool TalonSwerveDriveController::motionProfileService(talon_swerve_drive_control
 
 		full_profile_cmd full_profile_struct;
 		full_profile_struct.buffer = req.buffer;
-		if(req.buffer)
+		if(req.buffer && !req.bundle_profiles.empty())
+		{
+			if(!auto_bundle_.isOpen() || (auto_bundle_.checksum() != req.bundle_checksum))
+			{
+				ROS_ERROR_NAMED(name_, "Requested bundled profiles, but the auto bundle loaded here is missing or doesn't match the client's");
+				return false;
+			}
+			if(req.bundle_slots.size() != req.bundle_profiles.size())
+			{
+				ROS_ERROR_NAMED(name_, "bundle_profiles and bundle_slots must be the same size");
+				return false;
+			}
+			full_profile_struct.profiles.resize(req.bundle_profiles.size());
+			for(size_t i = 0; i < req.bundle_profiles.size(); i++)
+			{
+				if(!bundleProfile(req.bundle_profiles[i], req.bundle_slots[i], full_profile_struct.profiles[i]))
+					return false;
+			}
+		}
+		else if(req.buffer)
 		{
 			ROS_INFO_STREAM("size in controller: " << req.profiles.size());
 			full_profile_struct.profiles.resize(req.profiles.size());
@@ -1069,9 +1190,12 @@ bool TalonSwerveDriveController::motionProfileService(talon_swerve_drive_control
 		}
 
 		full_profile_struct.wipe_all		= req.wipe_all;		
+		full_profile_struct.append			= req.append;
+		full_profile_struct.streaming		= req.streaming;
 		full_profile_struct.run				= req.run;		
 		full_profile_struct.brake			= req.brake;		
 		full_profile_struct.run_slot		= req.run_slot;		
+		full_profile_struct.run_lookahead	= req.run_lookahead;
 		full_profile_struct.change_queue	= req.change_queue;
 		for(size_t i= 0; i< req.new_queue.size(); i++)
 		{
@@ -1079,11 +1203,27 @@ bool TalonSwerveDriveController::motionProfileService(talon_swerve_drive_control
 		}
 		full_profile_struct.newly_set		= true;
 				
-		//mutex?		
-		full_profile_buffer_.push_back(full_profile_struct);
-		
-
-		return true;
+		//Wait for update() to make room rather than overwriting a queued
+		//command - losing a chunk of a streamed profile leaves a hole in it
+		const ros::WallTime give_up = ros::WallTime::now() + ros::WallDuration(profile_queue_timeout_);
+		while(true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(full_profile_mutex_);
+				if(!full_profile_buffer_.full())
+				{
+					full_profile_buffer_.push_back(full_profile_cmd());
+					std::swap(full_profile_buffer_.back(), full_profile_struct);
+					return true;
+				}
+			}
+			if(ros::WallTime::now() > give_up)
+			{
+				ROS_ERROR_NAMED(name_, "Motion profile command queue is full, rejecting request");
+				return false;
+			}
+			ros::WallDuration(0.002).sleep();
+		}
 	}
 	else
 	{
@@ -1113,6 +1253,73 @@ bool TalonSwerveDriveController::brakeService(std_srvs::Empty::Request &/*req*/,
 	}
 }
 
+//Copies a profile out of the mmapped auto bundle. Steering setpoints were
+//generated for wherever the wheels pointed when the bundle was compiled,
+//so each wheel is shifted by the whole number of turns which puts its
+//first setpoint closest to where it is now - the same choice point_gen
+//makes when it generates a profile from the current wheel positions
+bool TalonSwerveDriveController::bundleProfile(size_t index, int slot, cmd_points &out)
+{
+	static_assert(WHEELCOUNT == auto_bundle::wheel_count, "auto bundle wheel count doesn't match the swerve model");
+	if(index >= auto_bundle_.header().profile_count)
+	{
+		ROS_ERROR_STREAM_NAMED(name_, "Bundled profile " << index << " out of range");
+		return false;
+	}
+	const auto_bundle::ProfileEntry &profile = auto_bundle_.profile(index);
+	const auto_bundle::WheelPoint *points = auto_bundle_.points(profile);
+
+	std::array<double, WHEELCOUNT> steer_angles;
+	{
+		std::lock_guard<std::mutex> lock(steer_angles_mutex_);
+		steer_angles = steer_angles_;
+	}
+	//Same as point_gen does when generating - point each wheel within a
+	//quarter turn of where it is now, running the drive backwards if
+	//that means it faces the other way to how it was compiled
+	std::array<double, WHEELCOUNT> steer_shift;
+	std::array<double, WHEELCOUNT> drive_sign;
+	for(size_t k = 0; k < WHEELCOUNT; k++)
+	{
+		steer_shift[k] = 0;
+		drive_sign[k] = 1;
+		if(profile.point_count > 0)
+		{
+			const double current = swerveC_->getWheelAngle(k, steer_angles[k]);
+			const double bundled = swerveC_->getWheelAngle(k, points[0].steer_pos[k]);
+			bool reverse;
+			const double nearest = leastDistantAngleWithinHalfPi(current, bundled, reverse);
+			steer_shift[k] = (nearest - bundled) * units_.steeringSet;
+			drive_sign[k] = reverse ? -1 : 1;
+		}
+	}
+
+	out.dt = profile.dt;
+	out.slot = slot;
+	out.drive_pos.resize(profile.point_count);
+	out.drive_f.resize(profile.point_count);
+	out.steer_pos.resize(profile.point_count);
+	out.steer_f.resize(profile.point_count);
+	out.hold.resize(profile.point_count);
+	for(size_t i = 0; i < profile.point_count; i++)
+	{
+		const auto_bundle::WheelPoint &point = points[i];
+		out.drive_pos[i].resize(WHEELCOUNT);
+		out.drive_f[i].resize(WHEELCOUNT);
+		out.steer_f[i].assign(point.steer_f, point.steer_f + WHEELCOUNT);
+		out.steer_pos[i].resize(WHEELCOUNT);
+		out.hold[i].resize(WHEELCOUNT);
+		for(size_t k = 0; k < WHEELCOUNT; k++)
+		{
+			out.drive_pos[i][k] = point.drive_pos[k] * drive_sign[k];
+			out.drive_f[i][k] = point.drive_f[k] * drive_sign[k];
+			out.steer_pos[i][k] = point.steer_pos[k] + steer_shift[k];
+			out.hold[i][k] = point.hold[k] != 0;
+		}
+	}
+	return true;
+}
+
 bool TalonSwerveDriveController::wheelPosService(talon_swerve_drive_controller::WheelPos::Request &/*req*/, talon_swerve_drive_controller::WheelPos::Response &res)
 {
 	if (isRunning())
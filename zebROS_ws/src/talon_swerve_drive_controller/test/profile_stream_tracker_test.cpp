@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <talon_swerve_drive_controller/profile_stream_tracker.h>
+
+using talon_swerve_drive_controller::ProfileStreamTracker;
+
+//Sends a stream the way point_gen does - a fresh first chunk which runs
+//with a lookahead, appended chunks, then a last chunk which runs again.
+//Steps time forward by each chunk's length, checking for starvation
+static double streamProfile(ProfileStreamTracker &tracker, int slot, double start, int chunks, double chunk_time)
+{
+	double now = start;
+	for (int i = 0; i < chunks; i++)
+	{
+		const bool append = i != 0;
+		const bool last = i == (chunks - 1);
+		EXPECT_TRUE(tracker.accept(slot, append));
+		tracker.buffered(slot, chunk_time, append, !last);
+		if (!append || last)
+			tracker.requestRun(slot, last ? 0 : chunk_time, append);
+		tracker.startRun(now);
+		EXPECT_EQ(slot, tracker.runningSlot());
+		EXPECT_FALSE(tracker.checkStarved(now, true));
+		now += chunk_time;
+	}
+	return now;
+}
+
+TEST(ProfileStreamTracker, testRunWaitsForLookahead)
+{
+	ProfileStreamTracker tracker(0.1);
+	tracker.buffered(0, 0.2, false, true);
+	tracker.requestRun(0, 0.3, false);
+	EXPECT_EQ(-1, tracker.startRun(0.0));
+	tracker.buffered(0, 0.2, true, true);
+	EXPECT_EQ(0, tracker.startRun(0.1));
+	EXPECT_EQ(0, tracker.runningSlot());
+}
+
+TEST(ProfileStreamTracker, testStarvedStreamIsDropped)
+{
+	ProfileStreamTracker tracker(0.1);
+	tracker.buffered(0, 0.5, false, true);
+	tracker.requestRun(0, 0.3, false);
+	EXPECT_EQ(0, tracker.startRun(1.0));
+	EXPECT_FALSE(tracker.checkStarved(1.55, true));
+	EXPECT_TRUE(tracker.checkStarved(1.65, true));
+	tracker.stop();
+
+	//Rest of the starved stream is dropped, a fresh profile isn't
+	EXPECT_FALSE(tracker.accept(0, true));
+	EXPECT_TRUE(tracker.accept(1, true));
+	EXPECT_TRUE(tracker.accept(0, false));
+	tracker.buffered(0, 0.5, false, false);
+	EXPECT_TRUE(tracker.accept(0, true));
+}
+
+TEST(ProfileStreamTracker, testLastChunkDoesntRestartRun)
+{
+	ProfileStreamTracker tracker(0.1);
+	tracker.buffered(0, 0.5, false, true);
+	tracker.requestRun(0, 0.3, false);
+	EXPECT_EQ(0, tracker.startRun(0.0));
+
+	//Last chunk arrives late enough that the run would have starved
+	//if it was timed from here instead of from the start
+	tracker.buffered(0, 0.5, true, false);
+	tracker.requestRun(0, 0, true);
+	EXPECT_EQ(0, tracker.startRun(0.4));
+	EXPECT_FALSE(tracker.checkStarved(0.9, true));
+	EXPECT_FALSE(tracker.checkStarved(5.0, true)); //not streaming any more
+}
+
+TEST(ProfileStreamTracker, testSameSlotStreamedTwice)
+{
+	ProfileStreamTracker tracker(0.1);
+	double now = streamProfile(tracker, 0, 10.0, 5, 0.5);
+
+	//The first profile finishes but the talons stay in custom profile
+	//mode, so the tracker still sees it as running. Well after, a second
+	//stream goes into the same slot
+	now += 20.0;
+	EXPECT_FALSE(tracker.checkStarved(now, true));
+	now = streamProfile(tracker, 0, now, 5, 0.5);
+	EXPECT_TRUE(tracker.accept(0, true));
+
+	//A third time, with a normal update in between
+	EXPECT_FALSE(tracker.checkStarved(now, false));
+	streamProfile(tracker, 0, now + 3.0, 5, 0.5);
+}
+
+TEST(ProfileStreamTracker, testRerunLoadedSlotRestartsClock)
+{
+	ProfileStreamTracker tracker(0.1);
+	tracker.buffered(0, 0.5, false, true);
+	tracker.requestRun(0, 0.3, false);
+	EXPECT_EQ(0, tracker.startRun(0.0));
+
+	tracker.requestRun(0, 0.3, false);
+	EXPECT_EQ(0, tracker.startRun(3.0));
+	EXPECT_FALSE(tracker.checkStarved(3.5, true));
+	EXPECT_TRUE(tracker.checkStarved(3.7, true));
+}
+
+TEST(ProfileStreamTracker, testWipe)
+{
+	ProfileStreamTracker tracker(0.1);
+	tracker.buffered(2, 0.5, false, true);
+	EXPECT_DOUBLE_EQ(0.5, tracker.bufferedTime(2));
+	tracker.wipe();
+	EXPECT_DOUBLE_EQ(0.0, tracker.bufferedTime(2));
+	EXPECT_DOUBLE_EQ(0.0, tracker.bufferedTime(7));
+}
+
+int main(int argc, char **argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
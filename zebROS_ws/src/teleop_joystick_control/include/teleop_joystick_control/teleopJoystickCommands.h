@@ -7,6 +7,7 @@
 #include "std_msgs/Float64.h"
 #include "sensor_msgs/JointState.h"
 #include "geometry_msgs/Twist.h"
+#include "geometry_msgs/TwistStamped.h"
 #include <string>
 #include <cmath>
 #include <math.h>
@@ -22,6 +23,7 @@
 #include <base_trajectory/GenerateSpline.h>
 #include <talon_state_controller/TalonState.h>
 #include <talon_state_controller/CustomProfileStatus.h>
+#include <talon_state_controller/talon_state_index.h>
 
 void rumbleTypeConverterPublish(uint16_t leftRumble, uint16_t rightRumble);
 void navXCallback(const sensor_msgs::Imu &navXState);
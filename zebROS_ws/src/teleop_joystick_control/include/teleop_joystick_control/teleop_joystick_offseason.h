@@ -22,6 +22,7 @@
 //#include <base_trajectory/GenerateSpline.h>
 #include <talon_state_controller/TalonState.h>
 #include <talon_state_controller/CustomProfileStatus.h>
+#include <talon_state_controller/talon_state_index.h>
 #include <std_msgs/Float64.h>
 #include <behaviors/ArmGoal.h>
 #include <behaviors/ForearmGoal.h>
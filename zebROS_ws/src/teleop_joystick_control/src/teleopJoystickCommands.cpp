@@ -1,6 +1,10 @@
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <realtime_tools/realtime_buffer.h>
 #include "teleop_joystick_control/teleopJoystickCommands.h"
+#include "ros_control_boilerplate/latency_trace.h"
 #include "elevator_controller/ElevatorControl.h"
 #include "elevator_controller/ReturnElevatorCmd.h"
 #include "elevator_controller/ElevatorControlS.h"
@@ -346,6 +350,92 @@ bool runTrajectory(const swerve_point_generator::FullGenCoefs::Response &traj)
 		return true;
 }
 
+//Snap to angle runs spline_gen -> point_gen -> swerve_control, each a
+//blocking service call. That happens on orientThread so evaluateCommands
+//never waits on it. Only the newest request matters : posting one
+//replaces anything still queued, and the worker abandons a request between
+//stages once a newer one has been posted or it has been cancelled
+struct OrientRequest
+{
+	double angle_diff;
+	ros::Duration time_to_run;
+};
+static std::mutex orient_mutex;
+static std::condition_variable orient_cv;
+static OrientRequest orient_request; //guarded by orient_mutex
+static bool orient_pending = false; //guarded by orient_mutex
+static uint64_t orient_generation = 0; //bumped by every post or cancel, guarded by orient_mutex
+static std::atomic<bool> orient_running; //a profile from the newest request has been sent to the controller
+
+void postOrient(const double angle_diff, const ros::Duration &time_to_run)
+{
+	{
+		std::lock_guard<std::mutex> l(orient_mutex);
+		orient_request.angle_diff = angle_diff;
+		orient_request.time_to_run = time_to_run;
+		orient_pending = true;
+		orient_generation += 1;
+	}
+	orient_running = false;
+	orient_cv.notify_one();
+}
+
+void cancelOrient(void)
+{
+	{
+		std::lock_guard<std::mutex> l(orient_mutex);
+		orient_pending = false;
+		orient_generation += 1;
+	}
+	orient_running = false;
+}
+
+static bool orientCurrent(const uint64_t generation)
+{
+	std::lock_guard<std::mutex> l(orient_mutex);
+	return ros::ok() && (generation == orient_generation);
+}
+
+void orientThread(void)
+{
+	while (ros::ok())
+	{
+		OrientRequest request;
+		uint64_t generation;
+		{
+			std::unique_lock<std::mutex> l(orient_mutex);
+			//time out now and then to notice ros shutting down
+			if (!orient_cv.wait_for(l, std::chrono::milliseconds(100), []() { return orient_pending; }))
+				continue;
+			request = orient_request;
+			generation = orient_generation;
+			orient_pending = false;
+		}
+
+		const ros::Time start_time = ros::Time::now();
+		base_trajectory::GenerateSpline srvBaseTrajectory;
+		swerve_point_generator::FullGenCoefs traj;
+
+		if (!generateCoefs(request.angle_diff, request.time_to_run, srvBaseTrajectory)) //generate coefficients for the spline from the endpoints
+			ROS_INFO_STREAM("spline_gen died in teleopJoystickCommands generateCoefs");
+		else if (!orientCurrent(generation))
+			ROS_INFO_STREAM("orient superseded after generateCoefs");
+		else if (!generateTrajectory(srvBaseTrajectory, traj)) //generate a motion profile from the coefs
+			ROS_INFO_STREAM("point_gen died in teleopJoystickCommands generateTrajectory");
+		else if (!orientCurrent(generation))
+			ROS_INFO_STREAM("orient superseded after generateTrajectory");
+		else if (!runTrajectory(traj.response)) //run on swerve_control
+			ROS_ERROR("swerve_control failed in teleopJoystickCommands runTrajectory");
+		else
+		{
+			ROS_INFO_STREAM("orient profile sent " << (ros::Time::now() - start_time).toSec() << " seconds after request");
+			std::lock_guard<std::mutex> l(orient_mutex);
+			if (generation == orient_generation)
+				orient_running = true;
+		}
+	}
+}
+
 void match_data_callback(const frc_msgs::MatchSpecificData::ConstPtr &MatchData)
 {
 	//Joystick Rumble
@@ -359,6 +449,8 @@ void match_data_callback(const frc_msgs::MatchSpecificData::ConstPtr &MatchData)
 //
 void evaluateCommands(const ros_control_boilerplate::JoystickState::ConstPtr &JoystickState)
 {
+	latency_trace::record(JoystickState->header.seq, JoystickState->header.stamp, latency_trace::TeleopReceive);
+
 	/*std_msgs::Header first_header;
 	  first_header.stamp = JoystickState->header.stamp;
 	  first_header.seq = 0;
@@ -1228,41 +1320,23 @@ void evaluateCommands(const ros_control_boilerplate::JoystickState::ConstPtr &Jo
 	if(JoystickState->stickRightPress == true)
 	{
 		ROS_INFO_STREAM("outOfPoints = " << outOfPoints);
-		static bool orient_running = false;
-		if(!orient_running || outOfPoints.load(std::memory_order_relaxed))
-		{
-			orient_running = false;
-			sendRobotZero = false;
-			const double angle = -navX_angle.load(std::memory_order_relaxed) - M_PI / 2;
-			//const double angle = M_PI; //for testing
-			ROS_INFO_STREAM("angle = " << angle);
-			// TODO: look at using ros::angles package
-			//const double least_dist_angle = round(angle/(M_PI/2))*M_PI/2;
-			const double least_dist_angle = angle + 2* M_PI;
-			const double max_rotational_velocity = 8.8; //radians/sec TODO: find this in config
-
-			ROS_INFO_STREAM("delta angle = " << least_dist_angle - angle);
-			const ros::Duration time_to_run((fabs(least_dist_angle - angle) / max_rotational_velocity) * .5); //TODO: needs testing
-			ROS_INFO_STREAM("time_to_run = " << time_to_run.toSec());
-
-			base_trajectory::GenerateSpline srvBaseTrajectory;
-			swerve_point_generator::FullGenCoefs traj;
-			
-			if (!generateCoefs(least_dist_angle - angle, time_to_run, srvBaseTrajectory)) //generate coefficients for the spline from the endpoints 
-				ROS_INFO_STREAM("spline_gen died in teleopJoystickCommands generateCoefs");
-			else if (!generateTrajectory(srvBaseTrajectory, traj)) //generate a motion profile from the coefs
-				ROS_INFO_STREAM("point_gen died in teleopJoystickCommands generateTrajectory");
-			else if (!runTrajectory(traj.response)) //run on swerve_control
-				ROS_ERROR("swerve_control failed in teleopJoystickCommands runTrajectory");
-			else
-				orient_running = true;
-		}
-		else 
-		{
-			ROS_INFO_STREAM("Can't run orient, it's already running");
-			if (outOfPoints.load(std::memory_order_relaxed))
-				orient_running = false;
-		}
+		if (orient_running.load(std::memory_order_relaxed) && !outOfPoints.load(std::memory_order_relaxed))
+			ROS_INFO_STREAM("Orient already running, replacing it");
+		sendRobotZero = false;
+		const double angle = -navX_angle.load(std::memory_order_relaxed) - M_PI / 2;
+		//const double angle = M_PI; //for testing
+		ROS_INFO_STREAM("angle = " << angle);
+		// TODO: look at using ros::angles package
+		//const double least_dist_angle = round(angle/(M_PI/2))*M_PI/2;
+		const double least_dist_angle = angle + 2* M_PI;
+		const double max_rotational_velocity = 8.8; //radians/sec TODO: find this in config
+
+		ROS_INFO_STREAM("delta angle = " << least_dist_angle - angle);
+		const ros::Duration time_to_run((fabs(least_dist_angle - angle) / max_rotational_velocity) * .5); //TODO: needs testing
+		ROS_INFO_STREAM("time_to_run = " << time_to_run.toSec());
+
+		//Generated and run on orientThread
+		postOrient(least_dist_angle - angle, time_to_run);
 	}
 
 	if (fabs(leftStickX) == 0.0 && fabs(leftStickY) == 0.0 && rotation == 0.0)
@@ -1280,6 +1354,7 @@ void evaluateCommands(const ros_control_boilerplate::JoystickState::ConstPtr &Jo
 	}
 	else // X or Y or rotation != 0 so tell the drive base to move
 	{
+		cancelOrient(); //driver took over, don't start a profile they no longer want
 		sendRobotZero = false;
 		//Publish drivetrain messages and elevator/pivot
 		Eigen::Vector2d joyVector;
@@ -1288,16 +1363,20 @@ void evaluateCommands(const ros_control_boilerplate::JoystickState::ConstPtr &Jo
 		Eigen::Rotation2Dd r(-navX_angle.load(std::memory_order_relaxed) - M_PI / 2);
 		Eigen::Vector2d rotatedJoyVector = r.toRotationMatrix() * joyVector;
 
-		geometry_msgs::Twist vel;
-		vel.linear.x = rotatedJoyVector[1];
-		vel.linear.y = rotatedJoyVector[0];
-		vel.linear.z = 0;
+		//Header carries the joystick sample's seq and stamp through to the
+		//controller for latency tracing
+		geometry_msgs::TwistStamped vel;
+		vel.header = JoystickState->header;
+		vel.twist.linear.x = rotatedJoyVector[1];
+		vel.twist.linear.y = rotatedJoyVector[0];
+		vel.twist.linear.z = 0;
 
-		vel.angular.x = 0;
-		vel.angular.y = 0;
-		vel.angular.z = rotation;
+		vel.twist.angular.x = 0;
+		vel.twist.angular.y = 0;
+		vel.twist.angular.z = rotation;
 
 		JoystickRobotVel.publish(vel);
+		latency_trace::record(JoystickState->header.seq, JoystickState->header.stamp, latency_trace::TeleopPublish);
 		/*std_msgs::Header test_header;
 		  test_header.stamp = JoystickState->header.stamp;
 		  test_header.seq = 1;
@@ -1443,16 +1522,20 @@ int main(int argc, char **argv)
 	if (!n_params.getParam("exchange_delay", exchange_delay))
 		ROS_ERROR("Could not read exchange_delay");
 
+	//Optional, records joystick to talon latency - see ros_control_boilerplate/latency_trace.h
+	latency_trace::startFromParam(n_params);
+
 	disableArmLimits = false;
 	navX_angle = M_PI / 2;
 	matchTimeRemaining = std::numeric_limits<double>::max();
 	outOfPoints = false;
+	orient_running = false;
 
 	ac = std::make_shared<actionlib::SimpleActionClient<behaviors::RobotAction>>("auto_interpreter_server", true);
 	ac_intake = std::make_shared<actionlib::SimpleActionClient<behaviors::IntakeAction>>("auto_interpreter_server_intake", true);
 	ac_lift = std::make_shared<actionlib::SimpleActionClient<behaviors::LiftAction>> ("auto_interpreter_server_lift", true);
 
-	JoystickRobotVel = n.advertise<geometry_msgs::Twist>("/frcrobot/swerve_drive_controller/cmd_vel", 1);
+	JoystickRobotVel = n.advertise<geometry_msgs::TwistStamped>("/frcrobot/swerve_drive_controller/cmd_vel_stamped", 1);
 	//JoystickTestVel = n.advertise<std_msgs::Header>("test_header", 3);
 	JoystickElevatorPos = n.advertise<elevator_controller::ElevatorControl>("/frcrobot/elevator_controller/cmd_pos", 1);
 	JoystickRumble = n.advertise<std_msgs::Float64>("rumble_controller/command", 1);
@@ -1480,9 +1563,13 @@ int main(int argc, char **argv)
 	ros::Subscriber joint_states_sub = n.subscribe("/frcrobot/joint_states", 1, &jointStateCallback);
 	ros::Subscriber talon_states_sub = n.subscribe("/frcrobot/talon_states", 1, &talonStateCallback);
 
+	std::thread orient_thread(orientThread);
+
 	ROS_WARN("joy_init");
 
 	ros::spin();
+	orient_cv.notify_one();
+	orient_thread.join();
 	return 0;
 }
 
@@ -1567,20 +1654,12 @@ void jointStateCallback(const sensor_msgs::JointState &joint_state)
 void talonStateCallback(const talon_state_controller::TalonState &talon_state)
 {
 	// TODO : This shouldn't be hard-coded
-	static size_t bl_angle_idx = std::numeric_limits<size_t>::max();
+	static talon_state_controller::TalonStateIndex talon_index({"bl_angle"});
 
-	if (bl_angle_idx >= talon_state.name.size())
+	if (talon_index.update(talon_state))
 	{
-		for (size_t i = 0; i < talon_state.name.size(); i++)
-		{
-			if (talon_state.name[i] == "bl_angle")
-			{
-				bl_angle_idx = i;
-				break;
-			}
-		}
+		const auto profile_status = talon_index.column(talon_state.custom_profile_status);
+		if (profile_status.valid(0))
+			outOfPoints.store(profile_status[0].outOfPoints, std::memory_order_relaxed);
 	}
-
-	if (bl_angle_idx < talon_state.custom_profile_status.size())
-		outOfPoints.store(talon_state.custom_profile_status[bl_angle_idx].outOfPoints, std::memory_order_relaxed);
 }
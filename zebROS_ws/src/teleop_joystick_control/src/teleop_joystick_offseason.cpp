@@ -387,26 +387,15 @@ void jointStateCallback(const sensor_msgs::JointState &joint_state)
 
 void talonStateCallback(const talon_state_controller::TalonState &talon_state)
 {
-	static size_t arm_joint_idx = std::numeric_limits<size_t>::max();
-        static size_t bl_drive_idx = std::numeric_limits<size_t>::max();
-
-	if (arm_joint_idx >= talon_state.name.size())
-	{
-		for (size_t i = 0; i < talon_state.name.size(); i++)
-		{
-			if (talon_state.name[i] == "arm_joint")
-			{
-				arm_joint_idx = i;
-			}
-			if (talon_state.name[i] == "bl_drive")
-			{
-				bl_drive_idx = i;
-			}
-		}
-	}
-
-        outOfPoints.store(talon_state.custom_profile_status[bl_drive_idx].outOfPoints, std::memory_order_relaxed);
-        arm_position.store(talon_state.position[arm_joint_idx], std::memory_order_relaxed);
+	static talon_state_controller::TalonStateIndex talon_index({"arm_joint", "bl_drive"});
+
+	talon_index.update(talon_state);
+	const auto profile_status = talon_index.column(talon_state.custom_profile_status);
+	if (profile_status.valid(1))
+		outOfPoints.store(profile_status[1].outOfPoints, std::memory_order_relaxed);
+	const auto position = talon_index.column(talon_state.position);
+	if (position.valid(0))
+		arm_position.store(position[0], std::memory_order_relaxed);
 }
 
 void most_recent_command_cb(const std_msgs::Float64 &msg)